@@ -666,6 +666,7 @@ void Configuration::ParserSettings::read(QSettings &conf)
         nodesc.append("#=It is pitch black...");
         nodesc.append("#=You just see a dense fog around you...");
     }
+    emit ConfigObserver::get().sig_configChanged(typeid(Configuration::ParserSettings));
 }
 
 void Configuration::MumeClientProtocolSettings::read(QSettings &conf)
@@ -137,9 +137,19 @@ class NODISCARD Configuration final
         QString roomDescColor; // ANSI room descriptions color
         bool removeXmlTags = false;
         char prefixChar = '_';
-        QStringList noDescriptionPatternsList;
+
+        NODISCARD const QStringList &getNoDescriptionPatternsList() const
+        {
+            return noDescriptionPatternsList;
+        }
+        void setNoDescriptionPatternsList(const QStringList &patterns)
+        {
+            noDescriptionPatternsList = patterns;
+            emit ConfigObserver::get().sig_configChanged(typeid(Configuration::ParserSettings));
+        }
 
     private:
+        QStringList noDescriptionPatternsList;
         SUBGROUP();
     } parser;
 
@@ -190,6 +200,8 @@ class NODISCARD Configuration final
         float doorNameScaleCutoff = 0.4f;
         float infomarkScaleCutoff = 0.25f;
         float extraDetailScaleCutoff = 0.15f;
+        // below this, each layer is drawn from its overview tiles (one texel per room)
+        float overviewScaleCutoff = 0.1f;
 
         MMapper::Array<int, 3> mapRadius{100, 100, 100};
         RestrictMapEnum useRestrictedMap = RestrictMapEnum::OnlyInMapMode;
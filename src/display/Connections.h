@@ -45,8 +45,6 @@ struct NODISCARD RoomNameBatch final
     NODISCARD UniqueMesh getMesh(GLFont &font);
 };
 
-using BatchedRoomNames = std::unordered_map<int, UniqueMesh>;
-
 struct NODISCARD ConnectionDrawerColorBuffer final
 {
     std::vector<ColorVert> lineVerts;
@@ -237,4 +235,3 @@ struct NODISCARD ConnectionDrawer final
 };
 
 using BatchedConnections = std::unordered_map<int, ConnectionDrawerBuffers>;
-using BatchedConnectionMeshes = std::unordered_map<int, ConnectionMeshes>;
@@ -0,0 +1,270 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2023 The MMapper Authors
+
+#include "FrameProfiler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iomanip>
+
+#include "../opengl/OpenGL.h"
+
+const char *getName(const CpuPhaseEnum phase)
+{
+#define X_CASE(UPPER_CASE, name) \
+    do { \
+    case CpuPhaseEnum::UPPER_CASE: \
+        return name; \
+    } while (false);
+    switch (phase) {
+        X_FOREACH_CPU_PHASE(X_CASE)
+    }
+    return "";
+#undef X_CASE
+}
+
+const char *getName(const RenderPassEnum pass)
+{
+#define X_CASE(UPPER_CASE, name) \
+    do { \
+    case RenderPassEnum::UPPER_CASE: \
+        return name; \
+    } while (false);
+    switch (pass) {
+        X_FOREACH_RENDER_PASS(X_CASE)
+    }
+    return "";
+#undef X_CASE
+}
+
+NODISCARD static double toMilliseconds(const FrameProfiler::Clock::duration delta)
+{
+    return std::chrono::duration<double, std::milli>(delta).count();
+}
+
+void FrameProfiler::beginFrame(OpenGL &gl)
+{
+    assert(!isInFrame());
+    m_canMeasureGpuTime = gl.canMeasureGpuTime();
+    collectGpuTimers(gl);
+
+    const auto now = Clock::now();
+    if (!m_epoch.has_value()) {
+        m_epoch = now;
+    }
+    m_frameStart = now;
+    ++m_frame;
+
+    if (m_canMeasureGpuTime) {
+        m_gpuFrames[m_frame].startMs = toMs(now);
+    }
+}
+
+void FrameProfiler::endFrame()
+{
+    assert(isInFrame());
+    assert(!m_passActive);
+
+    const auto start = m_frameStart.value();
+    const double totalMs = toMilliseconds(Clock::now() - start);
+    m_cpuFrame.add(totalMs);
+    addEvent(Event{m_frame, TrackEnum::CPU, "frame", std::nullopt, toMs(start), totalMs});
+
+    if (const auto it = m_gpuFrames.find(m_frame); it != m_gpuFrames.end()) {
+        it->second.ended = true;
+        finishGpuFrames();
+    }
+    m_frameStart.reset();
+}
+
+void FrameProfiler::addCpuPhase(const CpuPhaseEnum phase,
+                                const Clock::time_point begin,
+                                const Clock::time_point end)
+{
+    assert(isInFrame());
+    const double durationMs = toMilliseconds(end - begin);
+    m_cpuPhases.at(static_cast<size_t>(phase)).add(durationMs);
+    addEvent(Event{m_frame, TrackEnum::CPU, getName(phase), std::nullopt, toMs(begin), durationMs});
+}
+
+FrameProfiler::PassScope::PassScope(FrameProfiler &profiler,
+                                    OpenGL &gl,
+                                    const RenderPassEnum pass,
+                                    const std::optional<int> layer)
+    : m_profiler{profiler}
+    , m_gl{gl}
+    , m_timing{profiler.beginPass(gl, pass, layer)}
+{}
+
+FrameProfiler::PassScope::~PassScope()
+{
+    if (m_timing) {
+        m_profiler.endPass(m_gl);
+    }
+}
+
+bool FrameProfiler::beginPass(OpenGL &gl,
+                              const RenderPassEnum pass,
+                              const std::optional<int> layer)
+{
+    if (!isInFrame() || !m_canMeasureGpuTime) {
+        return false;
+    }
+    assert(!m_passActive);
+
+    GpuFrame &frame = m_gpuFrames[m_frame];
+    const uint32_t tag = m_nextTag++;
+    if (!gl.beginGpuTimer(tag)) {
+        // every query is still waiting for the GPU
+        ++m_droppedTimers;
+        frame.incomplete = true;
+        return false;
+    }
+
+    m_pending.emplace_back(PendingPass{tag, m_frame, pass, layer});
+    ++frame.outstanding;
+    m_passActive = true;
+    return true;
+}
+
+void FrameProfiler::endPass(OpenGL &gl)
+{
+    assert(m_passActive);
+    gl.endGpuTimer();
+    m_passActive = false;
+}
+
+void FrameProfiler::collectGpuTimers(OpenGL &gl)
+{
+    if (m_pending.empty()) {
+        return;
+    }
+
+    m_results.clear();
+    gl.collectGpuTimers(m_results);
+    for (const GpuTimerResult &result : m_results) {
+        if (m_pending.empty() || m_pending.front().tag != result.tag) {
+            assert(false);
+            continue;
+        }
+        const PendingPass pending = m_pending.front();
+        m_pending.pop_front();
+
+        const auto it = m_gpuFrames.find(pending.frame);
+        if (it == m_gpuFrames.end()) {
+            continue;
+        }
+        GpuFrame &frame = it->second;
+        const double ms = static_cast<double>(result.nanoseconds) * 1e-6;
+        addEvent(Event{pending.frame,
+                       TrackEnum::GPU,
+                       getName(pending.pass),
+                       pending.layer,
+                       frame.startMs + frame.totalMs,
+                       ms});
+
+        frame.totalMs += ms;
+        auto &passMs = frame.passMs.at(static_cast<size_t>(pending.pass));
+        passMs = passMs.value_or(0.0) + ms;
+        if (pending.layer.has_value()) {
+            frame.layerMs[pending.layer.value()] += ms;
+        }
+        assert(frame.outstanding > 0);
+        --frame.outstanding;
+    }
+    finishGpuFrames();
+}
+
+void FrameProfiler::finishGpuFrames()
+{
+    // The GPU finishes frames in order.
+    while (!m_gpuFrames.empty()) {
+        const auto it = m_gpuFrames.begin();
+        const GpuFrame &frame = it->second;
+        if (!frame.ended || frame.outstanding != 0) {
+            break;
+        }
+
+        // A frame with a dropped timer would look faster than it was.
+        const bool timedAnything = std::any_of(frame.passMs.begin(),
+                                               frame.passMs.end(),
+                                               [](const auto &ms) { return ms.has_value(); });
+        if (!frame.incomplete && timedAnything) {
+            m_gpuFrame.add(frame.totalMs);
+            for (size_t i = 0; i < NUM_RENDER_PASSES; ++i) {
+                if (const auto &ms = frame.passMs[i]) {
+                    m_gpuPasses[i].add(ms.value());
+                }
+            }
+            for (const auto &[layer, ms] : frame.layerMs) {
+                m_gpuLayers.try_emplace(layer, HISTORY).first->second.add(ms);
+            }
+        }
+        m_gpuFrames.erase(it);
+    }
+}
+
+void FrameProfiler::resetGpuTimers()
+{
+    m_pending.clear();
+    m_gpuFrames.clear();
+    m_passActive = false;
+}
+
+double FrameProfiler::toMs(const Clock::time_point t) const
+{
+    return toMilliseconds(t - m_epoch.value());
+}
+
+void FrameProfiler::addEvent(const Event &event)
+{
+    if (m_events.size() == MAX_EVENTS) {
+        m_events.pop_front();
+    }
+    m_events.emplace_back(event);
+}
+
+void FrameProfiler::writeCsv(std::ostream &os) const
+{
+    os << "frame,track,name,layer,start_ms,duration_ms\n";
+    os << std::fixed << std::setprecision(4);
+    for (const Event &event : m_events) {
+        os << event.frame << ',' << (event.track == TrackEnum::CPU ? "cpu" : "gpu") << ','
+           << event.name << ',';
+        if (event.layer.has_value()) {
+            os << event.layer.value();
+        }
+        os << ',' << event.startMs << ',' << event.durationMs << '\n';
+    }
+}
+
+void FrameProfiler::writeChromeTrace(std::ostream &os) const
+{
+    static constexpr const int CPU_TID = 1;
+    static constexpr const int GPU_TID = 2;
+
+    const auto nameThread = [&os](const int tid, const char *const name) {
+        os << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+           << ",\"args\":{\"name\":\"" << name << "\"}}";
+    };
+
+    os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    nameThread(CPU_TID, "CPU");
+    os << ",\n";
+    nameThread(GPU_TID, "GPU (passes laid end to end)");
+
+    // timestamps and durations are in microseconds
+    os << std::fixed << std::setprecision(1);
+    for (const Event &event : m_events) {
+        const bool isCpu = event.track == TrackEnum::CPU;
+        os << ",\n{\"name\":\"" << event.name << "\",\"cat\":\"" << (isCpu ? "cpu" : "gpu")
+           << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << (isCpu ? CPU_TID : GPU_TID)
+           << ",\"ts\":" << event.startMs * 1e3 << ",\"dur\":" << event.durationMs * 1e3
+           << ",\"args\":{\"frame\":" << event.frame;
+        if (event.layer.has_value()) {
+            os << ",\"layer\":" << event.layer.value();
+        }
+        os << "}}";
+    }
+    os << "\n]}\n";
+}
@@ -0,0 +1,189 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2023 The MMapper Authors
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <optional>
+#include <ostream>
+#include <vector>
+
+#include "../global/RollingHistogram.h"
+#include "../global/RuleOf5.h"
+#include "../opengl/OpenGLTypes.h"
+
+class OpenGL;
+
+// X(UPPER_CASE, "name")
+#define X_FOREACH_CPU_PHASE(X) \
+    X(UPDATE_TEXTURES, "updateTextures") \
+    X(UPDATE_BATCHES, "updateBatches") \
+    X(PAINT, "paintGL") \
+    /* define cpu phases above */
+
+// X(UPPER_CASE, "name")
+#define X_FOREACH_RENDER_PASS(X) \
+    X(TERRAIN, "terrain") \
+    X(CONNECTIONS, "connections") \
+    X(ROOM_NAMES, "room names") \
+    X(INFOMARKS, "infomarks") \
+    X(SELECTIONS, "selections") \
+    X(CHARACTERS, "characters") \
+    /* define render passes above */
+
+enum class NODISCARD CpuPhaseEnum : uint8_t {
+#define X_DECL_CPU_PHASE(UPPER_CASE, name) UPPER_CASE,
+    X_FOREACH_CPU_PHASE(X_DECL_CPU_PHASE)
+#undef X_DECL_CPU_PHASE
+};
+
+enum class NODISCARD RenderPassEnum : uint8_t {
+#define X_DECL_RENDER_PASS(UPPER_CASE, name) UPPER_CASE,
+    X_FOREACH_RENDER_PASS(X_DECL_RENDER_PASS)
+#undef X_DECL_RENDER_PASS
+};
+
+#define X_COUNT(UPPER_CASE, name) +1
+static constexpr const size_t NUM_CPU_PHASES = X_FOREACH_CPU_PHASE(X_COUNT);
+static constexpr const size_t NUM_RENDER_PASSES = X_FOREACH_RENDER_PASS(X_COUNT);
+#undef X_COUNT
+
+NODISCARD extern const char *getName(CpuPhaseEnum phase);
+NODISCARD extern const char *getName(RenderPassEnum pass);
+
+/// Frame times of the map canvas, for the performance stats overlay and for
+/// exporting to a file that can be sent in with a bug report.
+///
+/// CPU phases are timed with a steady clock. Render passes are timed on the GPU
+/// with asynchronous timer queries; their results are collected a few frames
+/// later, so nothing ever waits for the GPU to finish.
+///
+/// Everything keeps a rolling window of the last HISTORY frames.
+class NODISCARD FrameProfiler final
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    static constexpr const size_t HISTORY = 600;
+    static constexpr const size_t MAX_EVENTS = 16384;
+
+    enum class NODISCARD TrackEnum : uint8_t { CPU, GPU };
+
+    struct NODISCARD Event final
+    {
+        uint64_t frame = 0;
+        TrackEnum track = TrackEnum::CPU;
+        const char *name = "";
+        std::optional<int> layer;
+        // relative to the first profiled frame; GPU passes are laid end to end
+        // from the start of their frame, since timer queries only measure durations.
+        double startMs = 0.0;
+        double durationMs = 0.0;
+    };
+
+private:
+    struct NODISCARD PendingPass final
+    {
+        uint32_t tag = 0;
+        uint64_t frame = 0;
+        RenderPassEnum pass = RenderPassEnum::TERRAIN;
+        std::optional<int> layer;
+    };
+
+    struct NODISCARD GpuFrame final
+    {
+        double startMs = 0.0;
+        double totalMs = 0.0;
+        std::array<std::optional<double>, NUM_RENDER_PASSES> passMs;
+        std::map<int, double> layerMs;
+        size_t outstanding = 0;
+        bool ended = false;
+        bool incomplete = false;
+    };
+
+    std::optional<Clock::time_point> m_epoch;
+    std::optional<Clock::time_point> m_frameStart;
+    uint64_t m_frame = 0;
+    bool m_passActive = false;
+    uint32_t m_nextTag = 0;
+    size_t m_droppedTimers = 0;
+    bool m_canMeasureGpuTime = false;
+
+    std::deque<PendingPass> m_pending;
+    std::map<uint64_t, GpuFrame> m_gpuFrames;
+    std::vector<GpuTimerResult> m_results;
+    std::deque<Event> m_events;
+
+    RollingHistogram m_cpuFrame{HISTORY};
+    std::vector<RollingHistogram> m_cpuPhases
+        = std::vector<RollingHistogram>(NUM_CPU_PHASES, RollingHistogram{HISTORY});
+    RollingHistogram m_gpuFrame{HISTORY};
+    std::vector<RollingHistogram> m_gpuPasses
+        = std::vector<RollingHistogram>(NUM_RENDER_PASSES, RollingHistogram{HISTORY});
+    std::map<int, RollingHistogram> m_gpuLayers;
+
+public:
+    FrameProfiler() = default;
+    DELETE_CTORS_AND_ASSIGN_OPS(FrameProfiler);
+
+public:
+    /// Collects the GPU timers that have finished since the last frame.
+    void beginFrame(OpenGL &gl);
+    void endFrame();
+    NODISCARD bool isInFrame() const { return m_frameStart.has_value(); }
+
+    void addCpuPhase(CpuPhaseEnum phase, Clock::time_point begin, Clock::time_point end);
+
+    /// Times a render pass on the GPU; does nothing outside of beginFrame() / endFrame().
+    class NODISCARD PassScope final
+    {
+    private:
+        FrameProfiler &m_profiler;
+        OpenGL &m_gl;
+        bool m_timing = false;
+
+    public:
+        explicit PassScope(FrameProfiler &profiler,
+                           OpenGL &gl,
+                           RenderPassEnum pass,
+                           std::optional<int> layer = std::nullopt);
+        ~PassScope();
+        DELETE_CTORS_AND_ASSIGN_OPS(PassScope);
+    };
+
+    /// Forgets the timers in flight; call this before the GL context goes away.
+    void resetGpuTimers();
+
+public:
+    NODISCARD bool canMeasureGpuTime() const { return m_canMeasureGpuTime; }
+    NODISCARD size_t getDroppedTimers() const { return m_droppedTimers; }
+    NODISCARD const RollingHistogram &getCpuFrame() const { return m_cpuFrame; }
+    NODISCARD const RollingHistogram &getCpuPhase(const CpuPhaseEnum phase) const
+    {
+        return m_cpuPhases.at(static_cast<size_t>(phase));
+    }
+    NODISCARD const RollingHistogram &getGpuFrame() const { return m_gpuFrame; }
+    NODISCARD const RollingHistogram &getGpuPass(const RenderPassEnum pass) const
+    {
+        return m_gpuPasses.at(static_cast<size_t>(pass));
+    }
+    NODISCARD const std::map<int, RollingHistogram> &getGpuLayers() const { return m_gpuLayers; }
+    NODISCARD bool hasEvents() const { return !m_events.empty(); }
+
+public:
+    /// One row per recorded event.
+    void writeCsv(std::ostream &os) const;
+    /// The Trace Event Format used by chrome://tracing and https://ui.perfetto.dev
+    void writeChromeTrace(std::ostream &os) const;
+
+private:
+    NODISCARD bool beginPass(OpenGL &gl, RenderPassEnum pass, std::optional<int> layer);
+    void endPass(OpenGL &gl);
+    void collectGpuTimers(OpenGL &gl);
+    void finishGpuFrames();
+    NODISCARD double toMs(Clock::time_point t) const;
+    void addEvent(const Event &event);
+};
@@ -60,9 +60,6 @@ struct NODISCARD LayerMeshes final
     explicit operator bool() const { return isValid; }
 };
 
-// This must be ordered so we can iterate over the layers from lowest to highest.
-using BatchedMeshes = std::map<int, LayerMeshes>;
-
 struct NODISCARD ScaleFactor final
 {
 public:
@@ -4,16 +4,23 @@
 
 #include "MapCanvasRoomDrawer.h"
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <climits>
 #include <cstdlib>
+#include <future>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <map>
 #include <optional>
 #include <set>
 #include <stdexcept>
 #include <vector>
 #include <QColor>
 #include <QMessageLogContext>
+#include <QRunnable>
+#include <QThreadPool>
 #include <QtGui/qopengl.h>
 #include <QtGui>
 
@@ -37,6 +44,7 @@
 #include "../mapdata/mapdata.h"
 #include "../mapdata/mmapper2room.h"
 #include "../opengl/FontFormatFlags.h"
+#include "../opengl/Frustum.h"
 #include "../opengl/OpenGL.h"
 #include "../opengl/OpenGLTypes.h"
 #include "ConnectionLineBuilder.h"
@@ -113,31 +121,6 @@ NODISCARD static XNamedColor getVerticalNamedColor(const ExitFlags &flags)
     return getWallNamedColorCommon(flags, WallOrientationEnum::VERTICAL);
 }
 
-// All layers
-static void generateAllLayerMeshes(MapBatches &batches,
-                                   OpenGL &gl,
-                                   GLFont &font,
-                                   const LayerToRooms &layerToRooms,
-                                   const RoomIndex &roomIndex,
-                                   const MapCanvasTextures &textures,
-                                   const OptBounds &bounds);
-
-void MapCanvasRoomDrawer::generateBatches(const LayerToRooms &layerToRooms,
-                                          const RoomIndex &roomIndex,
-                                          const OptBounds &bounds)
-{
-    m_batches.reset();   // dtor, if necessary
-    m_batches.emplace(); // ctor
-
-    generateAllLayerMeshes(m_batches.value(),
-                           getOpenGL(),
-                           getFont(),
-                           layerToRooms,
-                           roomIndex,
-                           m_textures,
-                           bounds);
-}
-
 struct NODISCARD TerrainAndTrail
 {
     MMTexture *terrain = nullptr;
@@ -417,7 +400,10 @@ struct NODISCARD RoomTex
     }
 
     NODISCARD int priority() const { return deref(tex).getPriority(); }
-    NODISCARD GLuint textureId() const { return deref(tex).textureId(); }
+    // rooms whose textures are layers of the same array texture share a batch
+    NODISCARD MMTexture *batchTexture() const { return deref(tex).getBatchTexture(); }
+    NODISCARD int batchLayer() const { return deref(tex).getBatchLayer(); }
+    NODISCARD GLuint textureId() const { return deref(batchTexture()).textureId(); }
 
     friend bool operator<(const RoomTex &lhs, const RoomTex &rhs)
     {
@@ -528,100 +514,154 @@ static void foreach_texture(const T &textures, Callback &&callback)
     }
 }
 
-NODISCARD static UniqueMeshVector createSortedTexturedMeshes(OpenGL &gl,
-                                                             const RoomTexVector &textures)
+// The rooms of a batch all belong to the same chunk, so their offsets always fit.
+NODISCARD static int16_t toQuadOffset(const int offset)
 {
-    if (textures.empty())
-        return UniqueMeshVector{};
+    assert(isClamped(offset, -CHUNK_SIZE, CHUNK_SIZE));
+    return static_cast<int16_t>(offset);
+}
 
-    const size_t numUniqueTextures = [&textures]() -> size_t {
-        size_t texCount = 0;
-        ::foreach_texture(textures,
-                          [&texCount](size_t /* beg */, size_t /*end*/) -> void { ++texCount; });
-        return texCount;
-    }();
+template<typename T, typename GetColor>
+NODISCARD static std::vector<QuadInstanceBatch> createSortedQuadBatches(const T &textures,
+                                                                        GetColor &&getColor)
+{
+    std::vector<QuadInstanceBatch> result;
+    if (textures.empty())
+        return result;
 
-    std::vector<UniqueMesh> result_meshes;
-    result_meshes.reserve(numUniqueTextures);
-    const auto lambda = [&gl, &result_meshes, &textures](const size_t beg,
-                                                         const size_t end) -> void {
+    const auto lambda = [&result, &textures, &getColor](const size_t beg,
+                                                        const size_t end) -> void {
         const RoomTex &rtex = textures[beg];
         const size_t count = end - beg;
 
-        std::vector<TexVert> verts;
-        verts.reserve(count * VERTS_PER_QUAD); /* quads */
+        auto &batch = result.emplace_back();
+        batch.texture = rtex.batchTexture();
+        batch.origin = rtex.room->getPosition().to_ivec3();
+        std::vector<QuadInstance> &instances = batch.instances;
+        instances.reserve(count);
 
-        // D-C
-        // | |  ccw winding
-        // A-B
         for (size_t i = beg; i < end; ++i) {
-            const auto &pos = textures[i].room->getPosition();
-            const auto v0 = pos.to_vec3();
-#define EMIT(x, y) verts.emplace_back(glm::vec2((x), (y)), v0 + glm::vec3((x), (y), 0))
-            EMIT(0, 0);
-            EMIT(1, 0);
-            EMIT(1, 1);
-            EMIT(0, 1);
-#undef EMIT
+            const auto &thisVert = textures[i];
+            const glm::ivec3 offset = thisVert.room->getPosition().to_ivec3() - batch.origin;
+            instances.emplace_back(toQuadOffset(offset.x),
+                                   toQuadOffset(offset.y),
+                                   toQuadOffset(offset.z),
+                                   static_cast<int16_t>(thisVert.batchLayer()),
+                                   getColor(thisVert));
         }
-
-        result_meshes.emplace_back(gl.createTexturedQuadBatch(verts, rtex.tex->getShared()));
     };
 
     ::foreach_texture(textures, lambda);
-    assert(result_meshes.size() == numUniqueTextures);
-    return UniqueMeshVector{std::move(result_meshes)};
+    return result;
 }
 
-NODISCARD static UniqueMeshVector createSortedColoredTexturedMeshes(
-    OpenGL &gl, const ColoredRoomTexVector &textures)
+NODISCARD static LayerMeshesIntermediate::TexturedBatches createSortedTexturedBatches(
+    const RoomTexVector &textures)
 {
-    if (textures.empty())
-        return UniqueMeshVector{};
-
-    const size_t numUniqueTextures = [&textures]() -> size_t {
-        size_t texCount = 0;
-        ::foreach_texture(textures,
-                          [&texCount](size_t /* beg */, size_t /*end*/) -> void { ++texCount; });
-        return texCount;
-    }();
-
-    std::vector<UniqueMesh> result_meshes;
-    result_meshes.reserve(numUniqueTextures);
+    // the color comes from the uniform
+    return ::createSortedQuadBatches(textures, [](const RoomTex &) -> Color { return Color{}; });
+}
 
-    const auto lambda = [&gl, &result_meshes, &textures](const size_t beg,
-                                                         const size_t end) -> void {
-        const RoomTex &rtex = textures[beg];
-        const size_t count = end - beg;
+NODISCARD static LayerMeshesIntermediate::ColoredTexturedBatches
+createSortedColoredTexturedBatches(const ColoredRoomTexVector &textures)
+{
+    return ::createSortedQuadBatches(textures, [](const ColoredRoomTex &rtex) -> Color {
+        return rtex.color;
+    });
+}
 
-        std::vector<ColoredTexVert> verts;
-        verts.reserve(count * VERTS_PER_QUAD); /* quads */
+// Expands the instances to four vertices each, for when they can't be drawn instanced.
+template<typename Callback>
+static void foreach_quad_vertex(const QuadInstanceBatch &batch, Callback &&callback)
+{
+    const glm::vec3 origin{batch.origin};
+    for (const QuadInstance &quad : batch.instances) {
+        const glm::vec3 v0 = origin + glm::vec3{quad.x, quad.y, quad.z};
+        const auto layer = static_cast<float>(quad.layer);
 
         // D-C
         // | |  ccw winding
         // A-B
-        for (size_t i = beg; i < end; ++i) {
-            const ColoredRoomTex &thisVert = textures[i];
-            const auto &pos = thisVert.room->getPosition();
-            const auto v0 = pos.to_vec3();
-            const auto color = thisVert.color;
-
-#define EMIT(x, y) verts.emplace_back(color, glm::vec2((x), (y)), v0 + glm::vec3((x), (y), 0))
-            EMIT(0, 0);
-            EMIT(1, 0);
-            EMIT(1, 1);
-            EMIT(0, 1);
+#define EMIT(x, y) callback(quad, glm::vec3((x), (y), layer), v0 + glm::vec3((x), (y), 0))
+        EMIT(0, 0);
+        EMIT(1, 0);
+        EMIT(1, 1);
+        EMIT(0, 1);
 #undef EMIT
+    }
+}
+
+NODISCARD static UniqueMeshVector createTexturedMeshes(
+    OpenGL &gl, const LayerMeshesIntermediate::TexturedBatches &batches)
+{
+    const bool instanced = gl.canRenderInstancedQuads();
+    std::vector<UniqueMesh> result_meshes;
+    result_meshes.reserve(batches.size());
+    for (const auto &batch : batches) {
+        const SharedMMTexture texture = deref(batch.texture).getShared();
+        if (instanced && texture->isArray()) {
+            result_meshes.emplace_back(
+                gl.createInstancedQuadBatch(glm::vec3{batch.origin}, batch.instances, texture));
+            continue;
         }
 
-        result_meshes.emplace_back(gl.createColoredTexturedQuadBatch(verts, rtex.tex->getShared()));
-    };
+        std::vector<ArrayTexVert> verts;
+        verts.reserve(batch.instances.size() * VERTS_PER_QUAD);
+        ::foreach_quad_vertex(batch,
+                              [&verts](const QuadInstance &,
+                                       const glm::vec3 &tex,
+                                       const glm::vec3 &vert) { verts.emplace_back(tex, vert); });
+        result_meshes.emplace_back(gl.createTexturedQuadBatch(verts, texture));
+    }
+    return UniqueMeshVector{std::move(result_meshes)};
+}
 
-    ::foreach_texture(textures, lambda);
-    assert(result_meshes.size() == numUniqueTextures);
+NODISCARD static UniqueMeshVector createColoredTexturedMeshes(
+    OpenGL &gl, const LayerMeshesIntermediate::ColoredTexturedBatches &batches)
+{
+    const bool instanced = gl.canRenderInstancedQuads();
+    std::vector<UniqueMesh> result_meshes;
+    result_meshes.reserve(batches.size());
+    for (const auto &batch : batches) {
+        const SharedMMTexture texture = deref(batch.texture).getShared();
+        if (instanced && texture->isArray()) {
+            result_meshes.emplace_back(
+                gl.createInstancedQuadBatch(glm::vec3{batch.origin}, batch.instances, texture));
+            continue;
+        }
+
+        std::vector<ColoredArrayTexVert> verts;
+        verts.reserve(batch.instances.size() * VERTS_PER_QUAD);
+        ::foreach_quad_vertex(batch,
+                              [&verts](const QuadInstance &quad,
+                                       const glm::vec3 &tex,
+                                       const glm::vec3 &vert) {
+                                  verts.emplace_back(quad.color, tex, vert);
+                              });
+        result_meshes.emplace_back(gl.createColoredTexturedQuadBatch(verts, texture));
+    }
     return UniqueMeshVector{std::move(result_meshes)};
 }
 
+LayerMeshes LayerMeshesIntermediate::getLayerMeshes(OpenGL &gl) const
+{
+    LayerMeshes meshes;
+    meshes.terrain = ::createTexturedMeshes(gl, terrain);
+    for (const RoomTintEnum tint : ALL_ROOM_TINTS) {
+        meshes.tints[tint] = gl.createPlainQuadBatch(tints[tint]);
+    }
+    meshes.overlays = ::createTexturedMeshes(gl, overlays);
+    meshes.doors = ::createColoredTexturedMeshes(gl, doors);
+    meshes.walls = ::createColoredTexturedMeshes(gl, walls);
+    meshes.dottedWalls = ::createColoredTexturedMeshes(gl, dottedWalls);
+    meshes.upDownExits = ::createColoredTexturedMeshes(gl, upDownExits);
+    meshes.streamIns = ::createColoredTexturedMeshes(gl, streamIns);
+    meshes.streamOuts = ::createColoredTexturedMeshes(gl, streamOuts);
+    meshes.layerBoost = gl.createPlainQuadBatch(layerBoost);
+    meshes.isValid = true;
+    return meshes;
+}
+
 struct NODISCARD LayerBatchMeasurements final
 {
     size_t numTerrains = 0;
@@ -779,7 +819,8 @@ struct NODISCARD LayerBatchData final
 
     void sort()
     {
-        /* TODO: Only sort on 2.1 path, since 3.0 can use GL_TEXTURE_2D_ARRAY. */
+        // With array textures, each category is a single batch, but the sort
+        // still decides the order the rooms are drawn in.
         roomTerrains.sortByTexture();
         roomOverlays.sortByTexture();
 
@@ -794,22 +835,22 @@ struct NODISCARD LayerBatchData final
         streamOuts.sortByTexture();
     }
 
-    NODISCARD LayerMeshes getMeshes(OpenGL &gl)
+    // Moves the vertices out of the rooms, so they're no longer needed afterwards.
+    NODISCARD LayerMeshesIntermediate getIntermediate()
     {
-        LayerMeshes meshes;
-        meshes.terrain = ::createSortedTexturedMeshes(gl, roomTerrains);
+        LayerMeshesIntermediate meshes;
+        meshes.terrain = ::createSortedTexturedBatches(roomTerrains);
         for (const RoomTintEnum tint : ALL_ROOM_TINTS) {
-            meshes.tints[tint] = gl.createPlainQuadBatch(roomTints[tint]);
+            meshes.tints[tint] = std::move(roomTints[tint]);
         }
-        meshes.overlays = ::createSortedTexturedMeshes(gl, roomOverlays);
-        meshes.doors = ::createSortedColoredTexturedMeshes(gl, doors);
-        meshes.walls = ::createSortedColoredTexturedMeshes(gl, solidWallLines);
-        meshes.dottedWalls = ::createSortedColoredTexturedMeshes(gl, dottedWallLines);
-        meshes.upDownExits = ::createSortedColoredTexturedMeshes(gl, roomUpDownExits);
-        meshes.streamIns = ::createSortedColoredTexturedMeshes(gl, streamIns);
-        meshes.streamOuts = ::createSortedColoredTexturedMeshes(gl, streamOuts);
-        meshes.layerBoost = gl.createPlainQuadBatch(roomLayerBoostQuads);
-        meshes.isValid = true;
+        meshes.overlays = ::createSortedTexturedBatches(roomOverlays);
+        meshes.doors = ::createSortedColoredTexturedBatches(doors);
+        meshes.walls = ::createSortedColoredTexturedBatches(solidWallLines);
+        meshes.dottedWalls = ::createSortedColoredTexturedBatches(dottedWallLines);
+        meshes.upDownExits = ::createSortedColoredTexturedBatches(roomUpDownExits);
+        meshes.streamIns = ::createSortedColoredTexturedBatches(streamIns);
+        meshes.streamOuts = ::createSortedColoredTexturedBatches(streamOuts);
+        meshes.layerBoost = std::move(roomLayerBoostQuads);
         return meshes;
     }
 };
@@ -941,11 +982,10 @@ class NODISCARD LayerBatchBuilder final : public IRoomVisitorCallbacks
 
 LayerBatchBuilder::~LayerBatchBuilder() = default;
 
-NODISCARD static LayerMeshes generateLayerMeshes(OpenGL &gl,
-                                                 const RoomVector &rooms,
-                                                 const RoomIndex &roomIndex,
-                                                 const MapCanvasTextures &textures,
-                                                 const OptBounds &bounds)
+NODISCARD static LayerMeshesIntermediate generateLayerMeshes(const RoomVector &rooms,
+                                                             const RoomIndex &roomIndex,
+                                                             const MapCanvasTextures &textures,
+                                                             const OptBounds &bounds)
 {
     const LayerBatchMeasurements measurements =
         [&bounds, &rooms, &roomIndex, &textures]() -> LayerBatchMeasurements {
@@ -964,57 +1004,309 @@ NODISCARD static LayerMeshes generateLayerMeshes(OpenGL &gl,
     }
 
     data.sort();
-    return data.getMeshes(gl);
+    return data.getIntermediate();
 }
 
-static void generateAllLayerMeshes(MapBatches &batches,
-                                   OpenGL &gl,
-                                   GLFont &font,
-                                   const LayerToRooms &layerToRooms,
-                                   const RoomIndex &roomIndex,
-                                   const MapCanvasTextures &textures,
-                                   const OptBounds &bounds)
+ChunkId ChunkId::fromCoordinate(const Coordinate &c)
 {
-    auto &batchedMeshes = batches.batchedMeshes;
-    auto &connectionDrawerBuffers = batches.connectionDrawerBuffers;
-    auto &roomNameBatches = batches.roomNameBatches;
-    auto &connectionMeshes = batches.connectionMeshes;
+    // rounds towards negative infinity, unlike integer division
+    const auto chunkOf = [](const int n) -> int {
+        return (n >= 0) ? (n / CHUNK_SIZE) : -((-n - 1) / CHUNK_SIZE) - 1;
+    };
+    return ChunkId{c.z, ChunkPos{chunkOf(c.x), chunkOf(c.y)}};
+}
 
-    for (const auto &layer : layerToRooms) {
-        const int thisLayer = layer.first;
-        auto &layerMeshes = batchedMeshes[thisLayer];
-        auto &layerRoomNames = roomNameBatches[thisLayer];
-        auto &layerConnections = connectionMeshes[thisLayer];
-        auto &rooms = layer.second;
+// The terrain colors are the average colors of the terrain textures.
+QImage generateOverviewImage(const ChunkPos &pos,
+                             const RoomVector &rooms,
+                             const TerrainColors &terrainColors,
+                             const OptBounds &bounds)
+{
+    QImage image{CHUNK_SIZE, CHUNK_SIZE, QImage::Format_RGBA8888};
+    image.fill(Qt::transparent);
+
+    const int x0 = pos.first * CHUNK_SIZE;
+    const int y0 = pos.second * CHUNK_SIZE;
+    for (const Room *const room : rooms) {
+        const Coordinate &c = room->getPosition();
+        if (!bounds.contains(c)) {
+            continue;
+        }
+        const int x = c.x - x0;
+        const int y = c.y - y0;
+        assert(isClamped(x, 0, CHUNK_SIZE - 1) && isClamped(y, 0, CHUNK_SIZE - 1));
+        image.setPixelColor(x, y, terrainColors[room->getTerrainType()].getQColor());
+    }
+    return image;
+}
+
+// Connections can reach into other chunks and layers, so their vertices are included.
+NODISCARD static ChunkBox getChunkBox(const int layer,
+                                      const ChunkPos &pos,
+                                      const ConnectionDrawerBuffers &connections)
+{
+    // walls, doors and exit arrows stick out of their rooms a little
+    static constexpr const float MARGIN = 1.f;
+    const glm::vec3 lo{static_cast<float>(pos.first * CHUNK_SIZE),
+                       static_cast<float>(pos.second * CHUNK_SIZE),
+                       static_cast<float>(layer)};
+    const glm::vec3 size{static_cast<float>(CHUNK_SIZE), static_cast<float>(CHUNK_SIZE), 0.f};
+
+    ChunkBox box{lo - MARGIN, lo + size + MARGIN};
+    const auto include = [&box](const std::vector<ColorVert> &verts) {
+        for (const ColorVert &v : verts) {
+            box.lo = glm::min(box.lo, v.vert);
+            box.hi = glm::max(box.hi, v.vert);
+        }
+    };
+    for (const ConnectionDrawerColorBuffer *const buf : {&connections.normal, &connections.red}) {
+        include(buf->lineVerts);
+        include(buf->triVerts);
+    }
+    return box;
+}
+
+static void generateChunkBatches(ChunkBatchesIntermediate &batches,
+                                 const int thisLayer,
+                                 const ChunkPos &pos,
+                                 const RoomVector &rooms,
+                                 const RoomIndex &roomIndex,
+                                 const MapCanvasTextures &textures,
+                                 const OptBounds &bounds)
+{
+    batches.meshes = ::generateLayerMeshes(rooms, roomIndex, textures, bounds);
+    batches.overview = ::generateOverviewImage(pos, rooms, textures.terrain_colors, bounds);
+
+    auto &cdb = batches.connections;
+    auto &rnb = batches.roomNames;
+    ConnectionDrawer cd{cdb, rnb, thisLayer, bounds};
+    {
+        // pass 1: measurements
+        for (const auto &room : rooms) {
+            cd.drawRoomConnectionsAndDoors(room, roomIndex);
+        }
+        cd.endMeasurements();
+
+        // pass 2: add to buffers
+        for (const auto &room : rooms) {
+            cd.drawRoomConnectionsAndDoors(room, roomIndex);
+        }
+        cd.verify();
+    }
 
-        layerMeshes = ::generateLayerMeshes(gl, rooms, roomIndex, textures, bounds);
+    batches.box = ::getChunkBox(thisLayer, pos, cdb);
+}
+
+// Runs on a worker thread, so it must not touch the GL context.
+static void generateLayerBatches(LayerChunkBatches &batches,
+                                 const int thisLayer,
+                                 const RoomVector &rooms,
+                                 const std::optional<ChunkIdSet> &chunks,
+                                 const RoomIndex &roomIndex,
+                                 const MapCanvasTextures &textures,
+                                 const OptBounds &bounds)
+{
+    std::map<ChunkPos, RoomVector> chunkToRooms;
+    for (const Room *const room : rooms) {
+        const ChunkId id = ChunkId::fromCoordinate(room->getPosition());
+        if (!chunks || chunks->count(id) != 0) {
+            chunkToRooms[id.pos].emplace_back(room);
+        }
+    }
 
+    for (const auto &kv : chunkToRooms) {
+        ChunkBatchesIntermediate &chunk = batches[kv.first];
+        ::generateChunkBatches(chunk, thisLayer, kv.first, kv.second, roomIndex, textures, bounds);
+    }
+}
+
+// Layers are queued on the shared thread pool, so a map with many layers doesn't
+// start a thread for each one.
+NODISCARD static std::shared_future<void> runOnThreadPool(std::packaged_task<void()> task)
+{
+    class NODISCARD TaskRunnable final : public QRunnable
+    {
+    private:
+        std::packaged_task<void()> m_task;
+
+    public:
+        explicit TaskRunnable(std::packaged_task<void()> task)
+            : m_task(std::move(task))
         {
-            auto &cdb = connectionDrawerBuffers[thisLayer];
-            cdb.clear();
+            setAutoDelete(true);
+        }
 
-            const auto currentLayer = thisLayer;
+    private:
+        void run() final { m_task(); }
+    };
 
-            RoomNameBatch rnb;
-            ConnectionDrawer cd{cdb, rnb, currentLayer, bounds};
-            {
-                // pass 1: measurements
-                for (const auto &room : rooms) {
-                    cd.drawRoomConnectionsAndDoors(room, roomIndex);
-                }
-                cd.endMeasurements();
+    std::shared_future<void> future = task.get_future().share();
+    QThreadPool::globalInstance()->start(new TaskRunnable(std::move(task)));
+    return future;
+}
 
-                // pass 2: add to buffers
-                for (const auto &room : rooms) {
-                    cd.drawRoomConnectionsAndDoors(room, roomIndex);
-                }
-                cd.verify();
+std::vector<std::shared_future<void>> MapCanvasRoomDrawer::generateBatches(
+    LayerToRooms layerToRooms, const RoomIndex &roomIndex, const OptBounds &bounds)
+{
+    m_pendingBatches.reset(); // dtor, if necessary
+    m_pendingBatches.emplace();
+    PendingMapBatches &pending = m_pendingBatches.value();
+    pending.chunks = m_chunks;
+    pending.bounds = bounds;
+
+    const auto hasChunksInLayer = [this](const int layer) -> bool {
+        if (!m_chunks) {
+            return true;
+        }
+        const auto it = m_chunks->lower_bound(ChunkId{layer, ChunkPos{INT_MIN, INT_MIN}});
+        return it != m_chunks->end() && it->layer == layer;
+    };
+
+    // One task per layer; each only writes to its own LayerChunkBatches.
+    for (auto &layer : layerToRooms) {
+        const int thisLayer = layer.first;
+        if (!hasChunksInLayer(thisLayer)) {
+            continue;
+        }
+
+        LayerChunkBatches &batches = pending.addLayer(thisLayer);
+        auto task = [&batches,
+                     thisLayer,
+                     rooms = std::move(layer.second),
+                     &chunks = pending.chunks,
+                     &roomIndex,
+                     &textures = m_textures,
+                     bounds,
+                     onLayerFinished = m_onLayerFinished]() {
+            ::generateLayerBatches(batches, thisLayer, rooms, chunks, roomIndex, textures, bounds);
+            if (onLayerFinished) {
+                onLayerFinished();
             }
+        };
+        pending.addTask(runOnThreadPool(std::packaged_task<void()>{std::move(task)}));
+    }
+
+    return pending.getTasks();
+}
 
-            layerRoomNames = rnb.getMesh(font);
-            layerConnections = cdb.getMeshes(gl);
+PendingMapBatches::~PendingMapBatches()
+{
+    wait();
+}
+
+LayerChunkBatches &PendingMapBatches::addLayer(const int layer)
+{
+    const auto result = m_layers.try_emplace(layer);
+    assert(result.second);
+    return result.first->second;
+}
+
+bool PendingMapBatches::isReady() const
+{
+    return std::all_of(m_tasks.begin(), m_tasks.end(), [](const std::shared_future<void> &task) {
+        return task.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    });
+}
+
+void PendingMapBatches::wait() const
+{
+    for (const auto &task : m_tasks) {
+        task.wait();
+    }
+}
+
+// The texture is only ever minified, and each chunk has its own, so there's
+// no bleeding between chunks.
+NODISCARD static UniqueMesh createOverviewMesh(OpenGL &gl,
+                                               const int layer,
+                                               const ChunkPos &pos,
+                                               const QImage &image)
+{
+    const auto init = [&image](QOpenGLTexture &tex) -> void {
+        tex.setWrapMode(QOpenGLTexture::WrapMode::ClampToEdge);
+        tex.setMinMagFilters(QOpenGLTexture::Filter::LinearMipMapLinear,
+                             QOpenGLTexture::Filter::Nearest);
+        tex.setData(image, QOpenGLTexture::MipMapGeneration::GenerateMipMaps);
+    };
+    SharedMMTexture texture = MMTexture::alloc(QOpenGLTexture::Target::Target2D, init, true);
+
+    const auto x0 = static_cast<float>(pos.first * CHUNK_SIZE);
+    const auto y0 = static_cast<float>(pos.second * CHUNK_SIZE);
+    const auto x1 = x0 + static_cast<float>(CHUNK_SIZE);
+    const auto y1 = y0 + static_cast<float>(CHUNK_SIZE);
+    const auto z = static_cast<float>(layer);
+
+    const std::vector<TexVert> verts{
+        TexVert{glm::vec2{0, 0}, glm::vec3{x0, y0, z}},
+        TexVert{glm::vec2{1, 0}, glm::vec3{x1, y0, z}},
+        TexVert{glm::vec2{1, 1}, glm::vec3{x1, y1, z}},
+        TexVert{glm::vec2{0, 1}, glm::vec3{x0, y1, z}},
+    };
+    return gl.createTexturedQuadBatch(verts, texture);
+}
+
+void PendingMapBatches::finish(MapBatches &batches, OpenGL &gl, GLFont &font)
+{
+    for (const auto &task : m_tasks) {
+        task.get();
+    }
+
+    if (!chunks) {
+        batches.layers.clear();
+    } else {
+        // chunks whose rooms are all gone aren't regenerated
+        for (const ChunkId &id : chunks.value()) {
+            const auto it = batches.layers.find(id.layer);
+            if (it != batches.layers.end() && it->second.erase(id.pos) != 0
+                && it->second.empty()) {
+                batches.layers.erase(it);
+            }
         }
     }
+
+    for (auto &layer : m_layers) {
+        if (layer.second.empty()) {
+            continue;
+        }
+        LayerChunkMeshes &layerMeshes = batches.layers[layer.first];
+        for (auto &kv : layer.second) {
+            ChunkBatchesIntermediate &chunk = kv.second;
+            ChunkMeshes &meshes = layerMeshes[kv.first];
+            meshes.meshes = chunk.meshes.getLayerMeshes(gl);
+            meshes.connections = chunk.connections.getMeshes(gl);
+            meshes.roomNames = chunk.roomNames.getMesh(font);
+            meshes.overview = ::createOverviewMesh(gl, layer.first, kv.first, chunk.overview);
+            meshes.box = chunk.box;
+        }
+    }
+    batches.bounds = bounds;
+    batches.redrawMargin = redrawMargin;
+}
+
+bool ChunkMeshes::isVisible(const Frustum &frustum, const float margin) const
+{
+    return frustum.intersects(box.lo - margin, box.hi + margin);
+}
+
+void ChunkMeshes::renderOverview(const int thisLayer, const int focusedLayer)
+{
+    // Approximates the tint of LayerMeshes::render(), which draws a black
+    // layer boost over the layers below the focused one.
+    const auto color = [&thisLayer, &focusedLayer]() {
+        if (thisLayer == focusedLayer) {
+            return Colors::white.withAlpha(0.90f);
+        } else if (thisLayer > focusedLayer) {
+            return Colors::gray70.withAlpha(0.20f);
+        }
+        const auto diff = static_cast<float>(focusedLayer - thisLayer);
+        const float shade = 1.f - glm::clamp(0.5f + 0.03f * diff, 0.f, 1.f);
+        return Color{shade, shade, shade, 0.90f};
+    }();
+
+    const GLRenderState less_blended = GLRenderState()
+                                           .withDepthFunction(DepthFunctionEnum::LESS)
+                                           .withBlend(BlendModeEnum::TRANSPARENCY);
+    overview.render(less_blended.withColor(color));
 }
 
 void LayerMeshes::render(const int thisLayer, const int focusedLayer)
@@ -3,18 +3,27 @@
 // Copyright (C) 2019 The MMapper Authors
 // Author: Nils Schimmelmann <nschimme@gmail.com> (Jahara)
 
+#include <functional>
+#include <future>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <map>
+#include <memory>
 #include <optional>
+#include <set>
+#include <tuple>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 #include <QColor>
+#include <QImage>
 #include <QtCore>
 
 #include "../expandoracommon/coordinate.h"
 #include "../expandoracommon/room.h"
 #include "../global/Array.h"
+#include "../global/Color.h"
+#include "../global/EnumIndexedArray.h"
 #include "../global/roomid.h"
 #include "../mapdata/ExitDirection.h"
 #include "../mapdata/infomark.h"
@@ -24,6 +33,7 @@
 #include "MapCanvasData.h"
 #include "RoadIndex.h"
 
+class Frustum;
 class InfoMark;
 class MapCanvasRoomDrawer;
 struct MapCanvasTextures;
@@ -34,12 +44,71 @@ class Room;
 using RoomVector = std::vector<const Room *>;
 using LayerToRooms = std::map<int, RoomVector>;
 
+// Each layer is split into CHUNK_SIZE x CHUNK_SIZE chunks with their own meshes,
+// so a change to a few rooms only regenerates the chunks around them.
+static constexpr const int CHUNK_SIZE = 32;
+
+// x and y of a chunk, in units of CHUNK_SIZE rooms.
+using ChunkPos = std::pair<int, int>;
+
+struct NODISCARD ChunkId final
+{
+    int layer = 0;
+    ChunkPos pos;
+
+    NODISCARD static ChunkId fromCoordinate(const Coordinate &c);
+    NODISCARD bool operator<(const ChunkId &rhs) const
+    {
+        return std::tie(layer, pos) < std::tie(rhs.layer, rhs.pos);
+    }
+};
+
+using ChunkIdSet = std::set<ChunkId>;
+
+using TerrainColors = EnumIndexedArray<Color, RoomTerrainEnum>;
+
+// One texel per room of the chunk, colored by its terrain, and transparent where there's
+// no room (or it's out of bounds). It doesn't touch the GL context.
+NODISCARD extern QImage generateOverviewImage(const ChunkPos &pos,
+                                              const RoomVector &rooms,
+                                              const TerrainColors &terrainColors,
+                                              const OptBounds &bounds);
+
+// Axis-aligned, in world space.
+struct NODISCARD ChunkBox final
+{
+    glm::vec3 lo{0.f};
+    glm::vec3 hi{0.f};
+};
+
+struct NODISCARD ChunkMeshes final
+{
+    LayerMeshes meshes;
+    ConnectionMeshes connections;
+    UniqueMesh roomNames;
+    // One quad covering the chunk, textured with one texel per room; drawn instead of
+    // everything else when the map is zoomed out far enough that rooms are a few pixels.
+    UniqueMesh overview;
+    // Everything but the room names, which can stick out further.
+    ChunkBox box;
+
+    ChunkMeshes() = default;
+    DEFAULT_MOVES_DELETE_COPIES(ChunkMeshes);
+    ~ChunkMeshes() = default;
+
+    void renderOverview(int thisLayer, int focusedLayer);
+    // margin is added on all sides of the box, in rooms.
+    NODISCARD bool isVisible(const Frustum &frustum, float margin = 0.f) const;
+};
+
+using LayerChunkMeshes = std::map<ChunkPos, ChunkMeshes>;
+
 struct NODISCARD MapBatches final
 {
-    BatchedMeshes batchedMeshes;
-    BatchedConnections connectionDrawerBuffers;
-    BatchedConnectionMeshes connectionMeshes;
-    BatchedRoomNames roomNameBatches;
+    // This must be ordered so we can iterate over the layers from lowest to highest.
+    std::map<int, LayerChunkMeshes> layers;
+    // the bounds the rooms were filtered with; regenerated chunks must use the same
+    OptBounds bounds;
     OptBounds redrawMargin;
 
     MapBatches() = default;
@@ -47,10 +116,97 @@ struct NODISCARD MapBatches final
     DELETE_CTORS_AND_ASSIGN_OPS(MapBatches);
 };
 
+// Every room quad is a unit quad, so only its offset from the origin, the layer of
+// the (array) texture and its color are stored; see LayerMeshesIntermediate::getLayerMeshes().
+struct NODISCARD QuadInstanceBatch final
+{
+    MMTexture *texture = nullptr;
+    glm::ivec3 origin{0};
+    std::vector<QuadInstance> instances;
+};
+
+// The CPU side of a layer's meshes: plain vertex arrays that don't need the GL context.
+struct NODISCARD LayerMeshesIntermediate final
+{
+    // the color of the instances is only used by the colored batches
+    using TexturedBatches = std::vector<QuadInstanceBatch>;
+    using ColoredTexturedBatches = std::vector<QuadInstanceBatch>;
+    using PlainQuadBatch = std::vector<glm::vec3>;
+
+    TexturedBatches terrain;
+    RoomTintArray<PlainQuadBatch> tints;
+    TexturedBatches overlays;
+    ColoredTexturedBatches doors;
+    ColoredTexturedBatches walls;
+    ColoredTexturedBatches dottedWalls;
+    ColoredTexturedBatches upDownExits;
+    ColoredTexturedBatches streamIns;
+    ColoredTexturedBatches streamOuts;
+    PlainQuadBatch layerBoost;
+
+    NODISCARD LayerMeshes getLayerMeshes(OpenGL &gl) const;
+};
+
+// Everything that's generated for one chunk, before it's uploaded.
+struct NODISCARD ChunkBatchesIntermediate final
+{
+    LayerMeshesIntermediate meshes;
+    ConnectionDrawerBuffers connections;
+    RoomNameBatch roomNames;
+    // CHUNK_SIZE x CHUNK_SIZE; transparent where there's no room
+    QImage overview;
+    ChunkBox box;
+
+    ChunkBatchesIntermediate() = default;
+    ~ChunkBatchesIntermediate() = default;
+    DELETE_CTORS_AND_ASSIGN_OPS(ChunkBatchesIntermediate);
+};
+
+using LayerChunkBatches = std::map<ChunkPos, ChunkBatchesIntermediate>;
+
+// Map batches that are still being generated on worker threads, one task per layer.
+//
+// The tasks read the rooms without holding the map lock, so the map must not change
+// until they're finished (see MapFrontend::addReaders()), and they use the textures,
+// so they have to finish before the textures are destroyed. The destructor waits.
+class NODISCARD PendingMapBatches final
+{
+private:
+    std::map<int, LayerChunkBatches> m_layers;
+    std::vector<std::shared_future<void>> m_tasks;
+
+public:
+    // The chunks that are being regenerated; nullopt means the whole map.
+    std::optional<ChunkIdSet> chunks;
+    OptBounds bounds;
+    OptBounds redrawMargin;
+
+public:
+    PendingMapBatches() = default;
+    ~PendingMapBatches();
+    DELETE_CTORS_AND_ASSIGN_OPS(PendingMapBatches);
+
+public:
+    NODISCARD LayerChunkBatches &addLayer(int layer);
+    void addTask(std::shared_future<void> task) { m_tasks.emplace_back(std::move(task)); }
+    NODISCARD const std::vector<std::shared_future<void>> &getTasks() const { return m_tasks; }
+
+public:
+    NODISCARD bool isReady() const;
+    void wait() const;
+    // Uploads the generated chunks, replacing the whole map or just the regenerated chunks;
+    // rethrows if a task failed.
+    void finish(MapBatches &batches, OpenGL &gl, GLFont &font);
+};
+
 struct NODISCARD Batches final
 {
     std::optional<MapBatches> mapBatches;
+    std::optional<PendingMapBatches> pendingMapBatches;
     std::optional<BatchedInfomarksMeshes> infomarksMeshes;
+    // mapBatches is still drawn until the pending batches replace it (or the outdated chunks).
+    bool mapBatchesOutdated = false;
+    ChunkIdSet outdatedChunks;
 
     Batches() = default;
     ~Batches() = default;
@@ -58,38 +214,39 @@ struct NODISCARD Batches final
 
     void resetAll()
     {
+        pendingMapBatches.reset();
         mapBatches.reset();
         infomarksMeshes.reset();
+        mapBatchesOutdated = false;
+        outdatedChunks.clear();
     }
 };
 
 class NODISCARD MapCanvasRoomDrawer final
 {
 private:
-    OpenGL &m_opengl;
-    GLFont &m_font;
     const MapCanvasTextures &m_textures;
-    std::optional<MapBatches> &m_batches;
+    std::optional<PendingMapBatches> &m_pendingBatches;
+    // nullopt means all of them
+    std::optional<ChunkIdSet> m_chunks;
+    // called on a worker thread whenever a layer is finished
+    std::function<void()> m_onLayerFinished;
 
 public:
     explicit MapCanvasRoomDrawer(const MapCanvasTextures &textures,
-                                 OpenGL &opengl,
-                                 GLFont &font,
-                                 std::optional<MapBatches> &batches)
-        : m_opengl{opengl}
-        , m_font{font}
-        , m_textures{textures}
-        , m_batches{batches}
+                                 std::optional<PendingMapBatches> &pendingBatches,
+                                 std::optional<ChunkIdSet> chunks,
+                                 std::function<void()> onLayerFinished)
+        : m_textures{textures}
+        , m_pendingBatches{pendingBatches}
+        , m_chunks{std::move(chunks)}
+        , m_onLayerFinished{std::move(onLayerFinished)}
     {}
 
-private:
-    NODISCARD auto &getOpenGL() const { return m_opengl; }
-
-public:
-    void generateBatches(const LayerToRooms &layerToRooms,
-                         const RoomIndex &roomIndex,
-                         const OptBounds &bounds);
-
 public:
-    NODISCARD inline GLFont &getFont() { return m_font; }
+    // Starts generating the batches for the rooms in the requested chunks;
+    // returns the tasks that read the rooms.
+    NODISCARD std::vector<std::shared_future<void>> generateBatches(LayerToRooms layerToRooms,
+                                                                    const RoomIndex &roomIndex,
+                                                                    const OptBounds &bounds);
 };
@@ -3,6 +3,8 @@
 
 #include "Textures.h"
 
+#include <algorithm>
+#include <cassert>
 #include <glm/glm.hpp>
 #include <optional>
 #include <stdexcept>
@@ -30,6 +32,7 @@ MMTexture::MMTexture(this_is_private, const QString &name)
 void MapCanvasTextures::destroyAll()
 {
     for_each([](SharedMMTexture &tex) -> void { tex.reset(); });
+    for_each_array([](SharedMMTexture &tex) -> void { tex.reset(); });
 }
 
 NODISCARD static SharedMMTexture loadTexture(const QString &name)
@@ -69,6 +72,34 @@ static void loadPixmapArray(road_texture_array<Tag> &textures)
     }
 }
 
+// Alpha-weighted, so transparent texels don't darken the result.
+NODISCARD static Color getAverageColor(const QImage &image)
+{
+    const QImage rgba = image.convertToFormat(QImage::Format_RGBA8888);
+    glm::dvec4 sum{0.0};
+    for (int y = 0; y < rgba.height(); ++y) {
+        for (int x = 0; x < rgba.width(); ++x) {
+            const QColor c = rgba.pixelColor(x, y);
+            const double alpha = c.alphaF();
+            sum += glm::dvec4{c.redF() * alpha, c.greenF() * alpha, c.blueF() * alpha, alpha};
+        }
+    }
+    if (sum.a <= 0.0) {
+        return Colors::webGray;
+    }
+    const glm::dvec3 rgb = glm::dvec3{sum} / sum.a;
+    return Color{glm::vec4{glm::vec3{rgb}, 1.f}};
+}
+
+static void loadAverageColors(EnumIndexedArray<Color, RoomTerrainEnum> &colors)
+{
+    const auto N = colors.size();
+    for (uint i = 0u; i < N; ++i) {
+        const auto x = static_cast<RoomTerrainEnum>(i);
+        colors[x] = getAverageColor(QImage{getPixmapFilename(x)});
+    }
+}
+
 // Technically only the "minifying" filter can be trilinear.
 //
 // GL_NEAREST = 1 sample from level 0 (no mipmapping).
@@ -94,86 +125,100 @@ static void setTrilinear(const SharedMMTexture &mmtex, const bool trilinear)
     }
 }
 
-NODISCARD static SharedMMTexture createDottedWall(const ExitDirEnum dir)
+static constexpr const uint32_t DOTTED_WALL_MAX_BITS = 7;
+static constexpr const int DOTTED_WALL_SIZE = 1 << DOTTED_WALL_MAX_BITS;
+using DottedWallImages = MMapper::Array<QImage, DOTTED_WALL_MAX_BITS + 1>;
+
+// Every mip level is drawn by hand, so the dots don't blur away.
+NODISCARD static DottedWallImages createDottedWallImages(const ExitDirEnum dir)
 {
-    static constexpr const uint32_t MAX_BITS = 7;
-    static constexpr const int SIZE = 1 << MAX_BITS;
+    static constexpr const uint32_t MAX_BITS = DOTTED_WALL_MAX_BITS;
 
-    const auto init = [dir](QOpenGLTexture &tex) -> void {
-        const QColor OPAQUE_WHITE = Qt::white;
-        const QColor TRANSPARENT_BLACK = QColor::fromRgbF(0.0, 0.0, 0.0, 0.0);
-        MMapper::Array<QImage, MAX_BITS + 1> images;
-
-        for (auto i = 0u; i <= MAX_BITS; ++i) {
-            const int size = 1 << (MAX_BITS - i);
-            QImage image{size, size, QImage::Format::Format_RGBA8888};
-            image.fill(TRANSPARENT_BLACK);
-            if (size >= 4) {
-                if (size >= 16) {
-                    // 64 and 128:
-                    // ##..##..##..##..##..##..##..##..##..##..##..##..##..##..##..##..
-                    // ##..##..##..##..##..##..##..##..##..##..##..##..##..##..##..##..
-                    // ##..##..##..##..##..##..##..##..##..##..##..##..##..##..##..##..
-                    // ##..##..##..##..##..##..##..##..##..##..##..##..##..##..##..##..
-                    // 32:
-                    // ##..##..##..##..##..##..##..##..
-                    // ##..##..##..##..##..##..##..##..
-                    // 16:
-                    // ##..##..##..##..
-
-                    const int width = [i]() -> int {
-                        switch (MAX_BITS - i) {
-                        case 4:
-                            return 1;
-                        case 5:
-                            return 2;
-                        case 6:
-                        case 7:
-                            return 4;
-                        default:
-                            assert(false);
-                            return 4;
-                        }
-                    }();
-
-                    assert(isClamped(width, 1, 4));
-
-                    for (int y = 0; y < width; ++y) {
-                        for (int x = 0; x < size; x += 4) {
-                            image.setPixelColor(x + 0, y, OPAQUE_WHITE);
-                            image.setPixelColor(x + 1, y, OPAQUE_WHITE);
-                        }
+    const QColor OPAQUE_WHITE = Qt::white;
+    const QColor TRANSPARENT_BLACK = QColor::fromRgbF(0.0, 0.0, 0.0, 0.0);
+    MMapper::Array<QImage, MAX_BITS + 1> images;
+
+    for (auto i = 0u; i <= MAX_BITS; ++i) {
+        const int size = 1 << (MAX_BITS - i);
+        QImage image{size, size, QImage::Format::Format_RGBA8888};
+        image.fill(TRANSPARENT_BLACK);
+        if (size >= 4) {
+            if (size >= 16) {
+                // 64 and 128:
+                // ##..##..##..##..##..##..##..##..##..##..##..##..##..##..##..##..
+                // ##..##..##..##..##..##..##..##..##..##..##..##..##..##..##..##..
+                // ##..##..##..##..##..##..##..##..##..##..##..##..##..##..##..##..
+                // ##..##..##..##..##..##..##..##..##..##..##..##..##..##..##..##..
+                // 32:
+                // ##..##..##..##..##..##..##..##..
+                // ##..##..##..##..##..##..##..##..
+                // 16:
+                // ##..##..##..##..
+
+                const int width = [i]() -> int {
+                    switch (MAX_BITS - i) {
+                    case 4:
+                        return 1;
+                    case 5:
+                        return 2;
+                    case 6:
+                    case 7:
+                        return 4;
+                    default:
+                        assert(false);
+                        return 4;
+                    }
+                }();
+
+                assert(isClamped(width, 1, 4));
+
+                for (int y = 0; y < width; ++y) {
+                    for (int x = 0; x < size; x += 4) {
+                        image.setPixelColor(x + 0, y, OPAQUE_WHITE);
+                        image.setPixelColor(x + 1, y, OPAQUE_WHITE);
                     }
-                } else if (size == 8) {
-                    // #...#...
-                    image.setPixelColor(1, 0, OPAQUE_WHITE);
-                    image.setPixelColor(5, 0, OPAQUE_WHITE);
-                } else if (size == 4) {
-                    // -.-.
-                    image.setPixelColor(0, 0, QColor::fromRgbF(1.0, 1.0, 1.0, 0.5));
-                    image.setPixelColor(2, 0, QColor::fromRgbF(1.0, 1.0, 1.0, 0.5));
-                } else if (size == 2) {
-                    // ..
-                    image.setPixelColor(0, 0, QColor::fromRgbF(1.0, 1.0, 1.0, 0.25));
-                    image.setPixelColor(1, 0, QColor::fromRgbF(1.0, 1.0, 1.0, 0.25));
                 }
+            } else if (size == 8) {
+                // #...#...
+                image.setPixelColor(1, 0, OPAQUE_WHITE);
+                image.setPixelColor(5, 0, OPAQUE_WHITE);
+            } else if (size == 4) {
+                // -.-.
+                image.setPixelColor(0, 0, QColor::fromRgbF(1.0, 1.0, 1.0, 0.5));
+                image.setPixelColor(2, 0, QColor::fromRgbF(1.0, 1.0, 1.0, 0.5));
+            } else if (size == 2) {
+                // ..
+                image.setPixelColor(0, 0, QColor::fromRgbF(1.0, 1.0, 1.0, 0.25));
+                image.setPixelColor(1, 0, QColor::fromRgbF(1.0, 1.0, 1.0, 0.25));
             }
+        }
 
-            if (dir == ExitDirEnum::EAST || dir == ExitDirEnum::WEST) {
-                const auto halfSize = static_cast<double>(size) * 0.5;
-                QTransform matrix;
-                matrix.translate(halfSize, halfSize);
-                matrix.rotate(90);
-                matrix.translate(-halfSize, -halfSize);
-                images[i] = image.transformed(matrix, Qt::FastTransformation);
-            } else {
-                images[i] = image;
-            }
+        if (dir == ExitDirEnum::EAST || dir == ExitDirEnum::WEST) {
+            const auto halfSize = static_cast<double>(size) * 0.5;
+            QTransform matrix;
+            matrix.translate(halfSize, halfSize);
+            matrix.rotate(90);
+            matrix.translate(-halfSize, -halfSize);
+            images[i] = image.transformed(matrix, Qt::FastTransformation);
+        } else {
+            images[i] = image;
+        }
 
-            if (dir == ExitDirEnum::NORTH || dir == ExitDirEnum::WEST) {
-                images[i] = images[i].mirrored(true, true);
-            }
+        if (dir == ExitDirEnum::NORTH || dir == ExitDirEnum::WEST) {
+            images[i] = images[i].mirrored(true, true);
         }
+    }
+
+    return images;
+}
+
+NODISCARD static SharedMMTexture createDottedWall(const ExitDirEnum dir)
+{
+    static constexpr const uint32_t MAX_BITS = DOTTED_WALL_MAX_BITS;
+    static constexpr const int SIZE = DOTTED_WALL_SIZE;
+
+    const auto init = [dir](QOpenGLTexture &tex) -> void {
+        const DottedWallImages images = createDottedWallImages(dir);
 
         tex.setWrapMode(QOpenGLTexture::WrapMode::MirroredRepeat);
         tex.setMinMagFilters(QOpenGLTexture::Filter::NearestMipMapNearest,
@@ -200,11 +245,207 @@ NODISCARD static SharedMMTexture createDottedWall(const ExitDirEnum dir)
         QOpenGLTexture::Target::Target2D, [&init](QOpenGLTexture &tex) { return init(tex); }, true);
 }
 
+// The minimum GL_MAX_ARRAY_TEXTURE_LAYERS_EXT.
+static constexpr const int MAX_ARRAY_LAYERS = 64;
+
+namespace { // anonymous
+
+// Collects the images of the room textures of one mesh category,
+// to be uploaded as the layers of a single array texture.
+class NODISCARD TextureArrayBuilder final
+{
+private:
+    std::vector<SharedMMTexture> m_textures;
+    std::vector<QImage> m_images;
+
+public:
+    void add(const SharedMMTexture &tex, const QString &filename)
+    {
+        QImage image = QImage{filename}.mirrored().convertToFormat(QImage::Format_RGBA8888);
+        if (image.isNull()) {
+            qWarning() << "failed to load: " << filename;
+        }
+        m_textures.emplace_back(tex);
+        m_images.emplace_back(std::move(image));
+    }
+
+    template<typename E>
+    void addAll(texture_array<E> &textures)
+    {
+        const auto N = textures.size();
+        for (uint i = 0u; i < N; ++i) {
+            const auto x = static_cast<E>(i);
+            add(textures[x], getPixmapFilename(x));
+        }
+    }
+
+    template<RoadTagEnum Tag>
+    void addAll(road_texture_array<Tag> &textures)
+    {
+        const auto N = textures.size();
+        for (uint i = 0u; i < N; ++i) {
+            const auto x = TaggedRoadIndex<Tag>{static_cast<RoadIndexMaskEnum>(i)};
+            add(textures[x], getPixmapFilename(x));
+        }
+    }
+
+public:
+    // Smaller images are scaled up to the size of the largest one,
+    // since every layer of an array texture has the same size.
+    NODISCARD SharedMMTexture build() const
+    {
+        const int layers = static_cast<int>(m_images.size());
+        assert(isClamped(layers, 1, MAX_ARRAY_LAYERS));
+
+        int size = 1;
+        for (const QImage &image : m_images) {
+            size = std::max({size, image.width(), image.height()});
+        }
+
+        const auto init = [this, layers, size](QOpenGLTexture &tex) -> void {
+            tex.setWrapMode(QOpenGLTexture::WrapMode::MirroredRepeat);
+            tex.setMinMagFilters(QOpenGLTexture::Filter::LinearMipMapLinear,
+                                 QOpenGLTexture::Filter::Linear);
+            tex.setAutoMipMapGenerationEnabled(false);
+            tex.create();
+            tex.setSize(size, size);
+            tex.setLayers(layers);
+            tex.setMipLevels(tex.maximumMipLevels());
+            tex.setFormat(QOpenGLTexture::TextureFormat::RGBA8_UNorm);
+            tex.allocateStorage(QOpenGLTexture::PixelFormat::RGBA,
+                                QOpenGLTexture::PixelType::UInt8);
+
+            for (int layer = 0; layer < layers; ++layer) {
+                QImage image = m_images[static_cast<size_t>(layer)];
+                if (image.isNull()) {
+                    image = QImage{size, size, QImage::Format::Format_RGBA8888};
+                    image.fill(Qt::transparent);
+                } else if (image.width() != size || image.height() != size) {
+                    image = image.scaled(size,
+                                         size,
+                                         Qt::AspectRatioMode::IgnoreAspectRatio,
+                                         Qt::TransformationMode::SmoothTransformation);
+                }
+                tex.setData(0,
+                            layer,
+                            QOpenGLTexture::PixelFormat::RGBA,
+                            QOpenGLTexture::PixelType::UInt8,
+                            image.constBits());
+            }
+            tex.generateMipMaps();
+        };
+
+        SharedMMTexture array = MMTexture::alloc(QOpenGLTexture::Target::Target2DArray,
+                                                 init,
+                                                 false);
+        for (int layer = 0; layer < layers; ++layer) {
+            deref(m_textures[static_cast<size_t>(layer)]).setArrayLayer(deref(array), layer);
+        }
+        return array;
+    }
+};
+
+} // namespace
+
+NODISCARD static SharedMMTexture createDottedWallArray(MapCanvasTextures &textures)
+{
+    static constexpr const uint32_t MAX_BITS = DOTTED_WALL_MAX_BITS;
+    static constexpr const int SIZE = DOTTED_WALL_SIZE;
+    static constexpr const int LAYERS = static_cast<int>(NUM_EXITS_NESW);
+
+    const auto init = [](QOpenGLTexture &tex) -> void {
+        tex.setWrapMode(QOpenGLTexture::WrapMode::MirroredRepeat);
+        tex.setMinMagFilters(QOpenGLTexture::Filter::NearestMipMapNearest,
+                             QOpenGLTexture::Filter::Nearest);
+        tex.setAutoMipMapGenerationEnabled(false);
+        tex.create();
+        tex.setSize(SIZE, SIZE);
+        tex.setLayers(LAYERS);
+        tex.setMipLevels(tex.maximumMipLevels());
+        tex.setFormat(QOpenGLTexture::TextureFormat::RGBA8_UNorm);
+        tex.allocateStorage(QOpenGLTexture::PixelFormat::RGBA, QOpenGLTexture::PixelType::UInt8);
+
+        for (const ExitDirEnum dir : ALL_EXITS_NESW) {
+            const DottedWallImages images = createDottedWallImages(dir);
+            for (auto i = 0u; i <= MAX_BITS; ++i) {
+                tex.setData(static_cast<int>(i),
+                            static_cast<int>(dir),
+                            QOpenGLTexture::PixelFormat::RGBA,
+                            QOpenGLTexture::PixelType::UInt8,
+                            images[i].constBits());
+            }
+        }
+    };
+
+    SharedMMTexture array = MMTexture::alloc(QOpenGLTexture::Target::Target2DArray, init, true);
+    for (const ExitDirEnum dir : ALL_EXITS_NESW) {
+        deref(textures.dotted_wall[dir]).setArrayLayer(deref(array), static_cast<int>(dir));
+    }
+    return array;
+}
+
+static void initTextureArrays(MapCanvasTextures &textures)
+{
+    static_assert(NUM_ROOM_TERRAIN_TYPES + NUM_ROAD_INDICES <= MAX_ARRAY_LAYERS);
+    static_assert(NUM_ROAD_INDICES + NUM_ROOM_MOB_FLAGS + NUM_ROOM_LOAD_FLAGS + 2
+                  <= MAX_ARRAY_LAYERS);
+
+    const auto getFilename = [](const char *const format, const ExitDirEnum dir) -> QString {
+        return getPixmapFilenameRaw(QString::asprintf(format, lowercaseDirection(dir)));
+    };
+
+    {
+        TextureArrayBuilder terrain;
+        terrain.addAll(textures.terrain);
+        terrain.addAll(textures.road);
+        textures.terrain_array = terrain.build();
+    }
+    {
+        TextureArrayBuilder overlay;
+        overlay.addAll(textures.trail);
+        overlay.addAll(textures.mob);
+        overlay.addAll(textures.load);
+        overlay.add(textures.no_ride, getPixmapFilenameRaw("no-ride.png"));
+        overlay.add(textures.update, getPixmapFilenameRaw("update0.png"));
+        textures.overlay_array = overlay.build();
+    }
+    {
+        TextureArrayBuilder wall;
+        for (const ExitDirEnum dir : ALL_EXITS_NESW) {
+            wall.add(textures.wall[dir], getFilename("wall-%s.png", dir));
+        }
+        textures.wall_array = wall.build();
+    }
+    textures.dotted_wall_array = createDottedWallArray(textures);
+    {
+        TextureArrayBuilder door;
+        TextureArrayBuilder streamIn;
+        TextureArrayBuilder streamOut;
+        for (const ExitDirEnum dir : ALL_EXITS_NESWUD) {
+            door.add(textures.door[dir], getFilename("door-%s.png", dir));
+            streamIn.add(textures.stream_in[dir], getFilename("stream-in-%s.png", dir));
+            streamOut.add(textures.stream_out[dir], getFilename("stream-out-%s.png", dir));
+        }
+        textures.door_array = door.build();
+        textures.stream_in_array = streamIn.build();
+        textures.stream_out_array = streamOut.build();
+    }
+    {
+        TextureArrayBuilder upDownExit;
+        upDownExit.add(textures.exit_up, getPixmapFilenameRaw("exit-up.png"));
+        upDownExit.add(textures.exit_down, getPixmapFilenameRaw("exit-down.png"));
+        upDownExit.add(textures.exit_climb_up, getPixmapFilenameRaw("exit-climb-up.png"));
+        upDownExit.add(textures.exit_climb_down, getPixmapFilenameRaw("exit-climb-down.png"));
+        textures.up_down_exit_array = upDownExit.build();
+    }
+}
+
 void MapCanvas::initTextures()
 {
     MapCanvasTextures &textures = this->m_textures;
 
     loadPixmapArray(textures.terrain);
+    loadAverageColors(textures.terrain_colors);
     loadPixmapArray(textures.road);
     loadPixmapArray(textures.trail);
     loadPixmapArray(textures.mob);
@@ -241,6 +482,11 @@ void MapCanvas::initTextures()
             [&priority](SharedMMTexture &tex) -> void { deref(tex).setPriority(priority++); });
     }
 
+    // The individual textures are still used for everything else (and as the fallback).
+    if (getOpenGL().canRenderTextureArrays()) {
+        initTextureArrays(textures);
+    }
+
     updateTextures();
 }
 
@@ -256,5 +502,10 @@ void MapCanvas::updateTextures()
             ::setTrilinear(tex, wantTrilinear);
         }
     });
+    m_textures.for_each_array([wantTrilinear](SharedMMTexture &tex) -> void {
+        if (tex != nullptr && tex->canBeUpdated()) {
+            ::setTrilinear(tex, wantTrilinear);
+        }
+    });
     activeStatus = wantTrilinear;
 }
@@ -2,6 +2,7 @@
 // SPDX-License-Identifier: GPL-2.0-or-later
 // Copyright (C) 2019 The MMapper Authors
 
+#include <cassert>
 #include <functional>
 #include <memory>
 #include <QOpenGLTexture>
@@ -26,6 +27,9 @@ class NODISCARD MMTexture final : public std::enable_shared_from_this<MMTexture>
 private:
     // REVISIT: can we store the actual QOpenGLTexture in this object?
     QOpenGLTexture m_qt_texture;
+    // the array texture that also contains this texture, if there is one
+    MMTexture *m_array = nullptr;
+    int m_arrayLayer = 0;
     int m_priority = -1;
     bool m_forbidUpdates = false;
 
@@ -73,6 +77,18 @@ class NODISCARD MMTexture final : public std::enable_shared_from_this<MMTexture>
 
     NODISCARD int getPriority() const { return m_priority; }
     void setPriority(const int priority) { m_priority = priority; }
+
+public:
+    NODISCARD bool isArray() const { return target() == QOpenGLTexture::Target::Target2DArray; }
+    void setArrayLayer(MMTexture &array, const int layer)
+    {
+        assert(array.isArray());
+        m_array = &array;
+        m_arrayLayer = layer;
+    }
+    // The texture to bind when drawing this texture in a batch, and the layer to draw.
+    NODISCARD MMTexture *getBatchTexture() { return (m_array != nullptr) ? m_array : this; }
+    NODISCARD int getBatchLayer() const { return (m_array != nullptr) ? m_arrayLayer : 0; }
 };
 
 template<typename E>
@@ -115,6 +131,33 @@ struct NODISCARD MapCanvasTextures final
     SharedMMTexture room_sel_move_good;
     SharedMMTexture update;
 
+    // The average color of each terrain texture, for the zoomed-out overview.
+    EnumIndexedArray<Color, RoomTerrainEnum> terrain_colors;
+
+    // The room textures of each mesh category as the layers of one array texture,
+    // so each category is drawn in a single batch; null if they aren't supported.
+    SharedMMTexture terrain_array;
+    SharedMMTexture overlay_array;
+    SharedMMTexture wall_array;
+    SharedMMTexture dotted_wall_array;
+    SharedMMTexture door_array;
+    SharedMMTexture up_down_exit_array;
+    SharedMMTexture stream_in_array;
+    SharedMMTexture stream_out_array;
+
+    template<typename Callback>
+    void for_each_array(Callback &&callback)
+    {
+        callback(terrain_array);
+        callback(overlay_array);
+        callback(wall_array);
+        callback(dotted_wall_array);
+        callback(door_array);
+        callback(up_down_exit_array);
+        callback(stream_in_array);
+        callback(stream_out_array);
+    }
+
     template<typename Callback>
     void for_each(Callback &&callback)
     {
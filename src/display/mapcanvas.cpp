@@ -1018,7 +1018,7 @@ void MapCanvas::mapChanged()
 {
     // REVISIT: Ideally we'd want to only update the layers/chunks
     // that actually changed.
-    m_batches.mapBatches.reset();
+    m_batches.mapBatchesOutdated = true;
     update();
 }
 
@@ -25,6 +25,7 @@
 #include "../opengl/Font.h"
 #include "../opengl/FontFormatFlags.h"
 #include "../opengl/OpenGL.h"
+#include "FrameProfiler.h"
 #include "Infomarks.h"
 #include "MapCanvasData.h"
 #include "MapCanvasRoomDrawer.h"
@@ -61,6 +62,7 @@ class MapCanvas final : public QOpenGLWidget, private MapCanvasViewport, private
     GLFont m_glFont;
     Batches m_batches;
     MapCanvasTextures m_textures;
+    FrameProfiler m_frameProfiler;
     MapData &m_data;
 
     Mmapper2Group &m_groupManager;
@@ -82,6 +84,12 @@ class MapCanvas final : public QOpenGLWidget, private MapCanvasViewport, private
 public:
     NODISCARD static MapCanvas *getPrimary();
 
+public:
+    // Recorded while the performance stats are shown.
+    NODISCARD const FrameProfiler &getFrameProfiler() const { return m_frameProfiler; }
+    // Chrome trace if the file name ends in ".json", otherwise CSV.
+    NODISCARD bool exportFrameProfile(const QString &fileName) const;
+
 private:
     NODISCARD inline auto &getOpenGL() { return m_opengl; }
     NODISCARD inline auto &getGLFont() { return m_glFont; }
@@ -207,6 +215,8 @@ public slots:
                       const std::optional<Color> &overrideColor = std::nullopt);
     void updateBatches();
     void updateMapBatches();
+    void updateMapChunks();
+    void finishPendingMapBatches();
     void updateInfomarkBatches();
 
     void actuallyPaintGL();
@@ -41,6 +41,7 @@
 #include "../mapdata/mapdata.h"
 #include "../opengl/Font.h"
 #include "../opengl/FontFormatFlags.h"
+#include "../opengl/Frustum.h"
 #include "../opengl/OpenGL.h"
 #include "../opengl/OpenGLTypes.h"
 #include "Connections.h"
@@ -131,6 +132,7 @@ void MapCanvas::cleanupOpenGL()
     m_batches.resetAll();
     m_textures.destroyAll();
     getGLFont().cleanup();
+    m_frameProfiler.resetGpuTimers();
     getOpenGL().cleanup();
     m_logger.reset();
 }
@@ -451,10 +453,25 @@ void MapCanvas::updateBatches()
 
 void MapCanvas::updateMapBatches()
 {
-    if (m_data.getNeedsMapUpdate()) {
-        m_batches.mapBatches.reset();
-        m_data.clearNeedsMapUpdate();
-        assert(!m_data.getNeedsMapUpdate());
+    // The current batches stay on screen until their replacement is uploaded.
+    if (const auto meshUpdates = m_data.takeMeshUpdates()) {
+        for (const Coordinate &pos : meshUpdates.value()) {
+            m_batches.outdatedChunks.emplace(ChunkId::fromCoordinate(pos));
+        }
+    } else {
+        m_batches.mapBatchesOutdated = true;
+    }
+
+    // Anything that's still pending was generated before the changes above,
+    // so it's still finished; the outdated chunks are regenerated afterwards.
+    std::optional<PendingMapBatches> &opt_pending = m_batches.pendingMapBatches;
+    std::optional<MapBatches> &opt_mapBatches = m_batches.mapBatches;
+    if (opt_pending) {
+        if (!opt_pending->isReady()) {
+            // Each finished layer requests another update.
+            return;
+        }
+        finishPendingMapBatches();
     }
 
     const Coordinate &center = [this]() {
@@ -463,8 +480,12 @@ void MapCanvas::updateMapBatches()
                           static_cast<int>(screenCenter.y),
                           m_currentLayer};
     }();
-    std::optional<MapBatches> &opt_mapBatches = m_batches.mapBatches;
-    if (opt_mapBatches && opt_mapBatches->redrawMargin.contains(center)) {
+    if (opt_mapBatches && !m_batches.mapBatchesOutdated
+        && opt_mapBatches->redrawMargin.contains(center)) {
+        if (m_batches.outdatedChunks.empty()) {
+            return;
+        }
+        updateMapChunks();
         return;
     }
 
@@ -495,14 +516,67 @@ void MapCanvas::updateMapBatches()
                    : OptBounds{};                                //
     }();
 
-    MapCanvasRoomDrawer drawer{m_textures, getOpenGL(), getGLFont(), opt_mapBatches};
+    // Called on a worker thread; update() is posted to the GUI thread.
+    const auto onLayerFinished = [this]() {
+        QMetaObject::invokeMethod(
+            this, [this]() { update(); }, Qt::QueuedConnection);
+    };
+    MapCanvasRoomDrawer drawer{m_textures, opt_pending, std::nullopt, onLayerFinished};
 
     /// The following ends up calling MapCanvasRoomDrawer::generateBatches()
     m_data.generateBatches(drawer, bounds);
+    m_batches.mapBatchesOutdated = false;
+    m_batches.outdatedChunks.clear();
 
     if (bounds.isRestricted()) {
-        m_batches.mapBatches->redrawMargin = OptBounds::fromCenterRadius(center, radius * 3 / 4);
+        opt_pending->redrawMargin = OptBounds::fromCenterRadius(center, radius * 3 / 4);
+    }
+
+    if (!opt_mapBatches) {
+        // There's nothing to draw in the meantime.
+        opt_pending->wait();
+        finishPendingMapBatches();
+    }
+}
+
+void MapCanvas::updateMapChunks()
+{
+    std::optional<PendingMapBatches> &opt_pending = m_batches.pendingMapBatches;
+    const MapBatches &mapBatches = m_batches.mapBatches.value();
+
+    const auto onLayerFinished = [this]() {
+        QMetaObject::invokeMethod(
+            this, [this]() { update(); }, Qt::QueuedConnection);
+    };
+    MapCanvasRoomDrawer drawer{m_textures,
+                               opt_pending,
+                               std::exchange(m_batches.outdatedChunks, {}),
+                               onLayerFinished};
+
+    // The chunks have to line up with the rest of the map, so they use the same bounds.
+    m_data.generateBatches(drawer, mapBatches.bounds);
+    opt_pending->redrawMargin = mapBatches.redrawMargin;
+}
+
+void MapCanvas::finishPendingMapBatches()
+{
+    std::optional<PendingMapBatches> &opt_pending = m_batches.pendingMapBatches;
+    std::optional<MapBatches> &opt_mapBatches = m_batches.mapBatches;
+    assert(opt_pending && opt_pending->isReady());
+
+    if (!opt_pending->chunks) {
+        opt_mapBatches.reset(); // dtor, if necessary
+        opt_mapBatches.emplace();
+    }
+    assert(opt_mapBatches);
+    try {
+        opt_pending->finish(opt_mapBatches.value(), getOpenGL(), getGLFont());
+    } catch (...) {
+        // don't rethrow the same failure on every frame
+        opt_pending.reset();
+        throw;
     }
+    opt_pending.reset();
 }
 
 void MapCanvas::actuallyPaintGL()
@@ -518,9 +592,20 @@ void MapCanvas::actuallyPaintGL()
     }
 
     paintMap();
-    paintBatchedInfomarks();
-    paintSelections();
-    paintCharacters();
+
+    FrameProfiler &profiler = m_frameProfiler;
+    {
+        FrameProfiler::PassScope scope{profiler, gl, RenderPassEnum::INFOMARKS};
+        paintBatchedInfomarks();
+    }
+    {
+        FrameProfiler::PassScope scope{profiler, gl, RenderPassEnum::SELECTIONS};
+        paintSelections();
+    }
+    {
+        FrameProfiler::PassScope scope{profiler, gl, RenderPassEnum::CHARACTERS};
+        paintCharacters();
+    }
 }
 
 void MapCanvas::paintMap()
@@ -544,56 +629,44 @@ void MapCanvas::paintSelections()
 
 void MapCanvas::paintGL()
 {
-    static thread_local double longestBatchMs = 0.0;
-
     const bool showPerfStats = MapCanvasConfig::getShowPerfStats();
 
-    using Clock = std::chrono::high_resolution_clock;
-    std::optional<Clock::time_point> optStart;
-    std::optional<Clock::time_point> optAfterTextures;
-    std::optional<Clock::time_point> optAfterBatches;
+    FrameProfiler &profiler = m_frameProfiler;
     if (showPerfStats)
-        optStart = Clock::now();
+        profiler.beginFrame(getOpenGL());
+
+    using Clock = FrameProfiler::Clock;
+    auto phaseStart = Clock::now();
+    const auto endPhase = [showPerfStats, &profiler, &phaseStart](const CpuPhaseEnum phase) {
+        if (!showPerfStats)
+            return;
+        const auto now = Clock::now();
+        profiler.addCpuPhase(phase, phaseStart, now);
+        phaseStart = now;
+    };
 
     {
         updateMultisampling();
         updateTextures();
-        if (showPerfStats)
-            optAfterTextures = Clock::now();
+        endPhase(CpuPhaseEnum::UPDATE_TEXTURES);
 
         // Note: The real work happens here!
         updateBatches();
 
-        // For accurate timing of the update, we'd need to call glFinish(),
-        // or at least set up an OpenGL query object. The update will send
-        // a lot of data to the GPU, so it could take a while...
-        if (showPerfStats)
-            optAfterBatches = Clock::now();
+        // This only measures the CPU side of the update; the uploads it sends to
+        // the GPU are included in the GPU time of the frames that follow.
+        endPhase(CpuPhaseEnum::UPDATE_BATCHES);
 
         actuallyPaintGL();
+        endPhase(CpuPhaseEnum::PAINT);
     }
 
     if (!showPerfStats)
-        return; /* don't wait to finish */
-
-    const auto &start = optStart.value();
-    const auto &afterTextures = optAfterTextures.value();
-    const auto &afterBatches = optAfterBatches.value();
-    const auto afterPaint = Clock::now();
-    const bool calledFinish = [this]() -> bool {
-        if (auto *const ctxt = QOpenGLWidget::context())
-            if (auto *const func = ctxt->functions()) {
-                func->glFinish();
-                return true;
-            }
-        return false;
-    }();
-
-    const auto end = Clock::now();
+        return;
 
-    const auto ms = [](auto delta) -> double {
-        return double(std::chrono::duration_cast<std::chrono::nanoseconds>(delta).count()) * 1e-6;
-    };
+    // The GPU timers of this frame are collected during a later frame,
+    // so there's no need to wait for the GPU to finish.
+    profiler.endFrame();
 
     const auto w = width();
     const auto h = height();
@@ -618,23 +691,40 @@ void MapCanvas::paintGL()
         y += lineHeight;
     };
 
-    const auto texturesTime = ms(afterTextures - start);
-    const auto batchTime = ms(afterBatches - afterTextures);
+    const auto printPercentiles = [&print](const QString &name, const RollingHistogram &hist) {
+        if (hist.empty())
+            return;
+        print(QString::asprintf("%s: %.2f / %.2f / %.2f ms",
+                                qPrintable(name),
+                                hist.getPercentile(50),
+                                hist.getPercentile(95),
+                                hist.getPercentile(99)));
+    };
 
-    const auto total = ms(end - start);
-    print(QString::asprintf(
-        "%.1f (updateTextures) + %.1f (updateBatches) + %.1f (paintGL) + %.1f (glFinish%s) = %.1f ms",
-        texturesTime,
-        batchTime,
-        ms(afterPaint - afterBatches),
-        ms(end - afterPaint),
-        calledFinish ? "" : "*",
-        total));
-    if (!calledFinish)
-        print("* = unable to call glFinish()");
+    print(QString("p50 / p95 / p99 of the last %1 frames").arg(profiler.getCpuFrame().size()));
+    printPercentiles("CPU frame", profiler.getCpuFrame());
+    for (size_t i = 0; i < NUM_CPU_PHASES; ++i) {
+        const auto phase = static_cast<CpuPhaseEnum>(i);
+        printPercentiles(getName(phase), profiler.getCpuPhase(phase));
+    }
+    print(QString::asprintf("Worst updateBatches: %.1f ms",
+                            profiler.getCpuPhase(CpuPhaseEnum::UPDATE_BATCHES).getMax()));
 
-    longestBatchMs = std::max(batchTime, longestBatchMs);
-    print(QString::asprintf("Worst updateBatches: %.1f ms", longestBatchMs));
+    if (!profiler.canMeasureGpuTime()) {
+        print("GPU time: unavailable (requires GL_ARB_timer_query)");
+    } else {
+        printPercentiles("GPU frame", profiler.getGpuFrame());
+        for (size_t i = 0; i < NUM_RENDER_PASSES; ++i) {
+            const auto pass = static_cast<RenderPassEnum>(i);
+            printPercentiles(getName(pass), profiler.getGpuPass(pass));
+        }
+        for (const auto &[layer, hist] : profiler.getGpuLayers()) {
+            printPercentiles(QString::asprintf("layer %d", layer), hist);
+        }
+        if (const size_t dropped = profiler.getDroppedTimers(); dropped != 0) {
+            print(QString("%1 GPU timers dropped").arg(dropped));
+        }
+    }
 
     const auto &advanced = getConfig().canvas.advanced;
     const float zoom = getTotalScaleFactor();
@@ -667,6 +757,24 @@ void MapCanvas::paintGL()
     font.render2dTextImmediate(text);
 }
 
+bool MapCanvas::exportFrameProfile(const QString &fileName) const
+{
+    std::ostringstream os;
+    if (fileName.endsWith(".json", Qt::CaseInsensitive)) {
+        m_frameProfiler.writeChromeTrace(os);
+    } else {
+        m_frameProfiler.writeCsv(os);
+    }
+
+    QFile file{fileName};
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    const std::string data = os.str();
+    return file.write(data.data(), static_cast<qint64>(data.size()))
+           == static_cast<qint64>(data.size());
+}
+
 void MapCanvas::paintSelectionArea()
 {
     if (!hasSel1() || !hasSel2())
@@ -735,41 +843,79 @@ void MapCanvas::renderMapBatches()
     const auto wantExtraDetail = totalScaleFactor >= settings.extraDetailScaleCutoff;
     const auto wantDoorNames = settings.drawDoorNames
                                && (totalScaleFactor >= settings.doorNameScaleCutoff);
+    // Rooms are only a few pixels across, so one texel per room looks the same
+    // for a fraction of the draw calls.
+    const auto wantOverview = totalScaleFactor < settings.overviewScaleCutoff;
+
+    // Door names are centered on their rooms, but they're wider than a room.
+    static constexpr const float ROOM_NAME_MARGIN = static_cast<float>(CHUNK_SIZE) / 2.f;
 
     auto &gl = getOpenGL();
-    BatchedMeshes &batchedMeshes = batches.batchedMeshes;
-    const auto drawLayer =
-        [&batches, &batchedMeshes, wantExtraDetail, wantDoorNames](const int thisLayer,
-                                                                   const int currentLayer) {
-            const auto it_mesh = batchedMeshes.find(thisLayer);
-            if (it_mesh != batchedMeshes.end()) {
-                LayerMeshes &meshes = it_mesh->second;
-                meshes.render(thisLayer, currentLayer);
+    FrameProfiler &profiler = m_frameProfiler;
+    const Frustum frustum{m_viewProj};
+    std::vector<ChunkMeshes *> visible;
+    const auto drawLayer = [&batches,
+                            &gl,
+                            &profiler,
+                            &frustum,
+                            &visible,
+                            wantExtraDetail,
+                            wantDoorNames,
+                            wantOverview](const int thisLayer, const int currentLayer) {
+        const auto it_layer = batches.layers.find(thisLayer);
+        if (it_layer == batches.layers.end()) {
+            return;
+        }
+
+        visible.clear();
+        for (auto &kv : it_layer->second) {
+            if (kv.second.isVisible(frustum)) {
+                visible.emplace_back(&kv.second);
             }
+        }
+        if (visible.empty()) {
+            return;
+        }
 
-            if (wantExtraDetail) {
-                {
-                    BatchedConnectionMeshes &connectionMeshes = batches.connectionMeshes;
-                    const auto it_conn = connectionMeshes.find(thisLayer);
-                    if (it_conn != connectionMeshes.end()) {
-                        ConnectionMeshes &meshes = it_conn->second;
-                        meshes.render(thisLayer, currentLayer);
-                    }
+        if (wantOverview) {
+            FrameProfiler::PassScope scope{profiler, gl, RenderPassEnum::TERRAIN, thisLayer};
+            for (ChunkMeshes *const chunk : visible) {
+                chunk->renderOverview(thisLayer, currentLayer);
+            }
+            return;
+        }
+
+        {
+            FrameProfiler::PassScope scope{profiler, gl, RenderPassEnum::TERRAIN, thisLayer};
+            for (ChunkMeshes *const chunk : visible) {
+                chunk->meshes.render(thisLayer, currentLayer);
+            }
+        }
+
+        if (wantExtraDetail) {
+            {
+                FrameProfiler::PassScope scope{profiler,
+                                               gl,
+                                               RenderPassEnum::CONNECTIONS,
+                                               thisLayer};
+                for (ChunkMeshes *const chunk : visible) {
+                    chunk->connections.render(thisLayer, currentLayer);
                 }
+            }
 
-                // NOTE: This can display room names in lower layers, but the text
-                // isn't currently drawn with an appropriate Z-offset, so it doesn't
-                // stay aligned to its actual layer when you switch view layers.
-                if (wantDoorNames && thisLayer == currentLayer) {
-                    BatchedRoomNames &roomNameBatches = batches.roomNameBatches;
-                    const auto it_name = roomNameBatches.find(thisLayer);
-                    if (it_name != roomNameBatches.end()) {
-                        auto &roomNameBatch = it_name->second;
-                        roomNameBatch.render(GLRenderState());
+            // NOTE: This can display room names in lower layers, but the text
+            // isn't currently drawn with an appropriate Z-offset, so it doesn't
+            // stay aligned to its actual layer when you switch view layers.
+            if (wantDoorNames && thisLayer == currentLayer) {
+                FrameProfiler::PassScope scope{profiler, gl, RenderPassEnum::ROOM_NAMES, thisLayer};
+                for (auto &kv : it_layer->second) {
+                    if (kv.second.isVisible(frustum, ROOM_NAME_MARGIN)) {
+                        kv.second.roomNames.render(GLRenderState());
                     }
                 }
             }
-        };
+        }
+    };
 
     const auto fadeBackground = [&gl, &settings]() {
         auto bgColor = Color{settings.backgroundColor.getColor(), 0.5f};
@@ -780,7 +926,7 @@ void MapCanvas::renderMapBatches()
         gl.renderPlainFullScreenQuad(blendedWithBackground);
     };
 
-    for (const auto &layer : batchedMeshes) {
+    for (const auto &layer : batches.layers) {
         const int thisLayer = layer.first;
         if (thisLayer == m_currentLayer) {
             gl.clearDepth();
@@ -5,10 +5,13 @@
 
 #include "property.h"
 
+#include <functional>
 #include <stdexcept>
+#include <string_view>
 
 Property::Property(std::string s)
     : m_data{std::move(s)}
+    , m_hash{m_data.empty() ? 0u : static_cast<uint64_t>(std::hash<std::string_view>()(m_data))}
 {}
 
 Property::~Property() = default;
@@ -4,6 +4,7 @@
 // Author: Ulf Hermann <ulfonk_mennhar@gmx.de> (Alve)
 // Author: Marek Krejza <krejza@gmail.com> (Caligor)
 
+#include <cstdint>
 #include <optional>
 #include <string>
 
@@ -14,11 +15,14 @@ class NODISCARD Property final
 {
 private:
     std::string m_data;
+    // Computed once on construction so ParseTree lookups never rehash the string.
+    uint64_t m_hash = 0;
 
 public:
     bool isSkipped() const noexcept { return m_data.empty(); }
     const std::string &getStdString() const { return m_data; }
     size_t size() const { return m_data.size(); }
+    NODISCARD uint64_t getHash() const noexcept { return m_hash; }
 
 public:
     Property() = default;
@@ -9,6 +9,7 @@
 #include <sstream>
 #include <vector>
 
+#include "../global/PoolAllocator.h"
 #include "../global/StringView.h"
 #include "../global/random.h"
 #include "../mapdata/ExitFieldVariant.h"
@@ -52,10 +53,24 @@ void RoomModificationTracker::notifyModified(Room &room, RoomUpdateFlags updateF
 {
     m_isModified = true;
     if (updateFlags.contains(RoomUpdateEnum::Mesh))
-        m_needsMapUpdate = true;
+        notifyMeshModified(room.getPosition());
     virt_onNotifyModified(room, updateFlags);
 }
 
+void RoomModificationTracker::notifyMeshModified(const Coordinate &pos)
+{
+    m_needsMapUpdate = true;
+    if (m_needsFullMapUpdate)
+        return;
+
+    if (m_meshUpdates.size() >= MAX_MESH_UPDATES) {
+        m_needsFullMapUpdate = true;
+        m_meshUpdates.clear();
+        return;
+    }
+    m_meshUpdates.emplace_back(pos);
+}
+
 ExitDirConstRef::ExitDirConstRef(const ExitDirEnum dir, const Exit &exit)
     : dir{dir}
     , exit{exit}
@@ -237,6 +252,8 @@ void Room::setPosition(const Coordinate &c)
     if (c == m_position)
         return;
 
+    // the mesh at the old position has to go, too
+    m_tracker.notifyMeshModified(m_position);
     m_position = c;
     setModified(mesh_updateFlags | RoomUpdateEnum::Coord);
 }
@@ -256,6 +273,7 @@ void Room::setAboutToDie()
 {
     // REVISIT: m_id = INVALID_ROOMID; ?
     m_status = RoomStatusEnum::Zombie;
+    m_tracker.notifyMeshModified(m_position);
 }
 
 void Room::setUpToDate()
@@ -281,14 +299,19 @@ void Room::setModified(const RoomUpdateFlags updateFlags)
     m_tracker.notifyModified(*this, updateFlags);
 }
 
+SharedRoom Room::allocateRoom(RoomModificationTracker &tracker, const RoomStatusEnum status)
+{
+    return std::allocate_shared<Room>(PoolAllocator<Room>{}, this_is_private{0}, tracker, status);
+}
+
 std::shared_ptr<Room> Room::createPermanentRoom(RoomModificationTracker &tracker)
 {
-    return std::make_shared<Room>(this_is_private{0}, tracker, RoomStatusEnum::Permanent);
+    return allocateRoom(tracker, RoomStatusEnum::Permanent);
 }
 
 SharedRoom Room::createTemporaryRoom(RoomModificationTracker &tracker, const ParseEvent &ev)
 {
-    auto room = std::make_shared<Room>(this_is_private{0}, tracker, RoomStatusEnum::Temporary);
+    auto room = allocateRoom(tracker, RoomStatusEnum::Temporary);
     Room::update(*room, ev);
     return room;
 }
@@ -777,7 +800,7 @@ std::shared_ptr<Room> Room::clone(RoomModificationTracker &tracker) const
     if (m_status == RoomStatusEnum::Zombie)
         throw std::runtime_error("Attempt to clone a zombie");
 
-    const auto copy = std::make_shared<Room>(this_is_private{0}, tracker, RoomStatusEnum::Temporary);
+    const auto copy = allocateRoom(tracker, RoomStatusEnum::Temporary);
 #define COPY(x) \
     do { \
         copy->x = this->x; \
@@ -7,6 +7,7 @@
 #include <cassert>
 #include <memory>
 #include <optional>
+#include <vector>
 #include <QDebug>
 #include <QVariant>
 
@@ -80,9 +81,15 @@ struct NODISCARD RoomUpdateFlags final : enums::Flags<RoomUpdateFlags, RoomUpdat
 
 class NODISCARD RoomModificationTracker
 {
+public:
+    // Beyond this, it's cheaper to regenerate the whole map than to track each change.
+    static constexpr const size_t MAX_MESH_UPDATES = 4096;
+
 private:
     bool m_isModified = false;
     bool m_needsMapUpdate = false;
+    bool m_needsFullMapUpdate = false;
+    std::vector<Coordinate> m_meshUpdates;
 
 public:
     virtual ~RoomModificationTracker();
@@ -90,6 +97,9 @@ class NODISCARD RoomModificationTracker
 public:
     void notifyModified(Room &room, RoomUpdateFlags updateFlags);
     virtual void virt_onNotifyModified(Room & /*room*/, RoomUpdateFlags /*updateFlags*/) {}
+    // Records a mesh change at a position that isn't the room's current position,
+    // e.g. where a room was before it moved.
+    void notifyMeshModified(const Coordinate &pos);
 
 public:
     NODISCARD bool isModified() const { return m_isModified; }
@@ -97,7 +107,17 @@ class NODISCARD RoomModificationTracker
 
 public:
     NODISCARD bool getNeedsMapUpdate() const { return m_needsMapUpdate; }
-    void clearNeedsMapUpdate() { m_needsMapUpdate = false; }
+    // True if there were too many mesh changes to report them by position.
+    NODISCARD bool getNeedsFullMapUpdate() const { return m_needsFullMapUpdate; }
+    // Swaps out the positions whose meshes changed since the last call, which may repeat,
+    // and clears the update flags.
+    void swapMeshUpdates(std::vector<Coordinate> &out)
+    {
+        out.clear();
+        out.swap(m_meshUpdates);
+        m_needsMapUpdate = false;
+        m_needsFullMapUpdate = false;
+    }
 };
 
 // NOTE: Names are capitalized for use with getRoomName() and setRoomName(),
@@ -123,6 +143,8 @@ enum class RoomStatusEnum : uint8_t { Zombie, Temporary, Permanent };
 
 class NODISCARD Room final : public std::enable_shared_from_this<Room>
 {
+    friend class TestExpandoraCommon;
+
 private:
     struct NODISCARD this_is_private final
     {
@@ -229,6 +251,11 @@ class NODISCARD Room final : public std::enable_shared_from_this<Room>
     explicit operator QString() const { return toQString(); }
     friend QDebug operator<<(QDebug os, const Room &r) { return os << r.toQString(); }
 
+private:
+    // Rooms are allocated from a fixed-block pool; see PoolAllocator.h.
+    NODISCARD static std::shared_ptr<Room> allocateRoom(RoomModificationTracker &tracker,
+                                                        RoomStatusEnum status);
+
 public:
     NODISCARD static std::shared_ptr<Room> createPermanentRoom(RoomModificationTracker &tracker);
     NODISCARD static std::shared_ptr<Room> createTemporaryRoom(RoomModificationTracker &tracker,
@@ -0,0 +1,104 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2023 The MMapper Authors
+
+#include "PoolAllocator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <map>
+
+NODISCARD static size_t roundUpBlockSize(const size_t size)
+{
+    constexpr size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+    const size_t atLeast = std::max(size, sizeof(void *));
+    return (atLeast + align - 1u) / align * align;
+}
+
+FixedBlockPool::FixedBlockPool(const size_t blockSize)
+    : m_blockSize{roundUpBlockSize(blockSize)}
+{}
+
+FixedBlockPool::~FixedBlockPool()
+{
+    assert(m_live == 0);
+}
+
+void FixedBlockPool::addSlab()
+{
+    auto slab = std::make_unique<std::byte[]>(m_blockSize * BLOCKS_PER_SLAB);
+    std::byte *const base = slab.get();
+    // Push in reverse so blocks are handed out in address order.
+    for (size_t i = BLOCKS_PER_SLAB; i-- > 0;) {
+        auto *const block = ::new (base + i * m_blockSize) FreeBlock{};
+        block->next = m_freeList;
+        m_freeList = block;
+    }
+    m_slabs.emplace_back(std::move(slab));
+}
+
+void *FixedBlockPool::allocate()
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    if (m_freeList == nullptr)
+        addSlab();
+
+    FreeBlock *const block = m_freeList;
+    m_freeList = block->next;
+    ++m_live;
+    return block;
+}
+
+void FixedBlockPool::deallocate(void *const ptr) noexcept
+{
+    if (ptr == nullptr)
+        return;
+
+    std::lock_guard<std::mutex> lock{m_mutex};
+    auto *const block = ::new (ptr) FreeBlock{};
+    block->next = m_freeList;
+    m_freeList = block;
+    assert(m_live > 0);
+    --m_live;
+}
+
+size_t FixedBlockPool::getLiveCount()
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    return m_live;
+}
+
+size_t FixedBlockPool::getReservedBytes()
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    return m_slabs.size() * BLOCKS_PER_SLAB * m_blockSize;
+}
+
+namespace {
+using PoolMap = std::map<size_t, std::unique_ptr<FixedBlockPool>>;
+std::mutex g_poolsMutex;
+// intentionally leaked; see header
+PoolMap &getPools()
+{
+    static auto *const g_pools = new PoolMap();
+    return *g_pools;
+}
+} // namespace
+
+FixedBlockPool &pool_allocator::getPool(const size_t blockSize)
+{
+    std::lock_guard<std::mutex> lock{g_poolsMutex};
+    auto &pool = getPools()[blockSize];
+    if (pool == nullptr)
+        pool = std::make_unique<FixedBlockPool>(blockSize);
+    return *pool;
+}
+
+size_t pool_allocator::getTotalReservedBytes()
+{
+    std::lock_guard<std::mutex> lock{g_poolsMutex};
+    size_t total = 0;
+    for (auto &kv : getPools()) {
+        total += kv.second->getReservedBytes();
+    }
+    return total;
+}
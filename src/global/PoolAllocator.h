@@ -0,0 +1,114 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2023 The MMapper Authors
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include "RuleOf5.h"
+#include "macros.h"
+
+/// Thread-safe pool of fixed-size blocks carved out of large slabs.
+/// Freed blocks are recycled through an intrusive free list; slabs are only
+/// released when the pool itself is destroyed.
+class NODISCARD FixedBlockPool final
+{
+public:
+    static constexpr const size_t BLOCKS_PER_SLAB = 256;
+
+private:
+    struct NODISCARD FreeBlock final
+    {
+        FreeBlock *next = nullptr;
+    };
+
+    std::mutex m_mutex;
+    std::vector<std::unique_ptr<std::byte[]>> m_slabs;
+    FreeBlock *m_freeList = nullptr;
+    const size_t m_blockSize;
+    size_t m_live = 0;
+
+public:
+    explicit FixedBlockPool(size_t blockSize);
+    ~FixedBlockPool();
+    DELETE_CTORS_AND_ASSIGN_OPS(FixedBlockPool);
+
+public:
+    NODISCARD void *allocate();
+    void deallocate(void *ptr) noexcept;
+
+public:
+    NODISCARD size_t getBlockSize() const { return m_blockSize; }
+    NODISCARD size_t getLiveCount();
+    NODISCARD size_t getReservedBytes();
+
+private:
+    void addSlab();
+};
+
+namespace pool_allocator {
+/// One immortal pool per block size; it is never destroyed so objects that
+/// outlive main() (e.g. in static test fixtures) can still be released safely.
+NODISCARD FixedBlockPool &getPool(size_t blockSize);
+NODISCARD size_t getTotalReservedBytes();
+} // namespace pool_allocator
+
+/// Allocator for std::allocate_shared<T>: the object and its control block
+/// share one pooled block, so many small, frequently recycled objects (rooms,
+/// path machine hypotheses) are packed into slabs instead of scattered heap
+/// allocations.
+template<typename T>
+class NODISCARD PoolAllocator final
+{
+public:
+    using value_type = T;
+
+private:
+    static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+
+    // Each rebound allocator type (e.g. the control block allocate_shared<T>
+    // actually allocates) resolves its pool once instead of per call.
+    NODISCARD static FixedBlockPool &getPool()
+    {
+        static FixedBlockPool &pool = pool_allocator::getPool(sizeof(T));
+        return pool;
+    }
+
+public:
+    PoolAllocator() noexcept = default;
+    template<typename U>
+    PoolAllocator(const PoolAllocator<U> &) noexcept
+    {}
+
+public:
+    NODISCARD T *allocate(const size_t n)
+    {
+        if (n != 1)
+            return static_cast<T *>(::operator new(n * sizeof(T)));
+        return static_cast<T *>(getPool().allocate());
+    }
+
+    void deallocate(T *const ptr, const size_t n) noexcept
+    {
+        if (n != 1) {
+            ::operator delete(ptr);
+            return;
+        }
+        getPool().deallocate(ptr);
+    }
+
+public:
+    template<typename U>
+    NODISCARD bool operator==(const PoolAllocator<U> &) const noexcept
+    {
+        return true;
+    }
+    template<typename U>
+    NODISCARD bool operator!=(const PoolAllocator<U> &) const noexcept
+    {
+        return false;
+    }
+};
@@ -0,0 +1,84 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2023 The MMapper Authors
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "macros.h"
+
+/// The most recent samples of a measurement (e.g. frame times), for percentiles
+/// that follow recent behavior instead of the whole session.
+class NODISCARD RollingHistogram final
+{
+private:
+    std::vector<double> m_samples;
+    size_t m_capacity = 0;
+    size_t m_next = 0;
+    double m_max = 0.0;
+
+public:
+    explicit RollingHistogram(const size_t capacity)
+        : m_capacity{std::max<size_t>(capacity, 1)}
+    {
+        m_samples.reserve(m_capacity);
+    }
+
+public:
+    void add(const double sample)
+    {
+        if (m_samples.size() < m_capacity) {
+            m_samples.emplace_back(sample);
+        } else {
+            m_samples[m_next] = sample;
+        }
+        m_next = (m_next + 1) % m_capacity;
+        m_max = std::max(m_max, sample);
+    }
+
+    void clear()
+    {
+        m_samples.clear();
+        m_next = 0;
+        m_max = 0.0;
+    }
+
+public:
+    NODISCARD bool empty() const { return m_samples.empty(); }
+    NODISCARD size_t size() const { return m_samples.size(); }
+    NODISCARD size_t capacity() const { return m_capacity; }
+    /// Worst sample since the last clear(), even if it has left the window.
+    NODISCARD double getMax() const { return m_max; }
+
+    NODISCARD double getMean() const
+    {
+        if (m_samples.empty()) {
+            return 0.0;
+        }
+        double sum = 0.0;
+        for (const double sample : m_samples) {
+            sum += sample;
+        }
+        return sum / static_cast<double>(m_samples.size());
+    }
+
+    /// Nearest-rank percentile of the current window, for p in [0, 100].
+    NODISCARD double getPercentile(const double p) const
+    {
+        assert(p >= 0.0 && p <= 100.0);
+        if (m_samples.empty()) {
+            return 0.0;
+        }
+        const size_t n = m_samples.size();
+        const auto rank = static_cast<size_t>(std::ceil(p * static_cast<double>(n) / 100.0));
+        const size_t index = std::clamp<size_t>(rank, 1, n) - 1;
+
+        std::vector<double> copy = m_samples;
+        const auto nth = copy.begin() + static_cast<std::ptrdiff_t>(index);
+        std::nth_element(copy.begin(), nth, copy.end());
+        return *nth;
+    }
+};
@@ -0,0 +1,173 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2023 The MMapper Authors
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <utility>
+
+#include "macros.h"
+#include "roomid.h"
+
+/// Sorted set of RoomIds optimized for the common case of zero, one or two
+/// members. Small sets live inline; larger ones spill to a sorted heap array.
+/// Iteration is over contiguous memory in ascending order, like std::set.
+class NODISCARD TinyRoomIdSet final
+{
+public:
+    static constexpr const uint32_t INLINE_CAPACITY = 2;
+    using const_iterator = const RoomId *;
+
+private:
+    union Storage {
+        RoomId inlineIds[INLINE_CAPACITY];
+        RoomId *heap;
+        Storage()
+            : heap{nullptr}
+        {}
+    };
+
+    Storage m_storage;
+    uint32_t m_size = 0;
+    uint32_t m_capacity = INLINE_CAPACITY;
+
+public:
+    TinyRoomIdSet() = default;
+    ~TinyRoomIdSet() { freeHeap(); }
+
+    TinyRoomIdSet(const TinyRoomIdSet &rhs) { copyFrom(rhs); }
+    TinyRoomIdSet(TinyRoomIdSet &&rhs) noexcept { moveFrom(rhs); }
+    TinyRoomIdSet &operator=(const TinyRoomIdSet &rhs)
+    {
+        if (this != &rhs) {
+            if (rhs.m_size <= m_capacity) {
+                // reuse the existing storage; avoids reallocating on every assignment
+                std::copy(rhs.begin(), rhs.end(), data());
+                m_size = rhs.m_size;
+            } else {
+                freeHeap();
+                copyFrom(rhs);
+            }
+        }
+        return *this;
+    }
+    TinyRoomIdSet &operator=(TinyRoomIdSet &&rhs) noexcept
+    {
+        if (this != &rhs) {
+            freeHeap();
+            moveFrom(rhs);
+        }
+        return *this;
+    }
+
+private:
+    NODISCARD bool isInline() const { return m_capacity == INLINE_CAPACITY; }
+    NODISCARD RoomId *data() { return isInline() ? m_storage.inlineIds : m_storage.heap; }
+    NODISCARD const RoomId *data() const
+    {
+        return isInline() ? m_storage.inlineIds : m_storage.heap;
+    }
+
+    void freeHeap()
+    {
+        if (!isInline()) {
+            delete[] m_storage.heap;
+            m_storage.heap = nullptr;
+            m_capacity = INLINE_CAPACITY;
+        }
+        m_size = 0;
+    }
+
+    void copyFrom(const TinyRoomIdSet &rhs)
+    {
+        assert(isInline() && m_size == 0);
+        if (rhs.m_size > INLINE_CAPACITY) {
+            m_storage.heap = new RoomId[rhs.m_size];
+            m_capacity = rhs.m_size;
+        }
+        std::copy(rhs.begin(), rhs.end(), data());
+        m_size = rhs.m_size;
+    }
+
+    void moveFrom(TinyRoomIdSet &rhs) noexcept
+    {
+        assert(isInline() && m_size == 0);
+        if (rhs.isInline()) {
+            std::copy(rhs.begin(), rhs.end(), m_storage.inlineIds);
+        } else {
+            m_storage.heap = std::exchange(rhs.m_storage.heap, nullptr);
+            m_capacity = std::exchange(rhs.m_capacity, INLINE_CAPACITY);
+        }
+        m_size = std::exchange(rhs.m_size, 0u);
+    }
+
+    void grow()
+    {
+        const uint32_t newCapacity = m_capacity * 2u;
+        auto *const newHeap = new RoomId[newCapacity];
+        std::copy(begin(), end(), newHeap);
+        if (!isInline())
+            delete[] m_storage.heap;
+        m_storage.heap = newHeap;
+        m_capacity = newCapacity;
+    }
+
+public:
+    NODISCARD const_iterator begin() const { return data(); }
+    NODISCARD const_iterator end() const { return data() + m_size; }
+    NODISCARD size_t size() const { return m_size; }
+    NODISCARD bool empty() const { return m_size == 0; }
+
+    NODISCARD RoomId first() const
+    {
+        assert(!empty());
+        return *begin();
+    }
+
+    NODISCARD const_iterator find(const RoomId id) const
+    {
+        const auto it = std::lower_bound(begin(), end(), id);
+        return (it != end() && *it == id) ? it : end();
+    }
+    NODISCARD bool contains(const RoomId id) const { return find(id) != end(); }
+
+public:
+    void insert(const RoomId id)
+    {
+        const auto pos = static_cast<size_t>(std::lower_bound(begin(), end(), id) - begin());
+        if (pos < m_size && data()[pos] == id)
+            return;
+
+        if (m_size == m_capacity)
+            grow();
+
+        RoomId *const ids = data();
+        std::move_backward(ids + pos, ids + m_size, ids + m_size + 1);
+        ids[pos] = id;
+        ++m_size;
+    }
+
+    void erase(const RoomId id)
+    {
+        const auto it = find(id);
+        if (it == end())
+            return;
+
+        RoomId *const ids = data();
+        const auto pos = static_cast<size_t>(it - ids);
+        std::move(ids + pos + 1, ids + m_size, ids + pos);
+        --m_size;
+    }
+
+    void clear() { m_size = 0; }
+
+public:
+    NODISCARD bool operator==(const TinyRoomIdSet &rhs) const
+    {
+        return m_size == rhs.m_size && std::equal(begin(), end(), rhs.begin());
+    }
+    NODISCARD bool operator!=(const TinyRoomIdSet &rhs) const { return !(*this == rhs); }
+};
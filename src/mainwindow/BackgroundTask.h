@@ -0,0 +1,61 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2023 The MMapper Authors
+
+#include <cassert>
+#include <cstdint>
+#include <future>
+#include <utility>
+
+#include "../global/RuleOf5.h"
+#include "../global/macros.h"
+
+/// Result of a job running on another thread, e.g. a background save.
+///
+/// Every job gets a new generation number. A completion notice that only
+/// arrives after the job was already taken (e.g. through a queued event)
+/// can tell that it's stale, instead of waiting on a newer job.
+template<typename T>
+class NODISCARD BackgroundTask final
+{
+private:
+    std::future<T> m_future;
+    uint64_t m_generation = 0;
+
+public:
+    BackgroundTask() = default;
+    ~BackgroundTask() = default;
+    DELETE_CTORS_AND_ASSIGN_OPS(BackgroundTask);
+
+public:
+    /// Runs job(generation) on another thread, and returns the generation;
+    /// the previous job must have been taken.
+    template<typename Job>
+    uint64_t start(Job &&job)
+    {
+        assert(!m_future.valid());
+        const uint64_t generation = ++m_generation;
+        m_future = std::async(std::launch::async, std::forward<Job>(job), generation);
+        return generation;
+    }
+
+    NODISCARD bool isPending() const { return m_future.valid(); }
+    /// True if the job with this generation hasn't been taken yet.
+    NODISCARD bool isCurrent(const uint64_t generation) const
+    {
+        return m_future.valid() && generation == m_generation;
+    }
+
+    void wait() const
+    {
+        if (m_future.valid()) {
+            m_future.wait();
+        }
+    }
+    /// Waits for the job, and returns its result or rethrows its exception.
+    NODISCARD T take()
+    {
+        assert(m_future.valid());
+        return m_future.get();
+    }
+};
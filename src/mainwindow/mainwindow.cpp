@@ -6,9 +6,11 @@
 
 #include "mainwindow.h"
 
+#include <future>
 #include <memory>
 #include <mutex>
 #include <stdexcept>
+#include <utility>
 #include <vector>
 #include <QActionGroup>
 #include <QCloseEvent>
@@ -51,6 +53,7 @@
 #include "../mapdata/roomselection.h"
 #include "../mapfrontend/mapaction.h"
 #include "../mapfrontend/mapfrontend.h"
+#include "../mapstorage/FlatMapStorage.h"
 #include "../mapstorage/MmpMapStorage.h"
 #include "../mapstorage/PandoraMapStorage.h"
 #include "../mapstorage/XmlMapStorage.h"
@@ -451,20 +454,6 @@ void MainWindow::wireConnections()
 {
     connect(m_pathMachine, &Mmapper2PathMachine::sig_log, this, &MainWindow::slot_log);
 
-    connect(m_pathMachine,
-            QOverload<RoomRecipient &, const Coordinate &>::of(
-                &Mmapper2PathMachine::sig_lookingForRooms),
-            m_mapData,
-            QOverload<RoomRecipient &, const Coordinate &>::of(&MapData::lookingForRooms));
-    connect(m_pathMachine,
-            QOverload<RoomRecipient &, const SigParseEvent &>::of(
-                &Mmapper2PathMachine::sig_lookingForRooms),
-            m_mapData,
-            QOverload<RoomRecipient &, const SigParseEvent &>::of(&MapData::lookingForRooms));
-    connect(m_pathMachine,
-            QOverload<RoomRecipient &, RoomId>::of(&Mmapper2PathMachine::sig_lookingForRooms),
-            m_mapData,
-            QOverload<RoomRecipient &, RoomId>::of(&MapData::lookingForRooms));
     connect(m_mapData,
             &MapFrontend::sig_clearingMap,
             m_pathMachine,
@@ -618,6 +607,11 @@ void MainWindow::createActions()
     exportMm2xmlMapAct->setStatusTip(tr("Save a copy of the map in the MM2XML format"));
     connect(exportMm2xmlMapAct, &QAction::triggered, this, &MainWindow::slot_exportMm2xmlMap);
 
+    exportFlatMapAct = new QAction(tr("Export MMapper2 &Flat Map As..."), this);
+    exportFlatMapAct->setStatusTip(
+        tr("Save a copy of the map in the flat binary format, which loads faster"));
+    connect(exportFlatMapAct, &QAction::triggered, this, &MainWindow::slot_exportFlatMap);
+
     exportWebMapAct = new QAction(tr("Export &Web Map As..."), this);
     exportWebMapAct->setStatusTip(tr("Save a copy of the map for webclients"));
     connect(exportWebMapAct, &QAction::triggered, this, &MainWindow::slot_exportWebMap);
@@ -1147,6 +1141,7 @@ void MainWindow::disableActions(bool value)
     saveAsAct->setDisabled(value);
     exportBaseMapAct->setDisabled(value);
     exportMm2xmlMapAct->setDisabled(value);
+    exportFlatMapAct->setDisabled(value);
     exportWebMapAct->setDisabled(value);
     exportMmpMapAct->setDisabled(value);
     exitAct->setDisabled(value);
@@ -1197,6 +1192,7 @@ void MainWindow::setupMenuBar()
     QMenu *exportMenu = fileMenu->addMenu(QIcon::fromTheme("document-send"), tr("&Export"));
     exportMenu->addAction(exportBaseMapAct);
     exportMenu->addAction(exportMm2xmlMapAct);
+    exportMenu->addAction(exportFlatMapAct);
     exportMenu->addAction(exportWebMapAct);
     exportMenu->addAction(exportMmpMapAct);
     fileMenu->addAction(mergeAct);
@@ -1623,6 +1619,9 @@ void MainWindow::slot_newFile()
 
 void MainWindow::forceNewFile()
 {
+    // The callers have already asked whether to discard a map whose save failed.
+    MAYBE_UNUSED const bool ignored = waitForPendingSave();
+
     MapStorage mapStorage(*m_mapData, "", this);
     auto *storage = static_cast<AbstractMapStorage *>(&mapStorage);
     connect(storage, &AbstractMapStorage::sig_onNewData, getCanvas(), &MapCanvas::slot_dataLoaded);
@@ -1712,7 +1711,8 @@ void MainWindow::slot_open()
         this,
         "Choose map file ...",
         savedLastMapDir,
-        "MMapper2 Maps (*.mm2);;MMapper2 XML Maps (*.mm2xml);;Pandora Maps (*.xml)");
+        "MMapper2 Maps (*.mm2);;MMapper2 XML Maps (*.mm2xml);;MMapper2 Flat Maps (*.mm2f);;"
+        "Pandora Maps (*.xml)");
     if (fileName.isEmpty()) {
         statusBar()->showMessage(tr("No filename provided"), 2000);
         return;
@@ -1854,6 +1854,33 @@ bool MainWindow::slot_exportMm2xmlMap()
     return saveFile(fileNames[0], SaveModeEnum::FULL, SaveFormatEnum::MM2XML);
 }
 
+bool MainWindow::slot_exportFlatMap()
+{
+    const auto makeSaveDialog = [this]() {
+        // FIXME: code duplication
+        auto save = std::make_unique<QFileDialog>(this,
+                                                  "Choose map file name ...",
+                                                  QDir::current().absolutePath());
+        save->setFileMode(QFileDialog::AnyFile);
+        save->setDirectory(QDir(getConfig().autoLoad.lastMapDirectory));
+        save->setNameFilter("MMapper2 Flat Maps (*.mm2f)");
+        save->setDefaultSuffix("mm2f");
+        save->setAcceptMode(QFileDialog::AcceptSave);
+        save->selectFile(QFileInfo(m_mapData->getFileName())
+                             .fileName()
+                             .replace(QRegularExpression(R"(\.mm2$)"), ".mm2f"));
+
+        return save;
+    };
+
+    const auto fileNames = getSaveFileNames(makeSaveDialog());
+    if (fileNames.isEmpty()) {
+        statusBar()->showMessage(tr("No filename provided"), 2000);
+        return false;
+    }
+    return saveFile(fileNames[0], SaveModeEnum::FULL, SaveFormatEnum::MM2F);
+}
+
 bool MainWindow::slot_exportWebMap()
 {
     const auto makeSaveDialog = [this]() {
@@ -1912,6 +1939,8 @@ void MainWindow::slot_about()
 
 bool MainWindow::maybeSave()
 {
+    // A failed background save marks the map as modified again.
+    MAYBE_UNUSED const bool ignored = waitForPendingSave();
     if (!m_mapData->dataChanged())
         return true;
 
@@ -1924,7 +1953,8 @@ bool MainWindow::maybeSave()
                                          QMessageBox::Cancel | QMessageBox::Escape);
 
     if (ret == QMessageBox::Yes) {
-        return slot_save();
+        // The caller is about to close or replace the map, so the save has to be done.
+        return slot_save() && waitForPendingSave();
     }
 
     // REVISIT: is it a bug if this returns true? (Shouldn't this always be false?)
@@ -1961,6 +1991,7 @@ void MainWindow::loadFile(const QString &fileName)
     }
 
     CanvasDisabler canvasDisabler{deref(getCanvas())};
+    MAYBE_UNUSED const bool ignored = waitForPendingSave();
 
     QFile file(fileName);
     if (!file.open(QFile::ReadOnly)) {
@@ -1981,6 +2012,9 @@ void MainWindow::loadFile(const QString &fileName)
         } else if (fileNameLower.endsWith(".mm2xml")) {
             // MMapper2 XML map
             return std::make_unique<XmlMapStorage>(*m_mapData, fileName, &file, this);
+        } else if (fileNameLower.endsWith(".mm2f")) {
+            // MMapper2 flat binary map
+            return std::make_unique<FlatMapStorage>(*m_mapData, fileName, &file, this);
         } else {
             // MMapper2 binary map
             return std::make_unique<MapStorage>(*m_mapData, fileName, &file, this);
@@ -2041,6 +2075,12 @@ bool MainWindow::saveFile(const QString &fileName,
                           const SaveModeEnum mode,
                           const SaveFormatEnum format)
 {
+    if (mode == SaveModeEnum::FULL && format == SaveFormatEnum::MM2) {
+        return saveFileInBackground(fileName);
+    }
+    // An earlier save that failed is superseded by this one.
+    MAYBE_UNUSED const bool ignored = waitForPendingSave();
+
     CanvasDisabler canvasDisabler{deref(getCanvas())};
 
     FileSaver saver;
@@ -2060,6 +2100,8 @@ bool MainWindow::saveFile(const QString &fileName,
             return std::make_unique<MapStorage>(*m_mapData, fileName, &saver.file(), this);
         case SaveFormatEnum::MM2XML:
             return std::make_unique<XmlMapStorage>(*m_mapData, fileName, &saver.file(), this);
+        case SaveFormatEnum::MM2F:
+            return std::make_unique<FlatMapStorage>(*m_mapData, fileName, &saver.file(), this);
         case SaveFormatEnum::MMP:
             return std::make_unique<MmpMapStorage>(*m_mapData, fileName, &saver.file(), this);
         case SaveFormatEnum::WEB:
@@ -2113,6 +2155,98 @@ bool MainWindow::saveFile(const QString &fileName,
     return true;
 }
 
+// Only copying the map blocks the UI; it's written and compressed on another thread.
+bool MainWindow::saveFileInBackground(const QString &fileName)
+{
+    // An earlier save that failed is superseded by this one.
+    MAYBE_UNUSED const bool ignored = waitForPendingSave();
+
+    auto saver = std::make_unique<FileSaver>();
+    try {
+        saver->open(fileName);
+    } catch (const std::exception &e) {
+        showWarning(tr("Cannot write file %1:\n%2.").arg(fileName).arg(e.what()));
+        return false;
+    }
+
+    MapStorage storage{*m_mapData, fileName, &saver->file(), this};
+    connect(&storage, &AbstractMapStorage::sig_log, this, &MainWindow::slot_log);
+    MapStorage::SharedSnapshot snapshot = storage.takeSnapshot(false);
+
+    // Changes made from now on belong to the next save.
+    m_mapData->unsetDataChanged();
+    setWindowModified(false);
+    saveAct->setEnabled(false);
+    statusBar()->showMessage(tr("Saving map..."));
+
+    m_pendingSaveFileName = fileName;
+    m_pendingSaveFailed = false;
+    m_pendingSave.start(
+        [this, snapshot = std::move(snapshot), saver = std::move(saver)](
+            const uint64_t saveGeneration) -> double {
+            const auto notify = [this, saveGeneration]() {
+                QMetaObject::invokeMethod(
+                    this,
+                    [this, saveGeneration]() {
+                        // A later save may have waited for this one already.
+                        if (m_pendingSave.isCurrent(saveGeneration)) {
+                            finishPendingSave();
+                        }
+                    },
+                    Qt::QueuedConnection);
+            };
+            try {
+                const double compressionRatio = MapStorage::writeSnapshot(deref(snapshot),
+                                                                          saver->file());
+                saver->close();
+                notify();
+                return compressionRatio;
+            } catch (...) {
+                saver->abort();
+                notify();
+                throw;
+            }
+        });
+    return true;
+}
+
+bool MainWindow::waitForPendingSave()
+{
+    if (m_pendingSave.isPending()) {
+        m_pendingSave.wait();
+        finishPendingSave();
+    }
+    return !m_pendingSaveFailed;
+}
+
+void MainWindow::finishPendingSave()
+{
+    if (!m_pendingSave.isPending()) {
+        // already finished by waitForPendingSave()
+        return;
+    }
+
+    const QString fileName = std::exchange(m_pendingSaveFileName, QString{});
+    try {
+        const double compressionRatio = m_pendingSave.take();
+        slot_log("MapStorage",
+                 QString("Map compressed (compression ratio of %1:1)")
+                     .arg(QString::number(compressionRatio, 'f', 1)));
+    } catch (const std::exception &e) {
+        m_pendingSaveFailed = true;
+        m_mapData->setDataChanged();
+        setWindowModified(true);
+        saveAct->setEnabled(true);
+        statusBar()->clearMessage();
+        showWarning(tr("Cannot write file %1:\n%2.").arg(fileName).arg(e.what()));
+        return;
+    }
+
+    m_mapData->setFileName(fileName, !QFileInfo(fileName).isWritable());
+    setCurrentFile(fileName);
+    statusBar()->showMessage(tr("File saved"), 2000);
+}
+
 void MainWindow::slot_onFindRoom()
 {
     m_findRoomsDlg->show();
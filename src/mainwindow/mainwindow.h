@@ -5,6 +5,7 @@
 // Author: Marek Krejza <krejza@gmail.com> (Caligor)
 // Author: Nils Schimmelmann <nschimme@gmail.com> (Jahara)
 
+#include <future>
 #include <memory>
 #include <optional>
 #include <QActionGroup>
@@ -22,6 +23,7 @@
 #include "../display/CanvasMouseModeEnum.h"
 #include "../mapdata/roomselection.h"
 #include "../pandoragroup/mmapper2group.h"
+#include "BackgroundTask.h"
 
 class AutoLogger;
 class AbstractAction;
@@ -68,7 +70,7 @@ class MainWindow final : public QMainWindow
     ~MainWindow() final;
 
     enum class NODISCARD SaveModeEnum { FULL, BASEMAP };
-    enum class NODISCARD SaveFormatEnum { MM2, MM2XML, WEB, MMP };
+    enum class NODISCARD SaveFormatEnum { MM2, MM2XML, MM2F, WEB, MMP };
     bool saveFile(const QString &fileName, SaveModeEnum mode, SaveFormatEnum format);
     void loadFile(const QString &fileName);
     void setCurrentFile(const QString &fileName);
@@ -87,6 +89,7 @@ public slots:
     bool slot_saveAs();
     bool slot_exportBaseMap();
     bool slot_exportMm2xmlMap();
+    bool slot_exportFlatMap();
     bool slot_exportWebMap();
     bool slot_exportMmpMap();
     void slot_about();
@@ -160,6 +163,11 @@ public slots:
     void forceNewFile();
     void showWarning(const QString &s);
 
+    NODISCARD bool saveFileInBackground(const QString &fileName);
+    /// Returns false if the last background save failed.
+    NODISCARD bool waitForPendingSave();
+    void finishPendingSave();
+
 private:
     MapWindow *m_mapWindow = nullptr;
     QTextBrowser *logWindow = nullptr;
@@ -198,6 +206,11 @@ public slots:
 
     std::unique_ptr<QProgressDialog> m_progressDlg;
 
+    // MM2 save running on another thread; yields the compression ratio
+    BackgroundTask<double> m_pendingSave;
+    QString m_pendingSaveFileName;
+    bool m_pendingSaveFailed = false;
+
     QToolBar *fileToolBar = nullptr;
     QToolBar *mouseModeToolBar = nullptr;
     QToolBar *mapperModeToolBar = nullptr;
@@ -229,6 +242,7 @@ public slots:
     QAction *saveAsAct = nullptr;
     QAction *exportBaseMapAct = nullptr;
     QAction *exportMm2xmlMapAct = nullptr;
+    QAction *exportFlatMapAct = nullptr;
     QAction *exportWebMapAct = nullptr;
     QAction *exportMmpMapAct = nullptr;
     QAction *exitAct = nullptr;
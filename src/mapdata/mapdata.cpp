@@ -11,7 +11,9 @@
 #include <list>
 #include <map>
 #include <memory>
+#include <optional>
 #include <set>
+#include <utility>
 #include <QList>
 #include <QString>
 
@@ -171,18 +173,56 @@ const Room *MapData::getRoom(const RoomId id, RoomSelection &selection)
 void MapData::generateBatches(MapCanvasRoomDrawer &screen, const OptBounds &bounds)
 {
     QMutexLocker locker(&mapLock);
-    const LayerToRooms layerToRooms = [this]() -> LayerToRooms {
+    LayerToRooms layerToRooms = [this]() -> LayerToRooms {
         LayerToRooms ltr;
         DrawStream drawer(ltr);
         map.getRooms(drawer);
         return ltr;
     }();
-    screen.generateBatches(layerToRooms, roomIndex, bounds);
+    // The batches are generated on other threads, after the lock is released.
+    addReaders(screen.generateBatches(std::move(layerToRooms), roomIndex, bounds));
+}
+
+std::optional<std::vector<Coordinate>> MapData::takeMeshUpdates()
+{
+    QMutexLocker locker(&mapLock);
+    const bool needsFullMapUpdate = getNeedsFullMapUpdate();
+    std::vector<Coordinate> positions;
+    swapMeshUpdates(positions);
+    if (needsFullMapUpdate) {
+        return std::nullopt;
+    }
+    return positions;
+}
+
+void MapData::notifyConnectedMeshesModified(const Room &room)
+{
+    // Connections and streams are drawn with the rooms on both ends.
+    if (getNeedsFullMapUpdate()) {
+        return;
+    }
+    const auto notifyRoom = [this](const RoomId id) {
+        if (id.asUint32() >= roomIndex.size()) {
+            return;
+        }
+        if (const SharedRoom &other = roomIndex[id]) {
+            notifyMeshModified(other->getPosition());
+        }
+    };
+    for (const Exit &e : room.getExitsList()) {
+        for (const RoomId id : e.inRange()) {
+            notifyRoom(id);
+        }
+        for (const RoomId id : e.outRange()) {
+            notifyRoom(id);
+        }
+    }
 }
 
 bool MapData::execute(std::unique_ptr<MapAction> action, const SharedRoomSelection &selection)
 {
     QMutexLocker locker(&mapLock);
+    waitForReaders();
     action->schedule(this);
     std::list<RoomId> selectedIds;
 
@@ -214,6 +254,8 @@ bool MapData::execute(std::unique_ptr<MapAction> action, const SharedRoomSelecti
 void MapData::virt_clear()
 {
     m_markers.clear();
+    m_shortestPath.invalidate();
+    m_shortestPath.invalidateLandmarks();
     log("cleared MapData");
 }
 
@@ -247,6 +289,20 @@ void MapData::genericSearch(RoomRecipient *recipient, const RoomFilter &f)
     }
 }
 
+const Room *MapData::findUniqueMatch(const RoomFilter &f)
+{
+    QMutexLocker locker(&mapLock);
+    const Room *found = nullptr;
+    for (const SharedRoom &room : roomIndex) {
+        if (room == nullptr || !f.filter(room.get()))
+            continue;
+        if (found != nullptr)
+            return nullptr;
+        found = room.get();
+    }
+    return found;
+}
+
 MapData::~MapData() = default;
 
 void MapData::removeMarker(const std::shared_ptr<InfoMark> &im)
@@ -7,6 +7,7 @@
 
 #include <map>
 #include <memory>
+#include <optional>
 #include <vector>
 #include <QList>
 #include <QString>
@@ -49,6 +50,7 @@ class MapData final : public MapFrontend
     bool m_fileReadOnly = false;
     QString m_fileName;
     Coordinate m_position;
+    ShortestPathSearch m_shortestPath;
 
 protected:
     // the room will be inserted in the given selection. the selection must have been created by mapdata
@@ -60,6 +62,9 @@ class MapData final : public MapFrontend
     ~MapData() override;
 
     void generateBatches(MapCanvasRoomDrawer &screen, const OptBounds &bounds);
+    // Positions whose meshes changed since the last call, or std::nullopt if the whole
+    // map has to be regenerated. Taken under mapLock, since rooms can change on any thread.
+    NODISCARD std::optional<std::vector<Coordinate>> takeMeshUpdates();
 
     /* REVISIT: some callers ignore this */
     bool execute(std::unique_ptr<MapAction> action, const SharedRoomSelection &unlock);
@@ -88,12 +93,19 @@ class MapData final : public MapFrontend
 public:
     // search for matches
     void genericSearch(RoomRecipient *recipient, const RoomFilter &f);
+    // the only room matching the filter, or nullptr if there are none or several;
+    // stops at the second match and doesn't lock the rooms it finds
+    NODISCARD const Room *findUniqueMatch(const RoomFilter &f);
 
     void shortestPathSearch(const Room *origin,
                             ShortestPathRecipient *recipient,
                             const RoomFilter &f,
                             int max_hits = -1,
                             double max_dist = 0);
+    // goal-directed (A*) search for the route to a single room
+    void shortestPathSearch(const Room *origin,
+                            const Room *target,
+                            ShortestPathRecipient *recipient);
 
     // Used in Console Commands
     void removeDoorNames();
@@ -121,10 +133,26 @@ class MapData final : public MapFrontend
     void virt_onNotifyModified(Room &room, const RoomUpdateFlags updateFlags) override
     {
         RoomModificationTracker::virt_onNotifyModified(room, updateFlags);
+        if (updateFlags.contains(RoomUpdateEnum::Mesh)) {
+            notifyConnectedMeshesModified(room);
+        }
+        if (updateFlags.contains(RoomUpdateEnum::ConnectionsOut)
+            || updateFlags.contains(RoomUpdateEnum::Coord)) {
+            m_shortestPath.invalidate();
+        }
+        // Travel costs depend on exits, exit flags, terrain and ridability;
+        // the latter is only reported as a mesh change.
+        if (updateFlags.contains(RoomUpdateEnum::ConnectionsOut)
+            || updateFlags.contains(RoomUpdateEnum::ExitFlags)
+            || updateFlags.contains(RoomUpdateEnum::Terrain)
+            || updateFlags.contains(RoomUpdateEnum::Mesh)) {
+            m_shortestPath.invalidateLandmarks();
+        }
         if (!m_ignoreModifications) {
             setDataChanged();
         }
     }
+    void notifyConnectedMeshesModified(const Room &room);
     void virt_onNotifyModified(InfoMark &mark, const InfoMarkUpdateFlags updateFlags) override
     {
         InfoMarkModificationTracker::virt_onNotifyModified(mark, updateFlags);
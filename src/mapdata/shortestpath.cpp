@@ -4,18 +4,24 @@
 
 #include "shortestpath.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <limits>
 #include <memory>
+#include <queue>
 #include <type_traits>
 #include <utility>
+#include <vector>
 #include <QBasicMutex>
-#include <QSet>
-#include <QVector>
-#include <queue>
 
 #include "../expandoracommon/exit.h"
 #include "../expandoracommon/room.h"
 #include "../global/enums.h"
 #include "../global/roomid.h"
+#include "../global/utils.h"
 #include "ExitDirection.h"
 #include "ExitFlags.h"
 #include "mapdata.h"
@@ -94,61 +100,460 @@ NODISCARD static double getLength(const Exit &e, const Room *curr, const Room *n
     return cost;
 }
 
-void MapData::shortestPathSearch(const Room *origin,
-                                 ShortestPathRecipient *recipient,
-                                 const RoomFilter &f,
-                                 int max_hits,
-                                 double max_dist)
+// Cheapest possible step: an indoors/city/tunnel/cavern room reached by road.
+static constexpr const double MIN_STEP_COST = 0.75 - 0.1;
+
+NODISCARD static const Room *getUniqueTarget(const RoomIndex &roomIndex,
+                                             const Room &from,
+                                             const Exit &e)
 {
-    QMutexLocker locker(&mapLock);
-    QVector<SPNode> sp_nodes;
-    QSet<RoomId> visited;
-    std::priority_queue<std::pair<double, int>> future_paths;
-    sp_nodes.push_back(SPNode(origin, -1, 0, ExitDirEnum::UNKNOWN));
-    future_paths.push(std::make_pair(0, 0));
-    while (!future_paths.empty()) {
-        int spindex = future_paths.top().second;
-        future_paths.pop();
-        const Room *thisr = sp_nodes[spindex].r;
-        auto thisdist = sp_nodes[spindex].dist;
-        auto room_id = thisr->getId();
-        if (visited.contains(room_id)) {
+    if (!e.outIsUnique()) {
+        // 0: Not mapped
+        // 2+: Random, so no clear directions; skip it.
+        return nullptr;
+    }
+    if (!e.isExit()) {
+        return nullptr;
+    }
+    const RoomId to = e.outFirst();
+    const SharedRoom *const nextr = (to.asUint32() < roomIndex.size()) ? &roomIndex[to] : nullptr;
+    if (nextr == nullptr || *nextr == nullptr) {
+        qWarning() << "Source room" << from.getId().asUint32() << "("
+                   << from.getName().toQString() << ") has target room" << to.asUint32()
+                   << "which does not exist!";
+        return nullptr;
+    }
+    return nextr->get();
+}
+
+NODISCARD static int manhattan(const Coordinate &a, const Coordinate &b)
+{
+    const Coordinate d = a - b;
+    return std::abs(d.x) + std::abs(d.y) + std::abs(d.z);
+}
+
+static constexpr const double INFINITE_COST = std::numeric_limits<double>::infinity();
+
+NODISCARD static RoutingLandmarks::Graph makeGraph(const RoomIndex &roomIndex)
+{
+    RoutingLandmarks::Graph graph;
+    graph.offsets.reserve(roomIndex.size() + 1);
+    graph.offsets.push_back(0);
+    for (const SharedRoom &room : roomIndex) {
+        if (room != nullptr) {
+            for (const Exit &e : room->getExitsList()) {
+                // same edges as the search, but without getUniqueTarget()'s warnings
+                if (!e.isExit() || !e.outIsUnique())
+                    continue;
+                const RoomId to = e.outFirst();
+                if (to.asUint32() >= roomIndex.size() || roomIndex[to] == nullptr)
+                    continue;
+                graph.targets.push_back(to.asUint32());
+                graph.costs.push_back(getLength(e, room.get(), roomIndex[to].get()));
+            }
+        }
+        graph.offsets.push_back(static_cast<uint32_t>(graph.targets.size()));
+    }
+    return graph;
+}
+
+NODISCARD static RoutingLandmarks::Graph makeReverseGraph(const RoutingLandmarks::Graph &graph)
+{
+    const size_t numRooms = graph.size();
+    RoutingLandmarks::Graph reverse;
+    reverse.offsets.assign(numRooms + 1, 0);
+    for (const uint32_t to : graph.targets)
+        ++reverse.offsets[to + 1];
+    for (size_t i = 0; i < numRooms; ++i)
+        reverse.offsets[i + 1] += reverse.offsets[i];
+
+    reverse.targets.resize(graph.targets.size());
+    reverse.costs.resize(graph.costs.size());
+    std::vector<uint32_t> fill(reverse.offsets.begin(), reverse.offsets.end() - 1);
+    for (uint32_t from = 0; from < numRooms; ++from) {
+        for (uint32_t i = graph.offsets[from]; i < graph.offsets[from + 1]; ++i) {
+            const uint32_t slot = fill[graph.targets[i]]++;
+            reverse.targets[slot] = from;
+            reverse.costs[slot] = graph.costs[i];
+        }
+    }
+    return reverse;
+}
+
+// Plain single-source Dijkstra; returns false if cancelled.
+NODISCARD static bool dijkstra(const RoutingLandmarks::Graph &graph,
+                               const uint32_t source,
+                               std::vector<double> &dist,
+                               const std::atomic_bool &cancel)
+{
+    using Entry = std::pair<double, uint32_t>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+    dist.assign(graph.size(), INFINITE_COST);
+    dist[source] = 0.0;
+    queue.emplace(0.0, source);
+
+    size_t popped = 0;
+    while (!queue.empty()) {
+        const auto [d, v] = queue.top();
+        queue.pop();
+        if (d > dist[v])
+            continue;
+        if ((++popped & 0xFFFu) == 0 && cancel.load(std::memory_order_relaxed))
+            return false;
+        for (uint32_t i = graph.offsets[v]; i < graph.offsets[v + 1]; ++i) {
+            const uint32_t to = graph.targets[i];
+            const double nd = d + graph.costs[i];
+            if (nd < dist[to]) {
+                dist[to] = nd;
+                queue.emplace(nd, to);
+            }
+        }
+    }
+    return true;
+}
+
+std::shared_ptr<const RoutingLandmarks> RoutingLandmarks::build(const Graph &graph,
+                                                                const std::atomic_bool &cancel)
+{
+    const size_t numRooms = graph.size();
+    const Graph reverse = makeReverseGraph(graph);
+
+    // Only rooms that take part in the graph can be useful landmarks.
+    std::vector<bool> connected(numRooms, false);
+    for (size_t v = 0; v < numRooms; ++v) {
+        if (graph.offsets[v] != graph.offsets[v + 1]
+            || reverse.offsets[v] != reverse.offsets[v + 1])
+            connected[v] = true;
+    }
+
+    // "Farthest" selection: each new landmark is the room farthest from all
+    // of the previous ones; unreachable rooms count as infinitely far, which
+    // spreads the landmarks over disconnected parts of the map, too.
+    std::vector<double> closest(numRooms, INFINITE_COST);
+    const auto pickFarthest = [&connected, &closest, numRooms]() -> std::optional<uint32_t> {
+        std::optional<uint32_t> best;
+        for (uint32_t v = 0; v < numRooms; ++v) {
+            if (connected[v] && closest[v] > 0.0 && (!best || closest[v] > closest[*best]))
+                best = v;
+        }
+        return best;
+    };
+
+    std::optional<uint32_t> next = pickFarthest();
+    if (next) {
+        // The first pick is arbitrary, so use the room farthest away from it instead.
+        std::vector<double> dist;
+        if (!dijkstra(graph, *next, dist, cancel))
+            return nullptr;
+        for (size_t v = 0; v < numRooms; ++v)
+            closest[v] = std::isfinite(dist[v]) ? dist[v] : 0.0;
+        if (const auto farthest = pickFarthest())
+            next = farthest;
+    }
+
+    std::vector<uint32_t> landmarks;
+    std::vector<std::vector<double>> from;
+    std::vector<std::vector<double>> to;
+    for (; next && landmarks.size() < MAX_LANDMARKS; next = pickFarthest()) {
+        const uint32_t landmark = *next;
+        landmarks.push_back(landmark);
+
+        from.emplace_back();
+        to.emplace_back();
+        if (!dijkstra(graph, landmark, from.back(), cancel)
+            || !dijkstra(reverse, landmark, to.back(), cancel)) {
+            return nullptr;
+        }
+
+        if (landmarks.size() == 1)
+            std::fill(closest.begin(), closest.end(), INFINITE_COST);
+        for (size_t v = 0; v < numRooms; ++v)
+            closest[v] = std::min(closest[v], from.back()[v]);
+        closest[landmark] = 0.0;
+    }
+
+    auto result = std::make_shared<RoutingLandmarks>();
+    result->m_numRooms = numRooms;
+    result->m_numLandmarks = landmarks.size();
+    result->m_from.resize(numRooms * landmarks.size());
+    result->m_to.resize(numRooms * landmarks.size());
+    for (size_t v = 0; v < numRooms; ++v) {
+        for (size_t k = 0; k < landmarks.size(); ++k) {
+            result->m_from[v * landmarks.size() + k] = from[k][v];
+            result->m_to[v * landmarks.size() + k] = to[k][v];
+        }
+    }
+    return result;
+}
+
+double RoutingLandmarks::lowerBound(const uint32_t from, const uint32_t to) const
+{
+    if (from >= m_numRooms || to >= m_numRooms)
+        return 0.0;
+
+    const double *const fromV = &m_from[from * m_numLandmarks];
+    const double *const fromT = &m_from[to * m_numLandmarks];
+    const double *const toV = &m_to[from * m_numLandmarks];
+    const double *const toT = &m_to[to * m_numLandmarks];
+
+    double bound = 0.0;
+    for (size_t k = 0; k < m_numLandmarks; ++k) {
+        // d(v,t) >= d(L,t) - d(L,v); if L reaches v but not t, then v can't reach t either.
+        if (std::isfinite(fromV[k]))
+            bound = std::max(bound, fromT[k] - fromV[k]);
+        // d(v,t) >= d(v,L) - d(t,L); if t reaches L but v doesn't, then v can't reach t either.
+        if (std::isfinite(toT[k]))
+            bound = std::max(bound, toV[k] - toT[k]);
+    }
+    return bound;
+}
+
+ShortestPathSearch::~ShortestPathSearch()
+{
+    invalidateLandmarks();
+    for (auto &cancelled : m_cancelledLandmarks)
+        cancelled.wait();
+}
+
+void ShortestPathSearch::invalidateLandmarks()
+{
+    m_landmarks.reset();
+
+    // Finished builds can go; the rest are still checking their cancel flag.
+    const auto isReady = [](const std::future<SharedLandmarks> &f) {
+        return f.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    };
+    m_cancelledLandmarks.erase(std::remove_if(m_cancelledLandmarks.begin(),
+                                              m_cancelledLandmarks.end(),
+                                              isReady),
+                               m_cancelledLandmarks.end());
+
+    if (!m_pendingLandmarks.valid())
+        return;
+
+    // This runs under the map lock, so don't wait for the worker here;
+    // it notices within a few thousand rooms, and only touches its own snapshot.
+    deref(m_cancelLandmarks).store(true);
+    m_cancelLandmarks.reset();
+    m_cancelledLandmarks.emplace_back(std::move(m_pendingLandmarks));
+}
+
+void ShortestPathSearch::buildLandmarks(const RoomIndex &roomIndex)
+{
+    if (m_landmarks != nullptr || m_pendingLandmarks.valid())
+        return;
+
+    // The snapshot is taken by the caller's thread (under the map lock);
+    // the worker only ever touches its own copy.
+    auto cancel = std::make_shared<std::atomic_bool>(false);
+    m_cancelLandmarks = cancel;
+    m_pendingLandmarks = std::async(std::launch::async,
+                                    [graph = makeGraph(roomIndex), cancel]() -> SharedLandmarks {
+                                        return RoutingLandmarks::build(graph, *cancel);
+                                    });
+}
+
+void ShortestPathSearch::waitForLandmarks(const RoomIndex &roomIndex)
+{
+    buildLandmarks(roomIndex);
+    if (m_pendingLandmarks.valid())
+        m_pendingLandmarks.wait();
+    MAYBE_UNUSED const auto ignored = pollLandmarks();
+}
+
+const RoutingLandmarks *ShortestPathSearch::pollLandmarks()
+{
+    if (m_pendingLandmarks.valid()
+        && m_pendingLandmarks.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        m_landmarks = m_pendingLandmarks.get();
+        m_cancelLandmarks.reset();
+    }
+    return m_landmarks.get();
+}
+
+void ShortestPathSearch::beginSearch(const size_t numRooms)
+{
+    if (m_best.size() < numRooms) {
+        m_best.resize(numRooms, 0.0);
+        m_seenEpoch.resize(numRooms, 0u);
+        m_doneEpoch.resize(numRooms, 0u);
+    }
+    if (++m_epoch == 0) {
+        // wrapped around; forget every stale mark
+        std::fill(m_seenEpoch.begin(), m_seenEpoch.end(), 0u);
+        std::fill(m_doneEpoch.begin(), m_doneEpoch.end(), 0u);
+        m_epoch = 1;
+    }
+    m_nodes.clear();
+    m_queue.clear();
+}
+
+int ShortestPathSearch::getMaxExitSpan(const RoomIndex &roomIndex)
+{
+    if (m_maxExitSpan.has_value())
+        return m_maxExitSpan.value();
+
+    int maxSpan = 0;
+    for (const SharedRoom &room : roomIndex) {
+        if (room == nullptr)
+            continue;
+        for (const Exit &e : room->getExitsList()) {
+            for (const RoomId to : e.outRange()) {
+                if (to.asUint32() >= roomIndex.size())
+                    continue;
+                if (const SharedRoom &other = roomIndex[to]) {
+                    maxSpan = std::max(maxSpan,
+                                       manhattan(room->getPosition(), other->getPosition()));
+                }
+            }
+        }
+    }
+    m_maxExitSpan = maxSpan;
+    return maxSpan;
+}
+
+double ShortestPathSearch::heuristic(const Room &room,
+                                     const Room *const target,
+                                     const int maxSpan,
+                                     const RoutingLandmarks *const landmarks) const
+{
+    if (target == nullptr)
+        return 0.0;
+
+    double bound = 0.0;
+    if (maxSpan > 0) {
+        // Every step moves at most maxSpan and costs at least MIN_STEP_COST,
+        // and the step count only changes by one per exit, so this is consistent.
+        const int dist = manhattan(room.getPosition(), target->getPosition());
+        const int steps = (dist + maxSpan - 1) / maxSpan;
+        bound = MIN_STEP_COST * steps;
+    }
+    if (landmarks != nullptr) {
+        // Landmark bounds are consistent too, and so is the max of both.
+        const double landmarkBound = landmarks->lowerBound(room.getId().asUint32(),
+                                                           target->getId().asUint32());
+        bound = std::max(bound, landmarkBound);
+    }
+    return bound;
+}
+
+void ShortestPathSearch::search(const RoomIndex &roomIndex,
+                                RoomAdmin *const admin,
+                                ShortestPathRecipient &recipient,
+                                const Query &query)
+{
+    const Room *const origin = query.origin;
+    if (origin == nullptr)
+        return;
+
+    beginSearch(roomIndex.size());
+    const int maxSpan = (query.target != nullptr) ? getMaxExitSpan(roomIndex) : 0;
+    const RoutingLandmarks *landmarks = nullptr;
+    if (query.target != nullptr) {
+        // Until the landmarks are ready, the coordinate bound has to do.
+        buildLandmarks(roomIndex);
+        landmarks = pollLandmarks();
+    }
+    const auto isMatch = [&query](const Room *r) -> bool {
+        if (query.target != nullptr)
+            return r == query.target;
+        return query.filter != nullptr && query.filter->filter(r);
+    };
+
+    // std::priority_queue can't be cleared without losing its storage,
+    // so the heap lives in a reusable vector. Smallest estimate on top.
+    const auto cmp = [](const QueueEntry &a, const QueueEntry &b) { return a.first > b.first; };
+    const auto push = [this, &cmp](const double estimate, const int index) {
+        m_queue.emplace_back(estimate, index);
+        std::push_heap(m_queue.begin(), m_queue.end(), cmp);
+    };
+
+    int max_hits = query.max_hits;
+    const auto originId = origin->getId().asUint32();
+    m_nodes.emplace_back(origin, -1, 0, ExitDirEnum::UNKNOWN);
+    m_best[originId] = 0.0;
+    m_seenEpoch[originId] = m_epoch;
+    const double originEstimate = heuristic(*origin, query.target, maxSpan, landmarks);
+    if (!std::isfinite(originEstimate)) {
+        // unreachable
+        return;
+    }
+    push(originEstimate, 0);
+
+    while (!m_queue.empty()) {
+        std::pop_heap(m_queue.begin(), m_queue.end(), cmp);
+        const int spindex = m_queue.back().second;
+        m_queue.pop_back();
+
+        const SPNode node = m_nodes[static_cast<size_t>(spindex)];
+        const Room *const thisr = node.r;
+        const auto thisId = thisr->getId().asUint32();
+        if (m_doneEpoch[thisId] == m_epoch) {
             continue;
         }
-        visited.insert(room_id);
-        if (f.filter(thisr)) {
-            recipient->receiveShortestPath(this, sp_nodes, spindex);
-            if (--max_hits == 0) {
+        m_doneEpoch[thisId] = m_epoch;
+
+        if (isMatch(thisr)) {
+            recipient.receiveShortestPath(admin, m_nodes, spindex);
+            if (--max_hits == 0 || query.target != nullptr) {
                 return;
             }
         }
-        if ((max_dist != 0.0) && thisdist > max_dist) {
+        if ((query.max_dist != 0.0) && node.dist > query.max_dist) {
             return;
         }
-        ExitsList exits = thisr->getExitsList();
+
+        const ExitsList &exits = thisr->getExitsList();
         for (const ExitDirEnum dir : enums::makeCountingIterator<ExitDirEnum>(exits)) {
             const Exit &e = exits[dir];
-            if (!e.outIsUnique()) {
-                // 0: Not mapped
-                // 2+: Random, so no clear directions; skip it.
+            const Room *const nextr = getUniqueTarget(roomIndex, *thisr, e);
+            if (nextr == nullptr) {
                 continue;
             }
-            if (!e.isExit()) {
+            const auto nextId = nextr->getId().asUint32();
+            if (m_doneEpoch[nextId] == m_epoch) {
                 continue;
             }
-            const SharedConstRoom &nextr = roomIndex[e.outFirst()];
-            if (!nextr) {
-                qWarning() << "Source room" << thisr->getId().asUint32() << "("
-                           << thisr->getName().toQString() << ") has target room"
-                           << e.outFirst().asUint32() << "which does not exist!";
+            const double dist = node.dist + getLength(e, thisr, nextr);
+            if (m_seenEpoch[nextId] == m_epoch && m_best[nextId] <= dist) {
+                // already queued with a shorter (or equal) distance
                 continue;
             }
-            if (visited.contains(nextr->getId())) {
+            const double estimate = heuristic(*nextr, query.target, maxSpan, landmarks);
+            if (!std::isfinite(estimate)) {
+                // the target can't be reached from there
                 continue;
             }
-            const double length = getLength(e, thisr, nextr.get());
-            sp_nodes.push_back(SPNode(nextr.get(), spindex, thisdist + length, dir));
-            future_paths.push(std::make_pair(-(thisdist + length), sp_nodes.size() - 1));
+            m_seenEpoch[nextId] = m_epoch;
+            m_best[nextId] = dist;
+            m_nodes.emplace_back(nextr, spindex, dist, dir);
+            push(dist + estimate, static_cast<int>(m_nodes.size() - 1));
         }
     }
 }
+
+void MapData::shortestPathSearch(const Room *origin,
+                                 ShortestPathRecipient *recipient,
+                                 const RoomFilter &f,
+                                 int max_hits,
+                                 double max_dist)
+{
+    QMutexLocker locker(&mapLock);
+    ShortestPathSearch::Query query;
+    query.origin = origin;
+    query.filter = &f;
+    query.max_hits = max_hits;
+    query.max_dist = max_dist;
+    m_shortestPath.search(roomIndex, this, deref(recipient), query);
+}
+
+void MapData::shortestPathSearch(const Room *origin,
+                                 const Room *target,
+                                 ShortestPathRecipient *recipient)
+{
+    QMutexLocker locker(&mapLock);
+    ShortestPathSearch::Query query;
+    query.origin = origin;
+    query.target = target;
+    m_shortestPath.search(roomIndex, this, deref(recipient), query);
+}
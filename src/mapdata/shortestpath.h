@@ -3,16 +3,24 @@
 // Copyright (C) 2019 The MMapper Authors
 // Author: 'Elval' <ethorondil@gmail.com> (Elval)
 
-#include <QSet>
-#include <QVector>
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
 
 #include "../expandoracommon/RoomAdmin.h"
+#include "../global/RuleOf5.h"
+#include "../global/roomid.h"
 #include "../parser/abstractparser.h"
 #include "ExitDirection.h"
 #include "mmapper2exit.h"
 
 class Room;
 class RoomAdmin;
+class RoomFilter;
 
 class NODISCARD SPNode final
 {
@@ -38,12 +46,129 @@ class NODISCARD ShortestPathRecipient
     virtual ~ShortestPathRecipient();
 
 private:
-    virtual void virt_receiveShortestPath(RoomAdmin *admin, QVector<SPNode> spnodes, int endpoint)
+    virtual void virt_receiveShortestPath(RoomAdmin *admin,
+                                          const std::vector<SPNode> &spnodes,
+                                          int endpoint)
         = 0;
 
 public:
-    void receiveShortestPath(RoomAdmin *const admin, QVector<SPNode> spnodes, const int endpoint)
+    void receiveShortestPath(RoomAdmin *const admin,
+                             const std::vector<SPNode> &spnodes,
+                             const int endpoint)
     {
-        virt_receiveShortestPath(admin, std::move(spnodes), endpoint);
+        virt_receiveShortestPath(admin, spnodes, endpoint);
     }
 };
+
+/// Landmark lower bounds on travel cost (ALT).
+///
+/// For a few landmark rooms spread across the map, the exact travel cost to
+/// and from every room is precomputed with the same cost model as the search.
+/// By the triangle inequality, differences of those costs bound the remaining
+/// cost to a target from below, which is far tighter than the coordinate bound.
+class NODISCARD RoutingLandmarks final
+{
+public:
+    static constexpr const size_t MAX_LANDMARKS = 8;
+
+    // Snapshot of the exit graph in compressed sparse row form, indexed by RoomId.
+    struct NODISCARD Graph final
+    {
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> targets;
+        std::vector<double> costs;
+
+        NODISCARD size_t size() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+    };
+
+private:
+    size_t m_numRooms = 0;
+    size_t m_numLandmarks = 0;
+    // row-major: [room * m_numLandmarks + landmark]
+    std::vector<double> m_from;
+    std::vector<double> m_to;
+
+public:
+    // Returns nullptr if cancelled.
+    NODISCARD static std::shared_ptr<const RoutingLandmarks> build(const Graph &graph,
+                                                                   const std::atomic_bool &cancel);
+
+public:
+    NODISCARD size_t size() const { return m_numRooms; }
+    // Infinite if the target can't be reached from the room at all.
+    NODISCARD double lowerBound(uint32_t from, uint32_t to) const;
+};
+
+/// Dijkstra / A* search over the exit graph.
+///
+/// All per-room state lives in flat RoomId-indexed arrays that are kept
+/// between searches; an epoch counter marks which entries belong to the
+/// current search, so nothing has to be cleared or reallocated per query.
+/// When the search has a single target room, the remaining distance is
+/// bounded from below using room coordinates (A*), and by landmark
+/// distances once they have been computed in the background.
+class NODISCARD ShortestPathSearch final
+{
+private:
+    using QueueEntry = std::pair<double, int>;
+    using SharedLandmarks = std::shared_ptr<const RoutingLandmarks>;
+
+    std::vector<SPNode> m_nodes;
+    std::vector<QueueEntry> m_queue;
+    std::vector<double> m_best;
+    std::vector<uint32_t> m_seenEpoch;
+    std::vector<uint32_t> m_doneEpoch;
+    uint32_t m_epoch = 0;
+
+    // Largest coordinate (manhattan) distance crossed by a single exit;
+    // needed to keep the A* heuristic admissible for non-adjacent exits.
+    std::optional<int> m_maxExitSpan;
+
+    SharedLandmarks m_landmarks;
+    std::future<SharedLandmarks> m_pendingLandmarks;
+    std::shared_ptr<std::atomic_bool> m_cancelLandmarks;
+    // Cancelled builds that haven't finished yet; destroying them would block.
+    std::vector<std::future<SharedLandmarks>> m_cancelledLandmarks;
+
+public:
+    struct NODISCARD Query final
+    {
+        const Room *origin = nullptr;
+        // Either a filter, or a single target room (enables A*).
+        const RoomFilter *filter = nullptr;
+        const Room *target = nullptr;
+        int max_hits = -1;
+        double max_dist = 0.0;
+    };
+
+public:
+    ShortestPathSearch() = default;
+    ~ShortestPathSearch();
+    DELETE_CTORS_AND_ASSIGN_OPS(ShortestPathSearch);
+
+public:
+    // Call when room coordinates change.
+    void invalidate() { m_maxExitSpan.reset(); }
+    // Call when exits or travel costs change; the landmarks are rebuilt by
+    // the next search for a single target room.
+    void invalidateLandmarks();
+    // Searches never wait for the landmarks; this builds them (if needed) and
+    // blocks until they are in use, so the result doesn't depend on timing.
+    void waitForLandmarks(const RoomIndex &roomIndex);
+    NODISCARD bool hasLandmarks() const { return m_landmarks != nullptr; }
+    void search(const RoomIndex &roomIndex,
+                RoomAdmin *admin,
+                ShortestPathRecipient &recipient,
+                const Query &query);
+
+private:
+    // Starts building the landmarks on a worker thread, unless already built or underway.
+    void buildLandmarks(const RoomIndex &roomIndex);
+    void beginSearch(size_t numRooms);
+    NODISCARD int getMaxExitSpan(const RoomIndex &roomIndex);
+    NODISCARD const RoutingLandmarks *pollLandmarks();
+    NODISCARD double heuristic(const Room &room,
+                               const Room *target,
+                               int maxSpan,
+                               const RoutingLandmarks *landmarks) const;
+};
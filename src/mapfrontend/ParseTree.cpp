@@ -5,6 +5,7 @@
 #include "ParseTree.h"
 
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <cctype>
 #include <cstdio>
@@ -15,6 +16,8 @@
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "../expandoracommon/parseevent.h"
 #include "../expandoracommon/property.h"
@@ -109,16 +112,23 @@ NODISCARD static MaskFlagsEnum reduceMask(const MaskFlagsEnum mask)
     throw std::invalid_argument("mask");
 }
 
-NODISCARD static auto makeKey(const ParseEvent &event, const MaskFlagsEnum maskFlags)
+NODISCARD static constexpr uint64_t mix64(uint64_t h)
 {
-    char buf[64];
+    // splitmix64 finalizer
+    h ^= h >> 30;
+    h *= 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 27;
+    h *= 0x94D049BB133111EBull;
+    h ^= h >> 31;
+    return h;
+}
 
+/// Combines the cached per-property hashes selected by the mask.
+/// Skipped properties contribute nothing, which matches the old string keys.
+NODISCARD static uint64_t makeFingerprint(const ParseEvent &event, const MaskFlagsEnum maskFlags)
+{
     const auto mask = static_cast<uint32_t>(maskFlags);
-    std::string key;
-
-    std::snprintf(buf, sizeof(buf), "^K%u", mask);
-    key += buf;
-
+    uint64_t h = mix64(mask);
     for (size_t i = 0; i < ParseEvent::NUM_PROPS; ++i) {
         if (((mask >> i) & 1u) != 1u)
             continue;
@@ -127,29 +137,113 @@ NODISCARD static auto makeKey(const ParseEvent &event, const MaskFlagsEnum maskF
         if (prop.isSkipped())
             continue;
 
-        std::snprintf(buf, sizeof(buf), ";P%zu:%zu:", i, prop.size());
-        key += buf;
-        key += prop.getStdString();
+        h = mix64(h ^ (prop.getHash() + (i + 1u) * 0x9E3779B97F4A7C15ull));
     }
-
-    return key;
+    return h;
 }
 
+/// Verified copy of the properties that produced a fingerprint.
+struct NODISCARD ParseKeyData final
+{
+    std::array<std::string, ParseEvent::NUM_PROPS> props;
+
+    explicit ParseKeyData(const ParseEvent &event, const MaskFlagsEnum maskFlags)
+    {
+        const auto mask = static_cast<uint32_t>(maskFlags);
+        for (size_t i = 0; i < ParseEvent::NUM_PROPS; ++i) {
+            if (((mask >> i) & 1u) == 1u)
+                props[i] = event[i].getStdString();
+        }
+    }
+
+    NODISCARD bool matches(const ParseEvent &event, const MaskFlagsEnum maskFlags) const
+    {
+        const auto mask = static_cast<uint32_t>(maskFlags);
+        for (size_t i = 0; i < ParseEvent::NUM_PROPS; ++i) {
+            const bool used = ((mask >> i) & 1u) == 1u;
+            const auto &expected = props[i];
+            if (!used) {
+                if (!expected.empty())
+                    return false;
+                continue;
+            }
+            const auto &prop = event[i];
+            if (prop.size() != expected.size() || prop.getStdString() != expected)
+                return false;
+        }
+        return true;
+    }
+};
+
+/// Hash map keyed by a 64-bit fingerprint; the (rare) collisions share a bucket
+/// and are told apart by comparing the stored properties.
+template<typename V>
+class NODISCARD FingerprintMap final
+{
+private:
+    struct NODISCARD Entry final
+    {
+        ParseKeyData key;
+        V value;
+
+        explicit Entry(ParseKeyData key)
+            : key{std::move(key)}
+        {}
+    };
+    std::unordered_map<uint64_t, std::vector<Entry>> m_map;
+
+public:
+    NODISCARD V *find(const uint64_t fingerprint,
+                      const ParseEvent &event,
+                      const MaskFlagsEnum mask)
+    {
+        const auto it = m_map.find(fingerprint);
+        if (it == m_map.end())
+            return nullptr;
+        for (Entry &entry : it->second) {
+            if (entry.key.matches(event, mask))
+                return &entry.value;
+        }
+        return nullptr;
+    }
+
+    NODISCARD V &findOrInsert(const uint64_t fingerprint,
+                              const ParseEvent &event,
+                              const MaskFlagsEnum mask)
+    {
+        if (V *const found = find(fingerprint, event, mask))
+            return *found;
+        auto &bucket = m_map[fingerprint];
+        bucket.emplace_back(ParseKeyData{event, mask});
+        return bucket.back().value;
+    }
+};
+
 class NODISCARD ParseTree::ParseHashMap final
 {
 private:
-    using Key = std::string;
     using PV = SharedRoomCollection;
-    using Primary = std::unordered_map<Key, PV>;
+    using Primary = FingerprintMap<PV>;
     using SV = std::unordered_set<PV>;
-    using Secondary = std::unordered_map<Key, SV>;
+    using Secondary = FingerprintMap<SV>;
     Primary m_primary;
     EnumIndexedArray<Secondary, MaskFlagsEnum> m_secondary;
+    uint64_t m_fingerprintMask = ~uint64_t{0};
 
 public:
     ParseHashMap() = default;
     virtual ~ParseHashMap();
 
+    void setFingerprintMask(const uint64_t mask) { m_fingerprintMask = mask; }
+
+private:
+    NODISCARD uint64_t fingerprint(const ParseEvent &event, const MaskFlagsEnum mask) const
+    {
+        return makeFingerprint(event, mask) & m_fingerprintMask;
+    }
+
+public:
+
     NODISCARD SharedRoomCollection insertRoom(const ParseEvent &event)
     {
         const MaskFlagsEnum mask = getKeyMask(event);
@@ -157,15 +251,14 @@ class NODISCARD ParseTree::ParseHashMap final
         if (!isMatchedByTree(mask))
             return nullptr;
 
-        const auto pk = makeKey(event, MaskFlagsEnum::NAME_DESC_TERRAIN);
-        auto &result = m_primary[pk];
+        constexpr auto primaryMask = MaskFlagsEnum::NAME_DESC_TERRAIN;
+        auto &result = m_primary.findOrInsert(fingerprint(event, primaryMask), event, primaryMask);
         if (result == nullptr)
             result = std::make_shared<RoomCollection>();
 
         for (auto subMask = mask; subMask != MaskFlagsEnum::NONE; subMask = reduceMask(subMask)) {
-            const auto key = makeKey(event, subMask);
             Secondary &reference = m_secondary[subMask];
-            SV &bucket = reference[key];
+            SV &bucket = reference.findOrInsert(fingerprint(event, subMask), event, subMask);
             bucket.emplace(result);
         }
 
@@ -179,11 +272,12 @@ class NODISCARD ParseTree::ParseHashMap final
         if (!isMatchedByTree(mask))
             return;
 
-        const auto &key = makeKey(event, mask);
-
         Secondary &thislevel = m_secondary[mask];
-        SV &homes = thislevel[key];
-        for (const PV &home : homes) {
+        const SV *const homes = thislevel.find(fingerprint(event, mask), event, mask);
+        if (homes == nullptr)
+            return;
+
+        for (const PV &home : *homes) {
             if (home != nullptr) {
                 home->forEach(stream);
             }
@@ -207,3 +301,8 @@ void ParseTree::getRooms(AbstractRoomVisitor &stream, const ParseEvent &event)
 {
     m_pimpl->getRooms(stream, event);
 }
+
+void ParseTree::setFingerprintMask(const uint64_t mask)
+{
+    m_pimpl->setFingerprintMask(mask);
+}
@@ -34,4 +34,8 @@ class ParseTree final
 public:
     NODISCARD SharedRoomCollection insertRoom(const ParseEvent &event);
     void getRooms(AbstractRoomVisitor &stream, const ParseEvent &event);
+
+public:
+    /// Keeps only these bits of each fingerprint; tests use it to force collisions.
+    void setFingerprintMask(uint64_t mask);
 };
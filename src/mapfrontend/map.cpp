@@ -5,9 +5,15 @@
 
 #include "map.h"
 
-#include <map>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
 #include <memory>
+#include <tuple>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "../expandoracommon/coordinate.h"
 #include "../expandoracommon/room.h"
@@ -38,97 +44,244 @@ struct NODISCARD CoordinateMinMax final
     }
 };
 
+namespace {
+
+// Rooms are stored in dense 16x16x1 tiles; the low bits of each x/y coordinate
+// select the cell inside a chunk and the remaining bits select the chunk.
+// NOTE: this relies on arithmetic right shift of negative coordinates.
+static constexpr const int CHUNK_BITS = 4;
+static constexpr const int CHUNK_SIZE = 1 << CHUNK_BITS;
+static constexpr const int CHUNK_MASK = CHUNK_SIZE - 1;
+static constexpr const size_t CHUNK_CELLS = static_cast<size_t>(CHUNK_SIZE * CHUNK_SIZE);
+
+struct NODISCARD ChunkKey final
+{
+    int x = 0;
+    int y = 0;
+    int z = 0;
+
+    ChunkKey() = default;
+    explicit ChunkKey(const int x, const int y, const int z)
+        : x{x}
+        , y{y}
+        , z{z}
+    {}
+    explicit ChunkKey(const Coordinate &c)
+        : ChunkKey{c.x >> CHUNK_BITS, c.y >> CHUNK_BITS, c.z}
+    {}
+
+    NODISCARD bool operator==(const ChunkKey &rhs) const
+    {
+        return x == rhs.x && y == rhs.y && z == rhs.z;
+    }
+    NODISCARD bool operator<(const ChunkKey &rhs) const
+    {
+        return std::tie(z, y, x) < std::tie(rhs.z, rhs.y, rhs.x);
+    }
+};
+
+struct NODISCARD ChunkKeyHash final
+{
+    NODISCARD size_t operator()(const ChunkKey &key) const noexcept
+    {
+        // Coordinates are small in practice, so packing them into one 64-bit
+        // value and mixing it gives a good spread without a combine loop.
+        uint64_t h = static_cast<uint32_t>(key.x);
+        h = (h * 0x9E3779B97F4A7C15ull) ^ static_cast<uint32_t>(key.y);
+        h = (h * 0x9E3779B97F4A7C15ull) ^ static_cast<uint32_t>(key.z);
+        h ^= h >> 29;
+        return static_cast<size_t>(h);
+    }
+};
+
+NODISCARD inline size_t cellIndex(const Coordinate &c)
+{
+    return static_cast<size_t>(((c.y & CHUNK_MASK) << CHUNK_BITS) | (c.x & CHUNK_MASK));
+}
+
+struct NODISCARD Chunk final
+{
+    std::array<Room *, CHUNK_CELLS> cells{};
+    size_t used = 0;
+};
+
+} // namespace
+
 class Map::MapOrderedTree final
 {
 private:
-    // REVISIT: consider using something more efficient
-    std::map<int, std::map<int, std::map<int, Room *>>> map{};
+    std::unordered_map<ChunkKey, std::unique_ptr<Chunk>, ChunkKeyHash> m_chunks;
 
 public:
     MapOrderedTree() = default;
     ~MapOrderedTree();
 
-    void clear() { map.clear(); }
+    void clear() { m_chunks.clear(); }
 
-    void getRooms(AbstractRoomVisitor &stream) const
+private:
+    NODISCARD const Chunk *findChunk(const ChunkKey &key) const
     {
-        for (const auto &z : map) {
-            for (const auto &y : z.second) {
-                for (const auto &x : y.second) {
-                    stream.visit(x.second);
+        const auto it = m_chunks.find(key);
+        if (it == m_chunks.end())
+            return nullptr;
+        return it->second.get();
+    }
+
+    using ChunkList = std::vector<std::pair<ChunkKey, const Chunk *>>;
+
+    // Visits the rooms of the sorted chunks that fall inside [min, max] in z, y, x order,
+    // the same order as a row by row scan of the whole grid.
+    static void visitRowMajor(AbstractRoomVisitor &stream,
+                              const ChunkList &sorted,
+                              const Coordinate &min,
+                              const Coordinate &max)
+    {
+        // The bounds can be anywhere in the range of int.
+        const auto clampLo = [](const int lo, const int base) -> int {
+            return static_cast<int>(std::max<int64_t>(int64_t{lo} - base, 0));
+        };
+        const auto clampHi = [](const int hi, const int base) -> int {
+            return static_cast<int>(std::min<int64_t>(int64_t{hi} - base, CHUNK_MASK));
+        };
+
+        for (auto begin = sorted.begin(); begin != sorted.end();) {
+            // the chunks in one row of chunks, ordered by x
+            const ChunkKey &first = begin->first;
+            const auto end = std::find_if(begin, sorted.end(), [&first](const auto &kv) {
+                return kv.first.z != first.z || kv.first.y != first.y;
+            });
+
+            const int baseY = first.y << CHUNK_BITS;
+            const int hiY = clampHi(max.y, baseY);
+            for (int y = clampLo(min.y, baseY); y <= hiY; ++y) {
+                const auto row = static_cast<size_t>(y << CHUNK_BITS);
+                for (auto it = begin; it != end; ++it) {
+                    const Chunk &chunk = deref(it->second);
+                    const int baseX = it->first.x << CHUNK_BITS;
+                    const int hiX = clampHi(max.x, baseX);
+                    for (int x = clampLo(min.x, baseX); x <= hiX; ++x) {
+                        if (const Room *const room = chunk.cells[row + static_cast<size_t>(x)]) {
+                            stream.visit(room);
+                        }
+                    }
                 }
             }
+            begin = end;
+        }
+    }
+
+    static void sortChunks(ChunkList &chunks)
+    {
+        std::sort(chunks.begin(), chunks.end(), [](const auto &a, const auto &b) {
+            return a.first < b.first;
+        });
+    }
+
+public:
+    void getRooms(AbstractRoomVisitor &stream) const
+    {
+        ChunkList sorted;
+        sorted.reserve(m_chunks.size());
+        for (const auto &kv : m_chunks) {
+            sorted.emplace_back(kv.first, kv.second.get());
         }
+        sortChunks(sorted);
+
+        static constexpr const int LO = std::numeric_limits<int>::min();
+        static constexpr const int HI = std::numeric_limits<int>::max();
+        visitRowMajor(stream, sorted, Coordinate{LO, LO, LO}, Coordinate{HI, HI, HI});
     }
 
     void getRooms(AbstractRoomVisitor &stream, const Coordinate &min, const Coordinate &max) const
     {
-        const auto range = CoordinateMinMax(min, max).expandCopy(Coordinate{1, 1, 1});
-
-        const auto zUpper = map.lower_bound(range.max.z);
-        for (auto z = map.upper_bound(range.min.z); z != zUpper; ++z) {
-            const auto &ymap = (*z).second;
-            const auto yUpper = ymap.lower_bound(range.max.y);
-            for (auto y = ymap.upper_bound(range.min.y); y != yUpper; ++y) {
-                const auto &xmap = (*y).second;
-                const auto xUpper = xmap.lower_bound(range.max.x);
-                for (auto x = xmap.upper_bound(range.min.x); x != xUpper; ++x) {
-                    stream.visit(x->second);
+        const auto range = CoordinateMinMax(min, max);
+        const ChunkKey lo{range.min};
+        const ChunkKey hi{range.max};
+
+        const auto span = [](const int a, const int b) -> uint64_t {
+            return static_cast<uint64_t>(static_cast<int64_t>(b) - static_cast<int64_t>(a) + 1);
+        };
+        const uint64_t boxChunks = span(lo.x, hi.x) * span(lo.y, hi.y) * span(lo.z, hi.z);
+
+        ChunkList sorted;
+        if (boxChunks > m_chunks.size()) {
+            // Huge boxes (e.g. "everything") are cheaper to answer by filtering the
+            // chunks that actually exist than by probing every empty chunk slot.
+            for (const auto &kv : m_chunks) {
+                const ChunkKey &k = kv.first;
+                if (lo.x <= k.x && k.x <= hi.x && lo.y <= k.y && k.y <= hi.y && lo.z <= k.z
+                    && k.z <= hi.z) {
+                    sorted.emplace_back(k, kv.second.get());
+                }
+            }
+            sortChunks(sorted);
+        } else {
+            for (int z = lo.z; z <= hi.z; ++z) {
+                for (int y = lo.y; y <= hi.y; ++y) {
+                    for (int x = lo.x; x <= hi.x; ++x) {
+                        const ChunkKey key{x, y, z};
+                        if (const Chunk *const chunk = findChunk(key)) {
+                            sorted.emplace_back(key, chunk);
+                        }
+                    }
                 }
             }
         }
+        visitRowMajor(stream, sorted, range.min, range.max);
     }
 
     /**
      * doesn't modify c
      */
-    bool defined(const Coordinate &c) const
+    bool defined(const Coordinate &c) const { return get(c) != nullptr; }
+
+    Room *get(const Coordinate &c) const
     {
-        const auto &z = map.find(c.z);
-        if (z != map.end()) {
-            auto &ySeg = (*z).second;
-            const auto &y = ySeg.find(c.y);
-            if (y != ySeg.end()) {
-                const auto &xSeg = (*y).second;
-                if (xSeg.find(c.x) != xSeg.end()) {
-                    return true;
-                }
-            }
+        if (const Chunk *const chunk = findChunk(ChunkKey{c})) {
+            return chunk->cells[cellIndex(c)];
         }
-        return false;
+        return nullptr;
     }
 
-    Room *get(const Coordinate &c) const
-    { // map<K,V>::operator[] is not const!
-        //    if (!defined(c)) {
-        //        return nullptr;
-        //    }
-        //    return m_map[c.z][c.y][c.x];
-
-        const auto &zmap = map;
-        const auto &z = zmap.find(c.z);
-        if (z == zmap.end())
-            return nullptr;
-
-        const auto &ymap = z->second;
-        const auto &y = ymap.find(c.y);
-        if (y == ymap.end())
-            return nullptr;
-
-        const auto &xmap = y->second;
-        const auto &x = xmap.find(c.x);
-        if (x == xmap.end())
-            return nullptr;
-
-        return x->second;
+    void remove(const Coordinate &c)
+    {
+        const auto it = m_chunks.find(ChunkKey{c});
+        if (it == m_chunks.end())
+            return;
+
+        Chunk &chunk = deref(it->second);
+        Room *&cell = chunk.cells[cellIndex(c)];
+        if (cell == nullptr)
+            return;
+
+        cell = nullptr;
+        assert(chunk.used > 0);
+        if (--chunk.used == 0) {
+            m_chunks.erase(it);
+        }
     }
 
-    void remove(const Coordinate &c) { map[c.z][c.y].erase(c.x); }
-
     /**
      * doesn't modify c
      */
-    void set(const Coordinate &c, Room *room) { map[c.z][c.y][c.x] = room; }
+    void set(const Coordinate &c, Room *room)
+    {
+        if (room == nullptr) {
+            remove(c);
+            return;
+        }
+
+        auto &ptr = m_chunks[ChunkKey{c}];
+        if (ptr == nullptr) {
+            ptr = std::make_unique<Chunk>();
+        }
+
+        Room *&cell = ptr->cells[cellIndex(c)];
+        if (cell == nullptr) {
+            ++ptr->used;
+        }
+        cell = room;
+    }
 };
 
 Map::MapOrderedTree::~MapOrderedTree() = default;
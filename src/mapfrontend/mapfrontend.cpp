@@ -6,10 +6,14 @@
 
 #include "mapfrontend.h"
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <future>
 #include <memory>
 #include <set>
 #include <utility>
+#include <vector>
 #include <QMutex>
 
 #include "../expandoracommon/RoomRecipient.h"
@@ -30,12 +34,14 @@ MapFrontend::MapFrontend(QObject *const parent)
 MapFrontend::~MapFrontend()
 {
     QMutexLocker locker(&mapLock);
+    waitForReaders();
     emit sig_clearingMap();
 }
 
 void MapFrontend::block()
 {
     mapLock.lock();
+    waitForReaders();
     blockSignals(true);
 }
 
@@ -45,6 +51,23 @@ void MapFrontend::unblock()
     blockSignals(false);
 }
 
+void MapFrontend::addReaders(const std::vector<std::shared_future<void>> &tasks)
+{
+    const auto isFinished = [](const std::shared_future<void> &reader) {
+        return reader.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    };
+    readers.erase(std::remove_if(readers.begin(), readers.end(), isFinished), readers.end());
+    readers.insert(readers.end(), tasks.begin(), tasks.end());
+}
+
+void MapFrontend::waitForReaders()
+{
+    for (const auto &reader : readers) {
+        reader.wait();
+    }
+    readers.clear();
+}
+
 void MapFrontend::checkSize()
 {
     emit sig_mapSizeChanged(getMin(), getMax());
@@ -53,6 +76,7 @@ void MapFrontend::checkSize()
 void MapFrontend::scheduleAction(const std::shared_ptr<MapAction> &action)
 {
     QMutexLocker locker(&mapLock);
+    waitForReaders();
     action->schedule(this);
 
     bool executable = true;
@@ -113,9 +137,21 @@ void MapFrontend::lookingForRooms(RoomRecipient &recipient, const Coordinate &po
     }
 }
 
+void MapFrontend::lookingForRooms(RoomRecipient &recipient, const std::vector<Coordinate> &coords)
+{
+    QMutexLocker locker(&mapLock);
+    for (const Coordinate &pos : coords) {
+        if (Room *const r = map.get(pos)) {
+            locks[r->getId()].insert(&recipient);
+            recipient.receiveRoom(this, r);
+        }
+    }
+}
+
 void MapFrontend::clear()
 {
     QMutexLocker locker(&mapLock);
+    waitForReaders();
     emit sig_clearingMap();
 
     for (size_t i = 0, size = roomIndex.size(); i < size; ++i) {
@@ -157,6 +193,19 @@ void MapFrontend::lookingForRooms(RoomRecipient &recipient, const RoomId id)
     }
 }
 
+void MapFrontend::lookingForRooms(RoomRecipient &recipient, const std::vector<RoomId> &ids)
+{
+    QMutexLocker locker(&mapLock);
+    for (const RoomId id : ids) {
+        if (greatestUsedId < id || greatestUsedId == INVALID_ROOMID)
+            continue;
+        if (const SharedRoom &r = roomIndex[id]) {
+            locks[id].insert(&recipient);
+            recipient.receiveRoom(this, r.get());
+        }
+    }
+}
+
 RoomId MapFrontend::assignId(const SharedRoom &room, const SharedRoomCollection &roomHome)
 {
     /* REVISIT: move all of the objects modified in this function to a sub-object? */
@@ -202,6 +251,7 @@ void MapFrontend::insertPredefinedRoom(const SharedRoom &sharedRoom)
     Room &room = deref(sharedRoom);
 
     QMutexLocker locker(&mapLock);
+    waitForReaders();
     assert(signalsBlocked());
     const auto id = room.getId();
     const Coordinate &c = room.getPosition();
@@ -219,9 +269,30 @@ void MapFrontend::insertPredefinedRoom(const SharedRoom &sharedRoom)
     }
 }
 
+void MapFrontend::insertPredefinedRooms(const std::vector<SharedRoom> &rooms)
+{
+    QMutexLocker locker(&mapLock);
+    waitForReaders();
+
+    uint32_t maxId = 0;
+    for (const SharedRoom &room : rooms) {
+        maxId = std::max(maxId, deref(room).getId().asUint32());
+    }
+    if (!rooms.empty() && roomIndex.size() <= maxId) {
+        roomIndex.resize(maxId + 1u, nullptr);
+        locks.resize(maxId + 1u);
+        roomHomes.resize(maxId + 1u, nullptr);
+    }
+
+    for (const SharedRoom &room : rooms) {
+        insertPredefinedRoom(room);
+    }
+}
+
 RoomId MapFrontend::createEmptyRoom(const Coordinate &c)
 {
     QMutexLocker locker(&mapLock);
+    waitForReaders();
     SharedRoom room = Room::createPermanentRoom(*this);
     map.setNearest(c, *room);
     checkSize(room->getPosition());
@@ -268,6 +339,7 @@ void MapFrontend::slot_createRoom(const SigParseEvent &sigParseEvent,
     const ParseEvent &event = sigParseEvent.deref();
 
     QMutexLocker locker(&mapLock);
+    waitForReaders();
     checkSize(expectedPosition); // still hackish but somewhat better
     if (SharedRoomCollection roomHome = parseTree.insertRoom(event)) {
         SharedRoom room = Room::createTemporaryRoom(*this, event);
@@ -303,6 +375,7 @@ void MapFrontend::lockRoom(RoomRecipient *const recipient, const RoomId id)
 void MapFrontend::releaseRoom(RoomRecipient &sender, const RoomId id)
 {
     QMutexLocker lock(&mapLock);
+    waitForReaders();
     auto &room_locks_ref = locks[id];
     room_locks_ref.erase(&sender);
     if (room_locks_ref.empty()) {
@@ -325,6 +398,7 @@ void MapFrontend::releaseRoom(RoomRecipient &sender, const RoomId id)
 void MapFrontend::keepRoom(RoomRecipient &sender, const RoomId id)
 {
     QMutexLocker lock(&mapLock);
+    waitForReaders();
     auto &lock_ref = locks[id];
     lock_ref.erase(&sender);
     scheduleAction(std::make_shared<SingleRoomAction>(std::make_unique<MakePermanent>(), id));
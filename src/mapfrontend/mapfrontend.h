@@ -5,11 +5,13 @@
 // Author: Marek Krejza <krejza@gmail.com> (Caligor)
 // Author: Nils Schimmelmann <nschimme@gmail.com> (Jahara)
 
+#include <future>
 #include <map>
 #include <memory>
 #include <optional>
 #include <set>
 #include <stack>
+#include <vector>
 #include <QMutex>
 #include <QString>
 #include <QtCore>
@@ -36,6 +38,7 @@ class MapFrontend : public QObject, public RoomAdmin, public InfoMarkModificatio
 {
     Q_OBJECT
     friend class FrontendAccessor;
+    friend class TestMap;
 
 protected:
     ParseTree parseTree;
@@ -48,6 +51,9 @@ class MapFrontend : public QObject, public RoomAdmin, public InfoMarkModificatio
 
     RoomId greatestUsedId = INVALID_ROOMID;
     QRecursiveMutex mapLock;
+    // Tasks on other threads that read the rooms without holding mapLock;
+    // anything that changes the map has to call waitForReaders() first.
+    std::vector<std::shared_future<void>> readers;
 
     struct Bounds final
     {
@@ -64,6 +70,10 @@ class MapFrontend : public QObject, public RoomAdmin, public InfoMarkModificatio
     RoomId assignId(const SharedRoom &room, const SharedRoomCollection &roomHome);
     void checkSize(const Coordinate &);
 
+    // Must be called with mapLock held.
+    void addReaders(const std::vector<std::shared_future<void>> &tasks);
+    void waitForReaders();
+
 public:
     explicit MapFrontend(QObject *parent);
     ~MapFrontend() override;
@@ -88,6 +98,8 @@ class MapFrontend : public QObject, public RoomAdmin, public InfoMarkModificatio
     void lockRoom(RoomRecipient *, RoomId);
     RoomId createEmptyRoom(const Coordinate &);
     void insertPredefinedRoom(const SharedRoom &);
+    // Same as insertPredefinedRoom() for each room, but locks once and grows the index only once.
+    void insertPredefinedRooms(const std::vector<SharedRoom> &rooms);
     RoomId getMaxId() { return greatestUsedId; }
     Coordinate getMin() const { return m_bounds ? m_bounds->min : Coordinate{}; }
     Coordinate getMax() const { return m_bounds ? m_bounds->max : Coordinate{}; }
@@ -95,6 +107,12 @@ class MapFrontend : public QObject, public RoomAdmin, public InfoMarkModificatio
 public:
     void scheduleAction(const std::shared_ptr<MapAction> &action) final;
 
+public:
+    // Batched versions of lookingForRooms(): every candidate is resolved under a
+    // single lock acquisition, in order, without a signal per candidate.
+    void lookingForRooms(RoomRecipient &, const std::vector<RoomId> &ids);
+    void lookingForRooms(RoomRecipient &, const std::vector<Coordinate> &coords);
+
 public slots:
     // looking for rooms leads to a bunch of foundRoom() signals
     void lookingForRooms(RoomRecipient &, const SigParseEvent &);
@@ -0,0 +1,341 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2023 The MMapper Authors
+
+#include "FlatMapFormat.h"
+
+#include <cstring>
+#include <limits>
+#include <string>
+#include <QSysInfo>
+
+#include "../expandoracommon/exit.h"
+#include "../global/io.h"
+#include "../mapdata/DoorFlags.h"
+#include "../mapdata/ExitFlags.h"
+#include "../mapdata/infomark.h"
+#include "../mapdata/mmapper2room.h"
+
+namespace flatmap {
+
+// Records are read in place, so the host has to match the file's byte order.
+static constexpr const bool IS_LITTLE_ENDIAN = (QSysInfo::ByteOrder == QSysInfo::LittleEndian);
+
+static constexpr const uint64_t TABLE_ALIGNMENT = 8;
+
+NODISCARD static uint64_t alignUp(const uint64_t offset)
+{
+    return (offset + TABLE_ALIGNMENT - 1u) & ~(TABLE_ALIGNMENT - 1u);
+}
+
+NODISCARD static Coordinate toCoordinate(const int32_t (&xyz)[3])
+{
+    return Coordinate{xyz[0], xyz[1], xyz[2]};
+}
+
+static void fromCoordinate(int32_t (&xyz)[3], const Coordinate &c)
+{
+    xyz[0] = c.x;
+    xyz[1] = c.y;
+    xyz[2] = c.z;
+}
+
+NODISCARD static uint32_t checkedSize(const size_t size)
+{
+    if (size > std::numeric_limits<uint32_t>::max()) {
+        throw io::IOException("map is too large for the flat map format");
+    }
+    return static_cast<uint32_t>(size);
+}
+
+// Every value this writer produces is in range, so anything else means the file is corrupt.
+template<typename E>
+NODISCARD static E checkedEnum(const uint32_t value, const size_t count, const char *const what)
+{
+    if (value >= count) {
+        throw io::IOException(std::string{"invalid "} + what);
+    }
+    return static_cast<E>(value);
+}
+
+template<typename F>
+NODISCARD static F checkedFlags(const uint32_t bits, const int numFlags, const char *const what)
+{
+    const uint64_t valid = (uint64_t{1} << numFlags) - 1u;
+    if ((bits & ~valid) != 0u) {
+        throw io::IOException(std::string{"invalid "} + what);
+    }
+    return F{static_cast<typename F::underlying_type>(bits)};
+}
+
+void FlatMapWriter::setPosition(const Coordinate &pos)
+{
+    fromCoordinate(m_header.position, pos);
+}
+
+StringRef FlatMapWriter::addString(const std::string &s)
+{
+    if (s.empty()) {
+        return StringRef{};
+    }
+    if (const auto it = m_stringIndex.find(s); it != m_stringIndex.end()) {
+        return it->second;
+    }
+    const StringRef ref{checkedSize(m_strings.size()), checkedSize(s.size())};
+    m_strings += s;
+    checkedSize(m_strings.size());
+    m_stringIndex.emplace(s, ref);
+    return ref;
+}
+
+void FlatMapWriter::addRoom(const Room &room)
+{
+    RoomEntry entry;
+    entry.id = room.getId().asUint32();
+    fromCoordinate(entry.position, room.getPosition());
+    entry.name = addString(room.getName().getStdString());
+    entry.desc = addString(room.getDescription().getStdString());
+    entry.contents = addString(room.getContents().getStdString());
+    entry.note = addString(room.getNote().getStdString());
+    entry.mobFlags = static_cast<uint32_t>(room.getMobFlags());
+    entry.loadFlags = static_cast<uint32_t>(room.getLoadFlags());
+    entry.terrain = static_cast<uint8_t>(room.getTerrainType());
+    entry.light = static_cast<uint8_t>(room.getLightType());
+    entry.align = static_cast<uint8_t>(room.getAlignType());
+    entry.portable = static_cast<uint8_t>(room.getPortableType());
+    entry.ridable = static_cast<uint8_t>(room.getRidableType());
+    entry.sundeath = static_cast<uint8_t>(room.getSundeathType());
+    entry.upToDate = room.isUpToDate() ? 1u : 0u;
+    m_rooms.push_back(entry);
+
+    for (const Exit &e : room.getExitsList()) {
+        ExitEntry exit;
+        exit.exitFlags = static_cast<uint16_t>(e.getExitFlags());
+        exit.doorFlags = static_cast<uint16_t>(e.getDoorFlags());
+        exit.doorName = addString(e.getDoorName().getStdString());
+        exit.firstIn = checkedSize(m_ids.size());
+        for (const RoomId id : e.inRange()) {
+            m_ids.push_back(id.asUint32());
+        }
+        exit.numIn = checkedSize(m_ids.size()) - exit.firstIn;
+        exit.firstOut = checkedSize(m_ids.size());
+        for (const RoomId id : e.outRange()) {
+            m_ids.push_back(id.asUint32());
+        }
+        exit.numOut = checkedSize(m_ids.size()) - exit.firstOut;
+        m_exits.push_back(exit);
+    }
+}
+
+void FlatMapWriter::addMark(const MarkRecord &mark)
+{
+    MarkEntry entry;
+    entry.text = addString(std::string{mark.text});
+    entry.type = mark.type;
+    entry.clazz = mark.clazz;
+    entry.rotationAngle = mark.rotationAngle;
+    fromCoordinate(entry.position1, mark.position1);
+    fromCoordinate(entry.position2, mark.position2);
+    m_marks.push_back(entry);
+}
+
+QByteArray FlatMapWriter::finish() const
+{
+    if (!IS_LITTLE_ENDIAN) {
+        throw io::IOException("the flat map format is only supported on little-endian hosts");
+    }
+
+    FileHeader header = m_header;
+    header.roomsCount = checkedSize(m_rooms.size());
+    header.exitsCount = checkedSize(m_exits.size());
+    header.idsCount = checkedSize(m_ids.size());
+    header.marksCount = checkedSize(m_marks.size());
+
+    uint64_t offset = sizeof(FileHeader);
+    const auto place = [&offset](const uint64_t bytes) -> uint64_t {
+        const uint64_t start = alignUp(offset);
+        offset = start + bytes;
+        return start;
+    };
+    header.roomsOffset = place(m_rooms.size() * sizeof(RoomEntry));
+    header.exitsOffset = place(m_exits.size() * sizeof(ExitEntry));
+    header.idsOffset = place(m_ids.size() * sizeof(uint32_t));
+    header.marksOffset = place(m_marks.size() * sizeof(MarkEntry));
+    header.stringsOffset = place(m_strings.size());
+    header.stringsSize = m_strings.size();
+
+    if (offset > static_cast<uint64_t>(std::numeric_limits<int>::max())) {
+        throw io::IOException("map is too large for the flat map format");
+    }
+
+    QByteArray result(static_cast<int>(offset), '\0');
+    char *const out = result.data();
+    const auto write = [out](const uint64_t at, const void *const src, const size_t bytes) {
+        if (bytes != 0) {
+            std::memcpy(out + at, src, bytes);
+        }
+    };
+    write(0, &header, sizeof(header));
+    write(header.roomsOffset, m_rooms.data(), m_rooms.size() * sizeof(RoomEntry));
+    write(header.exitsOffset, m_exits.data(), m_exits.size() * sizeof(ExitEntry));
+    write(header.idsOffset, m_ids.data(), m_ids.size() * sizeof(uint32_t));
+    write(header.marksOffset, m_marks.data(), m_marks.size() * sizeof(MarkEntry));
+    write(header.stringsOffset, m_strings.data(), m_strings.size());
+    return result;
+}
+
+FlatMapReader::FlatMapReader(const char *const data, const size_t size)
+    : m_data{data}
+    , m_size{size}
+{
+    if (!IS_LITTLE_ENDIAN) {
+        throw io::IOException("the flat map format is only supported on little-endian hosts");
+    }
+    if (m_data == nullptr || m_size < sizeof(FileHeader)) {
+        throw io::IOException("file is too short");
+    }
+    std::memcpy(&m_header, m_data, sizeof(FileHeader));
+    if (m_header.magic != MAGIC) {
+        throw io::IOException("not a flat map file");
+    }
+    if (m_header.version != CURRENT_VERSION) {
+        throw io::IOException("unsupported flat map version");
+    }
+    if (m_header.exitsCount != uint64_t{m_header.roomsCount} * NUM_EXITS) {
+        throw io::IOException("exit table doesn't match room table");
+    }
+
+    // Counts are 32-bit, so none of these products can overflow.
+    const auto checkTable = [this](const uint64_t offset, const uint64_t bytes) {
+        if (offset > m_size || bytes > m_size - offset) {
+            throw io::IOException("table extends past end of file");
+        }
+    };
+    checkTable(m_header.roomsOffset, uint64_t{m_header.roomsCount} * sizeof(RoomEntry));
+    checkTable(m_header.exitsOffset, uint64_t{m_header.exitsCount} * sizeof(ExitEntry));
+    checkTable(m_header.idsOffset, uint64_t{m_header.idsCount} * sizeof(uint32_t));
+    checkTable(m_header.marksOffset, uint64_t{m_header.marksCount} * sizeof(MarkEntry));
+    checkTable(m_header.stringsOffset, m_header.stringsSize);
+}
+
+template<typename T>
+T FlatMapReader::load(const uint64_t tableOffset, const uint64_t index) const
+{
+    // memcpy instead of a cast, since the mapping's alignment isn't guaranteed.
+    T result;
+    std::memcpy(&result, m_data + tableOffset + index * sizeof(T), sizeof(T));
+    return result;
+}
+
+Coordinate FlatMapReader::getPosition() const
+{
+    return toCoordinate(m_header.position);
+}
+
+RoomEntry FlatMapReader::getRoom(const uint32_t index) const
+{
+    if (index >= m_header.roomsCount) {
+        throw io::IOException("room index out of range");
+    }
+    return load<RoomEntry>(m_header.roomsOffset, index);
+}
+
+ExitEntry FlatMapReader::getExit(const uint32_t roomIndex, const ExitDirEnum dir) const
+{
+    if (roomIndex >= m_header.roomsCount || static_cast<uint32_t>(dir) >= NUM_EXITS) {
+        throw io::IOException("exit index out of range");
+    }
+    const ExitEntry exit = load<ExitEntry>(m_header.exitsOffset,
+                                           uint64_t{roomIndex} * NUM_EXITS
+                                               + static_cast<uint32_t>(dir));
+    if (uint64_t{exit.firstIn} + exit.numIn > m_header.idsCount
+        || uint64_t{exit.firstOut} + exit.numOut > m_header.idsCount) {
+        throw io::IOException("connection range out of bounds");
+    }
+    return exit;
+}
+
+uint32_t FlatMapReader::getId(const uint32_t index) const
+{
+    if (index >= m_header.idsCount) {
+        throw io::IOException("connection index out of range");
+    }
+    return load<uint32_t>(m_header.idsOffset, index);
+}
+
+std::string_view FlatMapReader::getString(const StringRef &ref) const
+{
+    if (uint64_t{ref.offset} + ref.size > m_header.stringsSize) {
+        throw io::IOException("string out of bounds");
+    }
+    return std::string_view{m_data + m_header.stringsOffset + ref.offset, ref.size};
+}
+
+MarkRecord FlatMapReader::getMark(const uint32_t index) const
+{
+    if (index >= m_header.marksCount) {
+        throw io::IOException("info mark index out of range");
+    }
+    const auto entry = load<MarkEntry>(m_header.marksOffset, index);
+    MarkRecord mark;
+    mark.text = getString(entry.text);
+    mark.type = static_cast<uint8_t>(
+        checkedEnum<InfoMarkTypeEnum>(entry.type, NUM_INFOMARK_TYPES, "info mark type"));
+    mark.clazz = static_cast<uint8_t>(
+        checkedEnum<InfoMarkClassEnum>(entry.clazz, NUM_INFOMARK_CLASSES, "info mark class"));
+    mark.rotationAngle = entry.rotationAngle;
+    mark.position1 = toCoordinate(entry.position1);
+    mark.position2 = toCoordinate(entry.position2);
+    return mark;
+}
+
+SharedRoom FlatMapReader::createRoom(RoomModificationTracker &tracker,
+                                     const uint32_t index,
+                                     const uint32_t baseId,
+                                     const Coordinate &basePosition) const
+{
+    const RoomEntry entry = getRoom(index);
+    const auto str = [this](const StringRef &ref) { return std::string{getString(ref)}; };
+
+    const SharedRoom room = Room::createPermanentRoom(tracker);
+    room->setName(RoomName{str(entry.name)});
+    room->setDescription(RoomDesc{str(entry.desc)});
+    room->setContents(RoomContents{str(entry.contents)});
+    room->setId(RoomId{entry.id + baseId});
+    room->setNote(RoomNote{str(entry.note)});
+    room->setTerrainType(
+        checkedEnum<RoomTerrainEnum>(entry.terrain, NUM_ROOM_TERRAIN_TYPES, "terrain type"));
+    room->setLightType(checkedEnum<RoomLightEnum>(entry.light, NUM_LIGHT_TYPES, "light type"));
+    room->setAlignType(checkedEnum<RoomAlignEnum>(entry.align, NUM_ALIGN_TYPES, "align type"));
+    room->setPortableType(
+        checkedEnum<RoomPortableEnum>(entry.portable, NUM_PORTABLE_TYPES, "portable type"));
+    room->setRidableType(
+        checkedEnum<RoomRidableEnum>(entry.ridable, NUM_RIDABLE_TYPES, "ridable type"));
+    room->setSundeathType(
+        checkedEnum<RoomSundeathEnum>(entry.sundeath, NUM_SUNDEATH_TYPES, "sundeath type"));
+    room->setMobFlags(checkedFlags<RoomMobFlags>(entry.mobFlags, NUM_ROOM_MOB_FLAGS, "mob flags"));
+    room->setLoadFlags(
+        checkedFlags<RoomLoadFlags>(entry.loadFlags, NUM_ROOM_LOAD_FLAGS, "load flags"));
+    if (entry.upToDate != 0u) {
+        room->setUpToDate();
+    }
+    room->setPosition(toCoordinate(entry.position) + basePosition);
+
+    ExitsList eList;
+    for (const ExitDirEnum dir : ALL_EXITS7) {
+        const ExitEntry exit = getExit(index, dir);
+        Exit &e = eList[dir];
+        e.setExitFlags(checkedFlags<ExitFlags>(exit.exitFlags, NUM_EXIT_FLAGS, "exit flags"));
+        e.setDoorFlags(checkedFlags<DoorFlags>(exit.doorFlags, NUM_DOOR_FLAGS, "door flags"));
+        e.setDoorName(DoorName{str(exit.doorName)});
+        for (uint32_t i = 0; i < exit.numIn; ++i) {
+            e.addIn(RoomId{getId(exit.firstIn + i) + baseId});
+        }
+        for (uint32_t i = 0; i < exit.numOut; ++i) {
+            e.addOut(RoomId{getId(exit.firstOut + i) + baseId});
+        }
+    }
+    room->setExitsList(eList);
+    return room;
+}
+
+} // namespace flatmap
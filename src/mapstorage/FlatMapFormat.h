@@ -0,0 +1,175 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2023 The MMapper Authors
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include <QByteArray>
+
+#include "../expandoracommon/coordinate.h"
+#include "../expandoracommon/room.h"
+#include "../global/macros.h"
+#include "../mapdata/ExitDirection.h"
+
+/// Flat, offset-addressed binary map format.
+///
+/// A file is a header followed by fixed-size tables of rooms, exits,
+/// connection ids and info marks, and a pool holding every string.
+/// Records are found by offset arithmetic alone, so a memory-mapped file
+/// can be read in place; strings are returned as views into the mapping.
+/// All values are stored little-endian.
+namespace flatmap {
+
+static constexpr const uint32_t MAGIC = 0x46324D4Du; // "MM2F"
+static constexpr const uint32_t CURRENT_VERSION = 1u;
+
+struct NODISCARD StringRef final
+{
+    uint32_t offset = 0;
+    uint32_t size = 0;
+};
+
+struct NODISCARD FileHeader final
+{
+    uint32_t magic = MAGIC;
+    uint32_t version = CURRENT_VERSION;
+    int32_t position[3]{};
+    uint32_t roomsCount = 0;
+    uint32_t exitsCount = 0;
+    uint32_t idsCount = 0;
+    uint32_t marksCount = 0;
+    uint32_t reserved = 0;
+    uint64_t roomsOffset = 0;
+    uint64_t exitsOffset = 0;
+    uint64_t idsOffset = 0;
+    uint64_t marksOffset = 0;
+    uint64_t stringsOffset = 0;
+    uint64_t stringsSize = 0;
+};
+
+struct NODISCARD RoomEntry final
+{
+    uint32_t id = 0;
+    int32_t position[3]{};
+    StringRef name;
+    StringRef desc;
+    StringRef contents;
+    StringRef note;
+    uint32_t mobFlags = 0;
+    uint32_t loadFlags = 0;
+    uint8_t terrain = 0;
+    uint8_t light = 0;
+    uint8_t align = 0;
+    uint8_t portable = 0;
+    uint8_t ridable = 0;
+    uint8_t sundeath = 0;
+    uint8_t upToDate = 0;
+    uint8_t reserved = 0;
+};
+
+// Every room has NUM_EXITS entries, starting at (room index * NUM_EXITS).
+struct NODISCARD ExitEntry final
+{
+    uint16_t exitFlags = 0;
+    uint16_t doorFlags = 0;
+    StringRef doorName;
+    // ranges in the connection id table
+    uint32_t firstIn = 0;
+    uint32_t numIn = 0;
+    uint32_t firstOut = 0;
+    uint32_t numOut = 0;
+};
+
+struct NODISCARD MarkEntry final
+{
+    StringRef text;
+    uint8_t type = 0;
+    uint8_t clazz = 0;
+    uint8_t reserved[2]{};
+    int32_t rotationAngle = 0;
+    int32_t position1[3]{};
+    int32_t position2[3]{};
+};
+
+static_assert(sizeof(FileHeader) == 88);
+static_assert(sizeof(RoomEntry) == 64);
+static_assert(sizeof(ExitEntry) == 28);
+static_assert(sizeof(MarkEntry) == 40);
+static_assert(std::is_trivially_copyable_v<FileHeader>);
+static_assert(std::is_trivially_copyable_v<RoomEntry>);
+static_assert(std::is_trivially_copyable_v<ExitEntry>);
+static_assert(std::is_trivially_copyable_v<MarkEntry>);
+
+// Info marks are passed through as plain values, so this doesn't depend on MapData.
+struct NODISCARD MarkRecord final
+{
+    std::string_view text;
+    uint8_t type = 0;
+    uint8_t clazz = 0;
+    int32_t rotationAngle = 0;
+    Coordinate position1;
+    Coordinate position2;
+};
+
+class NODISCARD FlatMapWriter final
+{
+private:
+    FileHeader m_header;
+    std::vector<RoomEntry> m_rooms;
+    std::vector<ExitEntry> m_exits;
+    std::vector<uint32_t> m_ids;
+    std::vector<MarkEntry> m_marks;
+    std::string m_strings;
+    // identical strings (e.g. door names and notes) are only stored once
+    std::unordered_map<std::string, StringRef> m_stringIndex;
+
+public:
+    void setPosition(const Coordinate &pos);
+    void addRoom(const Room &room);
+    void addMark(const MarkRecord &mark);
+    NODISCARD QByteArray finish() const;
+
+private:
+    NODISCARD StringRef addString(const std::string &s);
+};
+
+class NODISCARD FlatMapReader final
+{
+private:
+    const char *m_data = nullptr;
+    size_t m_size = 0;
+    FileHeader m_header;
+
+public:
+    // Only the header and table bounds are checked up front; the records are
+    // checked as they are read. Throws io::IOException on invalid data.
+    explicit FlatMapReader(const char *data, size_t size);
+
+public:
+    NODISCARD uint32_t getRoomsCount() const { return m_header.roomsCount; }
+    NODISCARD uint32_t getMarksCount() const { return m_header.marksCount; }
+    NODISCARD Coordinate getPosition() const;
+
+    NODISCARD RoomEntry getRoom(uint32_t index) const;
+    NODISCARD ExitEntry getExit(uint32_t roomIndex, ExitDirEnum dir) const;
+    NODISCARD uint32_t getId(uint32_t index) const;
+    NODISCARD std::string_view getString(const StringRef &ref) const;
+    NODISCARD MarkRecord getMark(uint32_t index) const;
+
+    // Room ids are offset by baseId and positions by basePosition, to allow merging maps.
+    NODISCARD SharedRoom createRoom(RoomModificationTracker &tracker,
+                                    uint32_t index,
+                                    uint32_t baseId,
+                                    const Coordinate &basePosition) const;
+
+private:
+    template<typename T>
+    NODISCARD T load(uint64_t tableOffset, uint64_t index) const;
+};
+
+} // namespace flatmap
@@ -0,0 +1,208 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2023 The MMapper Authors
+
+#include "FlatMapStorage.h"
+
+#include <exception>
+#include <memory>
+#include <vector>
+#include <QFile>
+#include <QFileInfo>
+
+#include "../expandoracommon/room.h"
+#include "../global/roomid.h"
+#include "../global/utils.h"
+#include "../mapdata/infomark.h"
+#include "../mapdata/mapdata.h"
+#include "FlatMapFormat.h"
+#include "basemapsavefilter.h"
+#include "mapstorage.h"
+#include "progresscounter.h"
+#include "roomsaver.h"
+
+FlatMapStorage::FlatMapStorage(MapData &mapdata,
+                               const QString &filename,
+                               QFile *const file,
+                               QObject *parent)
+    : AbstractMapStorage(mapdata, filename, file, parent)
+{}
+
+FlatMapStorage::~FlatMapStorage() = default;
+
+void FlatMapStorage::newData()
+{
+    qWarning() << "FlatMapStorage does not implement newData()";
+}
+
+bool FlatMapStorage::loadData()
+{
+    // clear previous map
+    m_mapData.clear();
+    try {
+        return mergeData();
+    } catch (const std::exception &ex) {
+        const auto msg = QString::asprintf("Exception: %s", ex.what());
+        log(msg);
+        qWarning().noquote() << msg;
+        m_mapData.clear();
+        return false;
+    }
+}
+
+bool FlatMapStorage::mergeData()
+{
+    {
+        MapFrontendBlocker blocker(m_mapData);
+
+        // Same merge offsets as MapStorage::mergeData().
+        baseId = m_mapData.getMaxId().asUint32() + 1u;
+        basePosition = m_mapData.getMax();
+        if (basePosition.x + basePosition.y + basePosition.z != 0) {
+            basePosition.y = 0;
+            basePosition.x = 0;
+            basePosition.z = -1;
+        }
+
+        log("Loading data ...");
+        m_mapData.setDataChanged();
+
+        // The mapping stays valid until the file is closed (which also unmaps it),
+        // so the strings can be read straight out of it.
+        QByteArray fallback;
+        const qint64 fileSize = m_file->size();
+        const char *data = reinterpret_cast<const char *>(m_file->map(0, fileSize));
+        size_t size = static_cast<size_t>(fileSize);
+        if (data == nullptr) {
+            log("Unable to map the file; reading it instead.");
+            fallback = m_file->readAll();
+            data = fallback.constData();
+            size = static_cast<size_t>(fallback.size());
+        }
+
+        load(flatmap::FlatMapReader{data, size});
+        m_file->close();
+
+        if (m_mapData.getRoomsCount() == 0u) {
+            return false;
+        }
+
+        m_mapData.setFileName(m_fileName, !QFileInfo(m_fileName).isWritable());
+        m_mapData.unsetDataChanged();
+    }
+
+    m_mapData.checkSize();
+    emit sig_onDataLoaded();
+    return true;
+}
+
+void FlatMapStorage::load(const flatmap::FlatMapReader &reader)
+{
+    const uint32_t roomsCount = reader.getRoomsCount();
+    const uint32_t marksCount = reader.getMarksCount();
+
+    auto &progressCounter = getProgressCounter();
+    progressCounter.reset();
+    progressCounter.increaseTotalStepsBy(roomsCount + marksCount);
+
+    m_mapData.setPosition(reader.getPosition() + basePosition);
+
+    log(QString("Number of rooms: %1").arg(roomsCount));
+    std::vector<SharedRoom> rooms;
+    rooms.reserve(roomsCount);
+    for (uint32_t i = 0; i < roomsCount; ++i) {
+        rooms.emplace_back(reader.createRoom(m_mapData, i, baseId, basePosition));
+        progressCounter.step();
+    }
+    m_mapData.insertPredefinedRooms(rooms);
+
+    log(QString("Number of info items: %1").arg(marksCount));
+    const Coordinate markOffset{basePosition.x * INFOMARK_SCALE,
+                                basePosition.y * INFOMARK_SCALE,
+                                basePosition.z};
+    for (uint32_t i = 0; i < marksCount; ++i) {
+        const flatmap::MarkRecord record = reader.getMark(i);
+        // getMark() has already rejected values out of range.
+        const auto type = static_cast<InfoMarkTypeEnum>(record.type);
+        const auto clazz = static_cast<InfoMarkClassEnum>(record.clazz);
+
+        auto mark = InfoMark::alloc(m_mapData);
+        mark->setType(type);
+        mark->setClass(clazz);
+        mark->setRotationAngle(record.rotationAngle);
+        mark->setPosition1(record.position1 + markOffset);
+        mark->setPosition2(record.position2 + markOffset);
+        if (type == InfoMarkTypeEnum::TEXT) {
+            mark->setText(record.text.empty() ? InfoMarkText{"New Marker"}
+                                              : InfoMarkText{std::string{record.text}});
+        }
+        m_mapData.addMarker(std::move(mark));
+        progressCounter.step();
+    }
+
+    log("Finished loading.");
+}
+
+bool FlatMapStorage::saveData(const bool baseMapOnly)
+{
+    log("Writing data to file ...");
+
+    ConstRoomList roomList;
+    roomList.reserve(m_mapData.getRoomsCount());
+
+    const MarkerList &markerList = m_mapData.getMarkersList();
+    RoomSaver saver(m_mapData, roomList);
+    for (uint i = 0; i < m_mapData.getRoomsCount(); ++i) {
+        m_mapData.lookingForRooms(saver, RoomId{i});
+    }
+
+    const auto roomsCount = saver.getRoomsCount();
+    const auto marksCount = static_cast<uint32_t>(markerList.size());
+
+    auto &progressCounter = getProgressCounter();
+    progressCounter.reset();
+    progressCounter.increaseTotalStepsBy(roomsCount + marksCount);
+
+    BaseMapSaveFilter filter;
+    if (baseMapOnly) {
+        filter.setMapData(&m_mapData);
+        progressCounter.increaseTotalStepsBy(filter.prepareCount());
+        filter.prepare(progressCounter);
+    }
+
+    flatmap::FlatMapWriter writer;
+    writer.setPosition(m_mapData.getPosition());
+
+    auto saveOne = [&writer](const Room &room) { writer.addRoom(room); };
+    for (const std::shared_ptr<const Room> &pRoom : roomList) {
+        filter.visitRoom(deref(pRoom), baseMapOnly, saveOne);
+        progressCounter.step();
+    }
+
+    for (const auto &pMark : markerList) {
+        const InfoMark &mark = deref(pMark);
+        const InfoMarkTypeEnum type = mark.getType();
+        flatmap::MarkRecord record;
+        if (type == InfoMarkTypeEnum::TEXT) {
+            record.text = mark.getText().getStdString();
+        }
+        record.type = static_cast<uint8_t>(type);
+        record.clazz = static_cast<uint8_t>(mark.getClass());
+        record.rotationAngle = mark.getRotationAngle();
+        record.position1 = mark.getPosition1();
+        record.position2 = mark.getPosition2();
+        writer.addMark(record);
+        progressCounter.step();
+    }
+
+    const QByteArray data = writer.finish();
+    if (m_file->write(data) != data.size()) {
+        log(QString("Writing data failed: %1").arg(m_file->errorString()));
+        return false;
+    }
+    log("Writing data finished.");
+
+    m_mapData.unsetDataChanged();
+    emit sig_onDataSaved();
+
+    return true;
+}
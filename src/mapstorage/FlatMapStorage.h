@@ -0,0 +1,53 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2023 The MMapper Authors
+
+#include <cstdint>
+#include <QString>
+#include <QtCore>
+
+#include "../expandoracommon/coordinate.h"
+#include "../global/macros.h"
+#include "abstractmapstorage.h"
+
+class MapData;
+class QFile;
+class QObject;
+
+namespace flatmap {
+class FlatMapReader;
+} // namespace flatmap
+
+/*! \brief Flat binary map format (*.mm2f)
+ *
+ * Stores the map as offset-addressed tables (see FlatMapFormat.h). Loading
+ * memory-maps the file and creates the rooms directly from the mapping,
+ * without decompressing or decoding a stream first.
+ */
+class FlatMapStorage final : public AbstractMapStorage
+{
+    Q_OBJECT
+
+public:
+    explicit FlatMapStorage(MapData &, const QString &, QFile *, QObject *parent);
+    ~FlatMapStorage() final;
+
+public:
+    FlatMapStorage() = delete;
+
+private:
+    NODISCARD bool canLoad() const override { return true; }
+    NODISCARD bool canSave() const override { return true; }
+
+    void newData() override;
+    NODISCARD bool loadData() override;
+    NODISCARD bool saveData(bool baseMapOnly) override;
+    NODISCARD bool mergeData() override;
+
+private:
+    void load(const flatmap::FlatMapReader &reader);
+    void log(const QString &msg) { emit sig_log("FlatMapStorage", msg); }
+
+    uint32_t baseId = 0u;
+    Coordinate basePosition;
+};
@@ -4,12 +4,16 @@
 
 #include "StorageUtils.h"
 
+#include <stdexcept>
 #include <QByteArray>
+#include <QIODevice>
+#include <QtEndian>
+
+#include "../global/TextUtils.h"
 
 #ifndef MMAPPER_NO_ZLIB
 #include <cassert>
 #include <sstream>
-#include <stdexcept>
 #include <zlib.h>
 #endif
 
@@ -85,4 +89,130 @@ QByteArray inflate(QByteArray & /*data*/)
     abort();
 }
 #endif
+
+static void writeAll(QIODevice &device, const char *const data, const qint64 size) noexcept(false)
+{
+    if (device.write(data, size) != size) {
+        throw std::runtime_error(::toStdStringUtf8(device.errorString()));
+    }
+}
+
+struct CompressingWriter::Impl final
+{
+    QIODevice &device;
+    const qint64 start;
+    qint64 uncompressedSize = 0;
+    qint64 compressedSize = 0;
+#ifndef MMAPPER_NO_ZLIB
+    static constexpr const int CHUNK = 64 * 1024;
+    z_stream strm{};
+    char out[CHUNK];
+    bool initialized = false;
+#else
+    QByteArray pending;
+#endif
+
+    explicit Impl(QIODevice &in_device)
+        : device{in_device}
+        , start{in_device.pos()}
+    {}
+    ~Impl()
+    {
+#ifndef MMAPPER_NO_ZLIB
+        if (initialized) {
+            deflateEnd(&strm);
+        }
+#endif
+    }
+    DELETE_CTORS_AND_ASSIGN_OPS(Impl);
+
+#ifndef MMAPPER_NO_ZLIB
+    // Runs deflate() until it stops filling the whole output buffer.
+    void deflateAll(const int flush)
+    {
+        int ret = Z_OK;
+        do {
+            strm.avail_out = CHUNK;
+            strm.next_out = as_far_byte_array(out);
+            ret = ::deflate(&strm, flush);
+            assert(ret != Z_STREAM_ERROR); /* state not clobbered */
+            const auto length = static_cast<qint64>(CHUNK - strm.avail_out);
+            writeAll(device, out, length);
+            compressedSize += length;
+        } while (strm.avail_out == 0 || (flush == Z_FINISH && ret != Z_STREAM_END));
+    }
+#endif
+};
+
+CompressingWriter::CompressingWriter(QIODevice &device) noexcept(false)
+    : m_impl{std::make_unique<Impl>(device)}
+{
+#ifndef MMAPPER_NO_ZLIB
+    // same level as qCompress()
+    if (deflateInit(&m_impl->strm, Z_DEFAULT_COMPRESSION) != Z_OK) {
+        throw std::runtime_error("Unable to initialize zlib");
+    }
+    m_impl->initialized = true;
+
+    // placeholder for the uncompressed size; see finish()
+    static constexpr const char header[4]{};
+    writeAll(device, header, sizeof(header));
+#endif
+}
+
+CompressingWriter::~CompressingWriter() = default;
+
+void CompressingWriter::write(const QByteArray &data) noexcept(false)
+{
+    Impl &impl = *m_impl;
+    impl.uncompressedSize += data.size();
+#ifndef MMAPPER_NO_ZLIB
+    // deflate() doesn't modify the input.
+    impl.strm.avail_in = static_cast<uInt>(data.size());
+    impl.strm.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.constData()));
+    impl.deflateAll(Z_NO_FLUSH);
+    assert(impl.strm.avail_in == 0);
+#else
+    impl.pending.append(data);
+#endif
+}
+
+void CompressingWriter::finish() noexcept(false)
+{
+    Impl &impl = *m_impl;
+#ifndef MMAPPER_NO_ZLIB
+    impl.strm.avail_in = 0;
+    impl.strm.next_in = nullptr;
+    impl.deflateAll(Z_FINISH);
+    deflateEnd(&impl.strm);
+    impl.initialized = false;
+
+    // qUncompress() reads the uncompressed size from the first 4 bytes (big endian).
+    uchar header[4];
+    qToBigEndian(static_cast<quint32>(impl.uncompressedSize), header);
+    const qint64 end = impl.device.pos();
+    if (!impl.device.seek(impl.start)) {
+        throw std::runtime_error(::toStdStringUtf8(impl.device.errorString()));
+    }
+    writeAll(impl.device, reinterpret_cast<const char *>(header), sizeof(header));
+    if (!impl.device.seek(end)) {
+        throw std::runtime_error(::toStdStringUtf8(impl.device.errorString()));
+    }
+#else
+    const QByteArray compressed = qCompress(impl.pending);
+    impl.pending.clear();
+    writeAll(impl.device, compressed.constData(), compressed.size());
+    impl.compressedSize = compressed.size() - 4;
+#endif
+}
+
+qint64 CompressingWriter::getUncompressedSize() const
+{
+    return m_impl->uncompressedSize;
+}
+
+qint64 CompressingWriter::getCompressedSize() const
+{
+    return m_impl->compressedSize;
+}
 } // namespace StorageUtils
@@ -3,10 +3,43 @@
 // Copyright (C) 2019 The MMapper Authors
 // Author: Nils Schimmelmann <nschimme@gmail.com> (Jahara)
 
+#include <memory>
+#include <QtGlobal>
+
+#include "../global/RuleOf5.h"
 #include "../global/macros.h"
 
 class QByteArray;
+class QIODevice;
 
 namespace StorageUtils {
 NODISCARD QByteArray inflate(QByteArray &);
+
+/*! \brief Writes data in the format of qCompress() as it arrives.
+ *
+ * Only a small output buffer is kept in memory. The device must be random
+ * access, since the uncompressed size at the start is written last.
+ */
+class NODISCARD CompressingWriter final
+{
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+
+public:
+    /*! \exception std::runtime_error if the device can't be written. */
+    explicit CompressingWriter(QIODevice &device) noexcept(false);
+    ~CompressingWriter();
+    DELETE_CTORS_AND_ASSIGN_OPS(CompressingWriter);
+
+public:
+    /*! \exception std::runtime_error if the device can't be written. */
+    void write(const QByteArray &data) noexcept(false);
+    /*! \exception std::runtime_error if the device can't be written. */
+    void finish() noexcept(false);
+
+public:
+    NODISCARD qint64 getUncompressedSize() const;
+    NODISCARD qint64 getCompressedSize() const;
+};
 } // namespace StorageUtils
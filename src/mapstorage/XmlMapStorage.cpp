@@ -5,14 +5,21 @@
 
 #include "XmlMapStorage.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <cstddef>
+#include <future>
 #include <stdexcept>
 #include <type_traits>
+#include <utility>
+#include <vector>
 #include <QHash>
 #include <QMessageBox>
 #include <QString>
 #include <QStringView>
+#include <QThread>
 #include <QXmlStreamReader>
 #include <QXmlStreamWriter>
 
@@ -216,6 +223,29 @@ bool XmlMapStorage::mergeData()
     return false;
 }
 
+// ---------------------------- XmlMapStorage::RoomRecord ----------------------
+// Plain copy of a <room> element; decoding one doesn't touch the map,
+// so it can happen on any thread.
+struct NODISCARD XmlMapStorage::RoomRecord final
+{
+    RoomId id = INVALID_ROOMID;
+    bool upToDate = true;
+    RoomName name;
+    RoomDesc desc;
+    RoomContents contents;
+    RoomNote note;
+    Coordinate position;
+    RoomAlignEnum align = RoomAlignEnum::UNDEFINED;
+    RoomLightEnum light = RoomLightEnum::UNDEFINED;
+    RoomPortableEnum portable = RoomPortableEnum::UNDEFINED;
+    RoomRidableEnum ridable = RoomRidableEnum::UNDEFINED;
+    RoomSundeathEnum sundeath = RoomSundeathEnum::UNDEFINED;
+    RoomTerrainEnum terrain = RoomTerrainEnum::UNDEFINED;
+    RoomLoadFlags loadFlags;
+    RoomMobFlags mobFlags;
+    ExitsList exits;
+};
+
 // ---------------------------- XmlMapStorage::loadData() ----------------------
 bool XmlMapStorage::loadData()
 {
@@ -223,10 +253,10 @@ bool XmlMapStorage::loadData()
     m_mapData.clear();
     try {
         log("Loading data ...");
-        QXmlStreamReader stream(m_file);
+        const QByteArray data = m_file->readAll();
         m_loadProgressDivisor = std::max<uint64_t> //
-            (1, static_cast<uint64_t>(m_file->size()) / LOAD_PROGRESS_MAX);
-        loadWorld(stream);
+            (1, static_cast<uint64_t>(data.size()) / LOAD_PROGRESS_MAX);
+        loadWorld(data);
         log("Finished loading.");
 
         m_mapData.checkSize();
@@ -243,20 +273,34 @@ bool XmlMapStorage::loadData()
                               tr("XmlMapStorage Error"),
                               msg);
 
+        clearLoaded();
         m_mapData.clear();
         return false;
     }
 }
 
-void XmlMapStorage::loadWorld(QXmlStreamReader &stream)
+void XmlMapStorage::loadWorld(const QByteArray &data)
 {
-    ProgressCounter &progressCounter = getProgressCounter();
-    progressCounter.reset();
-    progressCounter.increaseTotalStepsBy(LOAD_PROGRESS_MAX);
+    const auto resetLoadProgress = [this]() {
+        ProgressCounter &progressCounter = getProgressCounter();
+        progressCounter.reset();
+        progressCounter.increaseTotalStepsBy(LOAD_PROGRESS_MAX);
+        m_loadProgress = 0;
+    };
+    resetLoadProgress();
 
     MapFrontendBlocker blocker(m_mapData);
     m_mapData.setDataChanged();
 
+    if (loadWorldParallel(data)) {
+        setLoadProgress(LOAD_PROGRESS_MAX);
+        return;
+    }
+
+    // The parallel attempt may have reported progress before it gave up.
+    resetLoadProgress();
+
+    QXmlStreamReader stream(data);
     while (stream.readNextStartElement() && !stream.hasError()) {
         if (as_u16string_view(stream.name()) == "map") {
             loadMap(stream);
@@ -267,35 +311,175 @@ void XmlMapStorage::loadWorld(QXmlStreamReader &stream)
     loadNotifyProgress(stream);
 }
 
-// load current <map> element
-void XmlMapStorage::loadMap(QXmlStreamReader &stream)
+NODISCARD static std::vector<int> findRoomStarts(const QByteArray &data)
 {
-    m_loadedRooms.clear();
-    {
-        const QXmlStreamAttributes attrs = stream.attributes();
-        const QString type = attrs.value("type").toString();
-        if (type != "mmapper2xml") {
-            throwErrorFmt(stream,
-                          "unsupported map type=\"%1\",\nexpecting type=\"mmapper2xml\"",
-                          type);
+    std::vector<int> starts;
+    static constexpr const char *const ROOM = "<room";
+    static constexpr const int ROOM_LENGTH = 5;
+    for (int pos = data.indexOf(ROOM); pos >= 0; pos = data.indexOf(ROOM, pos + ROOM_LENGTH)) {
+        const int next = pos + ROOM_LENGTH;
+        if (next < data.size()) {
+            switch (data.at(next)) {
+            case ' ':
+            case '\t':
+            case '\n':
+            case '\r':
+            case '/':
+            case '>':
+                starts.push_back(pos);
+                break;
+            default:
+                break;
+            }
         }
-        const QString version = attrs.value("version").toString();
-        const CompareVersion cmp(version);
-        if (cmp.major() != 1) {
-            throwErrorFmt(stream,
-                          "unsupported map version=\"%1\",\nexpecting version=\"1.x.y\"",
-                          version);
+    }
+    return starts;
+}
+
+// Decodes the rooms on a thread pool if the document can be split at its <room> tags,
+// which is true for anything saveData() wrote. Returns false if the caller has to load
+// the document sequentially instead; that's also how parse errors are reported, since
+// only the sequential loader knows the line numbers.
+bool XmlMapStorage::loadWorldParallel(const QByteArray &data)
+{
+    m_parallelChunks = 0u;
+    const std::vector<int> roomStarts = findRoomStarts(data);
+    if (roomStarts.empty()) {
+        return false;
+    }
+
+    // A literal "<room" can only appear outside of a tag inside comments, CDATA sections
+    // and processing instructions, and a DTD could declare entities we don't expand.
+    if (data.contains("<!") || data.indexOf("<?", roomStarts.front()) >= 0) {
+        return false;
+    }
+
+    static constexpr const uint32_t MIN_ROOMS_PER_WORKER = 1024;
+    const auto roomsCount = static_cast<uint32_t>(roomStarts.size());
+    const auto idealWorkers = static_cast<uint32_t>(std::max(1, QThread::idealThreadCount()));
+    const auto maxWorkers = (m_maxWorkers != 0u) ? m_maxWorkers : idealWorkers;
+    const auto numWorkers = std::min(roomsCount / MIN_ROOMS_PER_WORKER, maxWorkers);
+    if (numWorkers < 2) {
+        return false;
+    }
+
+    try {
+        clearLoaded();
+
+        // The header must be nothing but "<map ...>" followed by the first room.
+        {
+            QXmlStreamReader stream(QByteArray::fromRawData(data.constData(), roomStarts.front()));
+            if (!stream.readNextStartElement() || as_u16string_view(stream.name()) != "map") {
+                return false;
+            }
+            const QString encoding = stream.documentEncoding().toString();
+            if (!encoding.isEmpty() && encoding.compare("UTF-8", Qt::CaseInsensitive) != 0) {
+                return false;
+            }
+            loadMapAttributes(stream);
+            while (stream.readNext() == QXmlStreamReader::Characters && stream.isWhitespace()) {
+            }
+            if (stream.error() != QXmlStreamReader::PrematureEndOfDocumentError) {
+                return false;
+            }
+        }
+
+        // Each worker decodes a contiguous run of rooms into its own vector. The last room
+        // is left for the final pass below, together with the markers that follow it.
+        const uint32_t parallelRooms = roomsCount - 1u;
+        std::atomic<uint32_t> decoded{0u};
+        std::vector<std::future<std::vector<RoomRecord>>> workers;
+        workers.reserve(numWorkers);
+        for (uint32_t w = 0; w < numWorkers; ++w) {
+            const auto first = static_cast<uint32_t>(uint64_t{parallelRooms} * w / numWorkers);
+            const auto last = static_cast<uint32_t>(uint64_t{parallelRooms} * (w + 1u)
+                                                    / numWorkers);
+            const QByteArray chunk = QByteArray::fromRawData(data.constData() + roomStarts[first],
+                                                             roomStarts[last] - roomStarts[first]);
+            workers.emplace_back(std::async(std::launch::async, [chunk, &decoded]() {
+                return loadRoomChunk(chunk, decoded);
+            }));
         }
+
+        // ProgressCounter emits signals, so it's only touched from this thread.
+        const auto reportDecoded = [this, &decoded, roomsCount]() {
+            const uint64_t now = decoded.load(std::memory_order_relaxed);
+            setLoadProgress(static_cast<uint32_t>(now * LOAD_PROGRESS_MAX / roomsCount));
+        };
+
+        // Merge in document order, so the result doesn't depend on the scheduling.
+        for (auto &worker : workers) {
+            while (worker.wait_for(std::chrono::milliseconds(50)) != std::future_status::ready) {
+                reportDecoded();
+            }
+            reportDecoded();
+        }
+
+        QByteArray tail{"<map>"};
+        tail += QByteArray::fromRawData(data.constData() + roomStarts.back(),
+                                        data.size() - roomStarts.back());
+        QXmlStreamReader stream(tail);
+        MAYBE_UNUSED const bool ignored = stream.readNextStartElement();
+        for (auto &worker : workers) {
+            for (RoomRecord &record : worker.get()) {
+                addLoadedRoom(stream, std::move(record));
+            }
+        }
+        loadMapElements(stream);
+        if (stream.hasError()) {
+            throwError(stream, stream.errorString());
+        }
+        connectRoomsExitFrom(stream);
+    } catch (const std::exception &ex) {
+        log(QString("Reloading the map sequentially: %1").arg(ex.what()));
+        clearLoaded();
+        return false;
     }
 
+    moveLoadedToMapData();
+    m_parallelChunks = numWorkers;
+    return true;
+}
+
+// load current <map> element
+void XmlMapStorage::loadMap(QXmlStreamReader &stream)
+{
+    clearLoaded();
+    loadMapAttributes(stream);
+    loadMapElements(stream);
+    connectRoomsExitFrom(stream);
+    moveLoadedToMapData();
+}
+
+void XmlMapStorage::loadMapAttributes(QXmlStreamReader &stream)
+{
+    const QXmlStreamAttributes attrs = stream.attributes();
+    const QString type = attrs.value("type").toString();
+    if (type != "mmapper2xml") {
+        throwErrorFmt(stream,
+                      "unsupported map type=\"%1\",\nexpecting type=\"mmapper2xml\"",
+                      type);
+    }
+    const QString version = attrs.value("version").toString();
+    const CompareVersion cmp(version);
+    if (cmp.major() != 1) {
+        throwErrorFmt(stream,
+                      "unsupported map version=\"%1\",\nexpecting version=\"1.x.y\"",
+                      version);
+    }
+}
+
+// load the children of the current <map> element
+void XmlMapStorage::loadMapElements(QXmlStreamReader &stream)
+{
     while (stream.readNextStartElement() && !stream.hasError()) {
         const std::u16string_view name = as_u16string_view(stream.name());
         if (name == "room") {
-            loadRoom(stream);
+            addLoadedRoom(stream, loadRoom(stream));
         } else if (name == "marker") {
-            loadMarker(stream);
+            m_loadedMarkers.emplace_back(loadMarker(stream));
         } else if (name == "position") {
-            m_mapData.setPosition(loadCoordinate(stream));
+            m_loadedPosition = loadCoordinate(stream);
         } else {
             qWarning().noquote().nospace()
                 << "At line " << stream.lineNumber() << ": ignoring unexpected XML element <"
@@ -304,73 +488,86 @@ void XmlMapStorage::loadMap(QXmlStreamReader &stream)
         skipXmlElement(stream);
         loadNotifyProgress(stream);
     }
-    connectRoomsExitFrom(stream);
-    moveRoomsToMapData();
+}
+
+// load a run of <room> elements (and nothing else); runs on a worker thread
+std::vector<XmlMapStorage::RoomRecord> XmlMapStorage::loadRoomChunk(
+    const QByteArray &chunk, std::atomic<uint32_t> &decoded)
+{
+    QByteArray fragment;
+    fragment.reserve(chunk.size() + 11);
+    fragment += "<map>";
+    fragment += chunk;
+    fragment += "</map>";
+
+    QXmlStreamReader stream(fragment);
+    MAYBE_UNUSED const bool ignored = stream.readNextStartElement();
+    std::vector<RoomRecord> rooms;
+    while (stream.readNextStartElement() && !stream.hasError()) {
+        if (as_u16string_view(stream.name()) != "room") {
+            throwErrorFmt(stream, "unexpected XML element <%1>", stream.name().toString());
+        }
+        rooms.emplace_back(loadRoom(stream));
+        skipXmlElement(stream);
+        decoded.fetch_add(1u, std::memory_order_relaxed);
+    }
+    if (stream.hasError()) {
+        throwError(stream, stream.errorString());
+    }
+    return rooms;
 }
 
 // load current <room> element
-void XmlMapStorage::loadRoom(QXmlStreamReader &stream)
+XmlMapStorage::RoomRecord XmlMapStorage::loadRoom(QXmlStreamReader &stream)
 {
-    const SharedRoom sharedroom = Room::createPermanentRoom(m_mapData);
-    Room &room = deref(sharedroom);
+    RoomRecord room;
 
     const QXmlStreamAttributes attrs = stream.attributes();
     const QStringView idstr = attrs.value("id");
-    const RoomId roomId = loadRoomId(stream, idstr);
-    if (m_loadedRooms.count(roomId) != 0) {
-        throwErrorFmt(stream, "duplicate room id \"%1\"", idstr.toString());
-    }
-    room.setId(roomId);
-    if (attrs.value("uptodate") == "false") {
-        room.setOutDated();
-    } else {
-        room.setUpToDate();
-    }
-    room.setName(RoomName{attrs.value("name").toString()});
+    room.id = loadRoomId(stream, idstr);
+    room.upToDate = (attrs.value("uptodate") != "false");
+    room.name = RoomName{attrs.value("name").toString()};
 
-    ExitsList exitList;
-    RoomLoadFlags loadFlags;
-    RoomMobFlags mobFlags;
     RoomElementEnum found = RoomElementEnum::NONE;
 
     while (stream.readNextStartElement() && !stream.hasError()) {
         const std::u16string_view name = as_u16string_view(stream.name());
         if (name == "align") {
             throwIfDuplicate(stream, found, RoomElementEnum::ALIGN);
-            room.setAlignType(loadEnum<RoomAlignEnum>(stream));
+            room.align = loadEnum<RoomAlignEnum>(stream);
         } else if (name == "contents") {
             throwIfDuplicate(stream, found, RoomElementEnum::CONTENTS);
-            room.setContents(RoomContents{loadString(stream)});
+            room.contents = RoomContents{loadString(stream)};
         } else if (name == "coord") {
             throwIfDuplicate(stream, found, RoomElementEnum::POSITION);
-            room.setPosition(loadCoordinate(stream));
+            room.position = loadCoordinate(stream);
         } else if (name == "description") {
             throwIfDuplicate(stream, found, RoomElementEnum::DESCRIPTION);
-            room.setDescription(RoomDesc{loadString(stream)});
+            room.desc = RoomDesc{loadString(stream)};
         } else if (name == "exit") {
-            loadExit(stream, exitList);
+            loadExit(stream, room.exits);
         } else if (name == "light") {
             throwIfDuplicate(stream, found, RoomElementEnum::LIGHT);
-            room.setLightType(loadEnum<RoomLightEnum>(stream));
+            room.light = loadEnum<RoomLightEnum>(stream);
         } else if (name == "loadflag") {
-            loadFlags |= loadEnum<RoomLoadFlagEnum>(stream);
+            room.loadFlags |= loadEnum<RoomLoadFlagEnum>(stream);
         } else if (name == "mobflag") {
-            mobFlags |= loadEnum<RoomMobFlagEnum>(stream);
+            room.mobFlags |= loadEnum<RoomMobFlagEnum>(stream);
         } else if (name == "note") {
             throwIfDuplicate(stream, found, RoomElementEnum::NOTE);
-            room.setNote(RoomNote{loadString(stream)});
+            room.note = RoomNote{loadString(stream)};
         } else if (name == "portable") {
             throwIfDuplicate(stream, found, RoomElementEnum::PORTABLE);
-            room.setPortableType(loadEnum<RoomPortableEnum>(stream));
+            room.portable = loadEnum<RoomPortableEnum>(stream);
         } else if (name == "ridable") {
             throwIfDuplicate(stream, found, RoomElementEnum::RIDABLE);
-            room.setRidableType(loadEnum<RoomRidableEnum>(stream));
+            room.ridable = loadEnum<RoomRidableEnum>(stream);
         } else if (name == "sundeath") {
             throwIfDuplicate(stream, found, RoomElementEnum::SUNDEATH);
-            room.setSundeathType(loadEnum<RoomSundeathEnum>(stream));
+            room.sundeath = loadEnum<RoomSundeathEnum>(stream);
         } else if (name == "terrain") {
             throwIfDuplicate(stream, found, RoomElementEnum::TERRAIN);
-            room.setTerrainType(loadEnum<RoomTerrainEnum>(stream));
+            room.terrain = loadEnum<RoomTerrainEnum>(stream);
         } else {
             qWarning().noquote().nospace()
                 << "At line " << stream.lineNumber() << ": ignoring unexpected XML element <"
@@ -378,11 +575,40 @@ void XmlMapStorage::loadRoom(QXmlStreamReader &stream)
         }
         skipXmlElement(stream);
     }
-    room.setExitsList(exitList);
-    room.setLoadFlags(loadFlags);
-    room.setMobFlags(mobFlags);
+    return room;
+}
+
+// create the Room for a decoded <room> element; must run on the thread that owns m_mapData
+void XmlMapStorage::addLoadedRoom(QXmlStreamReader &stream, RoomRecord &&record)
+{
+    if (m_loadedRooms.count(record.id) != 0) {
+        throwErrorFmt(stream, "duplicate room id \"%1\"", roomIdToString(record.id));
+    }
 
-    m_loadedRooms.emplace(std::move(roomId), std::move(sharedroom));
+    const SharedRoom sharedroom = Room::createPermanentRoom(m_mapData);
+    Room &room = deref(sharedroom);
+    room.setId(record.id);
+    if (record.upToDate) {
+        room.setUpToDate();
+    } else {
+        room.setOutDated();
+    }
+    room.setName(std::move(record.name));
+    room.setDescription(std::move(record.desc));
+    room.setContents(std::move(record.contents));
+    room.setNote(std::move(record.note));
+    room.setPosition(record.position);
+    room.setAlignType(record.align);
+    room.setLightType(record.light);
+    room.setPortableType(record.portable);
+    room.setRidableType(record.ridable);
+    room.setSundeathType(record.sundeath);
+    room.setTerrainType(record.terrain);
+    room.setExitsList(record.exits);
+    room.setLoadFlags(record.loadFlags);
+    room.setMobFlags(record.mobFlags);
+
+    m_loadedRooms.emplace(record.id, sharedroom);
 }
 
 // convert string to RoomId
@@ -518,16 +744,37 @@ void XmlMapStorage::connectRoomExitFrom(QXmlStreamReader &stream,
     }
 }
 
-// add all loaded rooms to m_mapData
-void XmlMapStorage::moveRoomsToMapData()
+// add all loaded rooms and markers to m_mapData
+void XmlMapStorage::moveLoadedToMapData()
 {
+    std::vector<SharedRoom> rooms;
+    rooms.reserve(m_loadedRooms.size());
     for (const auto &elem : m_loadedRooms) {
-        m_mapData.insertPredefinedRoom(elem.second);
+        rooms.emplace_back(elem.second);
+    }
+    // insert in a deterministic order
+    std::sort(rooms.begin(), rooms.end(), [](const SharedRoom &a, const SharedRoom &b) {
+        return a->getId() < b->getId();
+    });
+    m_mapData.insertPredefinedRooms(rooms);
+
+    for (const SharedInfoMark &marker : m_loadedMarkers) {
+        m_mapData.addMarker(marker);
+    }
+    if (m_loadedPosition.has_value()) {
+        m_mapData.setPosition(m_loadedPosition.value());
     }
+    clearLoaded();
+}
+
+void XmlMapStorage::clearLoaded()
+{
     m_loadedRooms.clear();
+    m_loadedMarkers.clear();
+    m_loadedPosition.reset();
 }
 
-void XmlMapStorage::loadMarker(QXmlStreamReader &stream)
+SharedInfoMark XmlMapStorage::loadMarker(QXmlStreamReader &stream)
 {
     const QXmlStreamAttributes attrs = stream.attributes();
     bool fail = false;
@@ -599,7 +846,7 @@ void XmlMapStorage::loadMarker(QXmlStreamReader &stream)
         marker.setText(InfoMarkText{"New Marker"});
     }
 
-    m_mapData.addMarker(std::move(sharedmarker));
+    return sharedmarker;
 }
 
 // load current element, which is expected to contain ONLY the name of an enum value
@@ -648,8 +895,12 @@ void XmlMapStorage::skipXmlElement(QXmlStreamReader &stream)
 
 void XmlMapStorage::loadNotifyProgress(QXmlStreamReader &stream)
 {
-    uint32_t loadProgressNew = static_cast<uint32_t> //
-        (static_cast<uint64_t>(stream.characterOffset()) / m_loadProgressDivisor);
+    setLoadProgress(static_cast<uint32_t> //
+                    (static_cast<uint64_t>(stream.characterOffset()) / m_loadProgressDivisor));
+}
+
+void XmlMapStorage::setLoadProgress(const uint32_t loadProgressNew)
+{
     if (loadProgressNew <= m_loadProgress) {
         return;
     }
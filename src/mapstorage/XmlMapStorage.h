@@ -4,12 +4,16 @@
 // Author: Massimiliano Ghilardi <massimiliano.ghilardi@gmail.com> (Cosmos)
 // Author: Nils Schimmelmann <nschimme@gmail.com> (Jahara)
 
+#include <atomic>
+#include <optional>
 #include <string_view>
 #include <unordered_map>
+#include <vector>
 #include <QString>
 #include <QtCore>
 
 #include "../global/macros.h"
+#include "../mapdata/infomark.h"
 #include "../mapdata/mapdata.h"
 #include "abstractmapstorage.h"
 #include "mapstorage.h" // MapFrontendBlocker
@@ -28,6 +32,14 @@ class XmlMapStorage final : public AbstractMapStorage
     explicit XmlMapStorage(MapData &, const QString &, QFile *, QObject *parent);
     ~XmlMapStorage() final;
 
+public:
+    /// Limits the threads that decode rooms; 0 means QThread::idealThreadCount(),
+    /// and 1 loads the document sequentially.
+    void setMaxWorkers(const uint32_t maxWorkers) { m_maxWorkers = maxWorkers; }
+    /// How many chunks of rooms the last load decoded in parallel;
+    /// 0 if it read the document sequentially.
+    NODISCARD uint32_t getParallelChunks() const { return m_parallelChunks; }
+
 private:
     NODISCARD bool canLoad() const override { return true; }
     NODISCARD bool canSave() const override { return true; }
@@ -38,18 +50,28 @@ class XmlMapStorage final : public AbstractMapStorage
     NODISCARD bool mergeData() override;
 
     // ---------------- load map -------------------
-    void loadWorld(QXmlStreamReader &stream);
+    struct NODISCARD RoomRecord;
+
+    void loadWorld(const QByteArray &data);
+    NODISCARD bool loadWorldParallel(const QByteArray &data);
     void loadMap(QXmlStreamReader &stream);
-    void loadRoom(QXmlStreamReader &stream);
-    RoomId loadRoomId(QXmlStreamReader &stream, const QStringView idstr);
-    Coordinate loadCoordinate(QXmlStreamReader &stream);
-    void loadExit(QXmlStreamReader &stream, ExitsList &exitList);
-    void loadMarker(QXmlStreamReader &stream);
+    void loadMapAttributes(QXmlStreamReader &stream);
+    void loadMapElements(QXmlStreamReader &stream);
+    NODISCARD static std::vector<RoomRecord> loadRoomChunk(const QByteArray &chunk,
+                                                           std::atomic<uint32_t> &decoded);
+    NODISCARD static RoomRecord loadRoom(QXmlStreamReader &stream);
+    void addLoadedRoom(QXmlStreamReader &stream, RoomRecord &&record);
+    NODISCARD static RoomId loadRoomId(QXmlStreamReader &stream, const QStringView idstr);
+    NODISCARD static Coordinate loadCoordinate(QXmlStreamReader &stream);
+    static void loadExit(QXmlStreamReader &stream, ExitsList &exitList);
+    NODISCARD SharedInfoMark loadMarker(QXmlStreamReader &stream);
     void loadNotifyProgress(QXmlStreamReader &stream);
+    void setLoadProgress(uint32_t loadProgressNew);
 
     void connectRoomsExitFrom(QXmlStreamReader &stream);
     void connectRoomExitFrom(QXmlStreamReader &stream, const Room &fromRoom, const ExitDirEnum dir);
-    void moveRoomsToMapData();
+    void moveLoadedToMapData();
+    void clearLoaded();
 
     enum class RoomElementEnum : uint32_t {
         NONE /*  */ = 0,
@@ -66,9 +88,9 @@ class XmlMapStorage final : public AbstractMapStorage
     };
 
     template<typename ENUM>
-    ENUM loadEnum(QXmlStreamReader &stream);
-    QString loadString(QXmlStreamReader &stream);
-    QStringView loadStringView(QXmlStreamReader &stream);
+    NODISCARD static ENUM loadEnum(QXmlStreamReader &stream);
+    NODISCARD static QString loadString(QXmlStreamReader &stream);
+    NODISCARD static QStringView loadStringView(QXmlStreamReader &stream);
 
     static QString roomIdToString(const RoomId id);
 
@@ -89,8 +111,12 @@ class XmlMapStorage final : public AbstractMapStorage
                                  RoomElementEnum curr);
 
     std::unordered_map<RoomId, SharedRoom> m_loadedRooms;
+    std::vector<SharedInfoMark> m_loadedMarkers;
+    std::optional<Coordinate> m_loadedPosition;
     uint64_t m_loadProgressDivisor;
     uint32_t m_loadProgress;
+    uint32_t m_maxWorkers = 0u;
+    uint32_t m_parallelChunks = 0u;
     static constexpr const uint32_t LOAD_PROGRESS_MAX = 100;
 
     // ---------------- save map -------------------
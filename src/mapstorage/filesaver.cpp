@@ -65,3 +65,15 @@ void FileSaver::close() noexcept(false)
     remove_tmp_suffix(m_filename);
     m_file.close();
 }
+
+void FileSaver::abort() noexcept
+{
+    if (!m_file.isOpen()) {
+        return;
+    }
+
+    m_file.close();
+    if (USE_TMP_SUFFIX) {
+        MAYBE_UNUSED const bool ignored = m_file.remove();
+    }
+}
@@ -38,4 +38,10 @@ class FileSaver final
     /*! \exception std::runtime_error if the file can't be safely closed.
      */
     void close() noexcept(false);
+
+    /*! \brief Closes the file without replacing the original one.
+     *
+     * On Windows the original file has already been overwritten.
+     */
+    void abort() noexcept;
 };
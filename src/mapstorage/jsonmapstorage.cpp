@@ -6,11 +6,20 @@
 
 #include "jsonmapstorage.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <cstddef>
+#include <future>
+#include <map>
+#include <optional>
 #include <stdexcept>
-#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <QCryptographicHash>
 #include <QString>
+#include <QThread>
 
 #include "../expandoracommon/coordinate.h"
 #include "../expandoracommon/exit.h"
@@ -36,6 +45,42 @@ static constexpr const int c_roomIndexFileNameSize = 2;
 // Split the world into 20x20 zones
 static constexpr const int ZONE_WIDTH = 20;
 
+// Plain copy of an exported room (after the base map filter), so the zones
+// can be built on other threads while the rooms stay locked.
+struct NODISCARD JsonRoom final
+{
+    RoomId id = INVALID_ROOMID;
+    Coordinate position;
+    RoomName name;
+    RoomDesc desc;
+    RoomTerrainEnum terrain = RoomTerrainEnum::UNDEFINED;
+    RoomLightEnum light = RoomLightEnum::UNDEFINED;
+    RoomPortableEnum portable = RoomPortableEnum::UNDEFINED;
+    RoomRidableEnum ridable = RoomRidableEnum::UNDEFINED;
+    RoomSundeathEnum sundeath = RoomSundeathEnum::UNDEFINED;
+    RoomMobFlags mobFlags;
+    RoomLoadFlags loadFlags;
+    ExitsList exits;
+};
+
+NODISCARD static JsonRoom copyRoom(const Room &room)
+{
+    JsonRoom copy;
+    copy.id = room.getId();
+    copy.position = room.getPosition();
+    copy.name = room.getName();
+    copy.desc = room.getDescription();
+    copy.terrain = room.getTerrainType();
+    copy.light = room.getLightType();
+    copy.portable = room.getPortableType();
+    copy.ridable = room.getRidableType();
+    copy.sundeath = room.getSundeathType();
+    copy.mobFlags = room.getMobFlags();
+    copy.loadFlags = room.getLoadFlags();
+    copy.exits = room.getExitsList();
+    return copy;
+}
+
 /* Performs MD5 hashing on ASCII-transliterated, whitespace-normalized name+descs.
  * MD5 is for convenience (easily available in all languages), the rest makes
  * the hash resilient to trivial typo fixes by the builders.
@@ -51,6 +96,10 @@ class NODISCARD WebHasher final
 
     void add(QString str)
     {
+        // Compiled once; matching with a shared QRegularExpression is thread-safe.
+        static const QRegularExpression spaces(" +");
+        static const QRegularExpression lineEnds(" *\r?\n");
+
         // This is most likely unnecessary because the parser did it for us...
         // We need plain ASCII so that accentuation changes do not affect the
         // hashes and because MD5 is defined on bytes, not encoded chars.
@@ -59,8 +108,8 @@ class NODISCARD WebHasher final
         // spaces after periods). MMapper ignores such changes when comparing rooms,
         // but the web mapper may only look up rooms by hash. Normalizing the
         // whitespaces makes the hash more resilient.
-        str.replace(QRegularExpression(" +"), " ");
-        str.replace(QRegularExpression(" *\r?\n"), "\n");
+        str.replace(spaces, " ");
+        str.replace(lineEnds, "\n");
 
         // REVISIT: should this be latin1 or utf8?
         m_hash.addData(str.toLatin1());
@@ -71,6 +120,14 @@ class NODISCARD WebHasher final
     void reset() { m_hash.reset(); }
 };
 
+NODISCARD static QByteArray getRoomHash(const JsonRoom &room)
+{
+    WebHasher hasher;
+    hasher.add(room.name.toQString() + "\n");
+    hasher.add(room.desc.toQString());
+    return hasher.result().toHex();
+}
+
 // Lets the webclient locate and load the useful zones only, not the whole
 // world at once.
 class NODISCARD RoomHashIndex final
@@ -80,15 +137,11 @@ class NODISCARD RoomHashIndex final
 
 private:
     Index m_index;
-    WebHasher m_hasher;
 
 public:
-    void addRoom(const Room &room)
+    void addRoom(const QByteArray &hash, const Coordinate &position)
     {
-        m_hasher.add(room.getName().toQString() + "\n");
-        m_hasher.add(room.getDescription().toQString());
-        m_index.insert(m_hasher.result().toHex(), room.getPosition());
-        m_hasher.reset();
+        m_index.insert(hash, position);
     }
 
     NODISCARD const Index &index() const { return m_index; }
@@ -115,32 +168,23 @@ NODISCARD static std::string getZoneKey(const Coordinate &c)
 class NODISCARD ZoneIndex final
 {
 public:
-    using Index = std::unordered_map<std::string, ConstRoomList>;
+    // zone key -> indices of its rooms, in the order they were added
+    using Index = std::map<std::string, std::vector<size_t>>;
 
 private:
     Index m_index;
 
 public:
-    void addRoom(const Room &room)
+    void addRoom(const size_t index, const JsonRoom &room)
     {
-        const auto zone = getZoneKey(room.getPosition());
-        const auto iter = m_index.find(zone);
-        if (iter == m_index.end()) {
-            ConstRoomList list;
-            list.emplace_back(room.shared_from_this());
-            m_index.emplace(zone, std::move(list));
-        } else {
-            iter->second.emplace_back(room.shared_from_this());
-        }
+        m_index[getZoneKey(room.position)].emplace_back(index);
     }
 
     NODISCARD const Index &index() const { return m_index; }
 };
 
-template<typename JsonT>
-static void writeJson(const QString &filePath, JsonT &json, const QString &what)
+static void writeFile(const QString &filePath, const QByteArray &data, const QString &what)
 {
-    static_assert(std::is_same_v<JsonT, QJsonObject> || std::is_same_v<JsonT, QJsonArray>);
     QFile file(filePath);
     if (!file.open(QIODevice::WriteOnly)) {
         QString msg(
@@ -148,31 +192,109 @@ static void writeJson(const QString &filePath, JsonT &json, const QString &what)
         throw std::runtime_error(::toStdStringUtf8(msg));
     }
 
-    QJsonDocument doc(json);
-    QTextStream stream(&file);
-    stream << doc.toJson();
-    stream.flush();
-    if (!file.flush() || stream.status() != QTextStream::Ok) {
+    if (file.write(data) != data.size() || !file.flush()) {
         QString msg(
             QString("error writing %1 to %2: %3").arg(what).arg(filePath).arg(file.errorString()));
         throw std::runtime_error(::toStdStringUtf8(msg));
     }
 }
 
-class NODISCARD RoomIndexStore final
+template<typename JsonT>
+static void writeJson(const QString &filePath, JsonT &json, const QString &what)
 {
+    static_assert(std::is_same_v<JsonT, QJsonObject> || std::is_same_v<JsonT, QJsonArray>);
+    writeFile(filePath, QJsonDocument(json).toJson(), what);
+}
+
+/*! \brief Content hashes of the files written by the previous export.
+ *
+ * Files whose content hasn't changed are not written again, and files that
+ * are no longer part of the export are removed.
+ */
+class NODISCARD ExportManifest final
+{
+private:
     const QDir m_dir;
+    QJsonObject m_previous;
+    QJsonObject m_current;
+
+public:
+    static constexpr const char *const FILE_NAME = "manifest.json";
+
+public:
+    explicit ExportManifest(const QDir &dir)
+        : m_dir(dir)
+    {
+        QFile file(m_dir.filePath(FILE_NAME));
+        if (file.open(QIODevice::ReadOnly)) {
+            // a missing or damaged manifest just means everything is written again
+            m_previous = QJsonDocument::fromJson(file.readAll()).object();
+            file.close();
+            // If the export fails halfway, the old hashes no longer describe the files.
+            file.remove();
+        }
+    }
+
+public:
+    NODISCARD static QByteArray hash(const QByteArray &data)
+    {
+        return QCryptographicHash::hash(data, QCryptographicHash::Md5).toHex();
+    }
+
+    // The previous manifest is only read, so this can be called from any thread.
+    NODISCARD bool isUnchanged(const QString &name, const QByteArray &hash) const
+    {
+        const auto it = m_previous.constFind(name);
+        return it != m_previous.constEnd() && it->toString() == QString::fromLatin1(hash)
+               && QFileInfo::exists(m_dir.filePath(name));
+    }
+
+    void add(const QString &name, const QByteArray &hash)
+    {
+        m_current.insert(name, QString::fromLatin1(hash));
+    }
+
+    // Returns the number of files that were written.
+    uint32_t write(const QString &name, const QByteArray &data, const QString &what)
+    {
+        const QByteArray contentHash = hash(data);
+        add(name, contentHash);
+        if (isUnchanged(name, contentHash)) {
+            return 0;
+        }
+        writeFile(m_dir.filePath(name), data, what);
+        return 1;
+    }
+
+    void finish()
+    {
+        for (auto it = m_previous.constBegin(); it != m_previous.constEnd(); ++it) {
+            if (!m_current.contains(it.key())) {
+                QFile::remove(m_dir.filePath(it.key()));
+            }
+        }
+        writeJson(m_dir.filePath(FILE_NAME), m_current, "manifest");
+        m_previous = std::exchange(m_current, QJsonObject{});
+    }
+};
+
+class NODISCARD RoomIndexStore final
+{
+    ExportManifest &m_manifest;
     QJsonObject m_hashes;
     QByteArray m_prefix;
+    uint32_t m_written = 0;
 
 public:
     RoomIndexStore() = delete;
 
 public:
-    explicit RoomIndexStore(const QDir &dir)
-        : m_dir(dir)
+    explicit RoomIndexStore(ExportManifest &manifest)
+        : m_manifest(manifest)
     {}
 
+    NODISCARD uint32_t getWritten() const { return m_written; }
+
     void add(const QByteArray &hash, Coordinate coords)
     {
         QByteArray prefix = hash.left(c_roomIndexFileNameSize);
@@ -203,9 +325,8 @@ class NODISCARD RoomIndexStore final
         }
 
         assert(!m_prefix.isEmpty());
-        QString filePath = m_dir.filePath(QString::fromLocal8Bit(m_prefix) + ".json");
-
-        writeJson(filePath, m_hashes, "room index");
+        const QString name = "roomindex/" + QString::fromLocal8Bit(m_prefix) + ".json";
+        m_written += m_manifest.write(name, QJsonDocument(m_hashes).toJson(), "room index");
 
         m_hashes = QJsonObject();
         m_prefix = QByteArray();
@@ -242,15 +363,27 @@ uint JsonRoomIdsCache::size() const
     return m_nextJsonId;
 }
 
-// Expects that a RoomSaver locks the Rooms for the lifetime of this object!
+// Copies the rooms, so the RoomSaver only has to lock them during addRooms().
 class JsonWorld final
 {
     JsonRoomIdsCache m_jRoomIds;
-    RoomHashIndex m_roomHashIndex;
+    std::vector<JsonRoom> m_rooms;
+    std::vector<QByteArray> m_roomHashes;
     ZoneIndex m_zoneIndex;
 
-    void addRoom(QJsonArray &jRooms, const Room &room) const;
-    void addExits(const Room &room, QJsonObject &jr) const;
+    void addRoom(QJsonArray &jRooms, const JsonRoom &room) const;
+    void addExits(const JsonRoom &room, QJsonObject &jr) const;
+
+    struct NODISCARD ZoneBatch final
+    {
+        std::vector<std::pair<QString, QByteArray>> files;
+        uint32_t written = 0;
+    };
+    NODISCARD ZoneBatch writeZoneBatch(const QDir &dir,
+                                       const ExportManifest &manifest,
+                                       ZoneIndex::Index::const_iterator begin,
+                                       ZoneIndex::Index::const_iterator end,
+                                       std::atomic<uint32_t> &done);
 
 public:
     JsonWorld();
@@ -259,12 +392,13 @@ class JsonWorld final
                   BaseMapSaveFilter &filter,
                   ProgressCounter &progressCounter,
                   bool baseMapOnly);
-    void writeMetadata(const QFileInfo &path, const MapData &mapData) const;
-    void writeRoomIndex(const QDir &dir) const;
-    void writeZones(const QDir &dir,
-                    BaseMapSaveFilter &filter,
-                    ProgressCounter &progressCounter,
-                    bool baseMapOnly) const;
+    void writeMetadata(ExportManifest &manifest, const MapData &mapData) const;
+    // Also computes the room hashes used by writeRoomIndex().
+    NODISCARD uint32_t writeZones(const QDir &dir,
+                                  ExportManifest &manifest,
+                                  ProgressCounter &progressCounter,
+                                  uint32_t maxWorkers);
+    NODISCARD uint32_t writeRoomIndex(ExportManifest &manifest) const;
 };
 
 JsonWorld::JsonWorld() = default;
@@ -276,21 +410,22 @@ void JsonWorld::addRooms(const ConstRoomList &roomList,
                          ProgressCounter &progressCounter,
                          bool baseMapOnly)
 {
+    m_rooms.reserve(roomList.size());
+    const auto addOne = [this](const Room &room) {
+        m_jRoomIds.addRoom(room.getId());
+        const size_t index = m_rooms.size();
+        m_zoneIndex.addRoom(index, m_rooms.emplace_back(copyRoom(room)));
+    };
     for (const SharedConstRoom &pRoom : roomList) {
         const Room &room = deref(pRoom);
         progressCounter.step();
-
-        if (baseMapOnly) {
-            BaseMapSaveFilter::ActionEnum action = filter.filter(room);
-            if (room.isTemporary() || action == BaseMapSaveFilter::ActionEnum::REJECT) {
-                continue;
-            }
+        if (baseMapOnly && room.isTemporary()) {
+            continue;
         }
-
-        m_jRoomIds.addRoom(room.getId());
-        m_roomHashIndex.addRoom(room);
-        m_zoneIndex.addRoom(room);
+        // The copy has the exits of the altered room, if the filter alters it.
+        filter.visitRoom(room, baseMapOnly, addOne);
     }
+    m_roomHashes.resize(m_rooms.size());
 }
 
 NODISCARD static constexpr const char *getNameUpper(const ExitDirEnum dir)
@@ -316,7 +451,7 @@ NODISCARD static constexpr const char *getNameUpper(const ExitDirEnum dir)
 #undef CASE
 }
 
-void JsonWorld::writeMetadata(const QFileInfo &path, const MapData &mapData) const
+void JsonWorld::writeMetadata(ExportManifest &manifest, const MapData &mapData) const
 {
     // This can give bogus data if the bounds aren't set.
     const Coordinate &min = mapData.getMin();
@@ -341,22 +476,29 @@ void JsonWorld::writeMetadata(const QFileInfo &path, const MapData &mapData) con
         return arr;
     }();
 
-    writeJson(path.filePath(), meta, "metadata");
+    manifest.write("arda.json", QJsonDocument(meta).toJson(), "metadata");
 }
 
-void JsonWorld::writeRoomIndex(const QDir &dir) const
+uint32_t JsonWorld::writeRoomIndex(ExportManifest &manifest) const
 {
+    // Built in room order, so rooms sharing a hash are listed as before.
+    RoomHashIndex roomHashIndex;
+    for (size_t i = 0; i < m_rooms.size(); ++i) {
+        roomHashIndex.addRoom(m_roomHashes[i], m_rooms[i].position);
+    }
+
     using IterT = RoomHashIndex::Index::const_iterator;
-    const RoomHashIndex::Index &index = m_roomHashIndex.index();
+    const RoomHashIndex::Index &index = roomHashIndex.index();
 
-    RoomIndexStore store(dir);
+    RoomIndexStore store(manifest);
     for (IterT iter = index.cbegin(); iter != index.cend(); ++iter) {
         store.add(iter.key(), iter.value());
     }
     store.close();
+    return store.getWritten();
 }
 
-void JsonWorld::addRoom(QJsonArray &jRooms, const Room &room) const
+void JsonWorld::addRoom(QJsonArray &jRooms, const JsonRoom &room) const
 {
     /*
           x: 5, y: 5, z: 0,
@@ -367,34 +509,33 @@ void JsonWorld::addRoom(QJsonArray &jRooms, const Room &room) const
           "A largely ceremonial hall, it was the first mineshaft that led down to what is\n"
     */
 
-    const Coordinate &pos = room.getPosition();
+    const Coordinate &pos = room.position;
     QJsonObject jr;
     jr["x"] = pos.x;
     jr["y"] = -pos.y;
     jr["z"] = pos.z;
 
-    uint jsonId = m_jRoomIds[room.getId()];
+    uint jsonId = m_jRoomIds[room.id];
     jr["id"] = QString::number(jsonId);
-    jr["name"] = room.getName().toQString();
-    jr["desc"] = room.getDescription().toQString();
-    jr["sector"] = static_cast<quint8>(room.getTerrainType());
-    jr["light"] = static_cast<quint8>(room.getLightType());
-    jr["portable"] = static_cast<quint8>(room.getPortableType());
-    jr["rideable"] = static_cast<quint8>(room.getRidableType());
-    jr["sundeath"] = static_cast<quint8>(room.getSundeathType());
-    jr["mobflags"] = static_cast<qint64>(room.getMobFlags().asUint32());
-    jr["loadflags"] = static_cast<qint64>(room.getLoadFlags().asUint32());
+    jr["name"] = room.name.toQString();
+    jr["desc"] = room.desc.toQString();
+    jr["sector"] = static_cast<quint8>(room.terrain);
+    jr["light"] = static_cast<quint8>(room.light);
+    jr["portable"] = static_cast<quint8>(room.portable);
+    jr["rideable"] = static_cast<quint8>(room.ridable);
+    jr["sundeath"] = static_cast<quint8>(room.sundeath);
+    jr["mobflags"] = static_cast<qint64>(room.mobFlags.asUint32());
+    jr["loadflags"] = static_cast<qint64>(room.loadFlags.asUint32());
 
     addExits(room, jr);
 
     jRooms.push_back(jr);
 }
 
-void JsonWorld::addExits(const Room &room, QJsonObject &jr) const
+void JsonWorld::addExits(const JsonRoom &room, QJsonObject &jr) const
 {
-    const ExitsList &exitList = room.getExitsList();
     QJsonArray jExits; // Direction-indexed
-    for (const Exit &e : exitList) {
+    for (const Exit &e : room.exits) {
         QJsonObject je;
         je["flags"] = static_cast<qint64>(e.getExitFlags().asUint32());
         je["dflags"] = static_cast<qint64>(e.getDoorFlags().asUint32());
@@ -418,25 +559,99 @@ void JsonWorld::addExits(const Room &room, QJsonObject &jr) const
     jr["exits"] = jExits;
 }
 
-void JsonWorld::writeZones(const QDir &dir,
-                           BaseMapSaveFilter &filter,
-                           ProgressCounter &progressCounter,
-                           bool baseMapOnly) const
+// Runs on a worker thread: only reads the world and the previous manifest, and
+// only writes the hashes of its own rooms.
+JsonWorld::ZoneBatch JsonWorld::writeZoneBatch(const QDir &dir,
+                                               const ExportManifest &manifest,
+                                               ZoneIndex::Index::const_iterator begin,
+                                               const ZoneIndex::Index::const_iterator end,
+                                               std::atomic<uint32_t> &done)
 {
-    const ZoneIndex::Index &index = m_zoneIndex.index();
-
-    for (const auto &kv : index) {
-        const ConstRoomList &rooms = kv.second;
+    ZoneBatch batch;
+    for (; begin != end; ++begin) {
+        const auto &[zone, rooms] = *begin;
         QJsonArray jRooms;
-        auto saveOne = [this, &jRooms](const Room &room) { addRoom(jRooms, room); };
-        for (const auto &pRoom : rooms) {
-            filter.visitRoom(deref(pRoom), baseMapOnly, saveOne);
-            progressCounter.step();
+        for (const size_t index : rooms) {
+            const JsonRoom &room = m_rooms[index];
+            addRoom(jRooms, room);
+            m_roomHashes[index] = getRoomHash(room);
         }
 
-        QString filePath = dir.filePath(::toQStringUtf8(kv.first + ".json"));
-        writeJson(filePath, jRooms, "zone");
+        const QString name = ::toQStringUtf8("zone/" + zone + ".json");
+        const QByteArray data = QJsonDocument(jRooms).toJson();
+        const QByteArray contentHash = ExportManifest::hash(data);
+        if (!manifest.isUnchanged(name, contentHash)) {
+            writeFile(dir.filePath(name), data, "zone");
+            ++batch.written;
+        }
+        batch.files.emplace_back(name, contentHash);
+        done.fetch_add(static_cast<uint32_t>(rooms.size()), std::memory_order_relaxed);
+    }
+    return batch;
+}
+
+uint32_t JsonWorld::writeZones(const QDir &dir,
+                               ExportManifest &manifest,
+                               ProgressCounter &progressCounter,
+                               const uint32_t maxWorkers)
+{
+    const ZoneIndex::Index &index = m_zoneIndex.index();
+    const auto zonesCount = static_cast<uint32_t>(index.size());
+
+    // Each worker gets a contiguous run of zones; zones are independent files,
+    // and each room belongs to exactly one zone.
+    static constexpr const uint32_t MIN_ZONES_PER_WORKER = 16;
+    const auto idealWorkers = static_cast<uint32_t>(std::max(1, QThread::idealThreadCount()));
+    const auto numWorkers = std::clamp<uint32_t>(zonesCount / MIN_ZONES_PER_WORKER,
+                                                 1u,
+                                                 (maxWorkers != 0u) ? maxWorkers : idealWorkers);
+    std::atomic<uint32_t> done{0u};
+    std::vector<std::future<ZoneBatch>> workers;
+    workers.reserve(numWorkers);
+    auto begin = index.cbegin();
+    for (uint32_t w = 0; w < numWorkers; ++w) {
+        const auto first = static_cast<uint32_t>(uint64_t{zonesCount} * w / numWorkers);
+        const auto last = static_cast<uint32_t>(uint64_t{zonesCount} * (w + 1u) / numWorkers);
+        const auto end = std::next(begin, last - first);
+        workers.emplace_back(
+            std::async(std::launch::async, [this, &dir, &manifest, begin, end, &done]() {
+                return writeZoneBatch(dir, manifest, begin, end, done);
+            }));
+        begin = end;
+    }
+
+    // ProgressCounter emits signals, so it's only touched from this thread.
+    uint32_t reported = 0u;
+    const auto reportDone = [&progressCounter, &done, &reported]() {
+        const uint32_t now = done.load(std::memory_order_relaxed);
+        progressCounter.step(now - reported);
+        reported = now;
+    };
+
+    // Wait for every worker before rethrowing, since they use this object.
+    std::optional<std::runtime_error> error;
+    uint32_t written = 0;
+    for (auto &worker : workers) {
+        while (worker.wait_for(std::chrono::milliseconds(50)) != std::future_status::ready) {
+            reportDone();
+        }
+        reportDone();
+        try {
+            ZoneBatch batch = worker.get();
+            for (const auto &[name, contentHash] : batch.files) {
+                manifest.add(name, contentHash);
+            }
+            written += batch.written;
+        } catch (const std::exception &e) {
+            if (!error.has_value()) {
+                error.emplace(e.what());
+            }
+        }
+    }
+    if (error.has_value()) {
+        throw *error;
     }
+    return written;
 }
 
 } // namespace
@@ -512,9 +727,17 @@ bool JsonMapStorage::saveData(bool baseMapOnly)
             throw std::runtime_error("error creating dir v1/zone");
         }
 
-        world.writeMetadata(QFileInfo(destDir, "arda.json"), m_mapData);
-        world.writeRoomIndex(roomIndexDir);
-        world.writeZones(zoneDir, filter, progressCounter, baseMapOnly);
+        // Files that didn't change since the last export are left alone, so
+        // re-exporting after a small edit only rewrites a few zones.
+        ExportManifest manifest(destDir);
+        world.writeMetadata(manifest, m_mapData);
+        const uint32_t zonesWritten = world.writeZones(destDir,
+                                                       manifest,
+                                                       progressCounter,
+                                                       m_maxWorkers);
+        const uint32_t indexWritten = world.writeRoomIndex(manifest);
+        manifest.finish();
+        log(QString("Wrote %1 zone and %2 room index files.").arg(zonesWritten).arg(indexWritten));
     } catch (const std::exception &e) {
         log(e.what());
         return false;
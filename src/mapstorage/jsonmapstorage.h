@@ -20,6 +20,8 @@ class QObject;
  * - v1/arda.json (global metadata like map size).
  * - v1/roomindex/ss.json (room sums -> zone coords).
  * - v1/zone/xx-yy.json (full info on the NxN rooms zone at coords xx,yy).
+ * - v1/manifest.json (content hashes of the above, so that files that didn't
+ *   change since the previous export aren't written again).
  */
 class JsonMapStorage final : public AbstractMapStorage
 {
@@ -32,6 +34,11 @@ class JsonMapStorage final : public AbstractMapStorage
 public:
     JsonMapStorage() = delete;
 
+public:
+    /// Limits the threads that write zones; 0 means QThread::idealThreadCount(),
+    /// and 1 writes them sequentially.
+    void setMaxWorkers(const uint32_t maxWorkers) { m_maxWorkers = maxWorkers; }
+
 private:
     NODISCARD bool canLoad() const override { return false; }
     NODISCARD bool canSave() const override { return true; }
@@ -42,4 +49,7 @@ class JsonMapStorage final : public AbstractMapStorage
     NODISCARD bool mergeData() override;
     void log(const QString &msg) { emit sig_log("JsonMapStorage", msg); }
     // void saveMark(InfoMark * mark, QJsonObject &jRoom, const JsonRoomIdsCache &jRoomIds);
+
+private:
+    uint32_t m_maxWorkers = 0u;
 };
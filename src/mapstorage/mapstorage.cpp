@@ -6,15 +6,22 @@
 
 #include "mapstorage.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <climits>
+#include <cmath>
 #include <cstdint>
+#include <future>
 #include <memory>
 #include <mutex>
 #include <stdexcept>
 #include <type_traits>
 #include <utility>
+#include <vector>
 #include <QMessageLogContext>
 #include <QObject>
+#include <QThread>
 #include <QtCore>
 #include <QtWidgets>
 
@@ -222,6 +229,23 @@ class NODISCARD LoadRoomHelper final
         const auto z = read_i32();
         return Coordinate{x, y, z};
     }
+
+public:
+    void skip(const int bytes)
+    {
+        if (stream.skipRawData(bytes) != bytes) {
+            throw io::IOException("read past end of file");
+        }
+    }
+
+    void skip_string()
+    {
+        // QString is serialized as its size in bytes (or ~0u if null), followed by UTF-16.
+        const auto bytes = read_u32();
+        if (bytes != UINT_MAX) {
+            skip(static_cast<int>(bytes));
+        }
+    }
 };
 
 /* FIXME: all of these static casts need to do stronger type checking */
@@ -254,42 +278,35 @@ NODISCARD static RoomTerrainEnum serialize(const uint32_t value)
     return static_cast<RoomTerrainEnum>(value);
 }
 
-SharedRoom MapStorage::loadRoom(QDataStream &stream, const uint32_t version)
+// Plain copy of a room as stored in the file; decoding one doesn't touch the map,
+// so it can happen on any thread.
+struct NODISCARD RoomRecord final
 {
-    // TODO: change schema to just store size and latin1 bytes for strings.
-    LoadRoomHelper helper{stream};
-    const SharedRoom room = Room::createPermanentRoom(m_mapData);
-    room->setName(RoomName{helper.read_string()});
-    room->setDescription(RoomDesc{helper.read_string()});
-    room->setContents(RoomContents{helper.read_string()});
-    room->setId(RoomId{helper.read_u32() + baseId});
-    room->setNote(RoomNote{helper.read_string()});
-    room->setTerrainType(serialize(helper.read_u8()));
-    room->setLightType(serialize<RoomLightEnum>(helper.read_u8()));
-    room->setAlignType(serialize<RoomAlignEnum>(helper.read_u8()));
-    room->setPortableType(serialize<RoomPortableEnum>(helper.read_u8()));
-    room->setRidableType(serialize<RoomRidableEnum>(
-        (version >= MMAPPER_2_0_2_SCHEMA) ? helper.read_u8() : uint8_t{0}));
-    room->setSundeathType(serialize<RoomSundeathEnum>(
-        (version >= MMAPPER_2_4_0_SCHEMA) ? helper.read_u8() : uint8_t{0}));
-    room->setMobFlags(serialize<RoomMobFlags>(
-        (version >= MMAPPER_2_4_0_SCHEMA) ? helper.read_u32() : helper.read_u16()));
-    room->setLoadFlags(serialize<RoomLoadFlags>(
-        (version >= MMAPPER_2_4_0_SCHEMA) ? helper.read_u32() : helper.read_u16()));
-    if (helper.read_u8() /*roomUpdated*/ != 0u) {
-        room->setUpToDate();
-    }
-
-    room->setPosition(transformRoomOnLoad(version, helper.readCoord3d() + basePosition));
-    loadExits(*room, stream, version);
-    return room;
-}
+    RoomId id = INVALID_ROOMID;
+    Coordinate position;
+    RoomName name;
+    RoomDesc desc;
+    RoomContents contents;
+    RoomNote note;
+    RoomTerrainEnum terrain = RoomTerrainEnum::UNDEFINED;
+    RoomLightEnum light = RoomLightEnum::UNDEFINED;
+    RoomAlignEnum align = RoomAlignEnum::UNDEFINED;
+    RoomPortableEnum portable = RoomPortableEnum::UNDEFINED;
+    RoomRidableEnum ridable = RoomRidableEnum::UNDEFINED;
+    RoomSundeathEnum sundeath = RoomSundeathEnum::UNDEFINED;
+    RoomMobFlags mobFlags;
+    RoomLoadFlags loadFlags;
+    bool upToDate = false;
+    ExitsList exits;
+};
 
-void MapStorage::loadExits(Room &room, QDataStream &stream, const uint32_t version)
+static void loadExits(ExitsList &eList,
+                      QDataStream &stream,
+                      const uint32_t version,
+                      const uint32_t baseId)
 {
     LoadRoomHelper helper{stream};
 
-    ExitsList eList;
     for (const ExitDirEnum i : ALL_EXITS7) {
         Exit &e = eList[i];
 
@@ -325,8 +342,92 @@ void MapStorage::loadExits(Room &room, QDataStream &stream, const uint32_t versi
             e.addOut(RoomId{connection + baseId});
         }
     }
+}
 
-    room.setExitsList(eList);
+NODISCARD static RoomRecord loadRoom(QDataStream &stream,
+                                     const uint32_t version,
+                                     const uint32_t baseId,
+                                     const Coordinate &basePosition)
+{
+    // TODO: change schema to just store size and latin1 bytes for strings.
+    LoadRoomHelper helper{stream};
+    RoomRecord room;
+    room.name = RoomName{helper.read_string()};
+    room.desc = RoomDesc{helper.read_string()};
+    room.contents = RoomContents{helper.read_string()};
+    room.id = RoomId{helper.read_u32() + baseId};
+    room.note = RoomNote{helper.read_string()};
+    room.terrain = serialize(helper.read_u8());
+    room.light = serialize<RoomLightEnum>(helper.read_u8());
+    room.align = serialize<RoomAlignEnum>(helper.read_u8());
+    room.portable = serialize<RoomPortableEnum>(helper.read_u8());
+    room.ridable = serialize<RoomRidableEnum>(
+        (version >= MMAPPER_2_0_2_SCHEMA) ? helper.read_u8() : uint8_t{0});
+    room.sundeath = serialize<RoomSundeathEnum>(
+        (version >= MMAPPER_2_4_0_SCHEMA) ? helper.read_u8() : uint8_t{0});
+    room.mobFlags = serialize<RoomMobFlags>(
+        (version >= MMAPPER_2_4_0_SCHEMA) ? helper.read_u32() : helper.read_u16());
+    room.loadFlags = serialize<RoomLoadFlags>(
+        (version >= MMAPPER_2_4_0_SCHEMA) ? helper.read_u32() : helper.read_u16());
+    room.upToDate = helper.read_u8() /*roomUpdated*/ != 0u;
+    room.position = transformRoomOnLoad(version, helper.readCoord3d() + basePosition);
+    loadExits(room.exits, stream, version, baseId);
+    return room;
+}
+
+// Finds the end of a room record without decoding it; must match loadRoom() and loadExits().
+static void skipRoom(QDataStream &stream, const uint32_t version)
+{
+    LoadRoomHelper helper{stream};
+    helper.skip_string(); // name
+    helper.skip_string(); // desc
+    helper.skip_string(); // contents
+    helper.skip(4);       // id
+    helper.skip_string(); // note
+    helper.skip(4);       // terrain, light, align, portable
+    if (version >= MMAPPER_2_0_2_SCHEMA) {
+        helper.skip(1); // ridable
+    }
+    if (version >= MMAPPER_2_4_0_SCHEMA) {
+        helper.skip(1); // sundeath
+    }
+    helper.skip((version >= MMAPPER_2_4_0_SCHEMA) ? 8 : 4); // mob and load flags
+    helper.skip(1);                                         // roomUpdated
+    helper.skip(12);                                        // position
+
+    for (MAYBE_UNUSED const ExitDirEnum i : ALL_EXITS7) {
+        helper.skip((version >= MMAPPER_2_4_0_SCHEMA) ? 2 : 1); // exit flags
+        helper.skip((version >= MMAPPER_2_3_7_SCHEMA) ? 2 : 1); // door flags
+        helper.skip_string();                                   // door name
+        while (helper.read_u32() != UINT_MAX) {                 // incoming
+        }
+        while (helper.read_u32() != UINT_MAX) { // outgoing
+        }
+    }
+}
+
+NODISCARD static SharedRoom createRoom(RoomModificationTracker &tracker, RoomRecord &&record)
+{
+    const SharedRoom room = Room::createPermanentRoom(tracker);
+    room->setName(std::move(record.name));
+    room->setDescription(std::move(record.desc));
+    room->setContents(std::move(record.contents));
+    room->setId(record.id);
+    room->setNote(std::move(record.note));
+    room->setTerrainType(record.terrain);
+    room->setLightType(record.light);
+    room->setAlignType(record.align);
+    room->setPortableType(record.portable);
+    room->setRidableType(record.ridable);
+    room->setSundeathType(record.sundeath);
+    room->setMobFlags(record.mobFlags);
+    room->setLoadFlags(record.loadFlags);
+    if (record.upToDate) {
+        room->setUpToDate();
+    }
+    room->setPosition(record.position);
+    room->setExitsList(record.exits);
+    return room;
 }
 
 bool MapStorage::loadData()
@@ -421,17 +522,18 @@ bool MapStorage::mergeData()
         /* Caution! Stream requires buffer to have extended lifetime for new version,
          * so don't be tempted to move this inside the scope. */
         // Then shouldn't buffer be declared before stream, so it will outlive the stream?
+        //
+        // The rest of the file is always read into memory, so the room records
+        // can be decoded directly from it by the worker threads below.
+        QByteArray data;
         QBuffer buffer;
         const bool qCompressed = (version >= MMAPPER_2_4_3_SCHEMA);
         const bool zlibCompressed = (version >= MMAPPER_2_0_4_SCHEMA
                                      && version <= MMAPPER_2_4_0_SCHEMA);
         if (qCompressed || (!NO_ZLIB && zlibCompressed)) {
             QByteArray compressedData(stream.device()->readAll());
-            QByteArray uncompressedData = qCompressed ? qUncompress(compressedData)
-                                                      : StorageUtils::inflate(compressedData);
-            buffer.setData(uncompressedData);
-            buffer.open(QIODevice::ReadOnly);
-            stream.setDevice(&buffer);
+            data = qCompressed ? qUncompress(compressedData)
+                               : StorageUtils::inflate(compressedData);
             log(QString("Uncompressed map using %1").arg(qCompressed ? "qUncompress" : "zlib"));
 
         } else if (NO_ZLIB && zlibCompressed) {
@@ -440,25 +542,70 @@ bool MapStorage::mergeData()
                      "Please recompile MMapper with USE_ZLIB.");
             return false;
         } else {
+            data = stream.device()->readAll();
             log("Map was not compressed");
         }
+        buffer.setData(data);
+        buffer.open(QIODevice::ReadOnly);
+        stream.setDevice(&buffer);
         log(QString("Schema version: %1").arg(version));
 
         const uint32_t roomsCount = helper.read_u32();
         const uint32_t marksCount = helper.read_u32();
-        progressCounter.increaseTotalStepsBy(roomsCount + marksCount);
+        // rooms are counted twice: once when decoded, and once when inserted
+        progressCounter.increaseTotalStepsBy(2u * roomsCount + marksCount);
 
         m_mapData.setPosition(transformRoomOnLoad(version, helper.readCoord3d() + basePosition));
 
         log(QString("Number of rooms: %1").arg(roomsCount));
 
+        // Room records have variable length, so find where each one starts first;
+        // skipping over the strings is much cheaper than decoding them.
+        std::vector<qint64> offsets;
+        offsets.reserve(roomsCount + 1u);
         for (uint32_t i = 0; i < roomsCount; ++i) {
-            SharedRoom room = loadRoom(stream, version);
-
-            progressCounter.step();
-            m_mapData.insertPredefinedRoom(room);
+            offsets.push_back(buffer.pos());
+            skipRoom(stream, version);
+        }
+        offsets.push_back(buffer.pos());
+
+        // Then decode contiguous runs of records in parallel. Each worker reads
+        // from its own stream over the shared (read-only) buffer, and fills its
+        // own vector, so no locking is needed until the rooms are inserted.
+        static constexpr const uint32_t MIN_ROOMS_PER_WORKER = 1024;
+        const auto idealWorkers = static_cast<uint32_t>(std::max(1, QThread::idealThreadCount()));
+        const auto maxWorkers = (m_maxWorkers != 0u) ? m_maxWorkers : idealWorkers;
+        const auto numWorkers = std::clamp<uint32_t>(roomsCount / MIN_ROOMS_PER_WORKER,
+                                                     1u,
+                                                     maxWorkers);
+        const char *const raw = data.constData();
+        std::atomic<uint32_t> decoded{0u};
+        std::vector<std::future<std::vector<RoomRecord>>> workers;
+        workers.reserve(numWorkers);
+        for (uint32_t w = 0; w < numWorkers; ++w) {
+            const uint32_t first = static_cast<uint32_t>(uint64_t{roomsCount} * w / numWorkers);
+            const uint32_t last = static_cast<uint32_t>(uint64_t{roomsCount} * (w + 1u)
+                                                        / numWorkers);
+            const auto begin = offsets[first];
+            const auto size = static_cast<int>(offsets[last] - begin);
+            workers.emplace_back(std::async(
+                std::launch::async,
+                [raw, begin, size, count = last - first, version, baseId = baseId,
+                 basePosition = basePosition, &decoded]() -> std::vector<RoomRecord> {
+                    const QByteArray slice = QByteArray::fromRawData(raw + begin, size);
+                    QDataStream roomStream(slice);
+                    roomStream.setVersion(QDataStream::Qt_4_8);
+                    std::vector<RoomRecord> records;
+                    records.reserve(count);
+                    for (uint32_t i = 0; i < count; ++i) {
+                        records.emplace_back(loadRoom(roomStream, version, baseId, basePosition));
+                        decoded.fetch_add(1u, std::memory_order_relaxed);
+                    }
+                    return records;
+                }));
         }
 
+        // The info marks follow the rooms, so they can be loaded while the workers are busy.
         log(QString("Number of info items: %1").arg(marksCount));
 
         // TODO: reserve the markerList with marksCount
@@ -472,6 +619,29 @@ bool MapStorage::mergeData()
             progressCounter.step();
         }
 
+        // ProgressCounter emits signals, so it's only touched from this thread.
+        uint32_t reported = 0u;
+        const auto reportDecoded = [&progressCounter, &decoded, &reported]() {
+            const uint32_t now = decoded.load(std::memory_order_relaxed);
+            progressCounter.step(now - reported);
+            reported = now;
+        };
+
+        std::vector<SharedRoom> rooms;
+        rooms.reserve(roomsCount);
+        for (auto &worker : workers) {
+            while (worker.wait_for(std::chrono::milliseconds(50)) != std::future_status::ready) {
+                reportDecoded();
+            }
+            reportDecoded();
+            for (RoomRecord &record : worker.get()) {
+                rooms.emplace_back(createRoom(m_mapData, std::move(record)));
+            }
+        }
+
+        m_mapData.insertPredefinedRooms(rooms);
+        progressCounter.step(roomsCount);
+
         log("Finished loading.");
 
         // REVISIT: Closing is probably not necessary, since you don't do it in the failure cases.
@@ -554,29 +724,63 @@ void MapStorage::loadMark(InfoMark &mark, QDataStream &stream, uint32_t version)
         mark.setText(InfoMarkText{"New Marker"});
 }
 
-void MapStorage::saveRoom(const Room &room, QDataStream &stream)
+// Plain copy of an info mark, for the same reason as RoomRecord.
+struct NODISCARD MarkRecord final
+{
+    InfoMarkText text;
+    InfoMarkTypeEnum type = InfoMarkTypeEnum::TEXT;
+    InfoMarkClassEnum clas = InfoMarkClassEnum::GENERIC;
+    int rotationAngle = 0;
+    Coordinate position1;
+    Coordinate position2;
+};
+
+struct NODISCARD MapStorage::Snapshot final
+{
+    Coordinate position;
+    std::vector<RoomRecord> rooms;
+    std::vector<MarkRecord> marks;
+};
+
+NODISCARD static RoomRecord copyRoom(const Room &room)
 {
-    stream << room.getName().toQString();
-    stream << room.getDescription().toQString();
-    stream << room.getContents().toQString();
-    stream << static_cast<quint32>(room.getId());
-    stream << room.getNote().toQString();
-    stream << static_cast<quint8>(room.getTerrainType());
-    stream << static_cast<quint8>(room.getLightType());
-    stream << static_cast<quint8>(room.getAlignType());
-    stream << static_cast<quint8>(room.getPortableType());
-    stream << static_cast<quint8>(room.getRidableType());
-    stream << static_cast<quint8>(room.getSundeathType());
-    stream << static_cast<quint32>(room.getMobFlags());
-    stream << static_cast<quint32>(room.getLoadFlags());
-    stream << static_cast<quint8>(room.isUpToDate());
-    writeCoordinate(stream, room.getPosition());
-    saveExits(room, stream);
+    RoomRecord record;
+    record.id = room.getId();
+    record.position = room.getPosition();
+    record.name = room.getName();
+    record.desc = room.getDescription();
+    record.contents = room.getContents();
+    record.note = room.getNote();
+    record.terrain = room.getTerrainType();
+    record.light = room.getLightType();
+    record.align = room.getAlignType();
+    record.portable = room.getPortableType();
+    record.ridable = room.getRidableType();
+    record.sundeath = room.getSundeathType();
+    record.mobFlags = room.getMobFlags();
+    record.loadFlags = room.getLoadFlags();
+    record.upToDate = room.isUpToDate();
+    record.exits = room.getExitsList();
+    return record;
 }
 
-void MapStorage::saveExits(const Room &room, QDataStream &stream)
+NODISCARD static MarkRecord copyMark(const InfoMark &mark)
+{
+    MarkRecord record;
+    record.type = mark.getType();
+    if (record.type == InfoMarkTypeEnum::TEXT) {
+        record.text = mark.getText();
+    }
+    record.clas = mark.getClass();
+    // REVISIT: round to 45 degrees?
+    record.rotationAngle = static_cast<int>(std::lround(mark.getRotationAngle()));
+    record.position1 = mark.getPosition1();
+    record.position2 = mark.getPosition2();
+    return record;
+}
+
+static void saveExits(const ExitsList &exitList, QDataStream &stream)
 {
-    const ExitsList &exitList = room.getExitsList();
     for (const Exit &e : exitList) {
         // REVISIT: need to be much more careful about how we serialize flags;
         // places like this will be easy to overlook when the definition changes
@@ -595,13 +799,39 @@ void MapStorage::saveExits(const Room &room, QDataStream &stream)
     }
 }
 
-bool MapStorage::saveData(bool baseMapOnly)
+static void saveRoom(const RoomRecord &room, QDataStream &stream)
 {
-    log("Writing data to file ...");
+    stream << room.name.toQString();
+    stream << room.desc.toQString();
+    stream << room.contents.toQString();
+    stream << static_cast<quint32>(room.id);
+    stream << room.note.toQString();
+    stream << static_cast<quint8>(room.terrain);
+    stream << static_cast<quint8>(room.light);
+    stream << static_cast<quint8>(room.align);
+    stream << static_cast<quint8>(room.portable);
+    stream << static_cast<quint8>(room.ridable);
+    stream << static_cast<quint8>(room.sundeath);
+    stream << static_cast<quint32>(room.mobFlags);
+    stream << static_cast<quint32>(room.loadFlags);
+    stream << static_cast<quint8>(room.upToDate);
+    writeCoordinate(stream, room.position);
+    saveExits(room.exits, stream);
+}
 
-    QDataStream fileStream(m_file);
-    fileStream.setVersion(QDataStream::Qt_4_8);
+static void saveMark(const MarkRecord &mark, QDataStream &stream)
+{
+    // REVISIT: save type first, and then avoid saving fields that aren't necessary?
+    stream << mark.text.toQString();
+    stream << static_cast<quint8>(mark.type);
+    stream << static_cast<quint8>(mark.clas);
+    stream << static_cast<qint32>(mark.rotationAngle);
+    writeCoordinate(stream, mark.position1);
+    writeCoordinate(stream, mark.position2);
+}
 
+MapStorage::SharedSnapshot MapStorage::takeSnapshot(const bool baseMapOnly)
+{
     // Collect the room and marker lists. The room list can't be acquired
     // directly apparently and we have to go through a RoomSaver which receives
     // them from a sort of callback function.
@@ -614,67 +844,104 @@ bool MapStorage::saveData(bool baseMapOnly)
         m_mapData.lookingForRooms(saver, RoomId{i});
     }
 
-    auto roomsCount = saver.getRoomsCount();
-    const auto marksCount = static_cast<uint32_t>(markerList.size());
-
     auto &progressCounter = getProgressCounter();
     progressCounter.reset();
-    progressCounter.increaseTotalStepsBy(roomsCount + marksCount);
+    progressCounter.increaseTotalStepsBy(saver.getRoomsCount()
+                                         + static_cast<uint32_t>(markerList.size()));
 
     BaseMapSaveFilter filter;
     if (baseMapOnly) {
         filter.setMapData(&m_mapData);
         progressCounter.increaseTotalStepsBy(filter.prepareCount());
         filter.prepare(progressCounter);
-        roomsCount = filter.acceptedRoomsCount();
     }
 
-    // Compression step
-    progressCounter.increaseTotalStepsBy(1);
+    auto snapshot = std::make_shared<Snapshot>();
+    snapshot->position = m_mapData.getPosition();
+    snapshot->rooms.reserve(baseMapOnly ? filter.acceptedRoomsCount() : roomList.size());
+    snapshot->marks.reserve(markerList.size());
 
+    auto copyOne = [&snapshot](const Room &room) { snapshot->rooms.emplace_back(copyRoom(room)); };
+    for (const std::shared_ptr<const Room> &pRoom : roomList) {
+        filter.visitRoom(deref(pRoom), baseMapOnly, copyOne);
+        progressCounter.step();
+    }
+
+    for (const auto &mark : markerList) {
+        snapshot->marks.emplace_back(copyMark(deref(mark)));
+        progressCounter.step();
+    }
+
+    return snapshot;
+}
+
+double MapStorage::writeSnapshot(const Snapshot &snapshot, QIODevice &device) noexcept(false)
+{
     // Write a header with a "magic number" and a version
-    fileStream << static_cast<quint32>(0xFFB2AF01);
-    fileStream << static_cast<qint32>(CURRENT_SCHEMA);
+    {
+        QDataStream fileStream(&device);
+        fileStream.setVersion(QDataStream::Qt_4_8);
+        fileStream << static_cast<quint32>(0xFFB2AF01);
+        fileStream << static_cast<qint32>(CURRENT_SCHEMA);
+    }
 
-    // Serialize the data
+    // Serialize the data in pieces, compressing each one as soon as it's full.
+    StorageUtils::CompressingWriter writer{device};
     QBuffer buffer;
     buffer.open(QIODevice::WriteOnly);
     QDataStream stream(&buffer);
     stream.setVersion(QDataStream::Qt_4_8);
 
+    static constexpr const qint64 FLUSH_SIZE = 1 << 20;
+    const auto flush = [&writer, &buffer]() {
+        writer.write(buffer.data());
+        buffer.buffer().clear();
+        buffer.seek(0);
+    };
+
     // write counters
-    stream << static_cast<quint32>(roomsCount);
-    stream << static_cast<quint32>(marksCount);
+    stream << static_cast<quint32>(snapshot.rooms.size());
+    stream << static_cast<quint32>(snapshot.marks.size());
 
     // write selected room x,y,z
-    writeCoordinate(stream, m_mapData.getPosition());
+    writeCoordinate(stream, snapshot.position);
 
-    // save rooms
-    auto saveOne = [this, &stream](const Room &room) { saveRoom(room, stream); };
-    for (const std::shared_ptr<const Room> &pRoom : roomList) {
-        filter.visitRoom(deref(pRoom), baseMapOnly, saveOne);
-        progressCounter.step();
+    for (const RoomRecord &room : snapshot.rooms) {
+        saveRoom(room, stream);
+        if (buffer.size() >= FLUSH_SIZE) {
+            flush();
+        }
     }
 
-    // save items
-    for (const auto &mark : markerList) {
-        saveMark(deref(mark), stream);
-        progressCounter.step();
+    for (const MarkRecord &mark : snapshot.marks) {
+        saveMark(mark, stream);
+        if (buffer.size() >= FLUSH_SIZE) {
+            flush();
+        }
     }
 
-    buffer.close();
+    flush();
+    writer.finish();
+
+    const qint64 compressedSize = writer.getCompressedSize();
+    return (compressedSize == 0) ? 1.0
+                                 : (static_cast<double>(writer.getUncompressedSize())
+                                    / static_cast<double>(compressedSize));
+}
+
+bool MapStorage::saveData(bool baseMapOnly)
+{
+    log("Writing data to file ...");
+
+    const SharedSnapshot snapshot = takeSnapshot(baseMapOnly);
 
-    QByteArray uncompressedData(buffer.data());
-    QByteArray compressedData = qCompress(uncompressedData);
+    // Compression step
+    auto &progressCounter = getProgressCounter();
+    progressCounter.increaseTotalStepsBy(1);
+    const double compressionRatio = writeSnapshot(deref(snapshot), deref(m_file));
     progressCounter.step();
-    double compressionRatio = (compressedData.isEmpty())
-                                  ? 1.0
-                                  : (static_cast<double>(uncompressedData.size())
-                                     / static_cast<double>(compressedData.size()));
     log(QString("Map compressed (compression ratio of %1:1)")
             .arg(QString::number(compressionRatio, 'f', 1)));
-
-    fileStream.writeRawData(compressedData.data(), compressedData.size());
     log("Writing data finished.");
 
     m_mapData.unsetDataChanged();
@@ -682,16 +949,3 @@ bool MapStorage::saveData(bool baseMapOnly)
 
     return true;
 }
-
-void MapStorage::saveMark(const InfoMark &mark, QDataStream &stream)
-{
-    // REVISIT: save type first, and then avoid saving fields that aren't necessary?
-    const InfoMarkTypeEnum type = mark.getType();
-    stream << QString((type == InfoMarkTypeEnum::TEXT) ? mark.getText().toQString() : "");
-    stream << static_cast<quint8>(type);
-    stream << static_cast<quint8>(mark.getClass());
-    // REVISIT: round to 45 degrees?
-    stream << static_cast<qint32>(std::lround(mark.getRotationAngle()));
-    writeCoordinate(stream, mark.getPosition1());
-    writeCoordinate(stream, mark.getPosition2());
-}
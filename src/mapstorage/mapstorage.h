@@ -6,6 +6,7 @@
 // Author: Nils Schimmelmann <nschimme@gmail.com> (Jahara)
 
 #include <cstdint>
+#include <memory>
 #include <QArgument>
 #include <QObject>
 #include <QString>
@@ -20,6 +21,7 @@
 class InfoMark;
 class QDataStream;
 class QFile;
+class QIODevice;
 class QObject;
 class Room;
 
@@ -36,21 +38,35 @@ class MapStorage final : public AbstractMapStorage
     NODISCARD bool canLoad() const override { return true; }
     NODISCARD bool canSave() const override { return true; }
 
+public:
+    /// Limits the threads that decode room records; 0 means QThread::idealThreadCount().
+    void setMaxWorkers(const uint32_t maxWorkers) { m_maxWorkers = maxWorkers; }
+
+public:
+    /// Everything saveData() writes, copied out of the map.
+    struct Snapshot;
+    using SharedSnapshot = std::shared_ptr<const Snapshot>;
+
+    /// Must be called on the thread that owns the map; this is the only part of
+    /// saving that reads it.
+    NODISCARD SharedSnapshot takeSnapshot(bool baseMapOnly);
+
+    /// Serializes and compresses a snapshot into the device; safe to call on any thread.
+    /// Returns the compression ratio.
+    /// \exception std::runtime_error if the device can't be written.
+    static double writeSnapshot(const Snapshot &snapshot, QIODevice &device) noexcept(false);
+
 private:
     void newData() override;
     NODISCARD bool loadData() override;
     NODISCARD bool saveData(bool baseMapOnly) override;
 
-    SharedRoom loadRoom(QDataStream &stream, uint32_t version);
-    void loadExits(Room &room, QDataStream &stream, uint32_t version);
     void loadMark(InfoMark &mark, QDataStream &stream, uint32_t version);
-    void saveMark(const InfoMark &mark, QDataStream &stream);
-    void saveRoom(const Room &room, QDataStream &stream);
-    void saveExits(const Room &room, QDataStream &stream);
     void log(const QString &msg) { emit sig_log("MapStorage", msg); }
 
     uint32_t baseId = 0u;
     Coordinate basePosition;
+    uint32_t m_maxWorkers = 0u;
 };
 
 class MapFrontendBlocker final
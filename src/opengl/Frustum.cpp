@@ -0,0 +1,32 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2023 The MMapper Authors
+
+#include "Frustum.h"
+
+#include <glm/gtc/matrix_access.hpp>
+
+// A point is inside when -w <= x, y, z <= w in clip space, so each plane is
+// the last row of the matrix plus or minus one of the other rows.
+Frustum::Frustum(const glm::mat4 &viewProj)
+{
+    const glm::vec4 w = glm::row(viewProj, 3);
+    for (int i = 0; i < 3; ++i) {
+        const glm::vec4 row = glm::row(viewProj, i);
+        m_planes[static_cast<size_t>(2 * i)] = w + row;
+        m_planes[static_cast<size_t>(2 * i + 1)] = w - row;
+    }
+}
+
+bool Frustum::intersects(const glm::vec3 &lo, const glm::vec3 &hi) const
+{
+    for (const glm::vec4 &plane : m_planes) {
+        // the corner furthest along the plane's normal
+        const glm::vec3 corner{(plane.x >= 0.f) ? hi.x : lo.x,
+                               (plane.y >= 0.f) ? hi.y : lo.y,
+                               (plane.z >= 0.f) ? hi.z : lo.z};
+        if (glm::dot(glm::vec3{plane}, corner) + plane.w < 0.f) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,25 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2023 The MMapper Authors
+
+#include <array>
+#include <glm/glm.hpp>
+
+#include "../global/macros.h"
+
+/// The clip planes of a view-projection matrix, for skipping batches that
+/// can't end up on screen.
+class NODISCARD Frustum final
+{
+private:
+    // dot(plane, vec4(p, 1)) >= 0 on the inside; not normalized.
+    std::array<glm::vec4, 6> m_planes{};
+
+public:
+    explicit Frustum(const glm::mat4 &viewProj);
+
+public:
+    /// Conservative: a box just outside one of the frustum's edges or corners
+    /// can still count as visible, but a visible box never counts as hidden.
+    NODISCARD bool intersects(const glm::vec3 &lo, const glm::vec3 &hi) const;
+};
@@ -54,6 +54,36 @@ bool OpenGL::tryEnableMultisampling(const int requestedSamples)
     return getFunctions().tryEnableMultisampling(requestedSamples);
 }
 
+bool OpenGL::canRenderTextureArrays()
+{
+    return Legacy::Functions::canRenderTextureArrays();
+}
+
+bool OpenGL::canRenderInstancedQuads()
+{
+    return getFunctions().canRenderInstanced() && canRenderTextureArrays();
+}
+
+bool OpenGL::canMeasureGpuTime()
+{
+    return getFunctions().canMeasureGpuTime();
+}
+
+bool OpenGL::beginGpuTimer(const uint32_t tag)
+{
+    return getFunctions().beginGpuTimer(tag);
+}
+
+void OpenGL::endGpuTimer()
+{
+    getFunctions().endGpuTimer();
+}
+
+void OpenGL::collectGpuTimers(std::vector<GpuTimerResult> &results)
+{
+    getFunctions().collectGpuTimers(results);
+}
+
 UniqueMesh OpenGL::createPointBatch(const std::vector<ColorVert> &batch)
 {
     return getFunctions().createPointBatch(batch);
@@ -101,6 +131,25 @@ UniqueMesh OpenGL::createColoredTexturedQuadBatch(const std::vector<ColoredTexVe
     return getFunctions().createColoredTexturedBatch(DrawModeEnum::QUADS, batch, texture);
 }
 
+UniqueMesh OpenGL::createTexturedQuadBatch(const std::vector<ArrayTexVert> &batch,
+                                           const SharedMMTexture &texture)
+{
+    return getFunctions().createTexturedBatch(DrawModeEnum::QUADS, batch, texture);
+}
+
+UniqueMesh OpenGL::createColoredTexturedQuadBatch(const std::vector<ColoredArrayTexVert> &batch,
+                                                  const SharedMMTexture &texture)
+{
+    return getFunctions().createColoredTexturedBatch(DrawModeEnum::QUADS, batch, texture);
+}
+
+UniqueMesh OpenGL::createInstancedQuadBatch(const glm::vec3 &origin,
+                                            const std::vector<QuadInstance> &instances,
+                                            const SharedMMTexture &texture)
+{
+    return getFunctions().createInstancedQuadBatch(origin, instances, texture);
+}
+
 UniqueMesh OpenGL::createFontMesh(const SharedMMTexture &texture,
                                   const DrawModeEnum mode,
                                   const std::vector<FontVert3d> &batch)
@@ -3,6 +3,7 @@
 // Copyright (C) 2019 The MMapper Authors
 // Author: Nils Schimmelmann <nschimme@gmail.com> (Jahara)
 
+#include <cstdint>
 #include <glm/glm.hpp>
 #include <memory>
 #include <vector>
@@ -48,6 +49,20 @@ class OpenGL final
 
 public:
     NODISCARD bool tryEnableMultisampling(int samples);
+    // True if array textures can be passed to the textured quad batches below.
+    NODISCARD bool canRenderTextureArrays();
+    // True if createInstancedQuadBatch() can be used.
+    NODISCARD bool canRenderInstancedQuads();
+    // True if the GPU timers below measure anything.
+    NODISCARD bool canMeasureGpuTime();
+
+public:
+    // Asynchronous GPU timers; they can't nest. beginGpuTimer() returns false if the
+    // pass won't be timed; only call endGpuTimer() if it returned true.
+    NODISCARD bool beginGpuTimer(uint32_t tag);
+    void endGpuTimer();
+    // Appends the timers the GPU has finished, oldest first; never waits for the GPU.
+    void collectGpuTimers(std::vector<GpuTimerResult> &results);
 
 public:
     NODISCARD UniqueMesh createPointBatch(const std::vector<ColorVert> &verts);
@@ -72,6 +87,15 @@ class OpenGL final
                                                  const SharedMMTexture &texture);
     NODISCARD UniqueMesh createColoredTexturedQuadBatch(const std::vector<ColoredTexVert> &verts,
                                                         const SharedMMTexture &texture);
+    // The texture may be an array texture; the third texture coordinate selects its layer.
+    NODISCARD UniqueMesh createTexturedQuadBatch(const std::vector<ArrayTexVert> &verts,
+                                                 const SharedMMTexture &texture);
+    NODISCARD UniqueMesh createColoredTexturedQuadBatch(
+        const std::vector<ColoredArrayTexVert> &verts, const SharedMMTexture &texture);
+    // Unit quads at origin + instance offset; the texture must be an array texture.
+    NODISCARD UniqueMesh createInstancedQuadBatch(const glm::vec3 &origin,
+                                                  const std::vector<QuadInstance> &instances,
+                                                  const SharedMMTexture &texture);
 
     NODISCARD UniqueMesh createFontMesh(const SharedMMTexture &texture,
                                         DrawModeEnum mode,
@@ -41,6 +41,56 @@ struct NODISCARD ColoredTexVert final
     {}
 };
 
+// Like TexVert, but the third texture coordinate selects the layer of an array texture;
+// it's ignored when the texture is a regular 2D texture.
+struct NODISCARD ArrayTexVert final
+{
+    glm::vec3 tex;
+    glm::vec3 vert;
+
+    explicit ArrayTexVert(const glm::vec3 &tex, const glm::vec3 &vert)
+        : tex{tex}
+        , vert{vert}
+    {}
+};
+
+struct NODISCARD ColoredArrayTexVert final
+{
+    Color color;
+    glm::vec3 tex;
+    glm::vec3 vert;
+
+    explicit ColoredArrayTexVert(const Color &color, const glm::vec3 &tex, const glm::vec3 &vert)
+        : color{color}
+        , tex{tex}
+        , vert{vert}
+    {}
+};
+
+// One instance of a unit quad, offset from the origin of its batch by (x, y, z),
+// textured by one layer of an array texture, and modulated by color.
+struct NODISCARD QuadInstance final
+{
+    int16_t x = 0;
+    int16_t y = 0;
+    int16_t z = 0;
+    int16_t layer = 0;
+    Color color;
+
+    explicit QuadInstance(const int16_t x,
+                          const int16_t y,
+                          const int16_t z,
+                          const int16_t layer,
+                          const Color &color)
+        : x{x}
+        , y{y}
+        , z{z}
+        , layer{layer}
+        , color{color}
+    {}
+};
+static_assert(sizeof(QuadInstance) == 12);
+
 struct NODISCARD ColorVert final
 {
     Color color;
@@ -332,6 +382,13 @@ struct NODISCARD Viewport
     glm::ivec2 size;
 };
 
+// GPU time between beginGpuTimer(tag) and the following endGpuTimer().
+struct NODISCARD GpuTimerResult final
+{
+    uint32_t tag = 0;
+    uint64_t nanoseconds = 0;
+};
+
 static constexpr const size_t VERTS_PER_LINE = 2;
 static constexpr const size_t VERTS_PER_TRI = 3;
 static constexpr const size_t VERTS_PER_QUAD = 4;
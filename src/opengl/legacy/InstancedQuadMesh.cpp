@@ -0,0 +1,148 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2023 The MMapper Authors
+
+#include "InstancedQuadMesh.h"
+
+#include <cassert>
+#include <cstddef>
+#include <glm/gtc/matrix_transform.hpp>
+#include <optional>
+#include <tuple>
+#include <utility>
+
+#include "Binders.h"
+
+#define VPO(x) reinterpret_cast<void *>(offsetof(QuadInstance, x))
+
+namespace Legacy {
+
+InstancedQuadMesh::Attribs InstancedQuadMesh::Attribs::getLocations(
+    AbstractShaderProgram &shader)
+{
+    Attribs result;
+    result.quadPos = shader.getAttribLocation("aQuad");
+    result.instancePos = shader.getAttribLocation("aInstance");
+    result.colorPos = shader.getAttribLocation("aColor");
+    return result;
+}
+
+InstancedQuadMesh::InstancedQuadMesh(const SharedFunctions &sharedFunctions,
+                                     const std::shared_ptr<InstancedQuadShader> &sharedProgram,
+                                     const glm::vec3 &origin,
+                                     const std::vector<QuadInstance> &instances)
+    : m_shared_functions{sharedFunctions}
+    , m_functions{deref(m_shared_functions)}
+    , m_shared_program{sharedProgram}
+    , m_program{deref(m_shared_program)}
+    , m_origin{origin}
+{
+    // Like the VBOs of the immediate rendering functions, the quad is only
+    // uploaded again after the static VBOs have been cleaned up.
+    static WeakVbo weakQuad;
+    static std::pair<DrawModeEnum, GLsizei> quadModeAndVerts;
+    m_quad = weakQuad.lock();
+    if (m_quad == nullptr) {
+        weakQuad = m_quad = m_functions.getStaticVbos().alloc();
+        VBO &quad = deref(m_quad);
+        quad.emplace(m_shared_functions);
+        const std::vector<glm::vec2> corners{{0, 0}, {1, 0}, {1, 1}, {0, 1}};
+        quadModeAndVerts = m_functions.setVbo(DrawModeEnum::QUADS,
+                                              quad.get(),
+                                              corners,
+                                              BufferUsageEnum::STATIC_DRAW);
+    }
+    std::tie(m_quadMode, m_numQuadVerts) = quadModeAndVerts;
+
+    if (instances.empty()) {
+        return;
+    }
+
+    m_instances.emplace(m_shared_functions);
+    if (LOG_VBO_STATIC_UPLOADS) {
+        qInfo() << "Uploading static buffer with" << instances.size() << "instances of size"
+                << sizeof(QuadInstance) << "(total" << (instances.size() * sizeof(QuadInstance))
+                << "bytes) to VBO" << m_instances.get() << __FUNCTION__;
+    }
+    // INVALID, because the instances mustn't be converted like quad vertices.
+    m_numInstances = m_functions
+                         .setVbo(DrawModeEnum::INVALID,
+                                 m_instances.get(),
+                                 instances,
+                                 BufferUsageEnum::STATIC_DRAW)
+                         .second;
+}
+
+InstancedQuadMesh::~InstancedQuadMesh()
+{
+    reset();
+}
+
+void InstancedQuadMesh::virt_clear()
+{
+    if (m_instances) {
+        m_functions.clearVbo(m_instances.get(), BufferUsageEnum::STATIC_DRAW);
+    }
+    m_numInstances = 0;
+    assert(isEmpty());
+}
+
+void InstancedQuadMesh::virt_reset()
+{
+    m_numInstances = 0;
+    m_instances.reset();
+    m_quad.reset();
+    assert(isEmpty());
+}
+
+bool InstancedQuadMesh::virt_isEmpty() const
+{
+    return !m_instances || m_quad == nullptr || m_numInstances == 0
+           || m_quadMode == DrawModeEnum::INVALID;
+}
+
+void InstancedQuadMesh::virt_render(const GLRenderState &renderState)
+{
+    if (isEmpty())
+        return;
+
+    Functions &gl = m_functions;
+    gl.checkError();
+
+    // The instances are relative to the origin, so they fit in 16 bits.
+    const glm::mat4 mvp = glm::translate(gl.getProjectionMatrix(), m_origin);
+    auto programUnbinder = m_program.bind();
+    m_program.setUniforms(mvp, renderState.uniforms);
+    RenderStateBinder renderStateBinder(gl, renderState);
+
+    const auto attribs = Attribs::getLocations(m_program);
+    const auto instanceSize = static_cast<GLsizei>(sizeof(QuadInstance));
+    gl.glBindBuffer(GL_ARRAY_BUFFER, deref(m_quad).get());
+    gl.enableAttrib(attribs.quadPos, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+    gl.glBindBuffer(GL_ARRAY_BUFFER, m_instances.get());
+    gl.enableAttrib(attribs.instancePos, 4, GL_SHORT, GL_FALSE, instanceSize, VPO(x));
+    gl.enableAttrib(attribs.colorPos, 4, GL_UNSIGNED_BYTE, GL_TRUE, instanceSize, VPO(color));
+    gl.glVertexAttribDivisor(attribs.instancePos, 1);
+    gl.glVertexAttribDivisor(attribs.colorPos, 1);
+
+    gl.checkError();
+
+    if (const std::optional<GLenum> &optMode = Functions::toGLenum(m_quadMode)) {
+        gl.glDrawArraysInstanced(optMode.value(), 0, m_numQuadVerts, m_numInstances);
+    } else {
+        assert(false);
+    }
+
+    // The divisors belong to the attribute locations, so they'd leak into other meshes.
+    gl.glVertexAttribDivisor(attribs.instancePos, 0);
+    gl.glVertexAttribDivisor(attribs.colorPos, 0);
+    gl.glDisableVertexAttribArray(attribs.quadPos);
+    gl.glDisableVertexAttribArray(attribs.instancePos);
+    gl.glDisableVertexAttribArray(attribs.colorPos);
+    gl.glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    gl.checkError();
+}
+
+} // namespace Legacy
+
+#undef VPO
@@ -0,0 +1,58 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2023 The MMapper Authors
+
+#include <memory>
+#include <vector>
+
+#include "../OpenGLTypes.h"
+#include "Legacy.h"
+#include "Shaders.h"
+#include "VBO.h"
+
+namespace Legacy {
+
+// Draws a batch of unit quads with a single instanced draw call. Each quad only
+// takes one QuadInstance (12 bytes) instead of four full vertices; the corners
+// of the quad are in a VBO that's shared by every instanced mesh.
+class NODISCARD InstancedQuadMesh final : public IRenderable
+{
+private:
+    struct NODISCARD Attribs final
+    {
+        GLuint quadPos = INVALID_ATTRIB_LOCATION;
+        GLuint instancePos = INVALID_ATTRIB_LOCATION;
+        GLuint colorPos = INVALID_ATTRIB_LOCATION;
+
+        NODISCARD static Attribs getLocations(AbstractShaderProgram &shader);
+    };
+
+    const SharedFunctions m_shared_functions;
+    Functions &m_functions;
+    const std::shared_ptr<InstancedQuadShader> m_shared_program;
+    InstancedQuadShader &m_program;
+    SharedVbo m_quad;
+    DrawModeEnum m_quadMode = DrawModeEnum::INVALID;
+    GLsizei m_numQuadVerts = 0;
+    VBO m_instances;
+    glm::vec3 m_origin{0.f};
+    GLsizei m_numInstances = 0;
+
+public:
+    explicit InstancedQuadMesh(const SharedFunctions &sharedFunctions,
+                               const std::shared_ptr<InstancedQuadShader> &sharedProgram,
+                               const glm::vec3 &origin,
+                               const std::vector<QuadInstance> &instances);
+    ~InstancedQuadMesh() final;
+
+public:
+    DELETE_CTORS_AND_ASSIGN_OPS(InstancedQuadMesh);
+
+private:
+    void virt_clear() final;
+    void virt_reset() final;
+    NODISCARD bool virt_isEmpty() const final;
+    void virt_render(const GLRenderState &renderState) final;
+};
+
+} // namespace Legacy
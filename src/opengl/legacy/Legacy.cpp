@@ -19,15 +19,18 @@
 #include <QMessageLogContext>
 #include <QOpenGLTexture>
 
+#include "../../display/Textures.h" // modularity violation
 #include "../../global/utils.h"
 #include "../OpenGLTypes.h"
 #include "AbstractShaderProgram.h"
 #include "Binders.h"
 #include "FontMesh3d.h"
+#include "InstancedQuadMesh.h"
 #include "Meshes.h"
 #include "ShaderUtils.h"
 #include "Shaders.h"
 #include "SimpleMesh.h"
+#include "TimerQueries.h"
 #include "VBO.h"
 
 namespace Legacy {
@@ -104,6 +107,51 @@ UniqueMesh Functions::createColoredTexturedBatch(const DrawModeEnum mode,
     return createTexturedMesh<ColoredTexturedMesh>(shared_from_this(), mode, batch, prog, texture);
 }
 
+NODISCARD static bool isArrayTexture(const SharedMMTexture &texture)
+{
+    return deref(texture).target() == QOpenGLTexture::Target::Target2DArray;
+}
+
+UniqueMesh Functions::createTexturedBatch(const DrawModeEnum mode,
+                                          const std::vector<ArrayTexVert> &batch,
+                                          const SharedMMTexture &texture)
+{
+    assert(static_cast<size_t>(mode) >= VERTS_PER_TRI);
+    const auto shared = shared_from_this();
+    if (isArrayTexture(texture)) {
+        const auto &prog = getShaderPrograms().getTexturedArrayUColorShader();
+        return createTexturedMesh<TexturedArrayMesh>(shared, mode, batch, prog, texture);
+    }
+    const auto &prog = getShaderPrograms().getTexturedUColorShader();
+    return createTexturedMesh<TexturedMesh>(shared, mode, batch, prog, texture);
+}
+
+UniqueMesh Functions::createColoredTexturedBatch(const DrawModeEnum mode,
+                                                 const std::vector<ColoredArrayTexVert> &batch,
+                                                 const SharedMMTexture &texture)
+{
+    assert(static_cast<size_t>(mode) >= VERTS_PER_TRI);
+    const auto shared = shared_from_this();
+    if (isArrayTexture(texture)) {
+        const auto &prog = getShaderPrograms().getTexturedArrayAColorShader();
+        return createTexturedMesh<ColoredTexturedArrayMesh>(shared, mode, batch, prog, texture);
+    }
+    const auto &prog = getShaderPrograms().getTexturedAColorShader();
+    return createTexturedMesh<ColoredTexturedMesh>(shared, mode, batch, prog, texture);
+}
+
+UniqueMesh Functions::createInstancedQuadBatch(const glm::vec3 &origin,
+                                               const std::vector<QuadInstance> &batch,
+                                               const SharedMMTexture &texture)
+{
+    assert(canRenderInstanced());
+    assert(isArrayTexture(texture));
+    const auto &prog = getShaderPrograms().getInstancedQuadShader();
+    return UniqueMesh{std::make_unique<TexturedRenderable>(
+        texture,
+        std::make_unique<InstancedQuadMesh>(shared_from_this(), prog, origin, batch))};
+}
+
 template<typename _VertexType, template<typename> typename _Mesh, typename _ShaderType>
 static void renderImmediate(const SharedFunctions &sharedFunctions,
                             const DrawModeEnum mode,
@@ -231,6 +279,7 @@ UniqueMesh Functions::createFontMesh(const SharedMMTexture &texture,
 Functions::Functions(this_is_private)
     : m_shaderPrograms{std::make_unique<ShaderPrograms>(*this)}
     , m_staticVbos{std::make_unique<StaticVbos>()}
+    , m_timerQueries{std::make_unique<TimerQueries>()}
 {}
 
 Functions::~Functions()
@@ -238,6 +287,13 @@ Functions::~Functions()
     cleanup();
 }
 
+void Functions::initializeOpenGLFunctions()
+{
+    Base::initializeOpenGLFunctions();
+    m_instancing = resolveInstancingFunctions();
+    m_timerQuery = resolveTimerQueryFunctions();
+}
+
 /// <ul>
 /// <li>Resets the Wrapped GL's cached copies of (compiled) shaders given out
 /// to new meshes. This <em>does NOT</em> expire the shaders belonging to old
@@ -252,6 +308,9 @@ Functions::~Functions()
 /// only keep static weak pointers to the VBOs, and the weak pointers will
 /// expire immediately when you call this function. If you call those
 /// functions again, they'll detect the expiration and request new buffers.</li>
+///
+/// <li>Deletes the GPU timer queries, dropping any results that haven't been
+/// collected yet.</li>
 /// </ul>
 void Functions::cleanup()
 {
@@ -261,6 +320,7 @@ void Functions::cleanup()
 
     getShaderPrograms().resetAll();
     getStaticVbos().resetAll();
+    getTimerQueries().resetAll(*this);
 }
 
 ShaderPrograms &Functions::getShaderPrograms()
@@ -271,6 +331,29 @@ StaticVbos &Functions::getStaticVbos()
 {
     return deref(m_staticVbos);
 }
+TimerQueries &Functions::getTimerQueries()
+{
+    return deref(m_timerQueries);
+}
+
+bool Functions::beginGpuTimer(const uint32_t tag)
+{
+    return canMeasureGpuTime() && getTimerQueries().begin(*this, tag);
+}
+
+void Functions::endGpuTimer()
+{
+    if (canMeasureGpuTime()) {
+        getTimerQueries().end(*this);
+    }
+}
+
+void Functions::collectGpuTimers(std::vector<GpuTimerResult> &results)
+{
+    if (canMeasureGpuTime()) {
+        getTimerQueries().collect(*this, results);
+    }
+}
 
 std::shared_ptr<Functions> Functions::alloc()
 {
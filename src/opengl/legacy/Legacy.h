@@ -2,6 +2,7 @@
 // SPDX-License-Identifier: GPL-2.0-or-later
 // Copyright (C) 2019 The MMapper Authors
 
+#include <cassert>
 #include <cmath>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -21,6 +22,7 @@ class OpenGL;
 namespace Legacy {
 
 class StaticVbos;
+class TimerQueries;
 struct ShaderPrograms;
 struct PointSizeBinder;
 
@@ -84,6 +86,7 @@ class NODISCARD Functions final : private QOpenGLFunctions,
     float m_devicePixelRatio = 1.f;
     std::unique_ptr<ShaderPrograms> m_shaderPrograms;
     std::unique_ptr<StaticVbos> m_staticVbos;
+    std::unique_ptr<TimerQueries> m_timerQueries;
 
 private:
     struct NODISCARD this_is_private final
@@ -112,8 +115,42 @@ class NODISCARD Functions final : private QOpenGLFunctions,
         m_devicePixelRatio = devicePixelRatio;
     }
 
+private:
+    // GL_ARB_instanced_arrays and GL_ARB_draw_instanced; null if they aren't supported.
+    struct NODISCARD InstancingFunctions final
+    {
+        void(QOPENGLF_APIENTRYP vertexAttribDivisor)(GLuint index, GLuint divisor) = nullptr;
+        void(QOPENGLF_APIENTRYP drawArraysInstanced)(GLenum mode,
+                                                     GLint first,
+                                                     GLsizei count,
+                                                     GLsizei primcount)
+            = nullptr;
+    };
+    InstancingFunctions m_instancing;
+
+    // Query objects (core since GL 1.5) and GL_ARB_timer_query or GL_EXT_timer_query;
+    // null if the context can't measure GPU time.
+    struct NODISCARD TimerQueryFunctions final
+    {
+        void(QOPENGLF_APIENTRYP genQueries)(GLsizei n, GLuint *ids) = nullptr;
+        void(QOPENGLF_APIENTRYP deleteQueries)(GLsizei n, const GLuint *ids) = nullptr;
+        void(QOPENGLF_APIENTRYP beginQuery)(GLenum target, GLuint id) = nullptr;
+        void(QOPENGLF_APIENTRYP endQuery)(GLenum target) = nullptr;
+        void(QOPENGLF_APIENTRYP getQueryObjectiv)(GLuint id, GLenum pname, GLint *params)
+            = nullptr;
+        void(QOPENGLF_APIENTRYP getQueryObjectui64v)(GLuint id, GLenum pname, GLuint64 *params)
+            = nullptr;
+    };
+    TimerQueryFunctions m_timerQuery;
+
 public:
-    using Base::initializeOpenGLFunctions;
+    void initializeOpenGLFunctions();
+
+private:
+    /// platform-specific (ES vs GL); requires a current context
+    NODISCARD static InstancingFunctions resolveInstancingFunctions();
+    /// platform-specific (ES vs GL); requires a current context
+    NODISCARD static TimerQueryFunctions resolveTimerQueryFunctions();
 
 public:
     using Base::glAttachShader;
@@ -157,6 +194,65 @@ class NODISCARD Functions final : private QOpenGLFunctions,
     using Base::glUseProgram;
     using Base::glVertexAttribPointer;
 
+public:
+    NODISCARD bool canRenderInstanced() const
+    {
+        return m_instancing.vertexAttribDivisor != nullptr
+               && m_instancing.drawArraysInstanced != nullptr;
+    }
+    void glVertexAttribDivisor(const GLuint index, const GLuint divisor)
+    {
+        assert(canRenderInstanced());
+        m_instancing.vertexAttribDivisor(index, divisor);
+    }
+    void glDrawArraysInstanced(const GLenum mode,
+                               const GLint first,
+                               const GLsizei count,
+                               const GLsizei instanceCount)
+    {
+        assert(canRenderInstanced());
+        m_instancing.drawArraysInstanced(mode, first, count, instanceCount);
+    }
+
+public:
+    NODISCARD bool canMeasureGpuTime() const
+    {
+        return m_timerQuery.genQueries != nullptr && m_timerQuery.deleteQueries != nullptr
+               && m_timerQuery.beginQuery != nullptr && m_timerQuery.endQuery != nullptr
+               && m_timerQuery.getQueryObjectiv != nullptr
+               && m_timerQuery.getQueryObjectui64v != nullptr;
+    }
+    void glGenQueries(const GLsizei n, GLuint *const ids)
+    {
+        assert(canMeasureGpuTime());
+        m_timerQuery.genQueries(n, ids);
+    }
+    void glDeleteQueries(const GLsizei n, const GLuint *const ids)
+    {
+        assert(canMeasureGpuTime());
+        m_timerQuery.deleteQueries(n, ids);
+    }
+    void glBeginQuery(const GLenum target, const GLuint id)
+    {
+        assert(canMeasureGpuTime());
+        m_timerQuery.beginQuery(target, id);
+    }
+    void glEndQuery(const GLenum target)
+    {
+        assert(canMeasureGpuTime());
+        m_timerQuery.endQuery(target);
+    }
+    void glGetQueryObjectiv(const GLuint id, const GLenum pname, GLint *const params)
+    {
+        assert(canMeasureGpuTime());
+        m_timerQuery.getQueryObjectiv(id, pname, params);
+    }
+    void glGetQueryObjectui64v(const GLuint id, const GLenum pname, GLuint64 *const params)
+    {
+        assert(canMeasureGpuTime());
+        m_timerQuery.getQueryObjectui64v(id, pname, params);
+    }
+
 public:
     // OpenGL man page says "Only width 1 is guaranteed to be supported."
     void glLineWidth(const GLfloat lineWidth) { Base::glLineWidth(scalef(lineWidth)); }
@@ -204,6 +300,8 @@ class NODISCARD Functions final : private QOpenGLFunctions,
 
     NODISCARD StaticVbos &getStaticVbos();
 
+    NODISCARD TimerQueries &getTimerQueries();
+
 private:
     friend PointSizeBinder;
     /// platform-specific (ES vs GL)
@@ -237,6 +335,9 @@ class NODISCARD Functions final : private QOpenGLFunctions,
     /// platform-specific (ES vs GL)
     NODISCARD static bool canRenderQuads();
 
+    /// platform-specific (ES vs GL); requires a current context
+    NODISCARD static bool canRenderTextureArrays();
+
     /// platform-specific (ES vs GL)
     NODISCARD static std::optional<GLenum> toGLenum(DrawModeEnum mode);
 
@@ -285,6 +386,18 @@ class NODISCARD Functions final : private QOpenGLFunctions,
     NODISCARD UniqueMesh createColoredTexturedBatch(DrawModeEnum mode,
                                                     const std::vector<ColoredTexVert> &batch,
                                                     const SharedMMTexture &texture);
+    // These use the array texture shaders if the texture is an array texture.
+    NODISCARD UniqueMesh createTexturedBatch(DrawModeEnum mode,
+                                             const std::vector<ArrayTexVert> &batch,
+                                             const SharedMMTexture &texture);
+    NODISCARD UniqueMesh createColoredTexturedBatch(DrawModeEnum mode,
+                                                    const std::vector<ColoredArrayTexVert> &batch,
+                                                    const SharedMMTexture &texture);
+
+    // Requires canRenderInstanced(); the texture must be an array texture.
+    NODISCARD UniqueMesh createInstancedQuadBatch(const glm::vec3 &origin,
+                                                  const std::vector<QuadInstance> &batch,
+                                                  const SharedMMTexture &texture);
 
 public:
     NODISCARD UniqueMesh createFontMesh(const SharedMMTexture &texture,
@@ -309,6 +422,12 @@ class NODISCARD Functions final : private QOpenGLFunctions,
                                const GLRenderState &state);
     void renderFont3d(const SharedMMTexture &texture, const std::vector<FontVert3d> &verts);
 
+public:
+    // These do nothing unless canMeasureGpuTime().
+    NODISCARD bool beginGpuTimer(uint32_t tag);
+    void endGpuTimer();
+    void collectGpuTimers(std::vector<GpuTimerResult> &results);
+
 public:
     void checkError();
 };
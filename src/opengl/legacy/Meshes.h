@@ -117,12 +117,21 @@ class NODISCARD ColoredMesh final : public SimpleMesh<_VertexType, AColorPlainSh
     }
 }; // namespace Legacy
 
-// Textured mesh with color modulated by uniform
+// 2 texture coordinates, or 3 if the third one selects the layer of an array texture.
 template<typename _VertexType>
-class NODISCARD TexturedMesh final : public SimpleMesh<_VertexType, UColorTexturedShader>
+NODISCARD static constexpr GLint getNumTexCoords()
+{
+    constexpr auto size = sizeof(std::declval<_VertexType>().tex) / sizeof(GLfloat);
+    static_assert(size == 2 || size == 3);
+    return static_cast<GLint>(size);
+}
+
+// Textured mesh with color modulated by uniform
+template<typename _VertexType, typename _ShaderType>
+class NODISCARD BasicTexturedMesh final : public SimpleMesh<_VertexType, _ShaderType>
 {
 public:
-    using Base = SimpleMesh<_VertexType, UColorTexturedShader>;
+    using Base = SimpleMesh<_VertexType, _ShaderType>;
     using Base::Base;
 
 private:
@@ -145,14 +154,14 @@ class NODISCARD TexturedMesh final : public SimpleMesh<_VertexType, UColorTextur
     void virt_bind() override
     {
         const auto vertSize = static_cast<GLsizei>(sizeof(_VertexType));
-        static_assert(sizeof(std::declval<_VertexType>().tex) == 2 * sizeof(GLfloat));
         static_assert(sizeof(std::declval<_VertexType>().vert) == 3 * sizeof(GLfloat));
 
         Functions &gl = Base::m_functions;
         const auto attribs = Attribs::getLocations(Base::m_program);
         gl.glBindBuffer(GL_ARRAY_BUFFER, Base::m_vbo.get());
-        /* NOTE: OpenGL 2.x can't use GL_TEXTURE_2D_ARRAY. */
-        gl.enableAttrib(attribs.texPos, 2, GL_FLOAT, GL_FALSE, vertSize, VPO(tex));
+        // NOTE: A 2D texture shader just ignores the layer, if there is one.
+        const GLint numTexCoords = getNumTexCoords<_VertexType>();
+        gl.enableAttrib(attribs.texPos, numTexCoords, GL_FLOAT, GL_FALSE, vertSize, VPO(tex));
         gl.enableAttrib(attribs.vertPos, 3, GL_FLOAT, GL_FALSE, vertSize, VPO(vert));
         boundAttribs = attribs;
     }
@@ -173,12 +182,17 @@ class NODISCARD TexturedMesh final : public SimpleMesh<_VertexType, UColorTextur
     }
 };
 
-// Textured mesh with color modulated by color attribute.
 template<typename _VertexType>
-class NODISCARD ColoredTexturedMesh final : public SimpleMesh<_VertexType, AColorTexturedShader>
+using TexturedMesh = BasicTexturedMesh<_VertexType, UColorTexturedShader>;
+template<typename _VertexType>
+using TexturedArrayMesh = BasicTexturedMesh<_VertexType, UColorTexturedArrayShader>;
+
+// Textured mesh with color modulated by color attribute.
+template<typename _VertexType, typename _ShaderType>
+class NODISCARD BasicColoredTexturedMesh final : public SimpleMesh<_VertexType, _ShaderType>
 {
 public:
-    using Base = SimpleMesh<_VertexType, AColorTexturedShader>;
+    using Base = SimpleMesh<_VertexType, _ShaderType>;
     using Base::Base;
 
 private:
@@ -188,7 +202,7 @@ class NODISCARD ColoredTexturedMesh final : public SimpleMesh<_VertexType, AColo
         GLuint texPos = INVALID_ATTRIB_LOCATION;
         GLuint vertPos = INVALID_ATTRIB_LOCATION;
 
-        NODISCARD static Attribs getLocations(AColorTexturedShader &fontShader)
+        NODISCARD static Attribs getLocations(AbstractShaderProgram &fontShader)
         {
             Attribs result;
             result.colorPos = fontShader.getAttribLocation("aColor");
@@ -204,15 +218,15 @@ class NODISCARD ColoredTexturedMesh final : public SimpleMesh<_VertexType, AColo
     {
         const auto vertSize = static_cast<GLsizei>(sizeof(_VertexType));
         static_assert(sizeof(std::declval<_VertexType>().color) == 4 * sizeof(uint8_t));
-        static_assert(sizeof(std::declval<_VertexType>().tex) == 2 * sizeof(GLfloat));
         static_assert(sizeof(std::declval<_VertexType>().vert) == 3 * sizeof(GLfloat));
 
         Functions &gl = Base::m_functions;
         const auto attribs = Attribs::getLocations(Base::m_program);
         gl.glBindBuffer(GL_ARRAY_BUFFER, Base::m_vbo.get());
         gl.enableAttrib(attribs.colorPos, 4, GL_UNSIGNED_BYTE, GL_TRUE, vertSize, VPO(color));
-        /* NOTE: OpenGL 2.x can't use GL_TEXTURE_2D_ARRAY. */
-        gl.enableAttrib(attribs.texPos, 2, GL_FLOAT, GL_FALSE, vertSize, VPO(tex));
+        // NOTE: A 2D texture shader just ignores the layer, if there is one.
+        const GLint numTexCoords = getNumTexCoords<_VertexType>();
+        gl.enableAttrib(attribs.texPos, numTexCoords, GL_FLOAT, GL_FALSE, vertSize, VPO(tex));
         gl.enableAttrib(attribs.vertPos, 3, GL_FLOAT, GL_FALSE, vertSize, VPO(vert));
         boundAttribs = attribs;
     }
@@ -234,6 +248,11 @@ class NODISCARD ColoredTexturedMesh final : public SimpleMesh<_VertexType, AColo
     }
 };
 
+template<typename _VertexType>
+using ColoredTexturedMesh = BasicColoredTexturedMesh<_VertexType, AColorTexturedShader>;
+template<typename _VertexType>
+using ColoredTexturedArrayMesh = BasicColoredTexturedMesh<_VertexType, AColorTexturedArrayShader>;
+
 // Per-vertex color
 // flat-shaded in MMapper, due to glShadeModel(GL_FLAT)
 template<typename _VertexType>
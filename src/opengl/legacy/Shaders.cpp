@@ -29,6 +29,9 @@ AColorPlainShader::~AColorPlainShader() = default;
 UColorPlainShader::~UColorPlainShader() = default;
 AColorTexturedShader::~AColorTexturedShader() = default;
 UColorTexturedShader::~UColorTexturedShader() = default;
+AColorTexturedArrayShader::~AColorTexturedArrayShader() = default;
+UColorTexturedArrayShader::~UColorTexturedArrayShader() = default;
+InstancedQuadShader::~InstancedQuadShader() = default;
 FontShader::~FontShader() = default;
 PointShader::~PointShader() = default;
 
@@ -81,6 +84,27 @@ const std::shared_ptr<UColorTexturedShader> &ShaderPrograms::getTexturedUColorSh
     return getInitialized<UColorTexturedShader>(uTexturedShader, getFunctions(), "tex/ucolor");
 }
 
+const std::shared_ptr<AColorTexturedArrayShader> &ShaderPrograms::getTexturedArrayAColorShader()
+{
+    return getInitialized<AColorTexturedArrayShader>(aTexturedArrayShader,
+                                                     getFunctions(),
+                                                     "tex_array/acolor");
+}
+
+const std::shared_ptr<UColorTexturedArrayShader> &ShaderPrograms::getTexturedArrayUColorShader()
+{
+    return getInitialized<UColorTexturedArrayShader>(uTexturedArrayShader,
+                                                     getFunctions(),
+                                                     "tex_array/ucolor");
+}
+
+const std::shared_ptr<InstancedQuadShader> &ShaderPrograms::getInstancedQuadShader()
+{
+    return getInitialized<InstancedQuadShader>(instancedQuadShader,
+                                               getFunctions(),
+                                               "tex_array/instanced");
+}
+
 const std::shared_ptr<FontShader> &ShaderPrograms::getFontShader()
 {
     return getInitialized<FontShader>(font, getFunctions(), "font");
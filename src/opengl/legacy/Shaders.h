@@ -72,6 +72,63 @@ struct NODISCARD UColorTexturedShader final : public AbstractShaderProgram
     }
 };
 
+// Same as AColorTexturedShader, but samples a layer of an array texture.
+struct NODISCARD AColorTexturedArrayShader final : public AbstractShaderProgram
+{
+public:
+    using AbstractShaderProgram::AbstractShaderProgram;
+
+    ~AColorTexturedArrayShader() final;
+
+private:
+    void virt_setUniforms(const glm::mat4 &mvp, const GLRenderState::Uniforms &uniforms) final
+    {
+        assert(uniforms.textures[0]);
+
+        setColor("uColor", uniforms.color);
+        setMatrix("uMVP", mvp);
+        setTexture("uTexture", 0);
+    }
+};
+
+// Same as UColorTexturedShader, but samples a layer of an array texture.
+struct NODISCARD UColorTexturedArrayShader final : public AbstractShaderProgram
+{
+public:
+    using AbstractShaderProgram::AbstractShaderProgram;
+
+    ~UColorTexturedArrayShader() final;
+
+private:
+    void virt_setUniforms(const glm::mat4 &mvp, const GLRenderState::Uniforms &uniforms) final
+    {
+        assert(uniforms.textures[0]);
+
+        setColor("uColor", uniforms.color);
+        setMatrix("uMVP", mvp);
+        setTexture("uTexture", 0);
+    }
+};
+
+// Instances of a unit quad, each with its own offset, array texture layer and color.
+struct NODISCARD InstancedQuadShader final : public AbstractShaderProgram
+{
+public:
+    using AbstractShaderProgram::AbstractShaderProgram;
+
+    ~InstancedQuadShader() final;
+
+private:
+    void virt_setUniforms(const glm::mat4 &mvp, const GLRenderState::Uniforms &uniforms) final
+    {
+        assert(uniforms.textures[0]);
+
+        setColor("uColor", uniforms.color);
+        setMatrix("uMVP", mvp);
+        setTexture("uTexture", 0);
+    }
+};
+
 struct NODISCARD FontShader final : public AbstractShaderProgram
 {
 private:
@@ -118,6 +175,9 @@ struct NODISCARD ShaderPrograms final
     std::shared_ptr<UColorPlainShader> uColorShader;
     std::shared_ptr<AColorTexturedShader> aTexturedShader;
     std::shared_ptr<UColorTexturedShader> uTexturedShader;
+    std::shared_ptr<AColorTexturedArrayShader> aTexturedArrayShader;
+    std::shared_ptr<UColorTexturedArrayShader> uTexturedArrayShader;
+    std::shared_ptr<InstancedQuadShader> instancedQuadShader;
     std::shared_ptr<FontShader> font;
     std::shared_ptr<PointShader> point;
 
@@ -138,6 +198,9 @@ struct NODISCARD ShaderPrograms final
         uColorShader.reset();
         aTexturedShader.reset();
         uTexturedShader.reset();
+        aTexturedArrayShader.reset();
+        uTexturedArrayShader.reset();
+        instancedQuadShader.reset();
         font.reset();
         point.reset();
     }
@@ -151,6 +214,11 @@ struct NODISCARD ShaderPrograms final
     NODISCARD const std::shared_ptr<AColorTexturedShader> &getTexturedAColorShader();
     // uniform color + textured (aka "Textured")
     NODISCARD const std::shared_ptr<UColorTexturedShader> &getTexturedUColorShader();
+    // same as above, but for array textures (requires GL_EXT_texture_array)
+    NODISCARD const std::shared_ptr<AColorTexturedArrayShader> &getTexturedArrayAColorShader();
+    NODISCARD const std::shared_ptr<UColorTexturedArrayShader> &getTexturedArrayUColorShader();
+    // attribute color + array textured, instanced (requires GL_ARB_instanced_arrays)
+    NODISCARD const std::shared_ptr<InstancedQuadShader> &getInstancedQuadShader();
     NODISCARD const std::shared_ptr<FontShader> &getFontShader();
     NODISCARD const std::shared_ptr<PointShader> &getPointShader();
 };
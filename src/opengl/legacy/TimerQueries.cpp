@@ -0,0 +1,85 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2023 The MMapper Authors
+
+#include "TimerQueries.h"
+
+namespace Legacy {
+
+bool TimerQueries::begin(Functions &gl, const uint32_t tag)
+{
+    if (m_active.has_value()) {
+        assert(false);
+        return false;
+    }
+
+    if (m_free.empty()) {
+        if (m_allocated == MAX_QUERIES) {
+            return false;
+        }
+        GLuint query = 0;
+        gl.glGenQueries(1, &query);
+        if (query == 0) {
+            return false;
+        }
+        m_free.emplace_back(query);
+        ++m_allocated;
+    }
+
+    const GLuint query = m_free.back();
+    m_free.pop_back();
+    gl.glBeginQuery(GL_TIME_ELAPSED, query);
+    m_active = Pending{query, tag};
+    return true;
+}
+
+void TimerQueries::end(Functions &gl)
+{
+    if (!m_active.has_value()) {
+        assert(false);
+        return;
+    }
+
+    gl.glEndQuery(GL_TIME_ELAPSED);
+    m_pending.emplace_back(m_active.value());
+    m_active.reset();
+}
+
+void TimerQueries::collect(Functions &gl, std::vector<GpuTimerResult> &results)
+{
+    while (!m_pending.empty()) {
+        const Pending &front = m_pending.front();
+        GLint available = GL_FALSE;
+        gl.glGetQueryObjectiv(front.query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available == GL_FALSE) {
+            break;
+        }
+
+        GLuint64 nanoseconds = 0;
+        gl.glGetQueryObjectui64v(front.query, GL_QUERY_RESULT, &nanoseconds);
+        results.emplace_back(GpuTimerResult{front.tag, static_cast<uint64_t>(nanoseconds)});
+        m_free.emplace_back(front.query);
+        m_pending.pop_front();
+    }
+}
+
+void TimerQueries::resetAll(Functions &gl)
+{
+    if (m_active.has_value()) {
+        gl.glEndQuery(GL_TIME_ELAPSED);
+        m_free.emplace_back(m_active->query);
+        m_active.reset();
+    }
+    for (const Pending &pending : m_pending) {
+        m_free.emplace_back(pending.query);
+    }
+    m_pending.clear();
+
+    assert(m_free.size() == m_allocated);
+    if (!m_free.empty()) {
+        gl.glDeleteQueries(static_cast<GLsizei>(m_free.size()), m_free.data());
+        m_free.clear();
+    }
+    m_allocated = 0;
+}
+
+} // namespace Legacy
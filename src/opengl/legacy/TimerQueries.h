@@ -0,0 +1,56 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2023 The MMapper Authors
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <vector>
+
+#include "../../global/RuleOf5.h"
+#include "Legacy.h"
+
+namespace Legacy {
+
+/// A bounded pool of GL_TIME_ELAPSED queries.
+///
+/// Results are only read once the GPU reports them as available, so timing a
+/// pass never waits for the GPU. Queries finish in the order they were issued,
+/// so collect() stops at the first one that isn't ready yet.
+///
+/// If every query is still in flight, begin() returns false and that pass
+/// simply isn't timed.
+class NODISCARD TimerQueries final
+{
+public:
+    static constexpr const size_t MAX_QUERIES = 256;
+
+private:
+    struct NODISCARD Pending final
+    {
+        GLuint query = 0;
+        uint32_t tag = 0;
+    };
+
+    std::vector<GLuint> m_free;
+    std::deque<Pending> m_pending;
+    std::optional<Pending> m_active;
+    size_t m_allocated = 0;
+
+public:
+    TimerQueries() = default;
+    ~TimerQueries() { assert(m_allocated == 0); }
+    DELETE_CTORS_AND_ASSIGN_OPS(TimerQueries);
+
+public:
+    // GL_TIME_ELAPSED queries can't nest, so begin() fails while another is active.
+    NODISCARD bool begin(Functions &gl, uint32_t tag);
+    void end(Functions &gl);
+    // Appends the results that are ready, oldest first.
+    void collect(Functions &gl, std::vector<GpuTimerResult> &results);
+    void resetAll(Functions &gl);
+};
+
+} // namespace Legacy
@@ -1,5 +1,8 @@
 #include "Legacy.h"
 
+#include <QOpenGLContext>
+#include <QOpenGLTexture>
+
 namespace Legacy {
 
 bool Functions::canRenderQuads()
@@ -30,6 +33,62 @@ const char *Functions::getShaderVersion()
     return "#version 110\n\n";
 }
 
+bool Functions::canRenderTextureArrays()
+{
+    // GLSL 1.10 can only sample array textures through the extension.
+    const QOpenGLContext *const context = QOpenGLContext::currentContext();
+    return context != nullptr && context->hasExtension("GL_EXT_texture_array")
+           && QOpenGLTexture::hasFeature(QOpenGLTexture::TextureArrays);
+}
+
+Functions::InstancingFunctions Functions::resolveInstancingFunctions()
+{
+    // Instancing is core in GL 3.3, but GL 2.0 can only do it through the extensions.
+    InstancingFunctions result;
+    QOpenGLContext *const context = QOpenGLContext::currentContext();
+    if (context == nullptr || !context->hasExtension("GL_ARB_instanced_arrays")
+        || !context->hasExtension("GL_ARB_draw_instanced")) {
+        return result;
+    }
+
+    result.vertexAttribDivisor = reinterpret_cast<decltype(result.vertexAttribDivisor)>(
+        context->getProcAddress("glVertexAttribDivisorARB"));
+    result.drawArraysInstanced = reinterpret_cast<decltype(result.drawArraysInstanced)>(
+        context->getProcAddress("glDrawArraysInstancedARB"));
+    return result;
+}
+
+Functions::TimerQueryFunctions Functions::resolveTimerQueryFunctions()
+{
+    // GL_TIME_ELAPSED is core in GL 3.3; before that it needs one of the extensions.
+    TimerQueryFunctions result;
+    QOpenGLContext *const context = QOpenGLContext::currentContext();
+    if (context == nullptr) {
+        return result;
+    }
+
+    const char *ui64v = nullptr;
+    if (context->hasExtension("GL_ARB_timer_query")) {
+        ui64v = "glGetQueryObjectui64v";
+    } else if (context->hasExtension("GL_EXT_timer_query")) {
+        ui64v = "glGetQueryObjectui64vEXT";
+    } else {
+        return result;
+    }
+
+    const auto resolve = [context](auto &fn, const char *const name) {
+        fn = reinterpret_cast<std::remove_reference_t<decltype(fn)>>(
+            context->getProcAddress(name));
+    };
+    resolve(result.genQueries, "glGenQueries");
+    resolve(result.deleteQueries, "glDeleteQueries");
+    resolve(result.beginQuery, "glBeginQuery");
+    resolve(result.endQuery, "glEndQuery");
+    resolve(result.getQueryObjectiv, "glGetQueryObjectiv");
+    resolve(result.getQueryObjectui64v, ui64v);
+    return result;
+}
+
 void Functions::enableProgramPointSize(const bool enable)
 {
     if (enable)
@@ -4,8 +4,8 @@
 
 #include "abstractparser.h"
 
-#include <cassert>
-#include <memory>
+#include <string>
+#include <string_view>
 
 #include "../clock/mumeclock.h"
 #include "../pandoragroup/mmapper2group.h"
@@ -13,29 +13,23 @@
 
 void AbstractParser::initActionMap()
 {
-    auto &map = m_actionMap;
-    map.clear();
+    auto &matcher = m_actionMatcher;
+    matcher.clear();
 
-    auto addStartsWith = [&map](const std::string &match, const ActionCallback &callback) {
-        assert(!match.empty());
-        const char hint = match[0];
-        map.emplace(hint, std::make_unique<StartsWithAction>(match, callback));
+    auto addStartsWith = [&matcher](const std::string &match, const ActionCallback &callback) {
+        matcher.addStartsWith(match, callback);
     };
 
-    auto addEndsWith = [&map](const std::string &match, const ActionCallback &callback) {
-        assert(!match.empty());
-        const char hint = 0;
-        map.emplace(hint, std::make_unique<EndsWithAction>(match, callback));
+    auto addEndsWith = [&matcher](const std::string &match, const ActionCallback &callback) {
+        matcher.addEndsWith(match, callback);
     };
 
-    auto addRegex = [&map](const std::string &match, const ActionCallback &callback) {
-        assert(!match.empty());
-        const char hint = [&match]() -> char {
-            if (match.length() > 2 && match[0] == '^' && match[1] != '\\' && match[1] != '(')
-                return match[1];
-            return 0;
-        }();
-        map.emplace(hint, std::make_unique<RegexAction>(match, callback));
+    // Regexes that don't start with a literal should name a substring that
+    // every matching line contains; otherwise they are tried on every line.
+    auto addRegex = [&matcher](const std::string &match,
+                               const ActionCallback &callback,
+                               const std::string_view required = {}) {
+        matcher.addRegex(match, callback, required);
     };
 
     /// Positions
@@ -288,12 +282,14 @@ void AbstractParser::initActionMap()
                  const auto list = m_timers.getStatCommandEntry();
                  if (!list.empty())
                      sendToUser(list);
-             });
+             },
+             " Alert: ");
 
     /// Score
     addRegex(
         R"(^(You (have|report) )?\d+/\d+ hits?(, \d+/\d+ mana,)? and \d+/\d+ move(ment point)?s.$)",
-        [this](StringView view) { sendScoreLineEvent(view.toQByteArray()); });
+        [this](StringView view) { sendScoreLineEvent(view.toQByteArray()); },
+        " move");
 
     /// Search, reveal, and flush
     addStartsWith("You begin to search...", [this](StringView /*view*/) {
@@ -367,22 +363,6 @@ void AbstractParser::initActionMap()
 
 bool AbstractParser::evalActionMap(StringView line)
 {
-    if (line.empty())
-        return false;
-
-    auto &map = m_actionMap;
-
-    auto range = map.equal_range(line.firstChar());
-    for (auto it = range.first; it != range.second; ++it) {
-        const std::unique_ptr<IAction> &action = it->second;
-        action->match(line);
-    }
-
-    range = map.equal_range(0);
-    for (auto it = range.first; it != range.second; ++it) {
-        const std::unique_ptr<IAction> &action = it->second;
-        action->match(line);
-    }
-
+    m_actionMatcher.match(line);
     return false;
 }
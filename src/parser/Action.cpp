@@ -4,39 +4,183 @@
 
 #include "Action.h"
 
+#include <algorithm>
+#include <cassert>
 #include <regex>
 
-IAction::~IAction() = default;
+void ActionTrie::insert(const std::string_view str, const uint32_t action)
+{
+    uint32_t node = 0;
+    for (const char c : str) {
+        uint32_t child = findNext(node, c);
+        if (child == 0) {
+            child = static_cast<uint32_t>(m_nodes.size());
+            auto &next = m_nodes[node].next;
+            const auto it = std::lower_bound(next.begin(),
+                                             next.end(),
+                                             std::make_pair(c, uint32_t{0}));
+            next.emplace(it, c, child);
+            m_nodes.emplace_back();
+        }
+        node = child;
+    }
+    m_nodes[node].actions.emplace_back(action);
+}
+
+uint32_t ActionTrie::findNext(const uint32_t node, const char c) const
+{
+    const auto &next = m_nodes[node].next;
+    const auto it = std::lower_bound(next.begin(),
+                                     next.end(),
+                                     c,
+                                     [](const std::pair<char, uint32_t> &edge, const char value) {
+                                         return edge.first < value;
+                                     });
+    // the root is never a child, so 0 means "none"
+    return (it != next.end() && it->first == c) ? it->second : 0;
+}
 
-void IAction::match(const StringView &input) const
+NODISCARD static bool hasTopLevelAlternation(const std::string_view pattern)
 {
-    return virt_match(input);
+    int depth = 0;
+    bool inClass = false;
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        switch (pattern[i]) {
+        case '\\':
+            ++i;
+            break;
+        case '[':
+            inClass = true;
+            break;
+        case ']':
+            inClass = false;
+            break;
+        case '(':
+            depth += inClass ? 0 : 1;
+            break;
+        case ')':
+            depth -= inClass ? 0 : 1;
+            break;
+        case '|':
+            if (!inClass && depth == 0) {
+                return true;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    return false;
 }
 
-void StartsWithAction::virt_match(const StringView &input) const
+std::string ActionMatcher::getLiteralPrefix(const std::string_view pattern)
 {
-    if (input.startsWith(match))
-        callback(input);
+    if (pattern.size() < 2 || pattern[0] != '^' || hasTopLevelAlternation(pattern)) {
+        return {};
+    }
+
+    std::string prefix;
+    for (const char c : pattern.substr(1)) {
+        switch (c) {
+        case '?':
+        case '*':
+        case '{':
+            // the previous character is optional
+            if (!prefix.empty()) {
+                prefix.pop_back();
+            }
+            return prefix;
+        case '\\':
+        case '.':
+        case '^':
+        case '$':
+        case '|':
+        case '(':
+        case ')':
+        case '[':
+        case ']':
+        case '+':
+            return prefix;
+        default:
+            prefix += c;
+            break;
+        }
+    }
+    return prefix;
 }
 
-void EndsWithAction::virt_match(const StringView &input) const
+void ActionMatcher::clear()
 {
-    if (input.endsWith(match))
-        callback(input);
+    m_actions.clear();
+    m_prefixes.clear();
+    m_suffixes.clear();
+    m_substrings.clear();
+    m_unfiltered.clear();
 }
 
-NODISCARD static std::regex createRegex(const std::string &pattern)
+void ActionMatcher::addStartsWith(const std::string &match, const ActionCallback &callback)
 {
-    return std::regex(pattern, std::regex::nosubs | std::regex::optimize);
+    assert(!match.empty());
+    const auto index = static_cast<uint32_t>(m_actions.size());
+    m_actions.emplace_back(Action{std::nullopt, callback});
+    m_prefixes.insert(match, index);
 }
 
-RegexAction::RegexAction(const std::string &pattern, const ActionCallback &callback)
-    : regex{createRegex(pattern)}
-    , callback{callback}
-{}
+void ActionMatcher::addEndsWith(const std::string &match, const ActionCallback &callback)
+{
+    assert(!match.empty());
+    const auto index = static_cast<uint32_t>(m_actions.size());
+    m_actions.emplace_back(Action{std::nullopt, callback});
+    const std::string reversed{match.rbegin(), match.rend()};
+    m_suffixes.insert(reversed, index);
+}
 
-void RegexAction::virt_match(const StringView &input) const
+void ActionMatcher::addRegex(const std::string &pattern,
+                             const ActionCallback &callback,
+                             const std::string_view required)
 {
-    if (std::regex_match(input.begin(), input.end(), regex))
-        callback(input);
+    assert(!pattern.empty());
+    const auto index = static_cast<uint32_t>(m_actions.size());
+    m_actions.emplace_back(
+        Action{std::regex(pattern, std::regex::nosubs | std::regex::optimize), callback});
+
+    if (const std::string prefix = getLiteralPrefix(pattern); !prefix.empty()) {
+        m_prefixes.insert(prefix, index);
+    } else if (!required.empty()) {
+        m_substrings.emplace_back(std::string{required}, index);
+    } else {
+        m_unfiltered.emplace_back(index);
+    }
+}
+
+void ActionMatcher::match(const StringView &line) const
+{
+    if (line.empty()) {
+        return;
+    }
+
+    const std::string_view sv = line.getStdStringView();
+    std::vector<uint32_t> matched;
+    const auto tryAction = [this, &sv, &matched](const uint32_t index) {
+        const Action &action = m_actions[index];
+        if (!action.regex.has_value() || std::regex_match(sv.begin(), sv.end(), *action.regex)) {
+            matched.emplace_back(index);
+        }
+    };
+
+    m_prefixes.find(sv.begin(), sv.end(), tryAction);
+    m_suffixes.find(sv.rbegin(), sv.rend(), tryAction);
+    for (const auto &[substring, index] : m_substrings) {
+        if (sv.find(substring) != std::string_view::npos) {
+            tryAction(index);
+        }
+    }
+    for (const uint32_t index : m_unfiltered) {
+        tryAction(index);
+    }
+
+    std::sort(matched.begin(), matched.end());
+    for (const uint32_t index : matched) {
+        m_actions[index].callback(line);
+    }
 }
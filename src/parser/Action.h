@@ -3,76 +3,98 @@
 // Copyright (C) 2019 The MMapper Authors
 // Author: Nils Schimmelmann <nschimme@gmail.com> (Jahara)
 
+#include <cstdint>
 #include <functional>
-#include <memory>
+#include <optional>
 #include <regex>
 #include <string>
-#include <unordered_map>
+#include <string_view>
 #include <utility>
+#include <vector>
 
 #include "../global/RuleOf5.h"
 #include "../global/StringView.h"
 
 using ActionCallback = std::function<void(StringView)>;
 
-struct NODISCARD IAction
+/// Characters of several strings, merged by common prefix.
+class NODISCARD ActionTrie final
 {
-public:
-    virtual ~IAction();
-    IAction() = default;
-    DEFAULT_CTORS_AND_ASSIGN_OPS(IAction);
-
 private:
-    virtual void virt_match(const StringView &input) const = 0;
+    struct NODISCARD Node final
+    {
+        // sorted by character
+        std::vector<std::pair<char, uint32_t>> next;
+        // actions whose string ends at this node
+        std::vector<uint32_t> actions;
+    };
+    std::vector<Node> m_nodes{Node{}};
 
 public:
-    void match(const StringView &input) const;
-};
+    void clear() { m_nodes = {Node{}}; }
+    void insert(std::string_view str, uint32_t action);
+
+    /// Calls found(action) for every inserted string that is a prefix of
+    /// [begin, end); use reverse iterators to look for suffixes.
+    template<typename It, typename Callback>
+    void find(It begin, const It end, Callback &&found) const
+    {
+        uint32_t node = 0;
+        for (; begin != end; ++begin) {
+            node = findNext(node, *begin);
+            if (node == 0) {
+                return;
+            }
+            for (const uint32_t action : m_nodes[node].actions) {
+                found(action);
+            }
+        }
+    }
 
-class NODISCARD StartsWithAction : public IAction
-{
 private:
-    const std::string match;
-    const ActionCallback callback;
-
-public:
-    explicit StartsWithAction(std::string moved_str, const ActionCallback &callback)
-        : match{std::move(moved_str)}
-        , callback{callback}
-    {}
-
-private:
-    void virt_match(const StringView &input) const override;
+    NODISCARD uint32_t findNext(uint32_t node, char c) const;
 };
 
-class NODISCARD EndsWithAction : public IAction
+/// Every action of the parser, indexed so that a line is classified in one pass:
+///  - starts-with actions and regexes with a literal prefix share a trie
+///    that is walked from the start of the line,
+///  - ends-with actions share a trie that is walked from the end of the line,
+///  - other regexes are only tried if the line contains a required substring
+///    (or always, if they don't have one).
+class NODISCARD ActionMatcher final
 {
 private:
-    const std::string match;
-    const ActionCallback callback;
+    struct NODISCARD Action final
+    {
+        std::optional<std::regex> regex;
+        ActionCallback callback;
+    };
+
+    std::vector<Action> m_actions;
+    ActionTrie m_prefixes;
+    ActionTrie m_suffixes;
+    std::vector<std::pair<std::string, uint32_t>> m_substrings;
+    std::vector<uint32_t> m_unfiltered;
 
 public:
-    explicit EndsWithAction(std::string moved_str, const ActionCallback &callback)
-        : match{std::move(moved_str)}
-        , callback{callback}
-    {}
+    ActionMatcher() = default;
+    DELETE_CTORS_AND_ASSIGN_OPS(ActionMatcher);
 
-private:
-    void virt_match(const StringView &input) const override;
-};
-
-class NODISCARD RegexAction : public IAction
-{
-private:
-    const std::regex regex;
-    const ActionCallback callback;
+public:
+    void clear();
+    void addStartsWith(const std::string &match, const ActionCallback &callback);
+    void addEndsWith(const std::string &match, const ActionCallback &callback);
+    /// The regex has to match the whole line. If it doesn't start with a literal,
+    /// pass a substring that every matching line contains so it can be skipped.
+    void addRegex(const std::string &pattern,
+                  const ActionCallback &callback,
+                  std::string_view required = {});
 
 public:
-    explicit RegexAction(const std::string &pattern, const ActionCallback &callback);
+    /// Calls every matching action, in the order they were added.
+    void match(const StringView &line) const;
 
-private:
-    void virt_match(const StringView &input) const override;
+public:
+    /// Literal text at the start of an anchored ("^...") regex.
+    NODISCARD static std::string getLiteralPrefix(std::string_view pattern);
 };
-
-using ActionHint = char;
-using ActionRecordMap = std::unordered_multimap<ActionHint, std::unique_ptr<IAction>>;
@@ -0,0 +1,225 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2023 The MMapper Authors
+
+#include "PatternSet.h"
+
+#include <algorithm>
+#include <deque>
+
+static constexpr const uint32_t ROOT = 0;
+static constexpr const uint32_t NO_NODE = ~0u;
+
+NODISCARD static bool hasBackReference(const QString &regex)
+{
+    // Joining regexes renumbers their groups, which breaks numbered references.
+    static const QRegularExpression backref(R"(\\[1-9gk]|\(\?P=)");
+    return backref.match(regex).hasMatch();
+}
+
+PatternSet::PatternSet(const QStringList &patterns)
+{
+    m_nodes.emplace_back();
+
+    QStringList regexes;
+    for (const QString &pattern : patterns) {
+        if (pattern.length() < 2 || pattern.at(0) != '#') {
+            continue;
+        }
+        const QStringView text = QStringView{pattern}.mid(2);
+        switch (pattern.at(1).toLatin1()) {
+        case '!':
+            regexes.append(text.toString());
+            break;
+        case '<':
+            addLiteral(text, LiteralKindEnum::PREFIX);
+            break;
+        case '=':
+            addLiteral(text, LiteralKindEnum::EXACT);
+            break;
+        case '>':
+            addLiteral(text, LiteralKindEnum::SUFFIX);
+            break;
+        case '?':
+            addLiteral(text, LiteralKindEnum::CONTAINS);
+            break;
+        default:
+            break;
+        }
+    }
+
+    buildFailLinks();
+    addRegexes(regexes);
+}
+
+void PatternSet::addLiteral(const QStringView text, const LiteralKindEnum kind)
+{
+    if (text.isEmpty()) {
+        // an empty prefix, suffix or substring matches every line
+        if (kind == LiteralKindEnum::EXACT) {
+            m_matchesEmpty = true;
+        } else {
+            m_matchesAnything = true;
+        }
+        return;
+    }
+
+    uint32_t node = ROOT;
+    for (const QChar qc : text) {
+        const char16_t c = qc.unicode();
+        auto &next = m_nodes[node].next;
+        const auto it = std::find_if(next.begin(), next.end(), [c](const auto &edge) {
+            return edge.first == c;
+        });
+        if (it != next.end()) {
+            node = it->second;
+            continue;
+        }
+        const auto child = static_cast<uint32_t>(m_nodes.size());
+        next.emplace_back(c, child);
+        m_nodes.emplace_back();
+        node = child;
+    }
+
+    m_nodes[node].outputs.emplace_back(static_cast<uint32_t>(m_literals.size()));
+    m_literals.emplace_back(Literal{static_cast<int>(text.size()), kind});
+}
+
+void PatternSet::buildFailLinks()
+{
+    for (Node &node : m_nodes) {
+        std::sort(node.next.begin(), node.next.end());
+    }
+
+    // Breadth-first, so a node's fail target is always finished before the node.
+    std::deque<uint32_t> queue;
+    for (const auto &edge : m_nodes[ROOT].next) {
+        queue.push_back(edge.second);
+    }
+    while (!queue.empty()) {
+        const uint32_t parent = queue.front();
+        queue.pop_front();
+        for (const auto &[c, child] : m_nodes[parent].next) {
+            uint32_t fail = m_nodes[parent].fail;
+            uint32_t target = findNext(fail, c);
+            while (target == NO_NODE && fail != ROOT) {
+                fail = m_nodes[fail].fail;
+                target = findNext(fail, c);
+            }
+            m_nodes[child].fail = (target == NO_NODE) ? ROOT : target;
+
+            const auto &inherited = m_nodes[m_nodes[child].fail].outputs;
+            auto &outputs = m_nodes[child].outputs;
+            outputs.insert(outputs.end(), inherited.begin(), inherited.end());
+            queue.push_back(child);
+        }
+    }
+}
+
+void PatternSet::addRegexes(const QStringList &regexes)
+{
+    // invalid regexes never match, just like in Patterns::matchPattern()
+    QStringList valid;
+    for (const QString &regex : regexes) {
+        if (QRegularExpression{regex}.isValid()) {
+            valid.append(regex);
+        }
+    }
+
+    if (valid.size() > 1 && std::none_of(valid.begin(), valid.end(), hasBackReference)) {
+        QString joined;
+        for (const QString &regex : valid) {
+            if (!joined.isEmpty()) {
+                joined += QChar('|');
+            }
+            joined += QString("(?:%1)").arg(regex);
+        }
+        QRegularExpression combined{joined};
+        if (combined.isValid()) {
+            combined.optimize();
+            m_regexes.emplace_back(std::move(combined));
+            return;
+        }
+        // e.g. an unterminated \Q or a (?x) comment swallowed the closing paren
+    }
+
+    for (const QString &regex : valid) {
+        QRegularExpression compiled{regex};
+        compiled.optimize();
+        m_regexes.emplace_back(std::move(compiled));
+    }
+}
+
+uint32_t PatternSet::findNext(const uint32_t node, const char16_t c) const
+{
+    const auto &next = m_nodes[node].next;
+    const auto it = std::lower_bound(next.begin(),
+                                     next.end(),
+                                     c,
+                                     [](const std::pair<char16_t, uint32_t> &edge,
+                                        const char16_t value) { return edge.first < value; });
+    return (it != next.end() && it->first == c) ? it->second : NO_NODE;
+}
+
+bool PatternSet::matchesLiteral(const QString &str) const
+{
+    if (m_literals.empty()) {
+        return false;
+    }
+
+    const int length = str.length();
+    uint32_t node = ROOT;
+    for (int pos = 0; pos < length; ++pos) {
+        const char16_t c = str.at(pos).unicode();
+        uint32_t next = findNext(node, c);
+        while (next == NO_NODE && node != ROOT) {
+            node = m_nodes[node].fail;
+            next = findNext(node, c);
+        }
+        node = (next == NO_NODE) ? ROOT : next;
+
+        const int end = pos + 1;
+        for (const uint32_t index : m_nodes[node].outputs) {
+            const Literal &literal = m_literals[index];
+            const bool atStart = (end == literal.length);
+            const bool atEnd = (end == length);
+            switch (literal.kind) {
+            case LiteralKindEnum::PREFIX:
+                if (atStart) {
+                    return true;
+                }
+                break;
+            case LiteralKindEnum::EXACT:
+                if (atStart && atEnd) {
+                    return true;
+                }
+                break;
+            case LiteralKindEnum::SUFFIX:
+                if (atEnd) {
+                    return true;
+                }
+                break;
+            case LiteralKindEnum::CONTAINS:
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool PatternSet::matches(const QString &str) const
+{
+    if (m_matchesAnything || (m_matchesEmpty && str.isEmpty())) {
+        return true;
+    }
+    if (matchesLiteral(str)) {
+        return true;
+    }
+    return std::any_of(m_regexes.begin(), m_regexes.end(), [&str](const QRegularExpression &regex) {
+        return regex.match(str).hasMatch();
+    });
+}
+
+bool PatternSet::isEmpty() const
+{
+    return m_literals.empty() && m_regexes.empty() && !m_matchesAnything && !m_matchesEmpty;
+}
@@ -0,0 +1,64 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2023 The MMapper Authors
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <QRegularExpression>
+#include <QString>
+#include <QStringList>
+#include <QStringView>
+
+#include "../global/macros.h"
+
+/// A list of parser patterns, compiled once so that a line is scanned once
+/// no matter how many patterns there are.
+///
+/// Patterns use the same syntax as Patterns::matchPattern():
+///   "#<text" (prefix), "#=text" (whole line), "#>text" (suffix),
+///   "#?text" (substring) and "#!regex".
+///
+/// The literal patterns share one Aho-Corasick automaton; the regular
+/// expressions are joined into a single alternation where possible.
+class NODISCARD PatternSet final
+{
+private:
+    enum class NODISCARD LiteralKindEnum : uint8_t { PREFIX, EXACT, SUFFIX, CONTAINS };
+
+    struct NODISCARD Literal final
+    {
+        int length = 0;
+        LiteralKindEnum kind = LiteralKindEnum::CONTAINS;
+    };
+
+    struct NODISCARD Node final
+    {
+        // sorted by character
+        std::vector<std::pair<char16_t, uint32_t>> next;
+        uint32_t fail = 0;
+        // literals that end here, including those reached through fail links
+        std::vector<uint32_t> outputs;
+    };
+
+    std::vector<Literal> m_literals;
+    std::vector<Node> m_nodes;
+    std::vector<QRegularExpression> m_regexes;
+    bool m_matchesAnything = false;
+    bool m_matchesEmpty = false;
+
+public:
+    PatternSet() = default;
+    explicit PatternSet(const QStringList &patterns);
+
+public:
+    NODISCARD bool matches(const QString &str) const;
+    NODISCARD bool isEmpty() const;
+
+private:
+    void addLiteral(QStringView text, LiteralKindEnum kind);
+    void addRegexes(const QStringList &regexes);
+    void buildFailLinks();
+    NODISCARD uint32_t findNext(uint32_t node, char16_t c) const;
+    NODISCARD bool matchesLiteral(const QString &str) const;
+};
@@ -0,0 +1,150 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2023 The MMapper Authors
+
+#include "XmlTag.h"
+
+#include <algorithm>
+
+namespace { // anonymous
+
+NODISCARD bool isSpace(const char c)
+{
+    switch (c) {
+    case ' ':
+    case '\t':
+    case '\n':
+    case '\v':
+    case '\f':
+    case '\r':
+        return true;
+    default:
+        return false;
+    }
+}
+
+} // namespace
+
+XmlTagEnum lookupXmlTag(const std::string_view name)
+{
+    // The length and the first character are enough to pick a single candidate.
+    const auto check = [name](const std::string_view expected, const XmlTagEnum id) {
+        return (name == expected) ? id : XmlTagEnum::UNKNOWN;
+    };
+
+    if (name.empty()) {
+        return XmlTagEnum::UNKNOWN;
+    }
+
+    switch (name.size()) {
+    case 3:
+        return check("xml", XmlTagEnum::XML);
+    case 4:
+        switch (name.front()) {
+        case 'n':
+            return check("name", XmlTagEnum::NAME);
+        case 'r':
+            return check("room", XmlTagEnum::ROOM);
+        }
+        break;
+    case 5:
+        switch (name.front()) {
+        case 'e':
+            return check("exits", XmlTagEnum::EXITS);
+        case 's':
+            return check("snoop", XmlTagEnum::SNOOP);
+        }
+        break;
+    case 6:
+        switch (name.front()) {
+        case 'h':
+            return check("header", XmlTagEnum::HEADER);
+        case 'p':
+            return check("prompt", XmlTagEnum::PROMPT);
+        case 's':
+            return check("status", XmlTagEnum::STATUS);
+        }
+        break;
+    case 7:
+        switch (name.front()) {
+        case 't':
+            return check("terrain", XmlTagEnum::TERRAIN);
+        case 'w':
+            return check("weather", XmlTagEnum::WEATHER);
+        }
+        break;
+    case 8:
+        return check("movement", XmlTagEnum::MOVEMENT);
+    case 9:
+        return check("character", XmlTagEnum::CHARACTER);
+    case 10:
+        return check("gratuitous", XmlTagEnum::GRATUITOUS);
+    case 11:
+        return check("description", XmlTagEnum::DESCRIPTION);
+    default:
+        break;
+    }
+    return XmlTagEnum::UNKNOWN;
+}
+
+XmlTag::XmlTag(const std::string_view text)
+{
+    const size_t size = text.size();
+    size_t pos = 0;
+
+    if (pos < size && text[pos] == '/') {
+        m_closing = true;
+        ++pos;
+    }
+
+    const size_t nameBegin = pos;
+    while (pos < size && !isSpace(text[pos]) && text[pos] != '/') {
+        ++pos;
+    }
+    m_name = text.substr(nameBegin, pos - nameBegin);
+    m_id = lookupXmlTag(m_name);
+
+    while (pos < size) {
+        // key: everything up to '=', ignoring words without a value
+        if (isSpace(text[pos]) || text[pos] == '/') {
+            ++pos;
+            continue;
+        }
+        const size_t keyBegin = pos;
+        while (pos < size && !isSpace(text[pos]) && text[pos] != '=') {
+            ++pos;
+        }
+        const std::string_view key = text.substr(keyBegin, pos - keyBegin);
+        while (pos < size && isSpace(text[pos])) {
+            ++pos;
+        }
+        if (pos == size || text[pos] != '=') {
+            continue;
+        }
+        ++pos;
+
+        while (pos < size && isSpace(text[pos])) {
+            ++pos;
+        }
+
+        // value: quoted, or (not valid XML, but accepted) up to a space or '/'
+        std::string_view value;
+        if (pos < size && (text[pos] == '\'' || text[pos] == '"')) {
+            const char quote = text[pos++];
+            const size_t valueBegin = pos;
+            const size_t valueEnd = std::min(text.find(quote, valueBegin), size);
+            value = text.substr(valueBegin, valueEnd - valueBegin);
+            pos = std::min(valueEnd + 1, size);
+        } else {
+            const size_t valueBegin = pos;
+            while (pos < size && !isSpace(text[pos]) && text[pos] != '/') {
+                ++pos;
+            }
+            value = text.substr(valueBegin, pos - valueBegin);
+        }
+
+        // REVISIT: Translate XML entities into text
+        if (m_numAttributes < MAX_ATTRIBUTES) {
+            m_attributes[m_numAttributes++] = XmlAttribute{key, value};
+        }
+    }
+}
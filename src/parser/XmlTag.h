@@ -0,0 +1,71 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2023 The MMapper Authors
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "../global/macros.h"
+
+/// Tags of MUME's XML mode that the parser acts on.
+enum class NODISCARD XmlTagEnum : uint8_t {
+    UNKNOWN,
+    CHARACTER,
+    DESCRIPTION,
+    EXITS,
+    GRATUITOUS,
+    HEADER,
+    MOVEMENT,
+    NAME,
+    PROMPT,
+    ROOM,
+    SNOOP,
+    STATUS,
+    TERRAIN,
+    WEATHER,
+    XML
+};
+
+NODISCARD extern XmlTagEnum lookupXmlTag(std::string_view name);
+
+struct NODISCARD XmlAttribute final
+{
+    std::string_view key;
+    std::string_view value;
+};
+
+/// The contents of one tag (the text between '<' and '>'), split into the
+/// element name and its attributes in a single pass.
+///
+/// Names and values are views into the tag text, so the text must outlive
+/// the XmlTag. Attributes beyond MAX_ATTRIBUTES are ignored.
+class NODISCARD XmlTag final
+{
+public:
+    static constexpr const size_t MAX_ATTRIBUTES = 4;
+
+private:
+    std::string_view m_name;
+    std::array<XmlAttribute, MAX_ATTRIBUTES> m_attributes{};
+    uint8_t m_numAttributes = 0;
+    XmlTagEnum m_id = XmlTagEnum::UNKNOWN;
+    bool m_closing = false;
+
+public:
+    explicit XmlTag(std::string_view text);
+
+public:
+    /// Element name without the leading '/' of a closing tag.
+    NODISCARD std::string_view getName() const { return m_name; }
+    NODISCARD XmlTagEnum getId() const { return m_id; }
+    NODISCARD bool isClosing() const { return m_closing; }
+    NODISCARD bool isOpening(const XmlTagEnum id) const { return !m_closing && m_id == id; }
+    NODISCARD bool isClosing(const XmlTagEnum id) const { return m_closing && m_id == id; }
+
+public:
+    NODISCARD const XmlAttribute *begin() const { return m_attributes.data(); }
+    NODISCARD const XmlAttribute *end() const { return m_attributes.data() + m_numAttributes; }
+    NODISCARD bool hasAttributes() const { return m_numAttributes != 0; }
+};
@@ -743,20 +743,21 @@ class ShortestPathEmitter final : public ShortestPathRecipient
 
 private:
     void virt_receiveShortestPath(RoomAdmin * /*admin*/,
-                                  QVector<SPNode> spnodes,
+                                  const std::vector<SPNode> &spnodes,
                                   const int endpoint) final
     {
-        const SPNode *spnode = &spnodes[endpoint];
+        const SPNode *spnode = &spnodes.at(static_cast<size_t>(endpoint));
         auto name = spnode->r->getName();
         parser.sendToUser("Distance " + QString::number(spnode->dist) + ": " + name + "\n");
         QString dirs;
         while (spnode->parent >= 0) {
-            if (&spnodes[spnode->parent] == spnode) {
+            const SPNode *const parent = &spnodes.at(static_cast<size_t>(spnode->parent));
+            if (parent == spnode) {
                 parser.sendToUser("ERROR: loop\n");
                 break;
             }
             dirs.append(Mmapper2Exit::charForDir(spnode->lastdir));
-            spnode = &spnodes[spnode->parent];
+            spnode = parent;
         }
         std::reverse(dirs.begin(), dirs.end());
         parser.sendToUser("dirs: " + compressDirections(dirs) + "\n");
@@ -785,7 +786,13 @@ void AbstractParser::dirsCommand(const RoomFilter &f)
 
     auto rs = RoomSelection(m_mapData);
     if (const Room *const r = rs.getRoom(getTailPosition())) {
-        m_mapData.shortestPathSearch(r, &sp_emitter, f, 10, 0);
+        // Searching by filter would keep going through the whole map for more hits,
+        // so head straight for the match when there is only one.
+        if (const Room *const target = m_mapData.findUniqueMatch(f)) {
+            m_mapData.shortestPathSearch(r, target, &sp_emitter);
+        } else {
+            m_mapData.shortestPathSearch(r, &sp_emitter, f, 10, 0);
+        }
     }
 }
 
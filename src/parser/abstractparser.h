@@ -88,7 +88,7 @@ class AbstractParser : public QObject
     const char &prefixChar;
 
 private:
-    ActionRecordMap m_actionMap;
+    ActionMatcher m_actionMatcher;
 
 protected:
     QString m_exits = nullString;
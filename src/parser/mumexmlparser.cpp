@@ -5,7 +5,9 @@
 
 #include "mumexmlparser.h"
 
-#include <cctype>
+#include <algorithm>
+#include <cassert>
+#include <optional>
 #include <sstream>
 #include <utility>
 #include <QByteArray>
@@ -19,6 +21,7 @@
 #include "../proxy/telnetfilter.h"
 #include "ExitsFlags.h"
 #include "PromptFlags.h"
+#include "XmlTag.h"
 #include "abstractparser.h"
 #include "parserutils.h"
 #include "patterns.h"
@@ -70,6 +73,7 @@ MumeXmlParser::~MumeXmlParser()
 
 void MumeXmlParser::slot_parseNewMudInput(const TelnetData &data)
 {
+    PipelineTimer timer{m_stats, data.line.size()};
     switch (data.type) {
     case TelnetDataEnum::DELAY: // Twiddlers
         if (XPS_DEBUG_TO_FILE) {
@@ -140,31 +144,40 @@ void MumeXmlParser::parse(const TelnetData &data, const bool isGoAhead)
     if (!m_lineFlags.isSnoop())
         m_snoopChar.reset();
 
-    for (const char c : line) {
+    // Text and tags are appended in runs up to the next delimiter.
+    const char *pos = line.constData();
+    const char *const end = pos + line.size();
+    while (pos != end) {
         if (m_readingTag) {
-            if (c == '>') {
-                // send tag
-                if (!m_tempTag.isEmpty()) {
-                    MAYBE_UNUSED const auto ignored = //
-                        element(m_tempTag);
-                }
-
-                m_tempTag.clear();
+            const char *const close = std::find(pos, end, '>');
+            m_tempTag.append(pos, static_cast<int>(close - pos));
+            if (close == end) {
+                break;
+            }
+            pos = close + 1;
 
-                m_readingTag = false;
-                continue;
+            // send tag
+            if (!m_tempTag.isEmpty()) {
+                MAYBE_UNUSED const auto ignored = //
+                    element(m_tempTag);
             }
-            m_tempTag.append(c);
 
-        } else {
-            if (c == '<') {
-                m_lineToUser.append(characters(m_tempCharacters));
-                m_tempCharacters.clear();
+            m_tempTag.clear();
+
+            m_readingTag = false;
 
-                m_readingTag = true;
-                continue;
+        } else {
+            const char *const open = std::find(pos, end, '<');
+            m_tempCharacters.append(pos, static_cast<int>(open - pos));
+            if (open == end) {
+                break;
             }
-            m_tempCharacters.append(c);
+            pos = open + 1;
+
+            m_lineToUser.append(characters(m_tempCharacters));
+            m_tempCharacters.clear();
+
+            m_readingTag = true;
         }
     }
 
@@ -191,460 +204,330 @@ void MumeXmlParser::parse(const TelnetData &data, const bool isGoAhead)
     }
 }
 
+NODISCARD static RoomTerrainEnum parseTerrain(const std::string_view terrain)
+{
+    assert(!terrain.empty());
+    switch (terrain.front()) {
+    case 'b':
+        if (terrain == "brush")
+            return RoomTerrainEnum::BRUSH;
+        else // building
+            return RoomTerrainEnum::INDOORS;
+    case 'c':
+        if (terrain == "cavern")
+            return RoomTerrainEnum::CAVERN;
+        else // city
+            return RoomTerrainEnum::CITY;
+    case 'f':
+        if (terrain == "field")
+            return RoomTerrainEnum::FIELD;
+        else // forest
+            return RoomTerrainEnum::FOREST;
+    case 'h':
+        // hills
+        return RoomTerrainEnum::HILLS;
+    case 'm':
+        // mountains
+        return RoomTerrainEnum::MOUNTAINS;
+    case 'r':
+        if (terrain == "rapids")
+            return RoomTerrainEnum::RAPIDS;
+        else // road
+            return RoomTerrainEnum::ROAD;
+    case 's':
+        // shallows
+        return RoomTerrainEnum::SHALLOW;
+    case 't':
+        // tunnel
+        return RoomTerrainEnum::TUNNEL;
+    case 'u':
+        // underwater
+        return RoomTerrainEnum::UNDERWATER;
+    case 'w':
+        // water
+        return RoomTerrainEnum::WATER;
+    default:
+        qWarning() << "Unknown terrain type" << ::toQByteArrayLatin1(terrain);
+        return RoomTerrainEnum::UNDEFINED;
+    }
+}
+
+NODISCARD static std::optional<CommandEnum> parseMovement(const std::string_view dir)
+{
+    assert(!dir.empty());
+    switch (dir.front()) {
+    case 'n':
+        return CommandEnum::NORTH;
+    case 's':
+        return CommandEnum::SOUTH;
+    case 'e':
+        return CommandEnum::EAST;
+    case 'w':
+        return CommandEnum::WEST;
+    case 'u':
+        return CommandEnum::UP;
+    case 'd':
+        return CommandEnum::DOWN;
+    default:
+        qWarning() << "Unknown movement dir" << ::toQByteArrayLatin1(dir);
+        return std::nullopt;
+    }
+}
+
 bool MumeXmlParser::element(const QByteArray &line)
 {
-    const int length = line.length();
-
-    // REVISIT: Merge this logic with the state machine in parse()
-    const auto attributes = [&line]() {
-        std::list<std::pair<std::string, std::string>> attributes;
-
-        std::ostringstream os;
-        std::optional<std::string> key;
-
-        XmlAttributeStateEnum state = XmlAttributeStateEnum::ELEMENT;
-        const auto makeAttribute = [&key, &os, &attributes, &state]() {
-            assert(key.has_value());
-            // REVISIT: Translate XML entities into text
-            attributes.emplace_back(make_pair(key.value(), os.str()));
-            key.reset();
-            os.str(std::string());
-            state = XmlAttributeStateEnum::ATTRIBUTE;
-        };
-        for (const auto &c : line) {
-            switch (state) {
-            case XmlAttributeStateEnum::ELEMENT:
-                if (std::isspace(c))
-                    state = XmlAttributeStateEnum::ATTRIBUTE;
-                else
-                    continue;
-                break;
-            case XmlAttributeStateEnum::ATTRIBUTE:
-                if (std::isspace(c))
-                    continue;
-                else if (c == '=') {
-                    key = os.str();
-                    os.str(std::string());
-                    state = XmlAttributeStateEnum::EQUALS;
-                } else
-                    os << c;
-                break;
-            case XmlAttributeStateEnum::EQUALS:
-                if (std::isspace(c))
-                    continue;
-                else if (c == '\'')
-                    state = XmlAttributeStateEnum::SINGLE_QUOTED_VALUE;
-                else if (c == '"')
-                    state = XmlAttributeStateEnum::DOUBLE_QUOTED_VALUE;
-                else {
-                    os << c;
-                    state = XmlAttributeStateEnum::UNQUOTED_VALUE;
-                }
-                break;
-            case XmlAttributeStateEnum::UNQUOTED_VALUE:
-                // Note: This format is not valid according to the W3C XML standard
-                if (std::isspace(c) || c == '/')
-                    makeAttribute();
-                else
-                    os << c;
-                break;
-            case XmlAttributeStateEnum::SINGLE_QUOTED_VALUE:
-                if (c == '\'')
-                    makeAttribute();
-                else
-                    os << c;
-                break;
-            case XmlAttributeStateEnum::DOUBLE_QUOTED_VALUE:
-                if (c == '"')
-                    makeAttribute();
-                else
-                    os << c;
-                break;
-            }
-        }
-        if (key.has_value())
-            makeAttribute();
-        return attributes;
-    }();
+    const XmlTag tag{std::string_view{line.constData(), static_cast<size_t>(line.size())}};
 
     switch (m_xmlMode) {
     case XmlModeEnum::NONE:
-        if (length > 0) {
-            switch (line.at(0)) {
-            case '/':
-                if (line.startsWith("/snoop")) {
-                    m_lineFlags.remove(LineFlagEnum::SNOOP);
-                    if (m_descriptionReady) {
-                        if (!m_exitsReady && getConfig().mumeNative.emulatedExits) {
-                            m_exitsReady = true;
-                            std::ostringstream os;
-                            emulateExits(os, m_move);
-                            sendToUser(::toQByteArrayLatin1(snoopToUser(os.str())));
-                        }
-                        m_promptFlags.reset(); // Don't trust god prompts
-                        if (!m_queue.isEmpty() && m_move != CommandEnum::LOOK) // Remove follows
-                        {
-                            MAYBE_UNUSED const auto ignored = //
-                                m_queue.dequeue();
-                        }
-                        if (m_move != CommandEnum::LOOK)
-                            m_queue.enqueue(m_move);
-                        move();
+        switch (tag.getId()) {
+        case XmlTagEnum::SNOOP:
+            if (tag.isClosing()) {
+                m_lineFlags.remove(LineFlagEnum::SNOOP);
+                if (m_descriptionReady) {
+                    if (!m_exitsReady && getConfig().mumeNative.emulatedExits) {
+                        m_exitsReady = true;
+                        std::ostringstream os;
+                        emulateExits(os, m_move);
+                        sendToUser(::toQByteArrayLatin1(snoopToUser(os.str())));
                     }
-
-                } else if (line.startsWith("/status")) {
-                    m_lineFlags.remove(LineFlagEnum::STATUS);
-
-                } else if (line.startsWith("/weather")) {
-                    m_lineFlags.remove(LineFlagEnum::WEATHER);
-                    // Certain weather events happen on ticks
-
-                } else if (line.startsWith("/xml")) {
-                    sendToUser("[MMapper] Mapper cannot function without XML mode\n");
-                    m_queue.clear();
-                    m_lineFlags.clear();
-                }
-                break;
-            case 'p':
-                if (line.startsWith("prompt")) {
-                    m_xmlMode = XmlModeEnum::PROMPT;
-                    m_lineFlags.insert(LineFlagEnum::PROMPT);
-                    m_lastPrompt = emptyByteArray;
+                    m_promptFlags.reset(); // Don't trust god prompts
+                    if (!m_queue.isEmpty() && m_move != CommandEnum::LOOK) // Remove follows
+                    {
+                        MAYBE_UNUSED const auto ignored = //
+                            m_queue.dequeue();
+                    }
+                    if (m_move != CommandEnum::LOOK)
+                        m_queue.enqueue(m_move);
+                    move();
                 }
-                break;
-            case 'e':
-                if (line.startsWith("exits")) {
-                    m_exits = nullString; // Reset string since payload can be from the 'exit' command
-                    m_xmlMode = XmlModeEnum::EXITS;
-                    m_lineFlags.insert(LineFlagEnum::EXITS);
+            } else {
+                m_lineFlags.insert(LineFlagEnum::SNOOP);
+                if (line.length() > 13) {
+                    m_snoopChar = line.at(13);
                 }
-                break;
-            case 'r':
-                if (line.startsWith("room")) {
-                    m_xmlMode = XmlModeEnum::ROOM;
-                    m_roomName = RoomName{}; // 'name' tag will not show up when blinded
-                    m_descriptionReady = false;
-                    m_exitsReady = false;
-                    m_roomDesc.reset();
-                    m_roomContents.reset();
-                    m_terrain = RoomTerrainEnum::UNDEFINED;
-                    m_exits = nullString;
-                    m_promptFlags.reset();
-                    m_exitsFlags.reset();
-                    m_connectedRoomFlags.reset();
-                    m_lineFlags.insert(LineFlagEnum::ROOM);
-
-                    for (const auto &pair : attributes) {
-                        if (pair.first.empty() || pair.second.empty())
-                            continue;
-                        switch (pair.first.at(0)) {
-                        case 't':
-                            if (pair.first == "terrain") {
-                                switch (pair.second.at(0)) {
-                                case 'b':
-                                    if (pair.second == "brush")
-                                        m_terrain = RoomTerrainEnum::BRUSH;
-                                    else // building
-                                        m_terrain = RoomTerrainEnum::INDOORS;
-                                    break;
-                                case 'c':
-                                    if (pair.second == "cavern")
-                                        m_terrain = RoomTerrainEnum::CAVERN;
-                                    else // city
-                                        m_terrain = RoomTerrainEnum::CITY;
-                                    break;
-                                case 'f':
-                                    if (pair.second == "field")
-                                        m_terrain = RoomTerrainEnum::FIELD;
-                                    else // forest
-                                        m_terrain = RoomTerrainEnum::FOREST;
-                                    break;
-                                case 'h':
-                                    // hills
-                                    m_terrain = RoomTerrainEnum::HILLS;
-                                    break;
-                                case 'm':
-                                    // mountains
-                                    m_terrain = RoomTerrainEnum::MOUNTAINS;
-                                    break;
-                                case 'r':
-                                    if (pair.second == "rapids")
-                                        m_terrain = RoomTerrainEnum::RAPIDS;
-                                    else // road
-                                        m_terrain = RoomTerrainEnum::ROAD;
-                                    break;
-                                case 's':
-                                    // shallows
-                                    m_terrain = RoomTerrainEnum::SHALLOW;
-                                    break;
-                                case 't':
-                                    // tunnel
-                                    m_terrain = RoomTerrainEnum::TUNNEL;
-                                    break;
-                                case 'u':
-                                    // underwater
-                                    m_terrain = RoomTerrainEnum::UNDERWATER;
-                                    break;
-                                case 'w':
-                                    // water
-                                    m_terrain = RoomTerrainEnum::WATER;
-                                    break;
-                                default:
-                                    qWarning() << "Unknown terrain type"
-                                               << ::toQByteArrayLatin1(pair.second);
-                                    break;
-                                }
-                            }
-                            break;
-                        default:
-                            break;
-                        }
+            }
+            break;
+        case XmlTagEnum::STATUS:
+            if (tag.isClosing()) {
+                m_lineFlags.remove(LineFlagEnum::STATUS);
+            } else {
+                m_lineFlags.insert(LineFlagEnum::STATUS);
+            }
+            break;
+        case XmlTagEnum::WEATHER:
+            if (tag.isClosing()) {
+                m_lineFlags.remove(LineFlagEnum::WEATHER);
+                // Certain weather events happen on ticks
+            } else {
+                m_lineFlags.insert(LineFlagEnum::WEATHER);
+            }
+            break;
+        case XmlTagEnum::XML:
+            if (tag.isClosing()) {
+                sendToUser("[MMapper] Mapper cannot function without XML mode\n");
+                m_queue.clear();
+                m_lineFlags.clear();
+            }
+            break;
+        case XmlTagEnum::PROMPT:
+            if (!tag.isClosing()) {
+                m_xmlMode = XmlModeEnum::PROMPT;
+                m_lineFlags.insert(LineFlagEnum::PROMPT);
+                m_lastPrompt = emptyByteArray;
+            }
+            break;
+        case XmlTagEnum::EXITS:
+            if (!tag.isClosing()) {
+                m_exits = nullString; // Reset string since payload can be from the 'exit' command
+                m_xmlMode = XmlModeEnum::EXITS;
+                m_lineFlags.insert(LineFlagEnum::EXITS);
+            }
+            break;
+        case XmlTagEnum::ROOM:
+            if (!tag.isClosing()) {
+                m_xmlMode = XmlModeEnum::ROOM;
+                m_roomName = RoomName{}; // 'name' tag will not show up when blinded
+                m_descriptionReady = false;
+                m_exitsReady = false;
+                m_roomDesc.reset();
+                m_roomContents.reset();
+                m_terrain = RoomTerrainEnum::UNDEFINED;
+                m_exits = nullString;
+                m_promptFlags.reset();
+                m_exitsFlags.reset();
+                m_connectedRoomFlags.reset();
+                m_lineFlags.insert(LineFlagEnum::ROOM);
+
+                for (const XmlAttribute &attr : tag) {
+                    if (attr.key == "terrain" && !attr.value.empty()) {
+                        m_terrain = parseTerrain(attr.value);
                     }
                 }
-                break;
-            case 'm':
-                if (line.startsWith("movement")) {
-                    if (m_descriptionReady) {
-                        // We are most likely in a fall room where the prompt is not shown
-                        move();
-                    }
-                    if (attributes.empty()) {
-                        // movement/
-                        m_move = CommandEnum::NONE;
-                        break;
-                    }
-                    for (const auto &pair : attributes) {
-                        if (pair.first.empty() || pair.second.empty())
-                            continue;
-                        switch (pair.first.at(0)) {
-                        case 'd':
-                            if (pair.first == "dir") {
-                                switch (pair.second.at(0)) {
-                                case 'n':
-                                    m_move = CommandEnum::NORTH;
-                                    break;
-                                case 's':
-                                    m_move = CommandEnum::SOUTH;
-                                    break;
-                                case 'e':
-                                    m_move = CommandEnum::EAST;
-                                    break;
-                                case 'w':
-                                    m_move = CommandEnum::WEST;
-                                    break;
-                                case 'u':
-                                    m_move = CommandEnum::UP;
-                                    break;
-                                case 'd':
-                                    m_move = CommandEnum::DOWN;
-                                    break;
-                                default:
-                                    qWarning() << "Unknown movement dir"
-                                               << ::toQByteArrayLatin1(pair.second);
-                                    break;
-                                }
-                            }
-                            break;
-                        }
-                    }
+            }
+            break;
+        case XmlTagEnum::MOVEMENT:
+            if (!tag.isClosing()) {
+                if (m_descriptionReady) {
+                    // We are most likely in a fall room where the prompt is not shown
+                    move();
                 }
-                break;
-            case 'w':
-                if (line.startsWith("weather")) {
-                    m_lineFlags.insert(LineFlagEnum::WEATHER);
+                if (!tag.hasAttributes()) {
+                    // movement/
+                    m_move = CommandEnum::NONE;
+                    break;
                 }
-                break;
-            case 's':
-                if (line.startsWith("status")) {
-                    m_lineFlags.insert(LineFlagEnum::STATUS);
-
-                } else if (line.startsWith("snoop")) {
-                    m_lineFlags.insert(LineFlagEnum::SNOOP);
-                    if (length > 13) {
-                        m_snoopChar = line.at(13);
+                for (const XmlAttribute &attr : tag) {
+                    if (attr.key == "dir" && !attr.value.empty()) {
+                        if (const auto dir = parseMovement(attr.value)) {
+                            m_move = dir.value();
+                        }
                     }
                 }
-                break;
             }
+            break;
+        default:
+            break;
         }
         break;
 
     case XmlModeEnum::ROOM:
-        if (length > 0) {
-            switch (line.at(0)) {
-            case 'c':
-                if (line.startsWith("character")) {
-                    m_xmlMode = XmlModeEnum::CHARACTER;
-                    m_lineFlags.insert(LineFlagEnum::CHARACTER);
-                }
-                break;
-            case 'g':
-                if (line.startsWith("gratuitous") && getConfig().parser.removeXmlTags) {
-                    m_gratuitous = true;
-                }
-                break;
-            case 'e':
-                if (line.startsWith("exits")) {
-                    m_exits = nullString; // Reset string since payload can be from the 'exit' command
-                    m_xmlMode = XmlModeEnum::EXITS;
-                    m_lineFlags.insert(LineFlagEnum::EXITS);
-                    m_descriptionReady = true;
-                }
-                break;
-            case 'n':
-                if (line.startsWith("name")) {
-                    m_xmlMode = XmlModeEnum::NAME;
-                    m_lineFlags.insert(LineFlagEnum::NAME);
-                }
-                break;
-            case 'd':
-                if (line.startsWith("description")) {
-                    m_xmlMode = XmlModeEnum::DESCRIPTION;
-                    // might be empty but valid description
-                    m_roomDesc = RoomDesc{""};
-                    m_lineFlags.insert(LineFlagEnum::DESCRIPTION);
-                }
-                break;
-            case 't': // terrain tag only comes up in blindness or fog
-                if (line.startsWith("terrain")) {
-                    m_xmlMode = XmlModeEnum::TERRAIN;
-                    m_lineFlags.insert(LineFlagEnum::TERRAIN);
-                }
-                break;
-            case 'h': // Gods have an "Obvious exits" header
-                if (line.startsWith("header")) {
-                    m_xmlMode = XmlModeEnum::HEADER;
-                    m_lineFlags.insert(LineFlagEnum::HEADER);
-                    m_descriptionReady = true;
-                }
-                break;
-            case '/':
-                if (line.startsWith("/room")) {
-                    m_xmlMode = XmlModeEnum::NONE;
-                    m_lineFlags.remove(LineFlagEnum::ROOM);
-                    m_descriptionReady = true;
-                } else if (line.startsWith("/gratuitous")) {
-                    m_gratuitous = false;
-                }
-                break;
+        switch (tag.getId()) {
+        case XmlTagEnum::CHARACTER:
+            if (!tag.isClosing()) {
+                m_xmlMode = XmlModeEnum::CHARACTER;
+                m_lineFlags.insert(LineFlagEnum::CHARACTER);
+            }
+            break;
+        case XmlTagEnum::GRATUITOUS:
+            if (tag.isClosing()) {
+                m_gratuitous = false;
+            } else if (getConfig().parser.removeXmlTags) {
+                m_gratuitous = true;
+            }
+            break;
+        case XmlTagEnum::EXITS:
+            if (!tag.isClosing()) {
+                m_exits = nullString; // Reset string since payload can be from the 'exit' command
+                m_xmlMode = XmlModeEnum::EXITS;
+                m_lineFlags.insert(LineFlagEnum::EXITS);
+                m_descriptionReady = true;
             }
+            break;
+        case XmlTagEnum::NAME:
+            if (!tag.isClosing()) {
+                m_xmlMode = XmlModeEnum::NAME;
+                m_lineFlags.insert(LineFlagEnum::NAME);
+            }
+            break;
+        case XmlTagEnum::DESCRIPTION:
+            if (!tag.isClosing()) {
+                m_xmlMode = XmlModeEnum::DESCRIPTION;
+                // might be empty but valid description
+                m_roomDesc = RoomDesc{""};
+                m_lineFlags.insert(LineFlagEnum::DESCRIPTION);
+            }
+            break;
+        case XmlTagEnum::TERRAIN: // terrain tag only comes up in blindness or fog
+            if (!tag.isClosing()) {
+                m_xmlMode = XmlModeEnum::TERRAIN;
+                m_lineFlags.insert(LineFlagEnum::TERRAIN);
+            }
+            break;
+        case XmlTagEnum::HEADER: // Gods have an "Obvious exits" header
+            if (!tag.isClosing()) {
+                m_xmlMode = XmlModeEnum::HEADER;
+                m_lineFlags.insert(LineFlagEnum::HEADER);
+                m_descriptionReady = true;
+            }
+            break;
+        case XmlTagEnum::ROOM:
+            if (tag.isClosing()) {
+                m_xmlMode = XmlModeEnum::NONE;
+                m_lineFlags.remove(LineFlagEnum::ROOM);
+                m_descriptionReady = true;
+            }
+            break;
+        default:
+            break;
         }
         break;
     case XmlModeEnum::NAME:
-        if (line.startsWith("/name")) {
+        if (tag.isClosing(XmlTagEnum::NAME)) {
             m_xmlMode = XmlModeEnum::ROOM;
             m_lineFlags.remove(LineFlagEnum::NAME);
         }
         break;
     case XmlModeEnum::DESCRIPTION:
-        if (length > 0) {
-            switch (line.at(0)) {
-            case '/':
-                if (line.startsWith("/description")) {
-                    m_xmlMode = XmlModeEnum::ROOM;
-                    m_lineFlags.remove(LineFlagEnum::DESCRIPTION);
-                }
-                break;
-            }
+        if (tag.isClosing(XmlTagEnum::DESCRIPTION)) {
+            m_xmlMode = XmlModeEnum::ROOM;
+            m_lineFlags.remove(LineFlagEnum::DESCRIPTION);
         }
         break;
     case XmlModeEnum::EXITS:
-        if (length > 0) {
-            switch (line.at(0)) {
-            case '/':
-                if (line.startsWith("/exits")) {
-                    std::ostringstream os;
-                    parseExits(os);
-                    m_lineToUser.append(::toQByteArrayLatin1(snoopToUser(os.str())));
-                    m_exitsReady = true;
-                    m_lineFlags.remove(LineFlagEnum::EXITS);
-                    if (m_lineFlags.contains(LineFlagEnum::ROOM))
-                        m_xmlMode = XmlModeEnum::ROOM;
-                    else
-                        m_xmlMode = XmlModeEnum::NONE;
-                }
-                break;
-            }
+        if (tag.isClosing(XmlTagEnum::EXITS)) {
+            std::ostringstream os;
+            parseExits(os);
+            m_lineToUser.append(::toQByteArrayLatin1(snoopToUser(os.str())));
+            m_exitsReady = true;
+            m_lineFlags.remove(LineFlagEnum::EXITS);
+            if (m_lineFlags.contains(LineFlagEnum::ROOM))
+                m_xmlMode = XmlModeEnum::ROOM;
+            else
+                m_xmlMode = XmlModeEnum::NONE;
         }
         break;
     case XmlModeEnum::PROMPT:
-        if (length > 0) {
-            switch (line.at(0)) {
-            case 'c':
-                if (line.startsWith("character")) {
-                    m_xmlMode = XmlModeEnum::CHARACTER;
-                    m_lineFlags.insert(LineFlagEnum::CHARACTER);
-                }
-                break;
-            case '/':
-                if (line.startsWith("/prompt")) {
-                    m_xmlMode = XmlModeEnum::NONE;
-                    m_lineFlags.remove(LineFlagEnum::PROMPT);
-                    m_overrideSendPrompt = false;
-
-                    const QString copy = normalizeStringCopy(m_lastPrompt);
-                    sendPromptLineEvent(copy.toLatin1());
-                    parsePrompt(copy);
-
-                    const auto &config = getConfig();
-                    if (!config.parser.removeXmlTags) {
-                        m_lastPrompt.replace(ampersand, ampersandTemplate);
-                        m_lastPrompt.replace(greaterThanChar, greaterThanTemplate);
-                        m_lastPrompt.replace(lessThanChar, lessThanTemplate);
-                        m_lastPrompt = "<prompt>" + m_lastPrompt + "</prompt>";
-                    }
+        if (tag.isOpening(XmlTagEnum::CHARACTER)) {
+            m_xmlMode = XmlModeEnum::CHARACTER;
+            m_lineFlags.insert(LineFlagEnum::CHARACTER);
+        } else if (tag.isClosing(XmlTagEnum::PROMPT)) {
+            m_xmlMode = XmlModeEnum::NONE;
+            m_lineFlags.remove(LineFlagEnum::PROMPT);
+            m_overrideSendPrompt = false;
+
+            const QString copy = normalizeStringCopy(m_lastPrompt);
+            sendPromptLineEvent(copy.toLatin1());
+            parsePrompt(copy);
+
+            const auto &config = getConfig();
+            if (!config.parser.removeXmlTags) {
+                m_lastPrompt.replace(ampersand, ampersandTemplate);
+                m_lastPrompt.replace(greaterThanChar, greaterThanTemplate);
+                m_lastPrompt.replace(lessThanChar, lessThanTemplate);
+                m_lastPrompt = "<prompt>" + m_lastPrompt + "</prompt>";
+            }
 
-                    if (m_descriptionReady) {
-                        if (!m_exitsReady && config.mumeNative.emulatedExits) {
-                            m_exitsReady = true;
-                            std::ostringstream os;
-                            emulateExits(os, m_move);
-                            sendToUser(::toQByteArrayLatin1(snoopToUser(os.str())));
-                        }
-                        move();
-                    }
+            if (m_descriptionReady) {
+                if (!m_exitsReady && config.mumeNative.emulatedExits) {
+                    m_exitsReady = true;
+                    std::ostringstream os;
+                    emulateExits(os, m_move);
+                    sendToUser(::toQByteArrayLatin1(snoopToUser(os.str())));
                 }
-                break;
+                move();
             }
         }
         break;
     case XmlModeEnum::TERRAIN:
-        if (length > 0) {
-            switch (line.at(0)) {
-            case '/':
-                if (line.startsWith("/terrain")) {
-                    m_xmlMode = XmlModeEnum::ROOM;
-                    m_lineFlags.remove(LineFlagEnum::TERRAIN);
-                }
-                break;
-            }
+        if (tag.isClosing(XmlTagEnum::TERRAIN)) {
+            m_xmlMode = XmlModeEnum::ROOM;
+            m_lineFlags.remove(LineFlagEnum::TERRAIN);
         }
         break;
     case XmlModeEnum::HEADER:
-        if (length > 0) {
-            switch (line.at(0)) {
-            case '/':
-                if (line.startsWith("/header")) {
-                    m_xmlMode = XmlModeEnum::ROOM;
-                    m_lineFlags.remove(LineFlagEnum::HEADER);
-                }
-                break;
-            }
+        if (tag.isClosing(XmlTagEnum::HEADER)) {
+            m_xmlMode = XmlModeEnum::ROOM;
+            m_lineFlags.remove(LineFlagEnum::HEADER);
         }
         break;
     case XmlModeEnum::CHARACTER:
-        if (length > 0) {
-            switch (line.at(0)) {
-            case '/':
-                if (line.startsWith("/character")) {
-                    if (m_lineFlags.isPrompt())
-                        m_xmlMode = XmlModeEnum::PROMPT;
-                    else
-                        m_xmlMode = XmlModeEnum::ROOM;
-                    m_lineFlags.remove(LineFlagEnum::CHARACTER);
-                }
-                break;
-            }
+        if (tag.isClosing(XmlTagEnum::CHARACTER)) {
+            if (m_lineFlags.isPrompt())
+                m_xmlMode = XmlModeEnum::PROMPT;
+            else
+                m_xmlMode = XmlModeEnum::ROOM;
+            m_lineFlags.remove(LineFlagEnum::CHARACTER);
         }
         break;
     }
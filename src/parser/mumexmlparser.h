@@ -13,6 +13,7 @@
 #include <QtCore>
 #include <QtGlobal>
 
+#include "../proxy/PipelineStats.h"
 #include "CommandId.h"
 #include "LineFlags.h"
 #include "abstractparser.h"
@@ -66,21 +67,7 @@ class MumeXmlParser final : public AbstractParser
     std::optional<RoomDesc> m_roomDesc;
     std::optional<RoomContents> m_roomContents;
 
-private:
-    enum class NODISCARD XmlAttributeStateEnum : uint8_t {
-        /// received <room/>
-        ELEMENT,
-        /// received <room terrain/>
-        ATTRIBUTE,
-        /// received <room terrain=/>
-        EQUALS,
-        /// received <room terrain=field/>
-        UNQUOTED_VALUE,
-        /// received <room terrain='field'/>
-        SINGLE_QUOTED_VALUE,
-        /// received <room terrain="field"/>
-        DOUBLE_QUOTED_VALUE
-    };
+    PipelineStats m_stats;
 
 public:
     explicit MumeXmlParser(
@@ -94,6 +81,8 @@ class MumeXmlParser final : public AbstractParser
     void slot_parseNewMudInput(const TelnetData &data);
     void slot_parseGmcpInput(const GmcpMessage &msg);
 
+    NODISCARD const PipelineStats &getStats() const { return m_stats; }
+
 private:
     void parseMudCommands(const QString &str);
     NODISCARD QByteArray characters(QByteArray &ch);
@@ -5,39 +5,46 @@
 
 #include "patterns.h"
 
+#include <memory>
+#include <mutex>
+#include <typeinfo>
+#include <QObject>
 #include <QRegularExpression>
 
+#include "../configuration/configobserver.h"
 #include "../configuration/configuration.h"
+#include "PatternSet.h"
 
 bool Patterns::matchPattern(const QString &pattern, const QString &str)
 {
-    if (pattern.at(0) != '#') {
+    if (pattern.length() < 2 || pattern.at(0) != '#') {
         return false;
     }
 
+    const QStringRef text = pattern.midRef(2);
     switch (static_cast<int>((pattern.at(1)).toLatin1())) {
     case 33: // !
-        if (QRegularExpression(pattern.mid(2)).match(str).hasMatch()) {
+        if (QRegularExpression(text.toString()).match(str).hasMatch()) {
             return true;
         }
         break;
     case 60:; // <
-        if (str.startsWith(pattern.mid(2))) {
+        if (str.startsWith(text)) {
             return true;
         }
         break;
     case 61:; // =
-        if (str == (pattern.mid(2))) {
+        if (str == text) {
             return true;
         }
         break;
     case 62:; // >
-        if (str.endsWith(pattern.mid(2))) {
+        if (str.endsWith(text)) {
             return true;
         }
         break;
     case 63:; // ?
-        if (str.contains(pattern.mid(2))) {
+        if (str.contains(text)) {
             return true;
         }
         break;
@@ -46,12 +53,35 @@ bool Patterns::matchPattern(const QString &pattern, const QString &str)
     return false;
 }
 
-bool Patterns::matchNoDescriptionPatterns(const QString &str)
+namespace { // anonymous
+
+std::mutex g_noDescriptionMutex;
+std::shared_ptr<const PatternSet> g_noDescriptionPatterns;
+
+NODISCARD std::shared_ptr<const PatternSet> getNoDescriptionPatterns()
 {
-    for (const QString &pattern : getConfig().parser.noDescriptionPatternsList) {
-        if (matchPattern(pattern, str)) {
-            return true;
-        }
+    // The parser can run on the proxy thread, while the patterns are edited on the UI thread.
+    MAYBE_UNUSED static const QMetaObject::Connection connection = QObject::connect(
+        &ConfigObserver::get(),
+        &ConfigObserver::sig_configChanged,
+        [](const std::type_info &configGroup) {
+            if (configGroup == typeid(Configuration::ParserSettings)) {
+                std::lock_guard<std::mutex> lock{g_noDescriptionMutex};
+                g_noDescriptionPatterns.reset();
+            }
+        });
+
+    std::lock_guard<std::mutex> lock{g_noDescriptionMutex};
+    if (g_noDescriptionPatterns == nullptr) {
+        g_noDescriptionPatterns = std::make_shared<const PatternSet>(
+            getConfig().parser.getNoDescriptionPatternsList());
     }
-    return false;
+    return g_noDescriptionPatterns;
+}
+
+} // namespace
+
+bool Patterns::matchNoDescriptionPatterns(const QString &str)
+{
+    return getNoDescriptionPatterns()->matches(str);
 }
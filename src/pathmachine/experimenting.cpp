@@ -46,13 +46,12 @@ void Experimenting::augmentPath(const std::shared_ptr<Path> &path,
 
 std::shared_ptr<PathList> Experimenting::evaluate()
 {
-    for (std::shared_ptr<Path> working = nullptr; !shortPaths->empty();) {
-        working = shortPaths->front();
-        shortPaths->pop_front();
+    for (const std::shared_ptr<Path> &working : *shortPaths) {
         if (!(working->hasChildren())) {
             working->deny();
         }
     }
+    shortPaths->clear();
 
     if (best != nullptr) {
         if (second == nullptr || best->getProb() > second->getProb() * params.acceptBestRelative
@@ -61,12 +60,13 @@ std::shared_ptr<PathList> Experimenting::evaluate()
                 path->deny();
             }
             paths->clear();
-            paths->push_front(best);
+            paths->emplace_back(best);
         } else {
-            paths->push_back(best);
-
-            for (std::shared_ptr<Path> working = paths->front(); working != best;) {
-                paths->pop_front();
+            // Compact the survivors in place; best goes in front of them.
+            auto &list = *paths;
+            size_t kept = 0;
+            for (size_t i = 0, size = list.size(); i < size; ++i) {
+                std::shared_ptr<Path> &working = list[i];
                 // throw away if the probability is very low or not
                 // distinguishable from best. Don't keep paths with equal
                 // probability at the front, for we need to find a unique
@@ -76,10 +76,11 @@ std::shared_ptr<PathList> Experimenting::evaluate()
                         && best->getRoom() == working->getRoom())) {
                     working->deny();
                 } else {
-                    paths->push_back(working);
+                    list[kept++] = std::move(working);
                 }
-                working = paths->front();
             }
+            list.resize(kept);
+            list.insert(list.begin(), best);
         }
     }
     second = nullptr;
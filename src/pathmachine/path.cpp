@@ -12,6 +12,7 @@
 #include "../expandoracommon/coordinate.h"
 #include "../expandoracommon/exit.h"
 #include "../expandoracommon/room.h"
+#include "../global/PoolAllocator.h"
 #include "../global/roomid.h"
 #include "../global/utils.h"
 #include "../mapdata/ExitDirection.h"
@@ -24,12 +25,15 @@ std::shared_ptr<Path> Path::alloc(const Room *const room,
                                   RoomSignalHandler *const signaler,
                                   std::optional<ExitDirEnum> moved_direction)
 {
-    return std::make_shared<Path>(this_is_private{0},
-                                  room,
-                                  owner,
-                                  locker,
-                                  signaler,
-                                  std::move(moved_direction));
+    // Paths are created and thrown away on every experimenting step,
+    // so they come from a fixed-block pool instead of the general heap.
+    return std::allocate_shared<Path>(PoolAllocator<Path>{},
+                                      this_is_private{0},
+                                      room,
+                                      owner,
+                                      locker,
+                                      signaler,
+                                      std::move(moved_direction));
 }
 
 Path::Path(this_is_private,
@@ -47,6 +51,15 @@ Path::Path(this_is_private,
     }
 }
 
+Path::~Path()
+{
+    if (m_linked) {
+        Path &parent = deref(m_parent);
+        parent.unlinkChild(*this);
+        ++parent.m_expiredChildren;
+    }
+}
+
 /**
  * new Path is created,
  * distance between rooms is calculated
@@ -117,7 +130,8 @@ std::shared_ptr<Path> Path::fork(const Room *const in_room,
 void Path::setParent(const std::shared_ptr<Path> &p)
 {
     assert(!m_zombie);
-    assert(!p->m_zombie);
+    assert(p == nullptr || !p->m_zombie);
+    assert(!m_linked);
     m_parent = p;
 }
 
@@ -137,11 +151,14 @@ void Path::approve()
         parent->approve();
     }
 
-    for (const std::weak_ptr<Path> &weak_child : m_children) {
-        if (auto child = weak_child.lock()) {
-            child->setParent(nullptr);
-        }
+    // Each child still holds this path through m_parent, so it stays alive
+    // until the last child lets go below.
+    while (m_firstChild != nullptr) {
+        Path &child = *m_firstChild;
+        unlinkChild(child);
+        child.setParent(nullptr);
     }
+    m_expiredChildren = 0;
 
     // was: `delete this`
     this->m_zombie = true;
@@ -154,7 +171,7 @@ void Path::deny()
 {
     assert(!m_zombie);
 
-    if (!m_children.empty()) {
+    if (hasChildren()) {
         return;
     }
     if (m_dir.has_value()) {
@@ -172,24 +189,45 @@ void Path::deny()
 void Path::insertChild(const std::shared_ptr<Path> &p)
 {
     assert(!m_zombie);
-    assert(!p->m_zombie);
-    m_children.emplace_back(p);
+    Path &child = deref(p);
+    assert(!child.m_zombie);
+    assert(!child.m_linked && child.m_parent.get() == this);
+
+    child.m_linked = true;
+    child.m_prevSibling = nullptr;
+    child.m_nextSibling = m_firstChild;
+    if (m_firstChild != nullptr) {
+        m_firstChild->m_prevSibling = &child;
+    }
+    m_firstChild = &child;
+}
+
+void Path::unlinkChild(Path &child)
+{
+    assert(child.m_linked && child.m_parent.get() == this);
+
+    if (child.m_prevSibling != nullptr) {
+        child.m_prevSibling->m_nextSibling = child.m_nextSibling;
+    } else {
+        m_firstChild = child.m_nextSibling;
+    }
+    if (child.m_nextSibling != nullptr) {
+        child.m_nextSibling->m_prevSibling = child.m_prevSibling;
+    }
+    child.m_prevSibling = nullptr;
+    child.m_nextSibling = nullptr;
+    child.m_linked = false;
 }
 
 void Path::removeChild(const std::shared_ptr<Path> &p)
 {
     assert(!m_zombie);
-    assert(!p->m_zombie);
+    Path &child = deref(p);
+    assert(!child.m_zombie);
 
-    const auto end = m_children.end();
-    const auto it = std::remove_if(m_children.begin(), end, [&p](const auto &weak) {
-        if (auto shared = weak.lock()) {
-            return shared == p; // remove p
-        } else {
-            return true; // also remove any expired children
-        }
-    });
-    if (it != end) {
-        m_children.erase(it, end);
+    if (child.m_linked && child.m_parent.get() == this) {
+        unlinkChild(child);
     }
+    // also forget any expired children
+    m_expiredChildren = 0;
 }
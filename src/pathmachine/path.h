@@ -7,7 +7,6 @@
 
 #include <cassert>
 #include <climits>
-#include <list>
 #include <memory>
 #include <optional>
 #include <vector>
@@ -46,6 +45,7 @@ class NODISCARD Path final : public std::enable_shared_from_this<Path>
                   RoomRecipient *locker,
                   RoomSignalHandler *signaler,
                   std::optional<ExitDirEnum> direction);
+    ~Path();
     DELETE_CTORS_AND_ASSIGN_OPS(Path);
 
     void insertChild(const std::shared_ptr<Path> &p);
@@ -54,7 +54,7 @@ class NODISCARD Path final : public std::enable_shared_from_this<Path>
     NODISCARD bool hasChildren() const
     {
         assert(!m_zombie);
-        return !m_children.empty();
+        return m_firstChild != nullptr || m_expiredChildren != 0;
     }
     NODISCARD const Room *getRoom() const
     {
@@ -90,18 +90,32 @@ class NODISCARD Path final : public std::enable_shared_from_this<Path>
         return m_parent;
     }
 
+private:
+    void unlinkChild(Path &child);
+
 private:
     std::shared_ptr<Path> m_parent;
-    std::vector<std::weak_ptr<Path>> m_children;
+    // Children form an intrusive sibling list, so forking never allocates
+    // beyond the pooled Path itself. A linked child keeps its parent alive
+    // through m_parent and unlinks itself when it is destroyed.
+    Path *m_firstChild = nullptr;
+    Path *m_prevSibling = nullptr;
+    Path *m_nextSibling = nullptr;
+    // children destroyed without being removed; cleared by removeChild(),
+    // matching the expired weak_ptr entries this list used to hold.
+    size_t m_expiredChildren = 0;
     double m_probability = 1.0;
     // in fact a path only has one room, one parent and some children (forks).
     const Room *const m_room;
     RoomSignalHandler *const m_signaler;
     const std::optional<ExitDirEnum> m_dir;
+    bool m_linked = false;
     bool m_zombie = false;
 };
 
-struct NODISCARD PathList : public std::list<std::shared_ptr<Path>>,
+// NOTE: This used to be a std::list; a vector avoids a node allocation per
+// hypothesis, and the few front insertions/removals only touch short lists.
+struct NODISCARD PathList : public std::vector<std::shared_ptr<Path>>,
                             public std::enable_shared_from_this<PathList>
 {
 private:
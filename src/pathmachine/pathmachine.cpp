@@ -10,6 +10,7 @@
 #include <memory>
 #include <set>
 #include <utility>
+#include <vector>
 
 #include "../expandoracommon/coordinate.h"
 #include "../expandoracommon/exit.h"
@@ -51,7 +52,7 @@ PathMachine::PathMachine(MapData *const mapData, QObject *const parent)
 void PathMachine::slot_setCurrentRoom(const RoomId id, bool update)
 {
     Forced forced(lastEvent, update);
-    emit sig_lookingForRooms(forced, id);
+    m_mapData.lookingForRooms(forced, id);
     slot_releaseAllPaths();
     if (const Room *const perhaps = forced.oneMatch()) {
         setMostLikelyRoom(*perhaps);
@@ -104,26 +105,31 @@ void PathMachine::tryExits(const Room *const room,
         return;
     }
 
+    auto &ids = m_idBatch;
+    ids.clear();
+
     const CommandEnum move = event.getMoveType();
     if (isDirection7(move)) {
         const Exit &possible = room->exit(getDirection(move));
-        tryExit(possible, recipient, out);
+        collectExit(possible, ids, out);
     } else {
         // Only check the current room for LOOK
-        emit sig_lookingForRooms(recipient, room->getId());
+        ids.emplace_back(room->getId());
         if (move >= CommandEnum::FLEE) {
             // Only try all possible exits for commands FLEE, SCOUT, and NONE
             for (const auto &possible : room->getExitsList()) {
-                tryExit(possible, recipient, out);
+                collectExit(possible, ids, out);
             }
         }
     }
+
+    m_mapData.lookingForRooms(recipient, ids);
 }
 
-void PathMachine::tryExit(const Exit &possible, RoomRecipient &recipient, const bool out)
+void PathMachine::collectExit(const Exit &possible, std::vector<RoomId> &ids, const bool out)
 {
     for (auto idx : possible.getRange(out)) {
-        emit sig_lookingForRooms(recipient, idx);
+        ids.emplace_back(idx);
     }
 }
 
@@ -136,12 +142,14 @@ void PathMachine::tryCoordinate(const Room *const room,
         return;
     }
 
+    auto &coords = m_coordinateBatch;
+    coords.clear();
+
     const CommandEnum moveCode = event.getMoveType();
     if (moveCode < CommandEnum::FLEE) {
         // LOOK, UNKNOWN will have an empty offset
         auto offset = Room::exitDir(getDirection(moveCode));
-        const Coordinate c = room->getPosition() + offset;
-        emit sig_lookingForRooms(recipient, c);
+        coords.emplace_back(room->getPosition() + offset);
 
     } else {
         const Coordinate roomPos = room->getPosition();
@@ -151,9 +159,11 @@ void PathMachine::tryCoordinate(const Room *const room,
         // even though both ExitDirEnum::UNKNOWN and ExitDirEnum::NONE
         // both have Coordinate(0, 0, 0).
         for (const ExitDirEnum dir : ALL_EXITS7) {
-            emit sig_lookingForRooms(recipient, roomPos + Room::exitDir(dir));
+            coords.emplace_back(roomPos + Room::exitDir(dir));
         }
     }
+
+    m_mapData.lookingForRooms(recipient, coords);
 }
 
 void PathMachine::approved(const SigParseEvent &sigParseEvent)
@@ -164,7 +174,7 @@ void PathMachine::approved(const SigParseEvent &sigParseEvent)
     const Room *perhaps = nullptr;
 
     if (event.getMoveType() == CommandEnum::LOOK) {
-        emit sig_lookingForRooms(appr, getMostLikelyRoomId());
+        m_mapData.lookingForRooms(appr, getMostLikelyRoomId());
 
     } else {
         tryExits(getMostLikelyRoom(), appr, event, true);
@@ -198,14 +208,14 @@ void PathMachine::approved(const SigParseEvent &sigParseEvent)
                     appr.releaseMatch();
                     Coordinate c = getMostLikelyRoomPosition() + eDir;
                     c.z--;
-                    emit sig_lookingForRooms(appr, c);
+                    m_mapData.lookingForRooms(appr, c);
                     perhaps = appr.oneMatch();
 
                     if (perhaps == nullptr) {
                         // try to match by coordinate one step above expected
                         appr.releaseMatch();
                         c.z += 2;
-                        emit sig_lookingForRooms(appr, c);
+                        m_mapData.lookingForRooms(appr, c);
                         perhaps = appr.oneMatch();
                     }
                 }
@@ -224,7 +234,8 @@ void PathMachine::approved(const SigParseEvent &sigParseEvent)
             return;
         }
 
-        paths->push_front(Path::alloc(pathRoot, nullptr, nullptr, &signaler, std::nullopt));
+        paths->insert(paths->begin(),
+                      Path::alloc(pathRoot, nullptr, nullptr, &signaler, std::nullopt));
         experimenting(sigParseEvent);
 
         return;
@@ -290,7 +301,7 @@ void PathMachine::syncing(const SigParseEvent &sigParseEvent)
     {
         Syncing sync(params, paths, &signaler);
         if (event.getNumSkipped() <= params.maxSkipped) {
-            emit sig_lookingForRooms(sync, sigParseEvent);
+            m_mapData.lookingForRooms(sync, sigParseEvent);
         }
         paths = sync.evaluate();
     }
@@ -321,7 +332,7 @@ void PathMachine::experimenting(const SigParseEvent &sigParseEvent)
                 pathEnds.insert(working);
             }
         }
-        emit sig_lookingForRooms(*exp, sigParseEvent);
+        m_mapData.lookingForRooms(*exp, sigParseEvent);
     } else {
         auto pOneByOne = std::make_unique<OneByOne>(sigParseEvent, params, &signaler);
         {
@@ -351,10 +362,10 @@ void PathMachine::evaluatePaths()
         else
             clearMostLikelyRoom();
 
-        if (++paths->begin() == paths->end()) {
+        if (paths->size() == 1) {
             state = PathStateEnum::APPROVED;
             paths->front()->approve();
-            paths->pop_front();
+            paths->erase(paths->begin());
         } else {
             state = PathStateEnum::EXPERIMENTING;
         }
@@ -8,6 +8,7 @@
 #include <list>
 #include <memory>
 #include <optional>
+#include <vector>
 #include <QString>
 #include <QtCore>
 
@@ -45,9 +46,6 @@ public slots:
     void slot_scheduleAction(const std::shared_ptr<MapAction> &action) { scheduleAction(action); }
 
 signals:
-    void sig_lookingForRooms(RoomRecipient &, const SigParseEvent &);
-    void sig_lookingForRooms(RoomRecipient &, RoomId);
-    void sig_lookingForRooms(RoomRecipient &, const Coordinate &);
     void sig_playerMoved(const Coordinate &);
     void sig_createRoom(const SigParseEvent &, const Coordinate &);
     void sig_scheduleAction(std::shared_ptr<MapAction>);
@@ -71,8 +69,8 @@ public slots:
     void approved(const SigParseEvent &sigParseEvent);
     void evaluatePaths();
     void tryExits(const Room *, RoomRecipient &, const ParseEvent &, bool out);
-    void tryExit(const Exit &possible, RoomRecipient &recipient, bool out);
     void tryCoordinate(const Room *, RoomRecipient &, const ParseEvent &);
+    static void collectExit(const Exit &possible, std::vector<RoomId> &ids, bool out);
 
     RoomSignalHandler signaler;
     /* REVISIT: pathRoot and mostLikelyRoom should probably be of type RoomId */
@@ -80,6 +78,11 @@ public slots:
     PathStateEnum state = PathStateEnum::SYNCING;
     std::shared_ptr<PathList> paths;
 
+private:
+    // Reused candidate buffers for the batched MapFrontend lookups.
+    std::vector<RoomId> m_idBatch;
+    std::vector<Coordinate> m_coordinateBatch;
+
 private:
     std::optional<Coordinate> m_pathRootPos;
     std::optional<Coordinate> m_mostLikelyRoomPos;
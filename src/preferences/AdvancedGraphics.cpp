@@ -6,8 +6,10 @@
 #include <cassert>
 #include <memory>
 #include <QCheckBox>
+#include <QFileDialog>
 #include <QHBoxLayout>
 #include <QLabel>
+#include <QMessageBox>
 #include <QPushButton>
 #include <QSlider>
 #include <QSpinBox>
@@ -17,6 +19,7 @@
 
 #include "../configuration/configuration.h"
 #include "../display/MapCanvasConfig.h"
+#include "../display/mapcanvas.h"
 #include "../global/FixedPoint.h"
 #include "../global/RuleOf5.h"
 #include "../global/SignalBlocker.h"
@@ -181,7 +184,15 @@ AdvancedGraphicsGroupBox::AdvancedGraphicsGroupBox(QGroupBox &groupBox)
 
     auto *const checkboxDiag = new QCheckBox("Show Performance Stats");
     checkboxDiag->setChecked(MapCanvasConfig::getShowPerfStats());
-    vertical->addWidget(checkboxDiag);
+    auto *const exportDiag = new QPushButton("Export...");
+    exportDiag->setToolTip("Save the frame times recorded while the stats were shown");
+    {
+        auto *const diagLayout = new QHBoxLayout;
+        diagLayout->addWidget(checkboxDiag);
+        diagLayout->addStretch();
+        diagLayout->addWidget(exportDiag);
+        vertical->addLayout(diagLayout);
+    }
 
     auto *const checkbox3d = new QCheckBox("3d Mode");
     const bool is3dAtInit = MapCanvasConfig::isIn3dMode();
@@ -226,6 +237,8 @@ AdvancedGraphicsGroupBox::AdvancedGraphicsGroupBox(QGroupBox &groupBox)
         graphicsSettingsChanged();
     });
 
+    connect(exportDiag, &QPushButton::clicked, this, [this]() { exportPerfStats(); });
+
     m_connections = MapCanvasConfig::registerChangeCallback(
         [this, checkboxDiag, checkbox3d, autoTilt]() -> void {
             SignalBlocker sb1{*checkboxDiag};
@@ -242,6 +255,31 @@ AdvancedGraphicsGroupBox::AdvancedGraphicsGroupBox(QGroupBox &groupBox)
 
 AdvancedGraphicsGroupBox::~AdvancedGraphicsGroupBox() = default;
 
+void AdvancedGraphicsGroupBox::exportPerfStats()
+{
+    const QString title = "Export Performance Stats";
+    const MapCanvas *const canvas = MapCanvas::getPrimary();
+    if (canvas == nullptr || !canvas->getFrameProfiler().hasEvents()) {
+        QMessageBox::information(m_groupBox,
+                                 title,
+                                 "Nothing has been recorded yet. Check \"Show Performance Stats\" "
+                                 "and use the map for a while first.");
+        return;
+    }
+
+    const QString fileName = QFileDialog::getSaveFileName(m_groupBox,
+                                                          title,
+                                                          "mmapper-perf.json",
+                                                          "Chrome trace (*.json);;CSV (*.csv)");
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    if (!canvas->exportFrameProfile(fileName)) {
+        QMessageBox::warning(m_groupBox, title, QString("Unable to write \"%1\".").arg(fileName));
+    }
+}
+
 void AdvancedGraphicsGroupBox::enableSsbs(bool enabled)
 {
     for (auto &ssb : m_ssbs) {
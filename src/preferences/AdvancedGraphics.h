@@ -41,4 +41,5 @@ class AdvancedGraphicsGroupBox final : public QObject
 private:
     void graphicsSettingsChanged() { emit sig_graphicsSettingsChanged(); }
     void enableSsbs(bool enabled);
+    void exportPerfStats();
 };
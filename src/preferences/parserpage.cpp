@@ -97,7 +97,7 @@ void ParserPage::slot_loadConfig()
     suppressXmlTagsCheckBox->setEnabled(true);
 
     endDescPatternsList->clear();
-    endDescPatternsList->addItems(settings.noDescriptionPatternsList);
+    endDescPatternsList->addItems(settings.getNoDescriptionPatternsList());
 }
 
 void ParserPage::slot_roomNameColorClicked()
@@ -132,7 +132,7 @@ void ParserPage::savePatterns()
     };
 
     auto &settings = setConfig().parser;
-    settings.noDescriptionPatternsList = save(endDescPatternsList);
+    settings.setNoDescriptionPatternsList(save(endDescPatternsList));
 }
 
 void ParserPage::slot_removeEndDescPatternClicked()
@@ -16,6 +16,7 @@
 #include "../configuration/configuration.h"
 #include "../global/TextUtils.h"
 #include "../global/utils.h"
+#include "TelnetScanner.h"
 #include "TextCodec.h"
 
 NODISCARD static QString telnetCommandName(uint8_t cmd)
@@ -751,7 +752,12 @@ void AbstractTelnet::onReadInternal(const QByteArray &data)
             continue;
         }
 
-        // Process character by character
+        // Copy plaintext in bulk
+        pos += onReadInternalPlain(cleanData, data.data() + pos, data.size() - pos);
+        if (pos == data.size())
+            break;
+
+        // Process telnet commands character by character
         const uint8_t c = static_cast<unsigned char>(data.at(pos));
         onReadInternal2(cleanData, c);
         pos++;
@@ -916,6 +922,35 @@ void AbstractTelnet::onReadInternal2(AppendBuffer &cleanData, const uint8_t c)
     }
 }
 
+int AbstractTelnet::onReadInternalPlain(AppendBuffer &cleanData,
+                                        const char *const data,
+                                        const int length)
+{
+    // Only plaintext and subnegotiation payload can be copied without looking
+    // at each byte; everything else is up to the state machine.
+    AppendBuffer *target = nullptr;
+    switch (state) {
+    case TelnetStateEnum::NORMAL:
+        target = &cleanData;
+        break;
+    case TelnetStateEnum::SUBNEG:
+        target = &subnegBuffer;
+        break;
+    case TelnetStateEnum::IAC:
+    case TelnetStateEnum::COMMAND:
+    case TelnetStateEnum::SUBNEG_IAC:
+    case TelnetStateEnum::SUBNEG_COMMAND:
+        return 0;
+    }
+
+    const char *const end = telnet_scanner::findIac(data, data + length);
+    const auto count = static_cast<int>(end - data);
+    if (count > 0) {
+        deref(target).append(data, count);
+    }
+    return count;
+}
+
 int AbstractTelnet::onReadInternalInflate(const char *data,
                                           const int length,
                                           AppendBuffer &cleanData)
@@ -953,9 +988,14 @@ int AbstractTelnet::onReadInternalInflate(const char *data,
         }
 
         const int outLen = CHUNK - static_cast<int>(stream.avail_out);
-        for (auto i = 0; i < outLen; i++) {
-            // Process character by character
-            const uint8_t c = static_cast<unsigned char>(out[i]);
+        for (auto i = 0; i < outLen;) {
+            // Copy plaintext in bulk
+            i += onReadInternalPlain(cleanData, out + i, outLen - i);
+            if (i == outLen)
+                break;
+
+            // Process telnet commands character by character
+            const uint8_t c = static_cast<unsigned char>(out[i++]);
             onReadInternal2(cleanData, c);
 
             if (recvdGA) {
@@ -80,6 +80,7 @@ struct NODISCARD AppendBuffer : public QByteArray
     using QByteArray::operator=;
 
     void append(const uint8_t c) { QByteArray::append(static_cast<char>(c)); }
+    void append(const char *const data, const int len) { QByteArray::append(data, len); }
     void operator+=(const uint8_t c) { QByteArray::operator+=(static_cast<char>(c)); }
 
     NODISCARD unsigned char unsigned_at(int pos) const
@@ -197,6 +198,10 @@ class AbstractTelnet : public QObject
 private:
     void onReadInternal2(AppendBuffer &, uint8_t);
 
+    /** copies plaintext (or subnegotiation payload) up to the next IAC;
+     * returns the number of bytes consumed */
+    NODISCARD int onReadInternalPlain(AppendBuffer &, const char *, int);
+
     /** processes a telnet command (IAC ...) */
     void processTelnetCommand(const AppendBuffer &command);
 
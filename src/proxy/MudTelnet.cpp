@@ -55,6 +55,7 @@ void MudTelnet::slot_onDisconnected()
 
 void MudTelnet::slot_onAnalyzeMudStream(const QByteArray &data)
 {
+    PipelineTimer timer{m_stats, data.size()};
     onReadInternal(data);
 }
 
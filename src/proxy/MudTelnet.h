@@ -8,6 +8,8 @@
 #include <QByteArray>
 #include <QObject>
 
+#include "PipelineStats.h"
+
 class MudTelnet final : public AbstractTelnet
 {
     Q_OBJECT
@@ -15,11 +17,15 @@ class MudTelnet final : public AbstractTelnet
     /** modules for GMCP */
     GmcpModuleSet gmcp;
     bool receivedExternalDiscordHello = false;
+    PipelineStats m_stats;
 
 public:
     explicit MudTelnet(QObject *parent);
     ~MudTelnet() final = default;
 
+public:
+    NODISCARD const PipelineStats &getStats() const { return m_stats; }
+
 public slots:
     void slot_onAnalyzeMudStream(const QByteArray &);
     void slot_onSendToMud(const QByteArray &);
@@ -0,0 +1,63 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2023 The MMapper Authors
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <QString>
+
+#include "../global/RuleOf5.h"
+#include "../global/macros.h"
+
+/// Bytes and time spent in one stage of the MUD data path.
+///
+/// The stages are connected directly, so a stage's time includes the time
+/// spent in the stages it feeds.
+struct NODISCARD PipelineStats final
+{
+    using Clock = std::chrono::steady_clock;
+
+    uint64_t calls = 0;
+    uint64_t bytes = 0;
+    Clock::duration total{};
+    Clock::duration worst{};
+
+    void record(const int64_t numBytes, const Clock::duration elapsed)
+    {
+        ++calls;
+        bytes += static_cast<uint64_t>(std::max<int64_t>(numBytes, 0));
+        total += elapsed;
+        worst = std::max(worst, elapsed);
+    }
+
+    NODISCARD QString toQString() const
+    {
+        using std::chrono::duration_cast;
+        using std::chrono::microseconds;
+        const auto avg = (calls == 0) ? 0 : duration_cast<microseconds>(total).count() / calls;
+        return QString("%1 bytes in %2 calls, %3 us average, %4 us worst")
+            .arg(bytes)
+            .arg(calls)
+            .arg(avg)
+            .arg(duration_cast<microseconds>(worst).count());
+    }
+};
+
+/// Records the bytes and the time until the end of the scope.
+class NODISCARD PipelineTimer final
+{
+private:
+    PipelineStats &m_stats;
+    const int64_t m_bytes;
+    const PipelineStats::Clock::time_point m_start = PipelineStats::Clock::now();
+
+public:
+    explicit PipelineTimer(PipelineStats &stats, const int64_t bytes)
+        : m_stats{stats}
+        , m_bytes{bytes}
+    {}
+    ~PipelineTimer() { m_stats.record(m_bytes, PipelineStats::Clock::now() - m_start); }
+
+    DELETE_CTORS_AND_ASSIGN_OPS(PipelineTimer);
+};
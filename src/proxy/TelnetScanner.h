@@ -0,0 +1,60 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2023 The MMapper Authors
+
+#include <cstddef>
+#include <cstdint>
+
+#include "../global/macros.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MMAPPER_TELNET_SCAN_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define MMAPPER_TELNET_SCAN_NEON
+#include <arm_neon.h>
+#endif
+
+namespace telnet_scanner {
+
+static constexpr const uint8_t IAC = 255;
+
+NODISCARD static inline const char *findIacScalar(const char *begin, const char *const end)
+{
+    for (; begin != end; ++begin) {
+        if (static_cast<uint8_t>(*begin) == IAC) {
+            break;
+        }
+    }
+    return begin;
+}
+
+/// Returns a pointer to the first IAC (255) byte in [begin, end), or end.
+///
+/// Nearly all MUD output is plaintext, so the scan compares 16 bytes at a time
+/// and only looks at individual bytes in the block that contains a match.
+NODISCARD static inline const char *findIac(const char *begin, const char *const end)
+{
+#if defined(MMAPPER_TELNET_SCAN_SSE2)
+    const __m128i iac = _mm_set1_epi8(static_cast<char>(IAC));
+    while (end - begin >= 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(block, iac)) != 0) {
+            return findIacScalar(begin, begin + 16);
+        }
+        begin += 16;
+    }
+#elif defined(MMAPPER_TELNET_SCAN_NEON)
+    const uint8x16_t iac = vdupq_n_u8(IAC);
+    while (end - begin >= 16) {
+        const uint8x16_t block = vld1q_u8(reinterpret_cast<const uint8_t *>(begin));
+        if (vmaxvq_u8(vceqq_u8(block, iac)) != 0) {
+            return findIacScalar(begin, begin + 16);
+        }
+        begin += 16;
+    }
+#endif
+    return findIacScalar(begin, end);
+}
+
+} // namespace telnet_scanner
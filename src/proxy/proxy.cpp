@@ -390,6 +390,11 @@ void Proxy::slot_mudTerminatedConnection()
     m_userTelnet->slot_onRelayEchoMode(true);
 
     log("Mud terminated connection ...");
+    if (m_mudTelnet && m_telnetFilter && m_parserXml) {
+        log("Telnet: " + m_mudTelnet->getStats().toQString());
+        log("Line filter: " + m_telnetFilter->getMudStats().toQString());
+        log("XML parser: " + m_parserXml->getStats().toQString());
+    }
 
     sendToUser("\n"
                "\033[0;37;46m"
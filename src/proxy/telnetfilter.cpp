@@ -6,6 +6,8 @@
 
 #include "telnetfilter.h"
 
+#include <algorithm>
+#include <cassert>
 #include <QByteArray>
 #include <QObject>
 
@@ -19,13 +21,12 @@ static_assert(ASCII_CR == 13);
 
 void TelnetFilter::slot_onAnalyzeMudStream(const QByteArray &ba, bool goAhead)
 {
+    PipelineTimer timer{m_mudStats, ba.size()};
     dispatchTelnetStream(ba, m_mudIncomingBuffer, m_mudIncomingQue, goAhead);
 
     // parse incoming lines in que
-    TelnetData data;
     while (!m_mudIncomingQue.isEmpty()) {
-        data = m_mudIncomingQue.dequeue();
-        emit sig_parseNewMudInput(data);
+        emit sig_parseNewMudInput(m_mudIncomingQue.dequeue());
     }
 }
 
@@ -34,10 +35,8 @@ void TelnetFilter::slot_onAnalyzeUserStream(const QByteArray &ba, bool goAhead)
     dispatchTelnetStream(ba, m_userIncomingData, m_userIncomingQue, goAhead);
 
     // parse incoming lines in que
-    TelnetData data;
     while (!m_userIncomingQue.isEmpty()) {
-        data = m_userIncomingQue.dequeue();
-        emit sig_parseNewUserInput(data);
+        emit sig_parseNewUserInput(m_userIncomingQue.dequeue());
     }
 }
 
@@ -46,14 +45,37 @@ void TelnetFilter::dispatchTelnetStream(const QByteArray &stream,
                                         TelnetIncomingDataQueue &que,
                                         const bool &goAhead)
 {
-    for (const char c : stream) {
+    const auto enqueue = [&buffer, &que](const TelnetDataEnum type) {
+        buffer.type = type;
+        que.enqueue(buffer);
+        buffer.line.clear();
+        buffer.type = TelnetDataEnum::UNKNOWN;
+    };
+    const auto isSpecial = [](const char c) {
+        return c == ASCII_DEL || c == ASCII_CR || c == ASCII_LF;
+    };
+
+    const char *pos = stream.constData();
+    const char *const end = pos + stream.size();
+    while (pos != end) {
+        // Everything except DEL, CR and LF is appended in runs.
+        const char *const special = std::find_if(pos, end, isSpecial);
+        if (special != pos) {
+            if (!buffer.line.isEmpty() && buffer.line.back() == ASCII_LF) {
+                enqueue(TelnetDataEnum::LF);
+            }
+            buffer.line.append(pos, static_cast<int>(special - pos));
+            pos = special;
+            if (pos == end) {
+                break;
+            }
+        }
+
+        const char c = *pos++;
         switch (c) {
         case ASCII_DEL:
             buffer.line.append(ASCII_DEL);
-            buffer.type = TelnetDataEnum::DELAY;
-            que.enqueue(buffer);
-            buffer.line.clear();
-            buffer.type = TelnetDataEnum::UNKNOWN;
+            enqueue(TelnetDataEnum::DELAY);
             break;
 
         case ASCII_CR:
@@ -61,35 +83,16 @@ void TelnetFilter::dispatchTelnetStream(const QByteArray &stream,
             break;
 
         case ASCII_LF:
-            if (!buffer.line.isEmpty()) {
-                switch (buffer.line.back()) {
-                case ASCII_CR:
-                    buffer.line.append(ASCII_LF);
-                    buffer.type = TelnetDataEnum::CRLF;
-                    que.enqueue(buffer);
-                    buffer.line.clear();
-                    buffer.type = TelnetDataEnum::UNKNOWN;
-                    break;
-
-                default:
-                    buffer.line.append(ASCII_LF);
-                    break;
-                }
+            if (!buffer.line.isEmpty() && buffer.line.back() == ASCII_CR) {
+                buffer.line.append(ASCII_LF);
+                enqueue(TelnetDataEnum::CRLF);
             } else {
                 buffer.line.append(ASCII_LF);
-                break;
             }
             break;
 
         default:
-            if (!buffer.line.isEmpty() && buffer.line.back() == ASCII_LF) {
-                buffer.type = TelnetDataEnum::LF;
-                que.enqueue(buffer);
-                buffer.line.clear();
-                buffer.type = TelnetDataEnum::UNKNOWN;
-            }
-
-            buffer.line.append(c);
+            assert(false);
             break;
         }
     }
@@ -97,15 +100,9 @@ void TelnetFilter::dispatchTelnetStream(const QByteArray &stream,
     if (!buffer.line.isEmpty() && (goAhead || buffer.type == TelnetDataEnum::UNKNOWN)) {
         {
             if (goAhead) {
-                buffer.type = TelnetDataEnum::PROMPT;
-                que.enqueue(buffer);
-                buffer.line.clear();
-                buffer.type = TelnetDataEnum::UNKNOWN;
+                enqueue(TelnetDataEnum::PROMPT);
             } else if (buffer.line.endsWith(ASCII_LF)) {
-                buffer.type = TelnetDataEnum::LF;
-                que.enqueue(buffer);
-                buffer.line.clear();
-                buffer.type = TelnetDataEnum::UNKNOWN;
+                enqueue(TelnetDataEnum::LF);
             }
         }
     }
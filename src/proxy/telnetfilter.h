@@ -13,6 +13,7 @@
 #include <QtCore>
 
 #include "../global/macros.h"
+#include "PipelineStats.h"
 
 enum class NODISCARD TelnetDataEnum : uint8_t { UNKNOWN, PROMPT, CRLF, LF, DELAY };
 
@@ -34,6 +35,9 @@ class TelnetFilter final : public QObject
     {}
     ~TelnetFilter() final = default;
 
+public:
+    NODISCARD const PipelineStats &getMudStats() const { return m_mudStats; }
+
 public slots:
     void slot_onAnalyzeMudStream(const QByteArray &ba, bool goAhead);
     void slot_onAnalyzeUserStream(const QByteArray &ba, bool goAhead);
@@ -52,4 +56,5 @@ public slots:
     TelnetData m_mudIncomingBuffer;
     TelnetIncomingDataQueue m_mudIncomingQue;
     TelnetIncomingDataQueue m_userIncomingQue;
+    PipelineStats m_mudStats;
 };
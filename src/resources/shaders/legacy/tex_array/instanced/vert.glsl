@@ -0,0 +1,21 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2023 The MMapper Authors
+
+uniform mat4 uMVP;
+
+// per vertex: corner of the unit quad
+attribute vec2 aQuad;
+
+// per instance: xyz = offset, w = texture layer
+attribute vec4 aInstance;
+attribute vec4 aColor;
+
+varying vec4 vColor;
+varying vec3 vTexCoord;
+
+void main()
+{
+    vColor = aColor;
+    vTexCoord = vec3(aQuad, aInstance.w);
+    gl_Position = uMVP * vec4(aInstance.xyz + vec3(aQuad, 0.0), 1.0);
+}
@@ -0,0 +1,14 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2023 The MMapper Authors
+
+#extension GL_EXT_texture_array : require
+
+uniform sampler2DArray uTexture;
+uniform vec4 uColor;
+
+varying vec3 vTexCoord;
+
+void main()
+{
+    gl_FragColor = uColor * texture2DArray(uTexture, vTexCoord);
+}
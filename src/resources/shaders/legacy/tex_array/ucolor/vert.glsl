@@ -0,0 +1,15 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2023 The MMapper Authors
+
+uniform mat4 uMVP;
+
+attribute vec3 aTexCoord;
+attribute vec3 aVert;
+
+varying vec3 vTexCoord;
+
+void main()
+{
+    vTexCoord = aTexCoord;
+    gl_Position = uMVP * vec4(aVert, 1.0);
+}
@@ -3,14 +3,19 @@
 
 #include "TestGlobal.h"
 
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 #include <QDebug>
 #include <QtTest/QtTest>
 
 #include "../src/global/AnsiColor.h"
+#include "../src/global/RollingHistogram.h"
 #include "../src/global/StringView.h"
 #include "../src/global/TextUtils.h"
+#include "../src/global/TinyRoomIdSet.h"
 #include "../src/global/string_view_utils.h"
 #include "../src/global/unquote.h"
+#include "../src/opengl/Frustum.h"
 
 TestGlobal::TestGlobal() = default;
 
@@ -69,12 +74,75 @@ void TestGlobal::ansiToRgbTest()
     QCOMPARE(highBlackRgb, QColor("#555753"));
 }
 
+void TestGlobal::rollingHistogramTest()
+{
+    RollingHistogram hist{100};
+    QVERIFY(hist.empty());
+    QCOMPARE(hist.getPercentile(50), 0.0);
+
+    for (int i = 1; i <= 100; ++i) {
+        hist.add(static_cast<double>(i));
+    }
+    QCOMPARE(hist.size(), size_t{100});
+    QCOMPARE(hist.getPercentile(0), 1.0);
+    QCOMPARE(hist.getPercentile(50), 50.0);
+    QCOMPARE(hist.getPercentile(95), 95.0);
+    QCOMPARE(hist.getPercentile(99), 99.0);
+    QCOMPARE(hist.getPercentile(100), 100.0);
+    QCOMPARE(hist.getMean(), 50.5);
+
+    // old samples leave the window, but the worst one is remembered
+    for (int i = 0; i < 100; ++i) {
+        hist.add(1.0);
+    }
+    QCOMPARE(hist.size(), size_t{100});
+    QCOMPARE(hist.getPercentile(99), 1.0);
+    QCOMPARE(hist.getMax(), 100.0);
+
+    hist.clear();
+    QVERIFY(hist.empty());
+    QCOMPARE(hist.getMax(), 0.0);
+}
+
 void TestGlobal::stringViewTest()
 {
     // REVISIT: Test is meaningless during release builds
     test::testStringView();
 }
 
+void TestGlobal::tinyRoomIdSetTest()
+{
+    TinyRoomIdSet set;
+    QVERIFY(set.empty());
+
+    // stays inline
+    set.insert(RoomId{5});
+    set.insert(RoomId{2});
+    set.insert(RoomId{5});
+    QCOMPARE(set.size(), size_t{2});
+    QCOMPARE(set.first(), RoomId{2});
+    QVERIFY(set.contains(RoomId{5}));
+    QVERIFY(!set.contains(RoomId{3}));
+
+    // spills to the heap and stays sorted
+    for (uint32_t i = 10; i > 6; --i) {
+        set.insert(RoomId{i});
+    }
+    QCOMPARE(set.size(), size_t{6});
+    QVERIFY(std::is_sorted(set.begin(), set.end()));
+
+    TinyRoomIdSet copy = set;
+    QVERIFY(copy == set);
+    copy.erase(RoomId{2});
+    copy.erase(RoomId{42});
+    QVERIFY(copy != set);
+    QCOMPARE(copy.first(), RoomId{5});
+
+    TinyRoomIdSet moved = std::move(copy);
+    QCOMPARE(moved.size(), size_t{5});
+    QVERIFY(copy.empty()); // NOLINT (use after move is intentional)
+}
+
 void TestGlobal::unquoteTest()
 {
     // REVISIT: Test is meaningless during release builds
@@ -122,4 +190,35 @@ void TestGlobal::to_numberTest()
     QCOMPARE(ok, false);
 }
 
+void TestGlobal::frustumTest()
+{
+    const float width = 256.f;
+    const float height = 128.f;
+    const Frustum ortho{glm::ortho(0.f, width, 0.f, height, -1.f, 1.f)};
+    QVERIFY(ortho.intersects(glm::vec3{1.f, 1.f, 0.f}, glm::vec3{2.f, 2.f, 0.f}));
+    // straddling an edge, or covering the whole view
+    QVERIFY(ortho.intersects(glm::vec3{-1.f, 1.f, 0.f}, glm::vec3{1.f, 2.f, 0.f}));
+    QVERIFY(
+        ortho.intersects(glm::vec3{-1.f, -1.f, -2.f}, glm::vec3{width + 1.f, height + 1.f, 2.f}));
+    // left, right, below, above, and outside the depth range
+    QVERIFY(!ortho.intersects(glm::vec3{-3.f, 1.f, 0.f}, glm::vec3{-2.f, 2.f, 0.f}));
+    QVERIFY(!ortho.intersects(glm::vec3{width + 1.f, 1.f, 0.f}, glm::vec3{width + 2.f, 2.f, 0.f}));
+    QVERIFY(!ortho.intersects(glm::vec3{1.f, -3.f, 0.f}, glm::vec3{2.f, -2.f, 0.f}));
+    QVERIFY(
+        !ortho.intersects(glm::vec3{1.f, height + 1.f, 0.f}, glm::vec3{2.f, height + 2.f, 0.f}));
+    QVERIFY(!ortho.intersects(glm::vec3{1.f, 1.f, 2.f}, glm::vec3{2.f, 2.f, 3.f}));
+
+    // Tilted like the 3D map: looking north and down at the origin.
+    const glm::mat4 proj = glm::perspective(glm::radians(45.f), 2.f, 0.25f, 1024.f);
+    const glm::mat4 view = glm::lookAt(glm::vec3{0.f, -20.f, 20.f},
+                                       glm::vec3{0.f},
+                                       glm::vec3{0.f, 0.f, 1.f});
+    const Frustum tilted{proj * view};
+    QVERIFY(tilted.intersects(glm::vec3{-1.f, -1.f, 0.f}, glm::vec3{1.f, 1.f, 0.f}));
+    // further north is still in view, but nothing behind or beside the camera is
+    QVERIFY(tilted.intersects(glm::vec3{-1.f, 8.f, 0.f}, glm::vec3{1.f, 10.f, 0.f}));
+    QVERIFY(!tilted.intersects(glm::vec3{-1.f, -60.f, 0.f}, glm::vec3{1.f, -58.f, 0.f}));
+    QVERIFY(!tilted.intersects(glm::vec3{200.f, -1.f, 0.f}, glm::vec3{202.f, 1.f, 0.f}));
+}
+
 QTEST_MAIN(TestGlobal)
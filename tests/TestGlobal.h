@@ -14,8 +14,11 @@ class TestGlobal final : public QObject
 private Q_SLOTS:
     void ansi256ColorTest();
     void ansiToRgbTest();
+    void rollingHistogramTest();
     void stringViewTest();
+    void tinyRoomIdSetTest();
     void unquoteTest();
     void toLowerLatin1Test();
     void to_numberTest();
+    void frustumTest();
 };
@@ -3,10 +3,13 @@
 
 #include "TestMainWindow.h"
 
+#include <future>
+#include <vector>
 #include <QDebug>
 #include <QtTest/QtTest>
 
 #include "../src/global/Version.h"
+#include "../src/mainwindow/BackgroundTask.h"
 #include "../src/mainwindow/UpdateDialog.h"
 
 const char *getMMapperVersion()
@@ -49,4 +52,50 @@ void TestMainWindow::updaterTest()
     QVERIFY2((current > newerPatch) == false, "Older version is not newer than newer patch version");
 }
 
+void TestMainWindow::backgroundSaveTest()
+{
+    // Mirrors MainWindow::saveFileInBackground(): each save queues a completion event,
+    // and starting the next save first waits for the previous one.
+    BackgroundTask<double> saves;
+    std::vector<double> finished;
+    QObject context;
+    const auto notify = [&saves, &finished, &context](const uint64_t generation) {
+        QMetaObject::invokeMethod(
+            &context,
+            [&saves, &finished, generation]() {
+                if (saves.isCurrent(generation)) {
+                    finished.push_back(saves.take());
+                }
+            },
+            Qt::QueuedConnection);
+    };
+
+    const uint64_t first = saves.start([&notify](const uint64_t generation) {
+        notify(generation);
+        return 1.0;
+    });
+    // The second save takes the first one before its queued event is handled.
+    saves.wait();
+    QCOMPARE(saves.take(), 1.0);
+
+    std::promise<void> release;
+    const std::shared_future<void> released = release.get_future().share();
+    const uint64_t second = saves.start([&notify, released](const uint64_t generation) {
+        released.wait();
+        notify(generation);
+        return 2.0;
+    });
+
+    // The stale event of the first save must neither block on the second save nor take it.
+    QCoreApplication::processEvents();
+    const bool staleIgnored = finished.empty() && saves.isPending();
+    release.set_value();
+    QVERIFY(first != second);
+    QVERIFY(staleIgnored);
+
+    QTRY_COMPARE(finished.size(), static_cast<size_t>(1));
+    QCOMPARE(finished.front(), 2.0);
+    QVERIFY(!saves.isPending());
+}
+
 QTEST_MAIN(TestMainWindow)
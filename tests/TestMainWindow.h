@@ -14,4 +14,5 @@ class TestMainWindow final : public QObject
 private:
 private Q_SLOTS:
     void updaterTest();
+    void backgroundSaveTest();
 };
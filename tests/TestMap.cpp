@@ -0,0 +1,1206 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2023 The MMapper Authors
+
+#include "TestMap.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <QBuffer>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QTemporaryFile>
+#include <QtTest/QtTest>
+
+#include "../src/configuration/configuration.h"
+#include "../src/display/MapCanvasRoomDrawer.h"
+#include "../src/expandoracommon/exit.h"
+#include "../src/expandoracommon/parseevent.h"
+#include "../src/expandoracommon/room.h"
+#include "../src/global/Color.h"
+#include "../src/mapdata/ExitDirection.h"
+#include "../src/mapdata/ExitFlags.h"
+#include "../src/mapdata/infomark.h"
+#include "../src/mapdata/mapdata.h"
+#include "../src/mapdata/roomfilter.h"
+#include "../src/mapdata/roomselection.h"
+#include "../src/mapdata/shortestpath.h"
+#include "../src/mapfrontend/AbstractRoomVisitor.h"
+#include "../src/mapfrontend/ParseTree.h"
+#include "../src/mapfrontend/map.h"
+#include "../src/mapfrontend/roomcollection.h"
+#include "../src/mapstorage/FlatMapStorage.h"
+#include "../src/mapstorage/StorageUtils.h"
+#include "../src/mapstorage/XmlMapStorage.h"
+#include "../src/mapstorage/jsonmapstorage.h"
+#include "../src/mapstorage/mapstorage.h"
+#include "../src/parser/CommandId.h"
+#include "../src/pathmachine/mmapper2pathmachine.h"
+
+namespace { // anonymous
+
+constexpr int MAP_WIDTH = 100;
+constexpr int MAP_HEIGHT = 100;
+constexpr int NUM_MOVES = 2000;
+
+NODISCARD RoomId getGridRoomId(const int x, const int y)
+{
+    return RoomId{static_cast<uint32_t>(y * MAP_WIDTH + x)};
+}
+
+NODISCARD bool isOnGrid(const Coordinate &c)
+{
+    return c.x >= 0 && c.x < MAP_WIDTH && c.y >= 0 && c.y < MAP_HEIGHT && c.z == 0;
+}
+
+// A MAP_WIDTH x MAP_HEIGHT grid of rooms with two-way exits between neighbors.
+//
+// Like long roads and forests, rooms repeat one of `variants` names and descriptions,
+// chosen so the 4 neighbors of a room never share its name when there are at least 5.
+// The room in the middle is unique, so the path machine can sync there.
+// With mixed terrain, the travel costs vary from room to room.
+void createGridMap(MapData &mapData, const int variants, const bool mixedTerrain = false)
+{
+    static constexpr const RoomTerrainEnum terrains[] = {RoomTerrainEnum::FOREST,
+                                                         RoomTerrainEnum::ROAD,
+                                                         RoomTerrainEnum::HILLS,
+                                                         RoomTerrainEnum::FIELD,
+                                                         RoomTerrainEnum::WATER};
+
+    std::vector<SharedRoom> rooms;
+    rooms.reserve(MAP_WIDTH * MAP_HEIGHT);
+    for (int y = 0; y < MAP_HEIGHT; ++y) {
+        for (int x = 0; x < MAP_WIDTH; ++x) {
+            const Coordinate pos{x, y, 0};
+            const bool isCenter = x == MAP_WIDTH / 2 && y == MAP_HEIGHT / 2;
+            const std::string variant = std::to_string((x + 2 * y) % variants);
+
+            SharedRoom room = Room::createPermanentRoom(mapData);
+            room->setId(getGridRoomId(x, y));
+            room->setPosition(pos);
+            room->setName(RoomName{isCenter ? std::string{"Crossroads"} : "Forest " + variant});
+            room->setDescription(RoomDesc{"Tall trees surround you. (" + variant + ")\n"});
+            room->setTerrainType(mixedTerrain ? terrains[(x * 7 + y * 13) % 5]
+                                              : RoomTerrainEnum::FOREST);
+
+            ExitsList exits;
+            for (const ExitDirEnum dir : ALL_EXITS_NESW) {
+                const Coordinate to = pos + Room::exitDir(dir);
+                if (!isOnGrid(to)) {
+                    continue;
+                }
+                Exit &exit = exits[dir];
+                exit.setExitFlags(ExitFlags{ExitFlagEnum::EXIT});
+                exit.addIn(getGridRoomId(to.x, to.y));
+                exit.addOut(getGridRoomId(to.x, to.y));
+            }
+            room->setExitsList(exits);
+            room->setUpToDate();
+            rooms.emplace_back(std::move(room));
+        }
+    }
+    mapData.insertPredefinedRooms(rooms);
+    mapData.checkSize();
+}
+
+NODISCARD SigParseEvent createEvent(const Room &room, const CommandEnum move)
+{
+    const SharedParseEvent look = Room::getEvent(&room);
+    return SigParseEvent{ParseEvent::createEvent(move,
+                                                 room.getName(),
+                                                 room.getDescription(),
+                                                 room.getContents(),
+                                                 room.getTerrainType(),
+                                                 look->getExitsFlags(),
+                                                 PromptFlagsType{},
+                                                 ConnectedRoomFlagsType{})};
+}
+
+struct NODISCARD Replay final
+{
+    std::vector<SigParseEvent> events;
+    RoomId end = INVALID_ROOMID;
+};
+
+// What the parser would send for a random walk from the middle of the grid.
+// Every `fleeEvery`th move is a flee, which doesn't say which way the player went.
+// With `endAtCenter`, the walk finishes by heading straight back to the unique middle room.
+NODISCARD Replay createReplay(MapData &mapData, const int fleeEvery, const bool endAtCenter = false)
+{
+    std::mt19937 rng{42};
+    Replay replay;
+    Coordinate pos{MAP_WIDTH / 2, MAP_HEIGHT / 2, 0};
+    replay.events.emplace_back(createEvent(deref(mapData.getRoom(pos)), CommandEnum::LOOK));
+
+    for (int i = 1; i <= NUM_MOVES; ++i) {
+        ExitDirEnum dir = ExitDirEnum::NONE;
+        do {
+            dir = ALL_EXITS_NESW[std::uniform_int_distribution<size_t>{0, 3}(rng)];
+        } while (!isOnGrid(pos + Room::exitDir(dir)));
+        pos = pos + Room::exitDir(dir);
+
+        const CommandEnum move = (i % fleeEvery == 0) ? CommandEnum::FLEE : getCommand(dir);
+        replay.events.emplace_back(createEvent(deref(mapData.getRoom(pos)), move));
+    }
+    if (endAtCenter) {
+        const Coordinate center{MAP_WIDTH / 2, MAP_HEIGHT / 2, 0};
+        while (pos != center) {
+            const ExitDirEnum dir = (pos.x < center.x)   ? ExitDirEnum::EAST
+                                    : (pos.x > center.x) ? ExitDirEnum::WEST
+                                    : (pos.y < center.y) ? ExitDirEnum::NORTH
+                                                         : ExitDirEnum::SOUTH;
+            pos = pos + Room::exitDir(dir);
+            replay.events.emplace_back(createEvent(deref(mapData.getRoom(pos)), getCommand(dir)));
+        }
+    }
+    replay.end = getGridRoomId(pos.x, pos.y);
+    return replay;
+}
+
+// Replays the events into a new path machine, and returns where it put the player.
+NODISCARD RoomId runReplay(MapData &mapData, const Replay &replay)
+{
+    RoomId where = INVALID_ROOMID;
+    Mmapper2PathMachine pathMachine{&mapData, nullptr};
+    QObject::connect(&pathMachine,
+                     &PathMachine::sig_setCharPosition,
+                     [&where](const RoomId id) { where = id; });
+    for (const SigParseEvent &event : replay.events) {
+        pathMachine.slot_handleParseEvent(event);
+    }
+    return where;
+}
+
+class NODISCARD PositionRecorder final : public AbstractRoomVisitor
+{
+public:
+    std::vector<Coordinate> positions;
+
+private:
+    void visit(const Room *const room) final { positions.emplace_back(room->getPosition()); }
+};
+
+class NODISCARD RoomRecorder final : public AbstractRoomVisitor
+{
+public:
+    std::vector<const Room *> rooms;
+
+private:
+    void visit(const Room *const room) final { rooms.emplace_back(room); }
+};
+
+class NODISCARD DistanceRecorder final : public ShortestPathRecipient
+{
+public:
+    std::unordered_map<RoomId, double> distances;
+
+private:
+    void virt_receiveShortestPath(RoomAdmin * /*admin*/,
+                                  const std::vector<SPNode> &spnodes,
+                                  const int endpoint) final
+    {
+        const SPNode &node = spnodes.at(static_cast<size_t>(endpoint));
+        distances[node.r->getId()] = node.dist;
+    }
+};
+
+enum class NODISCARD MapFormatEnum { MM2, MM2F, MM2XML };
+
+NODISCARD std::unique_ptr<AbstractMapStorage> createStorage(MapData &mapData,
+                                                            QFile &file,
+                                                            const MapFormatEnum format,
+                                                            const uint32_t maxWorkers = 0)
+{
+    if (format == MapFormatEnum::MM2F) {
+        return std::make_unique<FlatMapStorage>(mapData, file.fileName(), &file, nullptr);
+    }
+    if (format == MapFormatEnum::MM2XML) {
+        auto storage = std::make_unique<XmlMapStorage>(mapData, file.fileName(), &file, nullptr);
+        storage->setMaxWorkers(maxWorkers);
+        return storage;
+    }
+    auto storage = std::make_unique<MapStorage>(mapData, file.fileName(), &file, nullptr);
+    storage->setMaxWorkers(maxWorkers);
+    return storage;
+}
+
+NODISCARD bool saveMap(MapData &mapData,
+                       QTemporaryFile &file,
+                       const MapFormatEnum format = MapFormatEnum::MM2)
+{
+    if (!file.open()) {
+        return false;
+    }
+    const bool saved = createStorage(mapData, file, format)->saveData(false);
+    file.close();
+    return saved;
+}
+
+// Not every storage closes the file when it's done.
+NODISCARD bool loadMap(MapData &mapData,
+                       QTemporaryFile &file,
+                       const MapFormatEnum format = MapFormatEnum::MM2,
+                       const uint32_t maxWorkers = 0)
+{
+    const bool loaded = file.open()
+                        && createStorage(mapData, file, format, maxWorkers)->loadData();
+    file.close();
+    return loaded;
+}
+
+NODISCARD bool mergeMap(MapData &mapData, QTemporaryFile &file, const MapFormatEnum format)
+{
+    return file.open() && createStorage(mapData, file, format)->mergeData();
+}
+
+NODISCARD bool isSameRoom(const Room &a, const Room &b)
+{
+#define X_COMPARE(_Type, _Prop, _OptInit) \
+    if (!(a.get##_Prop() == b.get##_Prop())) { \
+        return false; \
+    }
+    XFOREACH_ROOM_PROPERTY(X_COMPARE)
+#undef X_COMPARE
+    return a.getId() == b.getId() && a.getPosition() == b.getPosition()
+           && a.getExitsList() == b.getExitsList();
+}
+
+// Compares every room and exit; returns the number of rooms compared, or -1 on a mismatch.
+NODISCARD int compareMaps(MapData &a, MapData &b)
+{
+    const RoomFilter everyRoom{".*", Qt::CaseInsensitive, true, PatternKindsEnum::NAME};
+    auto roomsA = RoomSelection(a);
+    auto roomsB = RoomSelection(b);
+    roomsA.genericSearch(everyRoom);
+    roomsB.genericSearch(everyRoom);
+    if (roomsA.size() != roomsB.size()) {
+        return -1;
+    }
+    for (const auto &[id, room] : roomsA) {
+        const auto it = roomsB.find(id);
+        if (it == roomsB.end() || !isSameRoom(deref(room), deref(it->second))) {
+            return -1;
+        }
+    }
+    return static_cast<int>(roomsA.size());
+}
+
+// The web export splits the map in 20x20 room zones. This puts 4 rooms in each of
+// 8x8 zones; the rooms of the last zone get the highest ids, so leaving that zone
+// out doesn't renumber any other room.
+constexpr int JSON_ZONES = 8;
+constexpr int JSON_ZONE_WIDTH = 20;
+
+void createZonedMap(MapData &mapData,
+                    const bool withLastZone = true,
+                    const std::optional<RoomId> changed = std::nullopt)
+{
+    std::vector<SharedRoom> rooms;
+    uint32_t id = 0;
+    for (int zx = 0; zx < JSON_ZONES; ++zx) {
+        for (int zy = 0; zy < JSON_ZONES; ++zy) {
+            if (!withLastZone && zx == JSON_ZONES - 1 && zy == JSON_ZONES - 1) {
+                continue;
+            }
+            for (int i = 0; i < 4; ++i) {
+                SharedRoom room = Room::createPermanentRoom(mapData);
+                room->setId(RoomId{id});
+                room->setPosition(Coordinate{zx * JSON_ZONE_WIDTH + (i % 2) * 5,
+                                             -(zy * JSON_ZONE_WIDTH + (i / 2) * 5),
+                                             0});
+                room->setName(RoomName{"Room " + std::to_string(id)});
+                room->setDescription(RoomDesc{"Zone " + std::to_string(zx) + ","
+                                              + std::to_string(zy) + "\n"});
+                room->setTerrainType(room->getId() == changed ? RoomTerrainEnum::CITY
+                                                              : RoomTerrainEnum::FIELD);
+                room->setUpToDate();
+                rooms.emplace_back(std::move(room));
+                ++id;
+            }
+        }
+    }
+    mapData.insertPredefinedRooms(rooms);
+    mapData.checkSize();
+}
+
+NODISCARD bool exportJson(MapData &mapData, const QString &dirName, const uint32_t maxWorkers = 0)
+{
+    JsonMapStorage storage{mapData, dirName, nullptr};
+    storage.setMaxWorkers(maxWorkers);
+    return static_cast<AbstractMapStorage &>(storage).saveData(false);
+}
+
+// Relative path -> contents of every file below dir.
+NODISCARD std::map<QString, QByteArray> readFiles(const QDir &dir)
+{
+    std::map<QString, QByteArray> files;
+    QDirIterator it{dir.path(), QDir::Files, QDirIterator::Subdirectories};
+    while (it.hasNext()) {
+        QFile file{it.next()};
+        if (file.open(QIODevice::ReadOnly)) {
+            files.emplace(dir.relativeFilePath(file.fileName()), file.readAll());
+        }
+    }
+    return files;
+}
+
+// Backdates every file below dir, so that the files a later export writes stand out.
+const QDateTime LONG_AGO{QDate{2000, 1, 1}, QTime{0, 0}, Qt::UTC};
+
+NODISCARD bool backdateFiles(const QDir &dir)
+{
+    QDirIterator it{dir.path(), QDir::Files, QDirIterator::Subdirectories};
+    while (it.hasNext()) {
+        QFile file{it.next()};
+        if (!file.open(QIODevice::ReadWrite)
+            || !file.setFileTime(LONG_AGO, QFileDevice::FileModificationTime)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+NODISCARD QStringList getWrittenFiles(const QDir &dir)
+{
+    QStringList written;
+    QDirIterator it{dir.path(), QDir::Files, QDirIterator::Subdirectories};
+    while (it.hasNext()) {
+        const QFileInfo info{it.next()};
+        if (info.lastModified() != LONG_AGO) {
+            written.append(dir.relativeFilePath(info.filePath()));
+        }
+    }
+    written.sort();
+    return written;
+}
+
+} // namespace
+
+Q_DECLARE_METATYPE(MapFormatEnum)
+
+TestMap::TestMap() = default;
+
+TestMap::~TestMap() = default;
+
+void TestMap::initTestCase()
+{
+    // don't read or overwrite the user's settings
+    QStandardPaths::setTestModeEnabled(true);
+    setEnteredMain();
+}
+
+void TestMap::mapGridTest()
+{
+    // On both sides of the 16 room chunk boundaries, including negative coordinates.
+    const std::vector<int> xs{-33, -17, -16, -1, 0, 1, 15, 16, 31, 32};
+    const std::vector<int> ys{-16, -1, 0, 15, 16};
+    const std::vector<int> zs{-1, 0, 2};
+
+    // The old std::map grid visited the rooms by z, then y, then x.
+    std::vector<Coordinate> ordered;
+    for (const int z : zs) {
+        for (const int y : ys) {
+            for (const int x : xs) {
+                ordered.emplace_back(x, y, z);
+            }
+        }
+    }
+    std::vector<Coordinate> shuffled = ordered;
+    std::mt19937 rng{5};
+    std::shuffle(shuffled.begin(), shuffled.end(), rng);
+
+    MapData mapData{nullptr};
+    Map map;
+    std::vector<SharedRoom> rooms;
+    for (const Coordinate &c : shuffled) {
+        SharedRoom room = Room::createPermanentRoom(mapData);
+        map.setNearest(c, deref(room));
+        QCOMPARE(room->getPosition(), c);
+        rooms.emplace_back(std::move(room));
+    }
+    for (const SharedRoom &room : rooms) {
+        QCOMPARE(map.get(room->getPosition()), room.get());
+    }
+    QVERIFY(map.get(Coordinate{-2, 0, 0}) == nullptr);
+    QVERIFY(map.get(Coordinate{0, -17, 0}) == nullptr);
+    QVERIFY(map.get(Coordinate{0, 0, 1}) == nullptr);
+
+    const auto visitAll = [&map]() {
+        PositionRecorder recorder;
+        map.getRooms(recorder);
+        return recorder.positions;
+    };
+    const auto visitRange = [&map](const Coordinate &min, const Coordinate &max) {
+        PositionRecorder recorder;
+        map.getRooms(recorder, min, max);
+        return recorder.positions;
+    };
+    const auto filter = [](const std::vector<Coordinate> &in, const auto &pred) {
+        std::vector<Coordinate> out;
+        std::copy_if(in.begin(), in.end(), std::back_inserter(out), pred);
+        return out;
+    };
+
+    QCOMPARE(visitAll(), ordered);
+    const Coordinate min{-17, -1, 0};
+    const Coordinate max{16, 15, 2};
+    const auto inRange = filter(ordered, [&min, &max](const Coordinate &c) {
+        return min.x <= c.x && c.x <= max.x && min.y <= c.y && c.y <= max.y && min.z <= c.z
+               && c.z <= max.z;
+    });
+    QCOMPARE(visitRange(min, max), inRange);
+
+    // Emptying the chunk from -16 to -1 frees it, and nothing else moves.
+    const auto inEmptiedChunk = [](const Coordinate &c) { return -16 <= c.x && c.x <= -1; };
+    for (const Coordinate &c : ordered) {
+        if (inEmptiedChunk(c)) {
+            map.remove(c);
+            QVERIFY(map.get(c) == nullptr);
+        }
+    }
+    const auto remaining = filter(ordered, [&inEmptiedChunk](const Coordinate &c) {
+        return !inEmptiedChunk(c);
+    });
+    QCOMPARE(visitAll(), remaining);
+    for (const Coordinate &c : remaining) {
+        QVERIFY(map.get(c) != nullptr);
+    }
+}
+
+void TestMap::parseTreeCollisionTest()
+{
+    struct NODISCARD Props final
+    {
+        std::string name;
+        std::string desc;
+        RoomTerrainEnum terrain = RoomTerrainEnum::UNDEFINED;
+    };
+    // Each one differs from the first in a single property.
+    const std::vector<Props> inserted{{"Forest", "Tall trees.\n", RoomTerrainEnum::FOREST},
+                                      {"Forest", "Short trees.\n", RoomTerrainEnum::FOREST},
+                                      {"Road", "Tall trees.\n", RoomTerrainEnum::FOREST},
+                                      {"Forest", "Tall trees.\n", RoomTerrainEnum::ROAD}};
+    const Props missing{"Road", "Short trees.\n", RoomTerrainEnum::ROAD};
+
+    // With the fingerprints masked to nothing every key collides, and only the
+    // stored properties can tell them apart.
+    for (const uint64_t fingerprintMask : {~uint64_t{0}, uint64_t{0}}) {
+        MapData mapData{nullptr};
+        const auto createRoom = [&mapData](const Props &props) {
+            SharedRoom room = Room::createPermanentRoom(mapData);
+            room->setName(RoomName{props.name});
+            room->setDescription(RoomDesc{props.desc});
+            room->setTerrainType(props.terrain);
+            return room;
+        };
+        const auto findRooms = [](ParseTree &tree, const Room &room) {
+            RoomRecorder recorder;
+            tree.getRooms(recorder, deref(Room::getEvent(&room)));
+            return recorder.rooms;
+        };
+
+        ParseTree tree;
+        tree.setFingerprintMask(fingerprintMask);
+        std::vector<SharedRoom> rooms;
+        for (const Props &props : inserted) {
+            SharedRoom room = createRoom(props);
+            const SharedRoomCollection home = tree.insertRoom(deref(Room::getEvent(room.get())));
+            QVERIFY(home != nullptr);
+            home->addRoom(room);
+            rooms.emplace_back(std::move(room));
+        }
+
+        for (const SharedRoom &room : rooms) {
+            QCOMPARE(findRooms(tree, *room), (std::vector<const Room *>{room.get()}));
+        }
+        QVERIFY(findRooms(tree, *createRoom(missing)).empty());
+    }
+}
+
+void TestMap::pathMachineReplayBenchmark()
+{
+    MapData mapData{nullptr};
+    createGridMap(mapData, 5);
+    const Replay replay = createReplay(mapData, 10);
+
+    RoomId where = INVALID_ROOMID;
+    QBENCHMARK {
+        where = runReplay(mapData, replay);
+    }
+    QCOMPARE(where.asUint32(), replay.end.asUint32());
+    qInfo() << replay.events.size() << "events per replay";
+}
+
+void TestMap::pathMachineExperimentingBenchmark()
+{
+    // Every room but the middle one looks the same, so each flee forks the hypotheses
+    // and the path machine spends the walk in the experimenting state. The walk ends
+    // in the middle room, which only one hypothesis can match.
+    MapData mapData{nullptr};
+    createGridMap(mapData, 1);
+    const Replay replay = createReplay(mapData, 3, true);
+    QCOMPARE(replay.end.asUint32(), getGridRoomId(MAP_WIDTH / 2, MAP_HEIGHT / 2).asUint32());
+
+    RoomId where = INVALID_ROOMID;
+    QBENCHMARK {
+        where = runReplay(mapData, replay);
+    }
+    QCOMPARE(where.asUint32(), replay.end.asUint32());
+    qInfo() << replay.events.size() << "events per replay";
+}
+
+void TestMap::shortestPathTargetTest()
+{
+    MapData mapData{nullptr};
+    createGridMap(mapData, 5, true);
+    const RoomFilter everyRoom{".*", Qt::CaseInsensitive, true, PatternKindsEnum::NAME};
+
+    std::mt19937 rng{7};
+    std::uniform_int_distribution<int> randomX{0, MAP_WIDTH - 1};
+    std::uniform_int_distribution<int> randomY{0, MAP_HEIGHT - 1};
+    const auto randomRoom = [&]() -> const Room * {
+        return mapData.getRoom(Coordinate{randomX(rng), randomY(rng), 0});
+    };
+
+    for (int i = 0; i < 10; ++i) {
+        const Room *const origin = randomRoom();
+        QVERIFY(origin != nullptr);
+
+        // Dijkstra visits every room in order of distance.
+        DistanceRecorder everywhere;
+        mapData.shortestPathSearch(origin, &everywhere, everyRoom);
+        QCOMPARE(everywhere.distances.size(), static_cast<size_t>(MAP_WIDTH * MAP_HEIGHT));
+
+        for (int j = 0; j < 10; ++j) {
+            const Room *const target = (j == 0) ? origin : randomRoom();
+            QVERIFY(target != nullptr);
+
+            DistanceRecorder direct;
+            mapData.shortestPathSearch(origin, target, &direct);
+            QCOMPARE(direct.distances.size(), static_cast<size_t>(1));
+            QVERIFY(direct.distances.count(target->getId()) == 1);
+            QVERIFY(qFuzzyCompare(1.0 + direct.distances[target->getId()],
+                                  1.0 + everywhere.distances[target->getId()]));
+        }
+    }
+
+    // `dirs` only heads straight for a target when the filter has exactly one match.
+    const auto uniqueMatch = [&mapData](const char *const pattern) {
+        return mapData.findUniqueMatch(
+            RoomFilter{pattern, Qt::CaseInsensitive, true, PatternKindsEnum::NAME});
+    };
+    const Room *const center = uniqueMatch("^Crossroads$");
+    QVERIFY(center != nullptr);
+    QCOMPARE(center->getId().asUint32(),
+             getGridRoomId(MAP_WIDTH / 2, MAP_HEIGHT / 2).asUint32());
+    QVERIFY(uniqueMatch("^Forest") == nullptr);
+    QVERIFY(uniqueMatch("^Nowhere$") == nullptr);
+}
+
+void TestMap::routingLandmarksTest()
+{
+    static constexpr const double INF = std::numeric_limits<double>::infinity();
+
+    {
+        // A hand-made graph with one-way edges, a dead end (6) and an unreachable room (7).
+        struct NODISCARD Edge final
+        {
+            uint32_t from = 0;
+            uint32_t to = 0;
+            double cost = 0.0;
+        };
+        const std::vector<Edge> edges{{0, 1, 2.0},
+                                      {1, 0, 2.0},
+                                      {1, 2, 1.5},
+                                      {2, 1, 1.5},
+                                      {2, 3, 0.75},
+                                      {3, 2, 0.75},
+                                      {3, 4, 50.0},
+                                      {4, 3, 50.0},
+                                      {0, 5, 1.0},
+                                      {5, 4, 2.15},
+                                      {4, 6, 3.0}};
+        static constexpr const uint32_t NUM_ROOMS = 8;
+
+        // edges are listed by their source room, as compressed sparse rows want them
+        RoutingLandmarks::Graph graph;
+        graph.offsets.assign(NUM_ROOMS + 1, 0);
+        for (const Edge &edge : edges) {
+            ++graph.offsets[edge.from + 1];
+        }
+        for (uint32_t v = 0; v < NUM_ROOMS; ++v) {
+            graph.offsets[v + 1] += graph.offsets[v];
+        }
+        std::vector<uint32_t> fill(graph.offsets.begin(), graph.offsets.end() - 1);
+        graph.targets.resize(edges.size());
+        graph.costs.resize(edges.size());
+        for (const Edge &edge : edges) {
+            const uint32_t slot = fill[edge.from]++;
+            graph.targets[slot] = edge.to;
+            graph.costs[slot] = edge.cost;
+        }
+
+        // Floyd-Warshall for the true distances.
+        std::vector<std::vector<double>> dist(NUM_ROOMS, std::vector<double>(NUM_ROOMS, INF));
+        for (uint32_t v = 0; v < NUM_ROOMS; ++v) {
+            dist[v][v] = 0.0;
+        }
+        for (const Edge &edge : edges) {
+            dist[edge.from][edge.to] = std::min(dist[edge.from][edge.to], edge.cost);
+        }
+        for (uint32_t k = 0; k < NUM_ROOMS; ++k) {
+            for (uint32_t i = 0; i < NUM_ROOMS; ++i) {
+                for (uint32_t j = 0; j < NUM_ROOMS; ++j) {
+                    dist[i][j] = std::min(dist[i][j], dist[i][k] + dist[k][j]);
+                }
+            }
+        }
+
+        const std::atomic_bool cancel{false};
+        const auto landmarks = RoutingLandmarks::build(graph, cancel);
+        QVERIFY(landmarks != nullptr);
+        QCOMPARE(landmarks->size(), static_cast<size_t>(NUM_ROOMS));
+
+        bool anyTighter = false;
+        for (uint32_t a = 0; a < NUM_ROOMS; ++a) {
+            for (uint32_t b = 0; b < NUM_ROOMS; ++b) {
+                const double bound = landmarks->lowerBound(a, b);
+                QVERIFY2(bound <= dist[a][b] + 1e-9,
+                         qPrintable(QString("lowerBound(%1, %2) = %3 > %4")
+                                        .arg(a)
+                                        .arg(b)
+                                        .arg(bound)
+                                        .arg(dist[a][b])));
+                anyTighter = anyTighter || bound > 0.0;
+            }
+            QCOMPARE(landmarks->lowerBound(a, a), 0.0);
+        }
+        QVERIFY(anyTighter);
+    }
+
+    {
+        // A small grid of rooms: east/west exits go both ways, north/south ones only one way,
+        // the terrain makes detours worthwhile, and the last room can't be reached at all.
+        static constexpr const int WIDTH = 4;
+        static constexpr const int HEIGHT = 3;
+        static constexpr const RoomTerrainEnum terrains[] = {RoomTerrainEnum::ROAD,
+                                                             RoomTerrainEnum::WATER,
+                                                             RoomTerrainEnum::FOREST,
+                                                             RoomTerrainEnum::CITY,
+                                                             RoomTerrainEnum::HILLS};
+        static constexpr const int NUM_ROOMS = WIDTH * HEIGHT + 1;
+        const auto idAt = [](const int x, const int y) {
+            return RoomId{static_cast<uint32_t>(y * WIDTH + x)};
+        };
+
+        MapData mapData{nullptr};
+        RoomIndex roomIndex(static_cast<size_t>(NUM_ROOMS));
+        for (int i = 0; i < NUM_ROOMS; ++i) {
+            const int x = i % WIDTH;
+            const int y = i / WIDTH;
+            SharedRoom room = Room::createPermanentRoom(mapData);
+            room->setId(RoomId{static_cast<uint32_t>(i)});
+            room->setPosition(i < WIDTH * HEIGHT ? Coordinate{x, y, 0} : Coordinate{10, 10, 0});
+            room->setName(RoomName{"Room " + std::to_string(i)});
+            room->setTerrainType(terrains[(x * 7 + y * 13) % 5]);
+
+            ExitsList exits;
+            if (i < WIDTH * HEIGHT) {
+                for (const ExitDirEnum dir : ALL_EXITS_NESW) {
+                    const Coordinate to = Coordinate{x, y, 0} + Room::exitDir(dir);
+                    if (to.x < 0 || to.x >= WIDTH || to.y < 0 || to.y >= HEIGHT) {
+                        continue;
+                    }
+                    const bool vertical = dir == ExitDirEnum::NORTH || dir == ExitDirEnum::SOUTH;
+                    const ExitDirEnum oneWay = (x % 2 == 0) ? ExitDirEnum::NORTH
+                                                            : ExitDirEnum::SOUTH;
+                    if (vertical && dir != oneWay) {
+                        continue;
+                    }
+                    Exit &exit = exits[dir];
+                    exit.setExitFlags(ExitFlags{ExitFlagEnum::EXIT});
+                    exit.addOut(idAt(to.x, to.y));
+                }
+            }
+            room->setExitsList(exits);
+            roomIndex[room->getId()] = std::move(room);
+        }
+
+        ShortestPathSearch search;
+        search.waitForLandmarks(roomIndex);
+        QVERIFY(search.hasLandmarks());
+
+        const RoomFilter everyRoom{".*", Qt::CaseInsensitive, true, PatternKindsEnum::NAME};
+        for (int a = 0; a < NUM_ROOMS; ++a) {
+            const Room *const origin = roomIndex[RoomId{static_cast<uint32_t>(a)}].get();
+
+            // Dijkstra reaches every reachable room in order of distance.
+            DistanceRecorder everywhere;
+            ShortestPathSearch::Query all;
+            all.origin = origin;
+            all.filter = &everyRoom;
+            search.search(roomIndex, nullptr, everywhere, all);
+
+            for (int b = 0; b < NUM_ROOMS; ++b) {
+                const Room *const target = roomIndex[RoomId{static_cast<uint32_t>(b)}].get();
+                DistanceRecorder direct;
+                ShortestPathSearch::Query single;
+                single.origin = origin;
+                single.target = target;
+                search.search(roomIndex, nullptr, direct, single);
+
+                const auto expected = everywhere.distances.find(target->getId());
+                if (expected == everywhere.distances.end()) {
+                    QVERIFY(direct.distances.empty());
+                    continue;
+                }
+                QCOMPARE(direct.distances.size(), static_cast<size_t>(1));
+                QVERIFY(qFuzzyCompare(1.0 + direct.distances[target->getId()],
+                                      1.0 + expected->second));
+            }
+        }
+    }
+}
+
+void TestMap::chunkIdTest()
+{
+    const auto check = [](const Coordinate &c, const int layer, const int x, const int y) {
+        const ChunkId id = ChunkId::fromCoordinate(c);
+        return id.layer == layer && id.pos == ChunkPos{x, y};
+    };
+
+    QVERIFY(check(Coordinate{0, 0, 0}, 0, 0, 0));
+    QVERIFY(check(Coordinate{CHUNK_SIZE - 1, CHUNK_SIZE, 3}, 3, 0, 1));
+    QVERIFY(check(Coordinate{2 * CHUNK_SIZE + 5, 7, -2}, -2, 2, 0));
+
+    // Negative coordinates round down, so -1 and 0 are in different chunks.
+    QVERIFY(check(Coordinate{-1, -1, 0}, 0, -1, -1));
+    QVERIFY(check(Coordinate{-CHUNK_SIZE, -CHUNK_SIZE - 1, 0}, 0, -1, -2));
+    QVERIFY(check(Coordinate{-CHUNK_SIZE + 1, 1 - 2 * CHUNK_SIZE, -1}, -1, -1, -2));
+
+    // Every chunk holds exactly CHUNK_SIZE consecutive coordinates.
+    for (int x = -3 * CHUNK_SIZE; x < 3 * CHUNK_SIZE; ++x) {
+        const ChunkId id = ChunkId::fromCoordinate(Coordinate{x, 0, 0});
+        QVERIFY(id.pos.first * CHUNK_SIZE <= x);
+        QVERIFY(x < (id.pos.first + 1) * CHUNK_SIZE);
+    }
+}
+
+void TestMap::readerFenceTest()
+{
+    MapData mapData{nullptr};
+    createGridMap(mapData, 5);
+
+    // Registers a reader that only finishes when told to, then runs the mutation on
+    // another thread; returns true if the mutation waited for the reader.
+    const auto waitsForReader = [&mapData](const std::function<void()> &mutate) -> bool {
+        std::promise<void> reader;
+        {
+            QMutexLocker locker(&mapData.mapLock);
+            mapData.addReaders({reader.get_future().share()});
+        }
+        std::future<void> mutator = std::async(std::launch::async, mutate);
+        const bool blocked = mutator.wait_for(std::chrono::milliseconds(100))
+                             == std::future_status::timeout;
+        reader.set_value();
+        mutator.wait();
+        return blocked;
+    };
+
+    const Coordinate outside{-5, -5, 0};
+    QVERIFY(waitsForReader([&mapData, &outside]() {
+        SharedRoom room = Room::createPermanentRoom(mapData);
+        room->setId(RoomId{static_cast<uint32_t>(MAP_WIDTH * MAP_HEIGHT)});
+        room->setPosition(outside);
+        mapData.insertPredefinedRoom(room);
+    }));
+    QVERIFY(mapData.getRoom(outside) != nullptr);
+
+    QVERIFY(waitsForReader([&mapData]() { mapData.clear(); }));
+    QCOMPARE(mapData.getRoomsCount(), 0u);
+    QVERIFY(mapData.getRoom(outside) == nullptr);
+}
+
+void TestMap::meshUpdatesTest()
+{
+    MapData mapData{nullptr};
+    createGridMap(mapData, 5);
+    // forget the updates from building the map
+    MAYBE_UNUSED const auto initial = mapData.takeMeshUpdates();
+
+    const auto takeUpdates = [&mapData]() -> std::vector<Coordinate> {
+        std::optional<std::vector<Coordinate>> updates = mapData.takeMeshUpdates();
+        return updates.has_value() ? std::move(updates.value()) : std::vector<Coordinate>{};
+    };
+    const auto contains = [](const std::vector<Coordinate> &updates, const Coordinate &pos) {
+        return std::find(updates.begin(), updates.end(), pos) != updates.end();
+    };
+
+    // A mesh change also redraws the connections to the rooms at the other end of each exit.
+    const Coordinate middle{20, 20, 0};
+    Room &room = deref(mapData.roomIndex[getGridRoomId(middle.x, middle.y)]);
+    room.setTerrainType(RoomTerrainEnum::CITY);
+    {
+        const std::vector<Coordinate> updates = takeUpdates();
+        QVERIFY(contains(updates, middle));
+        for (const ExitDirEnum dir : ALL_EXITS_NESW) {
+            QVERIFY(contains(updates, middle + Room::exitDir(dir)));
+        }
+    }
+
+    // Moving a room redraws both where it was and where it is now. This room is not
+    // part of the map, so nothing else is redrawn.
+    SharedRoom loose = Room::createPermanentRoom(mapData);
+    const Coordinate from{-50, -50, 0};
+    const Coordinate to{-60, -40, 1};
+    loose->setPosition(from);
+    MAYBE_UNUSED const auto ignored = takeUpdates();
+    loose->setPosition(to);
+    {
+        const std::vector<Coordinate> updates = takeUpdates();
+        QVERIFY(contains(updates, from));
+        QVERIFY(contains(updates, to));
+    }
+
+    // A room that goes away is no longer drawn where it was.
+    loose->setAboutToDie();
+    QCOMPARE(takeUpdates(), std::vector<Coordinate>{to});
+
+    // Too many changes give up on the positions, until the next call.
+    for (size_t i = 0; i <= RoomModificationTracker::MAX_MESH_UPDATES; ++i) {
+        mapData.notifyMeshModified(to);
+    }
+    QVERIFY(!mapData.takeMeshUpdates().has_value());
+    const std::optional<std::vector<Coordinate>> after = mapData.takeMeshUpdates();
+    QVERIFY(after.has_value() && after->empty());
+}
+
+void TestMap::overviewImageTest()
+{
+    TerrainColors terrainColors;
+    terrainColors[RoomTerrainEnum::FOREST] = Color{0, 128, 0};
+    terrainColors[RoomTerrainEnum::WATER] = Color{0, 0, 255};
+
+    // Chunk (-1, 2) covers x in [-32, -1] and y in [64, 95].
+    const ChunkPos pos{-1, 2};
+    MapData mapData{nullptr};
+    std::vector<SharedRoom> rooms;
+    const auto addRoom = [&mapData, &rooms](const Coordinate &c, const RoomTerrainEnum terrain) {
+        SharedRoom room = Room::createPermanentRoom(mapData);
+        room->setPosition(c);
+        room->setTerrainType(terrain);
+        rooms.emplace_back(std::move(room));
+    };
+    addRoom(Coordinate{-32, 64, 0}, RoomTerrainEnum::FOREST);
+    addRoom(Coordinate{-20, 80, 0}, RoomTerrainEnum::WATER);
+    addRoom(Coordinate{-1, 95, 0}, RoomTerrainEnum::FOREST);
+    const RoomVector roomVector{rooms[0].get(), rooms[1].get(), rooms[2].get()};
+
+    const QColor forest = terrainColors[RoomTerrainEnum::FOREST].getQColor();
+    const QColor water = terrainColors[RoomTerrainEnum::WATER].getQColor();
+    {
+        const QImage image = generateOverviewImage(pos, roomVector, terrainColors, OptBounds{});
+        QCOMPARE(image.size(), QSize(CHUNK_SIZE, CHUNK_SIZE));
+        QCOMPARE(image.pixelColor(0, 0), forest);
+        QCOMPARE(image.pixelColor(12, 16), water);
+        QCOMPARE(image.pixelColor(31, 31), forest);
+        QCOMPARE(image.pixelColor(5, 5).alpha(), 0);
+        QCOMPARE(image.pixelColor(31, 0).alpha(), 0);
+    }
+    {
+        // The last room is out of bounds, so its texel stays transparent.
+        const OptBounds bounds{Coordinate{-40, 60, 0}, Coordinate{-5, 100, 0}};
+        const QImage image = generateOverviewImage(pos, roomVector, terrainColors, bounds);
+        QCOMPARE(image.pixelColor(0, 0), forest);
+        QCOMPARE(image.pixelColor(12, 16), water);
+        QCOMPARE(image.pixelColor(31, 31).alpha(), 0);
+    }
+}
+
+void TestMap::mapStorageParallelLoadTest()
+{
+    MapData original{nullptr};
+    createGridMap(original, 5, true);
+    QTemporaryFile file;
+    QVERIFY(saveMap(original, file));
+
+    // One worker decodes every record in order; four have to find their
+    // first record through the skipRoom() offsets.
+    QElapsedTimer timer;
+    MapData sequential{nullptr};
+    timer.start();
+    QVERIFY(loadMap(sequential, file, MapFormatEnum::MM2, 1));
+    const auto sequentialMs = timer.elapsed();
+
+    MapData parallel{nullptr};
+    timer.start();
+    QVERIFY(loadMap(parallel, file, MapFormatEnum::MM2, 4));
+    const auto parallelMs = timer.elapsed();
+
+    QCOMPARE(compareMaps(sequential, parallel), MAP_WIDTH * MAP_HEIGHT);
+    QCOMPARE(compareMaps(original, parallel), MAP_WIDTH * MAP_HEIGHT);
+    qInfo() << "loaded" << MAP_WIDTH * MAP_HEIGHT << "rooms in" << sequentialMs
+            << "ms with 1 worker, and" << parallelMs << "ms with 4";
+}
+
+void TestMap::xmlMapStorageParallelLoadTest()
+{
+    MapData original{nullptr};
+    createGridMap(original, 5, true);
+    {
+        auto mark = InfoMark::alloc(original);
+        mark->setType(InfoMarkTypeEnum::TEXT);
+        mark->setClass(InfoMarkClassEnum::PLACE);
+        mark->setText(InfoMarkText{"Crossroads"});
+        mark->setPosition1(Coordinate{100, 200, 0});
+        mark->setPosition2(Coordinate{300, 400, 0});
+        original.addMarker(mark);
+    }
+    QTemporaryFile file;
+    QVERIFY(saveMap(original, file, MapFormatEnum::MM2XML));
+
+    // One worker reads the whole document with a single QXmlStreamReader;
+    // four split it at the <room> tags and merge the rooms afterwards.
+    const auto load = [&file](MapData &mapData, const uint32_t maxWorkers) -> uint32_t {
+        if (!file.open()) {
+            return ~0u;
+        }
+        XmlMapStorage storage{mapData, file.fileName(), &file, nullptr};
+        storage.setMaxWorkers(maxWorkers);
+        const bool loaded = static_cast<AbstractMapStorage &>(storage).loadData();
+        file.close();
+        return loaded ? storage.getParallelChunks() : ~0u;
+    };
+
+    QElapsedTimer timer;
+    MapData sequential{nullptr};
+    timer.start();
+    QCOMPARE(load(sequential, 1), 0u);
+    const auto sequentialMs = timer.elapsed();
+
+    MapData parallel{nullptr};
+    timer.start();
+    QCOMPARE(load(parallel, 4), 4u);
+    const auto parallelMs = timer.elapsed();
+
+    QCOMPARE(compareMaps(sequential, parallel), MAP_WIDTH * MAP_HEIGHT);
+    QCOMPARE(compareMaps(original, parallel), MAP_WIDTH * MAP_HEIGHT);
+    for (MapData *const loaded : {&sequential, &parallel}) {
+        QCOMPARE(loaded->getMarkersList().size(), static_cast<size_t>(1));
+        const InfoMark &mark = deref(loaded->getMarkersList().front());
+        QCOMPARE(mark.getText().getStdString(), std::string{"Crossroads"});
+        QCOMPARE(mark.getPosition2(), (Coordinate{300, 400, 0}));
+    }
+    qInfo() << "loaded" << MAP_WIDTH * MAP_HEIGHT << "rooms in" << sequentialMs
+            << "ms sequentially, and" << parallelMs << "ms with 4 workers";
+
+    // Saving what the parallel loader read gives the same document.
+    QTemporaryFile resaved;
+    QVERIFY(saveMap(parallel, resaved, MapFormatEnum::MM2XML));
+    QVERIFY(file.open());
+    QVERIFY(resaved.open());
+    QCOMPARE(resaved.readAll(), file.readAll());
+}
+
+void TestMap::jsonMapStorageTest()
+{
+    QTemporaryDir exportDir;
+    QVERIFY(exportDir.isValid());
+    const QDir v1{QDir{exportDir.path()}.filePath("v1")};
+
+    MapData original{nullptr};
+    createZonedMap(original);
+    QVERIFY(exportJson(original, exportDir.path()));
+    const auto exported = readFiles(v1);
+    QVERIFY(exported.count("manifest.json") == 1);
+    QVERIFY(exported.count("arda.json") == 1);
+    QCOMPARE(std::count_if(exported.begin(),
+                           exported.end(),
+                           [](const auto &kv) { return kv.first.startsWith("zone/"); }),
+             static_cast<std::ptrdiff_t>(JSON_ZONES * JSON_ZONES));
+
+    // Exporting the same map again leaves every file but the manifest alone.
+    QVERIFY(backdateFiles(v1));
+    QVERIFY(exportJson(original, exportDir.path()));
+    QCOMPARE(getWrittenFiles(v1), QStringList{"manifest.json"});
+    QVERIFY(readFiles(v1) == exported);
+
+    // The terrain isn't part of the room hashes, so only the room's zone changes.
+    MapData changed{nullptr};
+    createZonedMap(changed, true, RoomId{0});
+    QVERIFY(backdateFiles(v1));
+    QVERIFY(exportJson(changed, exportDir.path()));
+    QCOMPARE(getWrittenFiles(v1), (QStringList{"manifest.json", "zone/0,0.json"}));
+
+    // The zone that no longer has any rooms is removed, and no other zone is written.
+    MapData shrunk{nullptr};
+    createZonedMap(shrunk, false, RoomId{0});
+    QVERIFY(backdateFiles(v1));
+    QVERIFY(exportJson(shrunk, exportDir.path()));
+    const QString lastZone = QString("zone/%1,%1.json").arg((JSON_ZONES - 1) * JSON_ZONE_WIDTH);
+    QVERIFY(!QFileInfo::exists(v1.filePath(lastZone)));
+    for (const QString &name : getWrittenFiles(v1)) {
+        QVERIFY2(!name.startsWith("zone/"), qPrintable(name));
+    }
+
+    // Exporting from scratch gives the same files, with one worker or several.
+    for (const uint32_t maxWorkers : {1u, 4u}) {
+        QTemporaryDir freshDir;
+        QVERIFY(freshDir.isValid());
+        QVERIFY(exportJson(shrunk, freshDir.path(), maxWorkers));
+        QVERIFY(readFiles(QDir{QDir{freshDir.path()}.filePath("v1")}) == readFiles(v1));
+    }
+}
+
+void TestMap::compressingWriterTest()
+{
+    // Pieces of every size, including empty ones and ones larger than the
+    // writer's output buffer, after something else was already written.
+    std::mt19937 rng{11};
+    std::uniform_int_distribution<int> pieceSize{0, 100000};
+    std::uniform_int_distribution<int> letter{'a', 'z'};
+    QByteArray input;
+    std::vector<QByteArray> pieces;
+    for (int i = 0; i < 50; ++i) {
+        QByteArray piece(pieceSize(rng), '\0');
+        for (char &c : piece) {
+            // long runs, like the repeated descriptions in a map
+            c = static_cast<char>((i % 2 == 0) ? 'x' : letter(rng));
+        }
+        input += piece;
+        pieces.emplace_back(piece);
+    }
+
+    const QByteArray prefix{"header"};
+    QBuffer buffer;
+    QVERIFY(buffer.open(QIODevice::WriteOnly));
+    QCOMPARE(buffer.write(prefix), static_cast<qint64>(prefix.size()));
+    {
+        StorageUtils::CompressingWriter writer{buffer};
+        for (const QByteArray &piece : pieces) {
+            writer.write(piece);
+        }
+        writer.finish();
+        QCOMPARE(writer.getUncompressedSize(), static_cast<qint64>(input.size()));
+        QVERIFY(writer.getCompressedSize() < writer.getUncompressedSize());
+    }
+    buffer.close();
+
+    const QByteArray &output = buffer.data();
+    QVERIFY(output.startsWith(prefix));
+    QCOMPARE(qUncompress(output.mid(prefix.size())), input);
+}
+
+void TestMap::mapStorageSnapshotTest()
+{
+    MapData original{nullptr};
+    createGridMap(original, 5, true);
+    QTemporaryFile file;
+    QVERIFY(file.open());
+
+    // The snapshot is all the writer needs, so the map can change while it's saved.
+    MapStorage::SharedSnapshot snapshot;
+    {
+        MapStorage storage{original, file.fileName(), &file, nullptr};
+        snapshot = storage.takeSnapshot(false);
+    }
+    MapData copy{nullptr};
+    createGridMap(copy, 5, true);
+    original.clear();
+
+    const double compressionRatio = MapStorage::writeSnapshot(deref(snapshot), file);
+    QVERIFY(compressionRatio > 1.0);
+    file.close();
+
+    MapData loaded{nullptr};
+    QVERIFY(loadMap(loaded, file));
+    QCOMPARE(compareMaps(copy, loaded), MAP_WIDTH * MAP_HEIGHT);
+}
+
+void TestMap::flatMapStorageTest()
+{
+    MapData original{nullptr};
+    createGridMap(original, 5, true);
+    {
+        auto mark = InfoMark::alloc(original);
+        mark->setType(InfoMarkTypeEnum::TEXT);
+        mark->setClass(InfoMarkClassEnum::PLACE);
+        mark->setText(InfoMarkText{"Crossroads"});
+        mark->setPosition1(Coordinate{100, 200, 0});
+        mark->setPosition2(Coordinate{300, 400, 0});
+        original.addMarker(mark);
+    }
+
+    QTemporaryFile file;
+    QVERIFY(saveMap(original, file, MapFormatEnum::MM2F));
+
+    MapData loaded{nullptr};
+    QVERIFY(loadMap(loaded, file, MapFormatEnum::MM2F));
+    QCOMPARE(compareMaps(original, loaded), MAP_WIDTH * MAP_HEIGHT);
+    QCOMPARE(loaded.getMarkersList().size(), static_cast<size_t>(1));
+    const InfoMark &mark = deref(loaded.getMarkersList().front());
+    QCOMPARE(mark.getText().getStdString(), std::string{"Crossroads"});
+    QCOMPARE(mark.getClass(), InfoMarkClassEnum::PLACE);
+    QCOMPARE(mark.getPosition1(), (Coordinate{100, 200, 0}));
+
+    // Merging puts the second copy below the first one, with ids after the first one's.
+    QVERIFY(mergeMap(loaded, file, MapFormatEnum::MM2F));
+    QCOMPARE(loaded.getRoomsCount(), static_cast<uint>(2 * MAP_WIDTH * MAP_HEIGHT));
+    QCOMPARE(loaded.getMarkersList().size(), static_cast<size_t>(2));
+
+    const Room &first = deref(loaded.getRoom(Coordinate{0, 0, 0}));
+    const Room &merged = deref(loaded.getRoom(Coordinate{0, 0, -1}));
+    const auto numRooms = static_cast<uint32_t>(MAP_WIDTH * MAP_HEIGHT);
+    QCOMPARE(merged.getId().asUint32(), first.getId().asUint32() + numRooms);
+    QCOMPARE(merged.getName(), first.getName());
+    const RoomId east = merged.exit(ExitDirEnum::EAST).outFirst();
+    QCOMPARE(east.asUint32(), first.exit(ExitDirEnum::EAST).outFirst().asUint32() + numRooms);
+}
+
+void TestMap::mapStorageLoadBenchmark_data()
+{
+    QTest::addColumn<MapFormatEnum>("format");
+    QTest::addColumn<uint32_t>("maxWorkers");
+    QTest::newRow("mm2, 1 worker") << MapFormatEnum::MM2 << 1u;
+    QTest::newRow("mm2, ideal thread count") << MapFormatEnum::MM2 << 0u;
+    QTest::newRow("mm2f") << MapFormatEnum::MM2F << 0u;
+    QTest::newRow("mm2xml, sequential") << MapFormatEnum::MM2XML << 1u;
+    QTest::newRow("mm2xml, ideal thread count") << MapFormatEnum::MM2XML << 0u;
+}
+
+void TestMap::mapStorageLoadBenchmark()
+{
+    QFETCH(MapFormatEnum, format);
+    QFETCH(uint32_t, maxWorkers);
+
+    QTemporaryFile file;
+    {
+        MapData original{nullptr};
+        createGridMap(original, 5, true);
+        QVERIFY(saveMap(original, file, format));
+    }
+
+    QBENCHMARK {
+        MapData mapData{nullptr};
+        QVERIFY(loadMap(mapData, file, format, maxWorkers));
+    }
+}
+
+QTEST_MAIN(TestMap)
@@ -0,0 +1,34 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2023 The MMapper Authors
+
+#include <QObject>
+
+class TestMap final : public QObject
+{
+    Q_OBJECT
+public:
+    TestMap();
+    ~TestMap() final;
+
+private Q_SLOTS:
+    void initTestCase();
+    void mapGridTest();
+    void parseTreeCollisionTest();
+    void pathMachineReplayBenchmark();
+    void pathMachineExperimentingBenchmark();
+    void shortestPathTargetTest();
+    void routingLandmarksTest();
+    void chunkIdTest();
+    void readerFenceTest();
+    void meshUpdatesTest();
+    void overviewImageTest();
+    void mapStorageParallelLoadTest();
+    void xmlMapStorageParallelLoadTest();
+    void jsonMapStorageTest();
+    void compressingWriterTest();
+    void mapStorageSnapshotTest();
+    void flatMapStorageTest();
+    void mapStorageLoadBenchmark_data();
+    void mapStorageLoadBenchmark();
+};
@@ -0,0 +1,263 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2023 The MMapper Authors
+
+#include "TestOpenGL.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <QDebug>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLFunctions>
+#include <QOpenGLTexture>
+#include <QtTest/QtTest>
+
+#include "../src/display/Textures.h"
+#include "../src/opengl/OpenGL.h"
+
+namespace { // anonymous
+
+// The same size as the chunks of MapCanvasRoomDrawer.
+constexpr int BATCH_SIZE = 32;
+// 32k rooms, which is about the size of the default map.
+constexpr int MAP_WIDTH = 8 * BATCH_SIZE;
+constexpr int MAP_HEIGHT = 4 * BATCH_SIZE;
+constexpr int NUM_LAYERS = 16;
+constexpr int TEXTURE_SIZE = 8;
+constexpr int FBO_WIDTH = 1024;
+constexpr int FBO_HEIGHT = 512;
+
+struct NODISCARD Batch final
+{
+    glm::vec3 origin{0.f};
+    std::vector<QuadInstance> instances;
+    std::vector<ColoredArrayTexVert> verts;
+};
+
+NODISCARD const std::vector<Batch> &getBatches()
+{
+    static const std::vector<Batch> batches = []() {
+        std::vector<Batch> result;
+        for (int by = 0; by < MAP_HEIGHT; by += BATCH_SIZE) {
+            for (int bx = 0; bx < MAP_WIDTH; bx += BATCH_SIZE) {
+                Batch &batch = result.emplace_back();
+                batch.origin = glm::vec3{bx, by, 0};
+                for (int y = 0; y < BATCH_SIZE; ++y) {
+                    for (int x = 0; x < BATCH_SIZE; ++x) {
+                        const int layer = (bx + x + 3 * (by + y)) % NUM_LAYERS;
+                        const float green = (x % 2 == 0) ? 1.f : 0.5f;
+                        const Color color{glm::vec4{1.f, green, 1.f, 1.f}};
+                        batch.instances.emplace_back(static_cast<int16_t>(x),
+                                                     static_cast<int16_t>(y),
+                                                     int16_t{0},
+                                                     static_cast<int16_t>(layer),
+                                                     color);
+
+                        const glm::vec3 v0 = batch.origin + glm::vec3{x, y, 0};
+                        const auto z = static_cast<float>(layer);
+#define EMIT(a, b) \
+    batch.verts.emplace_back(color, glm::vec3((a), (b), z), v0 + glm::vec3((a), (b), 0))
+                        EMIT(0, 0);
+                        EMIT(1, 0);
+                        EMIT(1, 1);
+                        EMIT(0, 1);
+#undef EMIT
+                    }
+                }
+            }
+        }
+        return result;
+    }();
+    return batches;
+}
+
+// Every layer is a different color, so drawing the wrong layer changes the image.
+NODISCARD SharedMMTexture createArrayTexture()
+{
+    const auto init = [](QOpenGLTexture &tex) -> void {
+        tex.setMinMagFilters(QOpenGLTexture::Filter::Nearest, QOpenGLTexture::Filter::Nearest);
+        tex.create();
+        tex.setSize(TEXTURE_SIZE, TEXTURE_SIZE);
+        tex.setLayers(NUM_LAYERS);
+        tex.setMipLevels(1);
+        tex.setFormat(QOpenGLTexture::TextureFormat::RGBA8_UNorm);
+        tex.allocateStorage(QOpenGLTexture::PixelFormat::RGBA, QOpenGLTexture::PixelType::UInt8);
+        for (int layer = 0; layer < NUM_LAYERS; ++layer) {
+            QImage image{TEXTURE_SIZE, TEXTURE_SIZE, QImage::Format::Format_RGBA8888};
+            image.fill(QColor::fromHsv(layer * 360 / NUM_LAYERS, 255, 255));
+            tex.setData(0,
+                        layer,
+                        QOpenGLTexture::PixelFormat::RGBA,
+                        QOpenGLTexture::PixelType::UInt8,
+                        image.constBits());
+        }
+    };
+    return MMTexture::alloc(QOpenGLTexture::Target::Target2DArray, init, false);
+}
+
+} // namespace
+
+TestOpenGL::TestOpenGL() = default;
+
+TestOpenGL::~TestOpenGL() = default;
+
+void TestOpenGL::initTestCase()
+{
+    m_context = std::make_unique<QOpenGLContext>();
+    if (!m_context->create()) {
+        m_context.reset();
+        return;
+    }
+    m_surface = std::make_unique<QOffscreenSurface>();
+    m_surface->setFormat(m_context->format());
+    m_surface->create();
+    if (!m_context->makeCurrent(m_surface.get())) {
+        m_context.reset();
+        return;
+    }
+
+    qInfo() << "Renderer:" << reinterpret_cast<const char *>(
+        m_context->functions()->glGetString(GL_RENDERER));
+
+    m_fbo = std::make_unique<QOpenGLFramebufferObject>(FBO_WIDTH, FBO_HEIGHT);
+    m_fbo->bind();
+
+    m_gl = std::make_unique<OpenGL>();
+    m_gl->initializeOpenGLFunctions();
+    m_gl->initializeRenderer(1.f);
+    m_gl->glViewport(0, 0, FBO_WIDTH, FBO_HEIGHT);
+    m_gl->setProjectionMatrix(glm::ortho(0.f,
+                                         static_cast<float>(MAP_WIDTH),
+                                         0.f,
+                                         static_cast<float>(MAP_HEIGHT),
+                                         -1.f,
+                                         1.f));
+    if (m_gl->canRenderTextureArrays()) {
+        m_texture = createArrayTexture();
+    }
+}
+
+void TestOpenGL::cleanupTestCase()
+{
+    if (m_context == nullptr) {
+        return;
+    }
+    // the GL objects have to be destroyed while the context is current
+    m_texture.reset();
+    if (m_gl != nullptr) {
+        m_gl->cleanup();
+    }
+    m_gl.reset();
+    m_fbo.reset();
+    m_context->doneCurrent();
+}
+
+// QSKIP() only leaves the function it's used in, so the tests skip themselves.
+bool TestOpenGL::requireInstancing()
+{
+    if (m_context == nullptr) {
+        qInfo() << "no OpenGL context";
+        return false;
+    }
+    if (!m_gl->canRenderInstancedQuads()) {
+        qInfo() << "instanced array textures aren't supported";
+        return false;
+    }
+    return true;
+}
+
+std::vector<UniqueMesh> TestOpenGL::createMeshes(const bool instanced)
+{
+    std::vector<UniqueMesh> meshes;
+    for (const Batch &batch : getBatches()) {
+        meshes.emplace_back(
+            instanced ? m_gl->createInstancedQuadBatch(batch.origin, batch.instances, m_texture)
+                      : m_gl->createColoredTexturedQuadBatch(batch.verts, m_texture));
+    }
+    return meshes;
+}
+
+void TestOpenGL::renderFrame(std::vector<UniqueMesh> &meshes)
+{
+    QOpenGLFunctions &functions = deref(m_context->functions());
+    functions.glClearColor(0.f, 0.f, 0.f, 1.f);
+    functions.glClear(GL_COLOR_BUFFER_BIT);
+    for (UniqueMesh &mesh : meshes) {
+        mesh.render(GLRenderState());
+    }
+    functions.glFinish();
+}
+
+void TestOpenGL::instancedQuadsTest()
+{
+    if (!requireInstancing()) {
+        QSKIP("needs instanced rendering");
+    }
+
+    auto vertexMeshes = createMeshes(false);
+    renderFrame(vertexMeshes);
+    const QImage expected = m_fbo->toImage();
+    auto instancedMeshes = createMeshes(true);
+    renderFrame(instancedMeshes);
+    const QImage actual = m_fbo->toImage();
+    QCOMPARE(actual, expected);
+
+    // something was actually drawn
+    QVERIFY(actual.pixelColor(FBO_WIDTH / 2, FBO_HEIGHT / 2) != QColor(Qt::black));
+
+    size_t instanceBytes = 0;
+    size_t vertexBytes = 0;
+    for (const Batch &batch : getBatches()) {
+        instanceBytes += batch.instances.size() * sizeof(QuadInstance);
+        vertexBytes += batch.verts.size() * sizeof(ColoredArrayTexVert);
+    }
+    qInfo() << "VBO bytes per room:" << (instanceBytes / (MAP_WIDTH * MAP_HEIGHT))
+            << "instanced vs" << (vertexBytes / (MAP_WIDTH * MAP_HEIGHT)) << "vertices";
+}
+
+void TestOpenGL::instancedUploadBenchmark()
+{
+    if (!requireInstancing()) {
+        QSKIP("needs instanced rendering");
+    }
+    QBENCHMARK {
+        auto meshes = createMeshes(true);
+        m_context->functions()->glFinish();
+    }
+}
+
+void TestOpenGL::vertexUploadBenchmark()
+{
+    if (!requireInstancing()) {
+        QSKIP("needs instanced rendering");
+    }
+    QBENCHMARK {
+        auto meshes = createMeshes(false);
+        m_context->functions()->glFinish();
+    }
+}
+
+void TestOpenGL::instancedFrameBenchmark()
+{
+    if (!requireInstancing()) {
+        QSKIP("needs instanced rendering");
+    }
+    auto meshes = createMeshes(true);
+    QBENCHMARK {
+        renderFrame(meshes);
+    }
+}
+
+void TestOpenGL::vertexFrameBenchmark()
+{
+    if (!requireInstancing()) {
+        QSKIP("needs instanced rendering");
+    }
+    auto meshes = createMeshes(false);
+    QBENCHMARK {
+        renderFrame(meshes);
+    }
+}
+
+QTEST_MAIN(TestOpenGL)
@@ -0,0 +1,45 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2023 The MMapper Authors
+
+#include <memory>
+#include <vector>
+#include <QObject>
+
+#include "../src/opengl/OpenGLTypes.h"
+
+class OpenGL;
+class QOffscreenSurface;
+class QOpenGLContext;
+class QOpenGLFramebufferObject;
+
+// Needs an OpenGL context; the tests are skipped without one. For a headless
+// run, use Mesa's software renderer (e.g. LIBGL_ALWAYS_SOFTWARE=1 under Xvfb).
+class TestOpenGL final : public QObject
+{
+    Q_OBJECT
+public:
+    TestOpenGL();
+    ~TestOpenGL() final;
+
+private:
+    std::unique_ptr<QOffscreenSurface> m_surface;
+    std::unique_ptr<QOpenGLContext> m_context;
+    std::unique_ptr<QOpenGLFramebufferObject> m_fbo;
+    std::unique_ptr<OpenGL> m_gl;
+    SharedMMTexture m_texture;
+
+private:
+    NODISCARD bool requireInstancing();
+    NODISCARD std::vector<UniqueMesh> createMeshes(bool instanced);
+    void renderFrame(std::vector<UniqueMesh> &meshes);
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+    void instancedQuadsTest();
+    void instancedUploadBenchmark();
+    void vertexUploadBenchmark();
+    void instancedFrameBenchmark();
+    void vertexFrameBenchmark();
+};
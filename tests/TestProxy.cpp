@@ -3,6 +3,7 @@
 
 #include "TestProxy.h"
 
+#include <string>
 #include <QDebug>
 #include <QtTest/QtTest>
 
@@ -10,6 +11,13 @@
 #include "../src/proxy/GmcpMessage.h"
 #include "../src/proxy/GmcpModule.h"
 #include "../src/proxy/GmcpUtils.h"
+#include "../src/proxy/TelnetScanner.h"
+
+namespace { // anonymous
+
+constexpr const char IAC = static_cast<char>(telnet_scanner::IAC);
+
+} // namespace
 
 void TestProxy::escapeTest()
 {
@@ -67,4 +75,30 @@ void TestProxy::gmcpModuleTest()
     QVERIFY(module4.isSupported());
 }
 
+void TestProxy::telnetScannerTest()
+{
+    using telnet_scanner::findIac;
+    using telnet_scanner::findIacScalar;
+
+    // Every length, alignment and match position around the 16-byte blocks.
+    std::string buffer(80, 'x');
+    for (size_t offset = 0; offset < 16; ++offset) {
+        for (size_t len = 0; offset + len <= buffer.size(); ++len) {
+            const char *const begin = buffer.data() + offset;
+            const char *const end = begin + len;
+            QCOMPARE(findIac(begin, end), end);
+            for (size_t match = 0; match < len; ++match) {
+                buffer[offset + match] = IAC;
+                QCOMPARE(findIac(begin, end), begin + match);
+                QCOMPARE(findIacScalar(begin, end), begin + match);
+                buffer[offset + match] = 'x';
+            }
+        }
+    }
+
+    // Bytes other than 255 with the high bit set are plaintext.
+    const std::string latin1 = "\xfe\xe9\x80\x7f caf\xe9 \xfe\xfe\xfe\xfe\xfe\xfe\xfe\xfe\xfe";
+    QCOMPARE(findIac(latin1.data(), latin1.data() + latin1.size()), latin1.data() + latin1.size());
+}
+
 QTEST_MAIN(TestProxy)
@@ -16,4 +16,5 @@ private Q_SLOTS:
     void gmcpMessageDeserializeTest();
     void gmcpMessageSerializeTest();
     void gmcpModuleTest();
+    void telnetScannerTest();
 };
@@ -0,0 +1,322 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2023 The MMapper Authors
+
+#include "TestTelnet.h"
+
+#include <algorithm>
+#include <random>
+#include <string_view>
+#include <vector>
+#include <QStandardPaths>
+#include <QtTest/QtTest>
+
+#include "../src/clock/mumeclock.h"
+#include "../src/configuration/configuration.h"
+#include "../src/mapdata/mapdata.h"
+#include "../src/observer/gameobserver.h"
+#include "../src/parser/mumexmlparser.h"
+#include "../src/proxy/AbstractTelnet.h"
+#include "../src/proxy/telnetfilter.h"
+#include "../src/timers/CTimers.h"
+
+namespace { // anonymous
+
+constexpr const char IAC = static_cast<char>(255);
+constexpr const char GA = static_cast<char>(249);
+
+// Roughly what MUME sends once MCCP is inflated: room descriptions and prompts,
+// each prompt followed by IAC GA, and the odd escaped IAC.
+QByteArray makeSession()
+{
+    QByteArray session;
+    for (int i = 0; i < 2000; ++i) {
+        session += "\x1b[32mThe Grey Havens\x1b[0m\r\n"
+                   "The quays run along the shore of the bay, where the white ships of the\r\n"
+                   "Elves lie at anchor before they sail into the West. A gull cries.\r\n"
+                   "Exits: north, east, south.\r\n\r\n"
+                   "* HP:Healthy Mana:Full Move:Fresh>";
+        session += IAC;
+        session += GA;
+        if (i % 100 == 0) {
+            session += "An elf says '\xff\xff'\r\n";
+        }
+    }
+    return session;
+}
+
+// The per-byte loop the telnet layer used before copying plaintext in bulk,
+// reduced to what the session above contains: IAC IAC is an escaped 255,
+// and IAC GA is dropped.
+QByteArray removeTelnetCommands(const QByteArray &session)
+{
+    QByteArray result;
+    bool iac = false;
+    for (const char c : session) {
+        if (iac) {
+            iac = false;
+            if (c == IAC) {
+                result.append(c);
+            }
+        } else if (c == IAC) {
+            iac = true;
+        } else {
+            result.append(c);
+        }
+    }
+    return result;
+}
+
+class NODISCARD TestTelnetClient final : public AbstractTelnet
+{
+public:
+    QByteArray received;
+    int goAheads = 0;
+
+public:
+    TestTelnetClient()
+        : AbstractTelnet(TextCodecStrategyEnum::FORCE_LATIN_1, nullptr, "unknown")
+    {}
+
+public:
+    void receive(const QByteArray &data) { onReadInternal(data); }
+
+private:
+    void virt_sendRawData(const std::string_view /*data*/) final {}
+    void virt_sendToMapper(const QByteArray &data, const bool goAhead) final
+    {
+        received += data;
+        if (goAhead) {
+            ++goAheads;
+        }
+    }
+};
+
+// The per-character loop TelnetFilter used before appending runs of plain text.
+void splitTelnetLines(const QByteArray &stream,
+                      TelnetData &buffer,
+                      std::vector<TelnetData> &que,
+                      const bool goAhead)
+{
+    const auto enqueue = [&buffer, &que](const TelnetDataEnum type) {
+        buffer.type = type;
+        que.push_back(buffer);
+        buffer.line.clear();
+        buffer.type = TelnetDataEnum::UNKNOWN;
+    };
+
+    for (const char c : stream) {
+        switch (c) {
+        case '\x08':
+            buffer.line.append(c);
+            enqueue(TelnetDataEnum::DELAY);
+            break;
+        case '\r':
+            buffer.line.append(c);
+            break;
+        case '\n':
+            if (!buffer.line.isEmpty() && buffer.line.back() == '\r') {
+                buffer.line.append(c);
+                enqueue(TelnetDataEnum::CRLF);
+            } else {
+                buffer.line.append(c);
+            }
+            break;
+        default:
+            if (!buffer.line.isEmpty() && buffer.line.back() == '\n') {
+                enqueue(TelnetDataEnum::LF);
+            }
+            buffer.line.append(c);
+            break;
+        }
+    }
+
+    if (!buffer.line.isEmpty() && (goAhead || buffer.type == TelnetDataEnum::UNKNOWN)) {
+        if (goAhead) {
+            enqueue(TelnetDataEnum::PROMPT);
+        } else if (buffer.line.endsWith('\n')) {
+            enqueue(TelnetDataEnum::LF);
+        }
+    }
+}
+
+// What the per-character loop of MumeXmlParser sent to the user for text and tags
+// that don't change its mode, with removeXmlTags off: tags are passed through,
+// empty tags are dropped, and '>' in the text is escaped.
+QByteArray passXmlThrough(const QByteArray &input)
+{
+    QByteArray result;
+    QByteArray tag;
+    bool readingTag = false;
+    for (const char c : input) {
+        if (readingTag) {
+            if (c == '>') {
+                if (!tag.isEmpty()) {
+                    result.append('<').append(tag).append('>');
+                }
+                tag.clear();
+                readingTag = false;
+            } else {
+                tag.append(c);
+            }
+        } else if (c == '<') {
+            readingTag = true;
+        } else if (c == '>') {
+            result.append("&gt;");
+        } else {
+            result.append(c);
+        }
+    }
+    return result;
+}
+
+// Random pieces from a small alphabet, so that runs, delimiters and chunk
+// boundaries fall next to each other in every possible order.
+QByteArray makeRandomInput(std::mt19937 &rng,
+                           const std::vector<QByteArray> &alphabet,
+                           const int length)
+{
+    std::uniform_int_distribution<size_t> pick{0, alphabet.size() - 1};
+    QByteArray result;
+    for (int i = 0; i < length; ++i) {
+        result.append(alphabet[pick(rng)]);
+    }
+    return result;
+}
+
+std::vector<QByteArray> splitRandomly(std::mt19937 &rng, const QByteArray &input)
+{
+    std::uniform_int_distribution<int> pieceSize{1, 16};
+    std::vector<QByteArray> pieces;
+    for (int pos = 0; pos < input.size();) {
+        const int size = std::min(pieceSize(rng), input.size() - pos);
+        pieces.emplace_back(input.mid(pos, size));
+        pos += size;
+    }
+    return pieces;
+}
+
+} // namespace
+
+void TestTelnet::initTestCase()
+{
+    // don't read or overwrite the user's settings
+    QStandardPaths::setTestModeEnabled(true);
+    setEnteredMain();
+}
+
+void TestTelnet::plaintextTest()
+{
+    const QByteArray session = makeSession();
+    const QByteArray expected = removeTelnetCommands(session);
+
+    // All at once, and in random pieces that split IAC sequences between reads.
+    TestTelnetClient whole;
+    whole.receive(session);
+    QCOMPARE(whole.received, expected);
+    QCOMPARE(whole.goAheads, 2000);
+
+    std::mt19937 rng{1};
+    std::uniform_int_distribution<int> pieceSize{1, 300};
+    TestTelnetClient pieces;
+    for (int pos = 0; pos < session.size();) {
+        const int size = std::min(pieceSize(rng), session.size() - pos);
+        pieces.receive(session.mid(pos, size));
+        pos += size;
+    }
+    QCOMPARE(pieces.received, expected);
+    QCOMPARE(pieces.goAheads, 2000);
+}
+
+void TestTelnet::plaintextBenchmark()
+{
+    const QByteArray session = makeSession();
+    QBENCHMARK {
+        TestTelnetClient client;
+        client.receive(session);
+        QCOMPARE(client.goAheads, 2000);
+    }
+}
+
+void TestTelnet::telnetFilterTest()
+{
+    const std::vector<QByteArray> alphabet{"a", "bc", " ", "\r", "\n", "\x08"};
+    std::mt19937 rng{2};
+    std::bernoulli_distribution goAhead{0.2};
+
+    for (int round = 0; round < 200; ++round) {
+        const QByteArray input = makeRandomInput(rng, alphabet, 64);
+
+        std::vector<TelnetData> actual;
+        std::vector<TelnetData> expected;
+        TelnetData buffer;
+        TelnetFilter filter{nullptr};
+        QObject::connect(&filter,
+                         &TelnetFilter::sig_parseNewMudInput,
+                         [&actual](const TelnetData &data) { actual.push_back(data); });
+
+        for (const QByteArray &piece : splitRandomly(rng, input)) {
+            const bool ga = goAhead(rng);
+            filter.slot_onAnalyzeMudStream(piece, ga);
+            splitTelnetLines(piece, buffer, expected, ga);
+        }
+
+        QCOMPARE(actual.size(), expected.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            QCOMPARE(actual[i].line, expected[i].line);
+            QCOMPARE(actual[i].type, expected[i].type);
+        }
+    }
+}
+
+void TestTelnet::xmlParserTest()
+{
+    setConfig().parser.removeXmlTags = false;
+
+    // Unknown tags and plain text leave the parser in its default mode,
+    // so everything it reads is passed on to the user.
+    const std::vector<QByteArray> alphabet{"The",
+                                           " path",
+                                           ".",
+                                           ">",
+                                           "\r\n",
+                                           "<magic>",
+                                           "</magic>",
+                                           "<tell from=\"Gandalf\">",
+                                           "</tell>",
+                                           "<>",
+                                           "<",
+                                           "<hr/>"};
+    std::mt19937 rng{3};
+
+    for (int round = 0; round < 200; ++round) {
+        const QByteArray input = makeRandomInput(rng, alphabet, 64);
+
+        MapData mapData{nullptr};
+        GameObserver observer;
+        MumeClock clock{observer};
+        CTimers timers{nullptr};
+        MumeXmlParser parser{mapData,
+                             clock,
+                             ProxyParserApi{WeakHandle<Proxy>{}},
+                             GroupManagerApi{WeakHandle<Mmapper2Group>{}},
+                             timers,
+                             nullptr};
+        QByteArray actual;
+        QObject::connect(&parser,
+                         &AbstractParser::sig_sendToUser,
+                         [&actual](const QByteArray &data, bool /*goAhead*/) {
+                             actual.append(data);
+                         });
+
+        for (const QByteArray &piece : splitRandomly(rng, input)) {
+            TelnetData data;
+            data.line = piece;
+            data.type = TelnetDataEnum::LF;
+            parser.slot_parseNewMudInput(data);
+        }
+
+        QCOMPARE(actual, passXmlThrough(input));
+    }
+}
+
+QTEST_MAIN(TestTelnet)
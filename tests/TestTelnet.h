@@ -0,0 +1,20 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2023 The MMapper Authors
+
+#include <QObject>
+
+class TestTelnet final : public QObject
+{
+    Q_OBJECT
+public:
+    TestTelnet() = default;
+    ~TestTelnet() override = default;
+
+private Q_SLOTS:
+    void initTestCase();
+    void plaintextTest();
+    void plaintextBenchmark();
+    void telnetFilterTest();
+    void xmlParserTest();
+};
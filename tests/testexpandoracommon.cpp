@@ -3,12 +3,18 @@
 
 #include "testexpandoracommon.h"
 
+#include <cstddef>
+#include <cstring>
 #include <QtTest/QtTest>
 
 #include "../src/expandoracommon/RoomAdmin.h"
 #include "../src/expandoracommon/parseevent.h"
 #include "../src/expandoracommon/property.h"
 #include "../src/expandoracommon/room.h"
+#include "../src/global/PoolAllocator.h"
+#include "../src/mapdata/DoorFlags.h"
+#include "../src/mapdata/ExitFlags.h"
+#include "../src/mapstorage/FlatMapFormat.h"
 
 TestExpandoraCommon::TestExpandoraCommon() = default;
 
@@ -447,4 +453,229 @@ void TestExpandoraCommon::roomCompareTest()
     QCOMPARE(result, comparison);
 }
 
+void TestExpandoraCommon::roomArenaTest()
+{
+    TestRoomAdmin admin;
+    SharedRoom first = Room::createPermanentRoom(admin);
+    const Room *const firstAddress = first.get();
+    first.reset();
+
+    // A released block is the next one handed out.
+    SharedRoom second = Room::createPermanentRoom(admin);
+    QCOMPARE(second.get(), firstAddress);
+
+    SharedRoom copy = second->clone(admin);
+    QVERIFY(copy != nullptr);
+    QVERIFY(copy.get() != second.get());
+    QVERIFY(copy->isTemporary());
+}
+
+void TestExpandoraCommon::roomScanBenchmark_data()
+{
+    QTest::addColumn<bool>("pooled");
+    QTest::newRow("make_shared (before)") << false;
+    QTest::newRow("pool") << true;
+}
+
+void TestExpandoraCommon::roomScanBenchmark()
+{
+    QFETCH(bool, pooled);
+    static constexpr const int NUM_ROOMS = 30000;
+
+    TestRoomAdmin admin;
+    // Allocated the way rooms were before they were pooled.
+    const auto createUnpooledRoom = [&admin]() {
+        return std::make_shared<Room>(Room::this_is_private{0}, admin, RoomStatusEnum::Permanent);
+    };
+
+    const size_t reservedBefore = pool_allocator::getTotalReservedBytes();
+    std::vector<SharedRoom> rooms;
+    rooms.reserve(NUM_ROOMS);
+    for (int i = 0; i < NUM_ROOMS; ++i) {
+        SharedRoom room = pooled ? Room::createPermanentRoom(admin) : createUnpooledRoom();
+        room->setPosition(Coordinate{i % 200, i / 200, 0});
+        room->setTerrainType(
+            static_cast<RoomTerrainEnum>(static_cast<size_t>(i) % NUM_ROOM_TERRAIN_TYPES));
+        // Loading a map interleaves each room with the allocations of its strings,
+        // which is what scatters heap-allocated rooms.
+        room->setName(RoomName{"The Great East Road, somewhere in " + std::to_string(i)});
+        room->setDescription(RoomDesc{std::string(80u + static_cast<size_t>(i % 7), 'x')});
+        rooms.emplace_back(std::move(room));
+    }
+
+    if (pooled) {
+        qInfo() << "room pool reserved"
+                << (pool_allocator::getTotalReservedBytes() - reservedBefore) << "bytes for"
+                << NUM_ROOMS << "rooms";
+    }
+
+    int64_t sum = 0;
+    QBENCHMARK {
+        for (const SharedRoom &room : rooms) {
+            if (room->getTerrainType() != RoomTerrainEnum::UNDEFINED) {
+                sum += room->getPosition().x;
+            }
+        }
+    }
+    QVERIFY(sum > 0);
+}
+
+NODISCARD static std::vector<SharedRoom> createTestMap(RoomAdmin &admin, const uint32_t numRooms)
+{
+    static const char *const descriptions[] = {
+        "A narrow trail winds between the trees.",
+        "The road continues east and west across the plains.",
+        "Moss covers the stone walls of this damp tunnel.",
+    };
+
+    std::vector<SharedRoom> rooms;
+    rooms.reserve(numRooms);
+    for (uint32_t i = 0; i < numRooms; ++i) {
+        SharedRoom room = Room::createPermanentRoom(admin);
+        room->setId(RoomId{i});
+        room->setName(RoomName{"Room " + std::to_string(i)});
+        room->setDescription(RoomDesc{descriptions[i % 3]});
+        room->setNote(RoomNote{(i % 7 == 0) ? "note" : ""});
+        room->setTerrainType(static_cast<RoomTerrainEnum>(i % NUM_ROOM_TERRAIN_TYPES));
+        room->setRidableType(RoomRidableEnum::RIDABLE);
+        room->setMobFlags(RoomMobFlags{RoomMobFlagEnum::RENT});
+        room->setPosition(Coordinate{static_cast<int>(i % 200), static_cast<int>(i / 200), 0});
+        if (i % 2 == 0) {
+            room->setUpToDate();
+        }
+
+        ExitsList exits;
+        Exit &east = exits[ExitDirEnum::EAST];
+        east.setExitFlags(ExitFlags{ExitFlagEnum::EXIT} | ExitFlagEnum::DOOR);
+        east.setDoorFlags(DoorFlags{DoorFlagEnum::HIDDEN});
+        east.setDoorName(DoorName{"gate"});
+        east.addOut(RoomId{(i + 1) % numRooms});
+        east.addIn(RoomId{(i + 1) % numRooms});
+        exits[ExitDirEnum::WEST].addOut(RoomId{(i + numRooms - 1) % numRooms});
+        room->setExitsList(exits);
+        rooms.emplace_back(std::move(room));
+    }
+    return rooms;
+}
+
+void TestExpandoraCommon::flatMapRoundTripTest()
+{
+    TestRoomAdmin admin;
+    const auto rooms = createTestMap(admin, 100);
+
+    flatmap::FlatMapWriter writer;
+    writer.setPosition(Coordinate{1, 2, 3});
+    for (const SharedRoom &room : rooms) {
+        writer.addRoom(*room);
+    }
+    flatmap::MarkRecord mark;
+    mark.text = "Bree";
+    mark.type = 0;
+    mark.clazz = 2;
+    mark.rotationAngle = 45;
+    mark.position1 = Coordinate{100, 200, 0};
+    mark.position2 = Coordinate{300, 400, 0};
+    writer.addMark(mark);
+    const QByteArray data = writer.finish();
+
+    const flatmap::FlatMapReader reader{data.constData(), static_cast<size_t>(data.size())};
+    QCOMPARE(reader.getRoomsCount(), 100u);
+    QCOMPARE(reader.getMarksCount(), 1u);
+    QCOMPARE(reader.getPosition(), (Coordinate{1, 2, 3}));
+
+    for (uint32_t i = 0; i < reader.getRoomsCount(); ++i) {
+        const Room &expected = *rooms[i];
+        const SharedRoom actual = reader.createRoom(admin, i, 0u, Coordinate{});
+        QCOMPARE(actual->getId(), expected.getId());
+        QCOMPARE(actual->getName(), expected.getName());
+        QCOMPARE(actual->getDescription(), expected.getDescription());
+        QCOMPARE(actual->getContents(), expected.getContents());
+        QCOMPARE(actual->getNote(), expected.getNote());
+        QCOMPARE(actual->getTerrainType(), expected.getTerrainType());
+        QCOMPARE(actual->getRidableType(), expected.getRidableType());
+        QCOMPARE(actual->getMobFlags(), expected.getMobFlags());
+        QCOMPARE(actual->getLoadFlags(), expected.getLoadFlags());
+        QCOMPARE(actual->getPosition(), expected.getPosition());
+        QCOMPARE(actual->isUpToDate(), expected.isUpToDate());
+        QVERIFY(actual->getExitsList() == expected.getExitsList());
+    }
+
+    const flatmap::MarkRecord readMark = reader.getMark(0);
+    QCOMPARE(readMark.text, mark.text);
+    QCOMPARE(readMark.clazz, mark.clazz);
+    QCOMPARE(readMark.rotationAngle, mark.rotationAngle);
+    QCOMPARE(readMark.position1, mark.position1);
+    QCOMPARE(readMark.position2, mark.position2);
+
+    // Merging offsets the ids and positions.
+    const SharedRoom merged = reader.createRoom(admin, 5, 1000u, Coordinate{0, 0, -1});
+    QCOMPARE(merged->getId(), RoomId{1005});
+    QCOMPARE(merged->getPosition(), (rooms[5]->getPosition() + Coordinate{0, 0, -1}));
+    QVERIFY(merged->exit(ExitDirEnum::EAST).containsOut(RoomId{1006}));
+
+    // Truncated or foreign data is rejected instead of being read out of bounds.
+    bool threw = false;
+    try {
+        const auto half = static_cast<size_t>(data.size() / 2);
+        const flatmap::FlatMapReader truncated{data.constData(), half};
+    } catch (const std::exception &) {
+        threw = true;
+    }
+    QVERIFY(threw);
+    threw = false;
+    try {
+        const QByteArray garbage(256, 'x');
+        const auto size = static_cast<size_t>(garbage.size());
+        const flatmap::FlatMapReader foreign{garbage.constData(), size};
+    } catch (const std::exception &) {
+        threw = true;
+    }
+    QVERIFY(threw);
+}
+
+void TestExpandoraCommon::flatMapCorruptEnumTest()
+{
+    TestRoomAdmin admin;
+    flatmap::FlatMapWriter writer;
+    for (const SharedRoom &room : createTestMap(admin, 2)) {
+        writer.addRoom(*room);
+    }
+    const QByteArray data = writer.finish();
+
+    flatmap::FileHeader header;
+    std::memcpy(&header, data.constData(), sizeof(header));
+    const auto roomAt = static_cast<int>(header.roomsOffset);
+    const auto exitAt = static_cast<int>(header.exitsOffset);
+
+    const auto rejects = [&admin](const QByteArray &corrupt) -> bool {
+        const auto size = static_cast<size_t>(corrupt.size());
+        const flatmap::FlatMapReader reader{corrupt.constData(), size};
+        try {
+            MAYBE_UNUSED const auto ignored = reader.createRoom(admin, 0, 0u, Coordinate{});
+        } catch (const std::exception &) {
+            return true;
+        }
+        return false;
+    };
+
+    QVERIFY(!rejects(data));
+
+    QByteArray badTerrain = data;
+    badTerrain[roomAt + static_cast<int>(offsetof(flatmap::RoomEntry, terrain))]
+        = static_cast<char>(NUM_ROOM_TERRAIN_TYPES);
+    QVERIFY(rejects(badTerrain));
+
+    QByteArray badSundeath = data;
+    badSundeath[roomAt + static_cast<int>(offsetof(flatmap::RoomEntry, sundeath))] = '\x7f';
+    QVERIFY(rejects(badSundeath));
+
+    QByteArray badLoadFlags = data;
+    badLoadFlags[roomAt + static_cast<int>(offsetof(flatmap::RoomEntry, loadFlags)) + 3] = '\x80';
+    QVERIFY(rejects(badLoadFlags));
+
+    QByteArray badExitFlags = data;
+    badExitFlags[exitAt + static_cast<int>(offsetof(flatmap::ExitEntry, exitFlags)) + 1] = '\xff';
+    QVERIFY(rejects(badExitFlags));
+}
+
 QTEST_MAIN(TestExpandoraCommon)
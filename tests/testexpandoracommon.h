@@ -25,4 +25,9 @@ private Q_SLOTS:
     void stringPropertyTest();
     void roomCompareTest_data();
     void roomCompareTest();
+    void roomArenaTest();
+    void roomScanBenchmark_data();
+    void roomScanBenchmark();
+    void flatMapRoundTripTest();
+    void flatMapCorruptEnumTest();
 };
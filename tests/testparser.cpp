@@ -4,6 +4,9 @@
 #include "testparser.h"
 
 #include <memory>
+#include <string_view>
+#include <utility>
+#include <vector>
 #include <QDebug>
 #include <QString>
 #include <QtTest/QtTest>
@@ -11,7 +14,11 @@
 #include "../src/expandoracommon/parseevent.h"
 #include "../src/expandoracommon/property.h"
 #include "../src/global/TextUtils.h"
+#include "../src/global/StringView.h"
 #include "../src/mapdata/mmapper2room.h"
+#include "../src/parser/Action.h"
+#include "../src/parser/PatternSet.h"
+#include "../src/parser/XmlTag.h"
 #include "../src/parser/parserutils.h"
 
 TestParser::TestParser() = default;
@@ -72,4 +79,240 @@ void TestParser::createParseEventTest()
              ::toQStringLatin1(std::string(1, static_cast<char>(terrain))));
 }
 
+void TestParser::actionMatcherTest()
+{
+    QCOMPARE(ActionMatcher::getLiteralPrefix("^You are"), std::string("You are"));
+    QCOMPARE(ActionMatcher::getLiteralPrefix("^- a (deep|small) wound"), std::string("- a "));
+    QCOMPARE(ActionMatcher::getLiteralPrefix("^hits?"), std::string("hit"));
+    QCOMPARE(ActionMatcher::getLiteralPrefix("^\\d+"), std::string());
+    QCOMPARE(ActionMatcher::getLiteralPrefix("^abc|def"), std::string());
+    QCOMPARE(ActionMatcher::getLiteralPrefix("abc"), std::string());
+
+    std::vector<int> calls;
+    const auto record = [&calls](const int id) {
+        return [&calls, id](StringView /*view*/) { calls.emplace_back(id); };
+    };
+
+    ActionMatcher matcher;
+    matcher.addStartsWith("You are", record(0));
+    matcher.addEndsWith("hits you.", record(1));
+    matcher.addRegex(R"(^ZBLAM! .* doesn't want you riding (him|her|it) anymore.$)", record(2));
+    matcher.addRegex(R"(^(You have )?\d+/\d+ hits? and \d+/\d+ moves.$)", record(3), " move");
+    matcher.addRegex(R"(^You are trapped by some (black )?roots.$)", record(4));
+    matcher.addStartsWith("You", record(5));
+
+    const auto run = [&matcher, &calls](const std::string &line) {
+        calls.clear();
+        matcher.match(StringView{line});
+        return calls;
+    };
+
+    QVERIFY(run("You are trapped by some roots.") == (std::vector<int>{0, 4, 5}));
+    QVERIFY(run("An orc hits you.") == (std::vector<int>{1}));
+    QVERIFY(run("ZBLAM! A pony doesn't want you riding him anymore.") == (std::vector<int>{2}));
+    QVERIFY(run("You have 10/20 hits and 5/80 moves.") == (std::vector<int>{3, 5}));
+    QVERIFY(run("10/20 hits and 5/80 moves.") == (std::vector<int>{3}));
+    QVERIFY(run("The orc hits you hard.").empty());
+    QVERIFY(run("").empty());
+
+    matcher.clear();
+    QVERIFY(run("You are trapped by some roots.").empty());
+}
+
+void TestParser::actionMatcherBenchmark()
+{
+    ActionMatcher matcher;
+    int calls = 0;
+    const auto count = [&calls](StringView /*view*/) { ++calls; };
+    for (int i = 0; i < 50; ++i) {
+        matcher.addStartsWith("Starts with action " + std::to_string(i), count);
+        matcher.addEndsWith(" ends with action " + std::to_string(i) + ".", count);
+        matcher.addRegex("^Regex action " + std::to_string(i) + " (hits|misses) (you|him)\\.$",
+                         count);
+    }
+
+    // typical combat spam, none of which triggers an action
+    const std::vector<std::string> lines{"An orc hits you hard.",
+                                         "You slash an orc extremely hard.",
+                                         "An orc tries to pierce you, but you parry.",
+                                         "Your opponent is in excellent condition.",
+                                         "You feel a little better."};
+    QBENCHMARK {
+        for (int i = 0; i < 200; ++i) {
+            for (const std::string &line : lines) {
+                matcher.match(StringView{line});
+            }
+        }
+    }
+    QCOMPARE(calls, 0);
+}
+
+void TestParser::patternSetTest()
+{
+    const PatternSet empty;
+    QVERIFY(empty.isEmpty());
+    QVERIFY(!empty.matches("It is pitch black..."));
+
+    const PatternSet set{QStringList{"#=It is pitch black...",
+                                     "#<You just see",
+                                     "#>around you.",
+                                     "#?blinded",
+                                     "#!^A (large|small) fog",
+                                     "#![0-9]+ exits",
+                                     "#!(unterminated",
+                                     "not a pattern",
+                                     "#"}};
+    QVERIFY(!set.isEmpty());
+
+    // literal kinds only match in their position
+    QVERIFY(set.matches("It is pitch black..."));
+    QVERIFY(!set.matches("It is pitch black... again"));
+    QVERIFY(set.matches("You just see a dense fog around you..."));
+    QVERIFY(!set.matches("Now You just see"));
+    QVERIFY(set.matches("The mist swirls around you."));
+    QVERIFY(!set.matches("around you. The mist swirls"));
+    QVERIFY(set.matches("You have been blinded!"));
+
+    // regexes
+    QVERIFY(set.matches("A small fog rolls in."));
+    QVERIFY(!set.matches("Not a small fog."));
+    QVERIFY(set.matches("There are 3 exits."));
+    QVERIFY(!set.matches("(unterminated"));
+    QVERIFY(!set.matches("not a pattern"));
+    QVERIFY(!set.matches(""));
+
+    // overlapping literals go through the fail links
+    const PatternSet overlap{QStringList{"#?abcd", "#?bc", "#>cde", "#=e"}};
+    QVERIFY(overlap.matches("xbcx"));
+    QVERIFY(overlap.matches("abce"));
+    QVERIFY(overlap.matches("abcde"));
+    QVERIFY(overlap.matches("e"));
+    QVERIFY(!overlap.matches("abdcd"));
+    QVERIFY(!overlap.matches("ee"));
+
+    // empty literals
+    QVERIFY(PatternSet{QStringList{"#?"}}.matches("anything"));
+    QVERIFY(PatternSet{QStringList{"#="}}.matches(""));
+    QVERIFY(!PatternSet{QStringList{"#="}}.matches("x"));
+
+    // back references keep their own group numbers
+    const PatternSet backref{QStringList{"#!(a)b", "#!(x)\\1"}};
+    QVERIFY(backref.matches("xx"));
+    QVERIFY(!backref.matches("xy"));
+}
+
+void TestParser::patternSetBenchmark()
+{
+    QStringList patterns;
+    for (int i = 0; i < 25; ++i) {
+        patterns.append(QString("#?literal pattern number %1").arg(i));
+        patterns.append(QString("#!^regex pattern [0-9]+ of %1$").arg(i));
+    }
+    const PatternSet set{patterns};
+
+    const QString line = "The quays run along the shore of the bay, where the white ships lie.";
+    int matches = 0;
+    QBENCHMARK {
+        for (int i = 0; i < 1000; ++i) {
+            if (set.matches(line)) {
+                ++matches;
+            }
+        }
+    }
+    QCOMPARE(matches, 0);
+}
+
+void TestParser::xmlTagTest()
+{
+    {
+        const XmlTag tag{"room terrain=\"field\""};
+        QCOMPARE(tag.getId(), XmlTagEnum::ROOM);
+        QVERIFY(tag.isOpening(XmlTagEnum::ROOM));
+        QVERIFY(tag.hasAttributes());
+        QVERIFY(std::distance(tag.begin(), tag.end()) == 1);
+        QVERIFY(tag.begin()->key == "terrain");
+        QVERIFY(tag.begin()->value == "field");
+    }
+    {
+        const XmlTag tag{"/room"};
+        QVERIFY(tag.isClosing(XmlTagEnum::ROOM));
+        QVERIFY(!tag.hasAttributes());
+    }
+    {
+        // self-closing, with single quotes and an unquoted value
+        const XmlTag tag{"movement dir=north/"};
+        QVERIFY(tag.isOpening(XmlTagEnum::MOVEMENT));
+        QVERIFY(tag.begin()->key == "dir");
+        QVERIFY(tag.begin()->value == "north");
+
+        const XmlTag empty{"movement/"};
+        QVERIFY(empty.isOpening(XmlTagEnum::MOVEMENT));
+        QVERIFY(!empty.hasAttributes());
+
+        const XmlTag quoted{"snoop by='Gandalf' extra = \"a b\""};
+        QCOMPARE(quoted.getId(), XmlTagEnum::SNOOP);
+        QVERIFY(std::distance(quoted.begin(), quoted.end()) == 2);
+        QVERIFY(quoted.begin()[0].value == "Gandalf");
+        QVERIFY(quoted.begin()[1].key == "extra");
+        QVERIFY(quoted.begin()[1].value == "a b");
+    }
+    {
+        // only whole names match
+        QCOMPARE(XmlTag{"rooms"}.getId(), XmlTagEnum::UNKNOWN);
+        QCOMPARE(XmlTag{"roo"}.getId(), XmlTagEnum::UNKNOWN);
+        QCOMPARE(XmlTag{""}.getId(), XmlTagEnum::UNKNOWN);
+        QVERIFY(XmlTag{"/"}.isClosing());
+        QVERIFY(XmlTag{"unterminated key=\"value"}.begin()->value == "value");
+    }
+    for (const auto &[name, id] : std::vector<std::pair<std::string_view, XmlTagEnum>>{
+             {"character", XmlTagEnum::CHARACTER},
+             {"description", XmlTagEnum::DESCRIPTION},
+             {"exits", XmlTagEnum::EXITS},
+             {"gratuitous", XmlTagEnum::GRATUITOUS},
+             {"header", XmlTagEnum::HEADER},
+             {"movement", XmlTagEnum::MOVEMENT},
+             {"name", XmlTagEnum::NAME},
+             {"prompt", XmlTagEnum::PROMPT},
+             {"room", XmlTagEnum::ROOM},
+             {"snoop", XmlTagEnum::SNOOP},
+             {"status", XmlTagEnum::STATUS},
+             {"terrain", XmlTagEnum::TERRAIN},
+             {"weather", XmlTagEnum::WEATHER},
+             {"xml", XmlTagEnum::XML}}) {
+        QCOMPARE(lookupXmlTag(name), id);
+    }
+}
+
+void TestParser::xmlTagBenchmark()
+{
+    // The tags MUME sends for a single move in XML mode.
+    const std::vector<std::string_view> move{"movement dir=north/",
+                                             "room terrain=\"forest\"",
+                                             "name",
+                                             "/name",
+                                             "gratuitous",
+                                             "description",
+                                             "/description",
+                                             "/gratuitous",
+                                             "exits",
+                                             "/exits",
+                                             "/room",
+                                             "prompt",
+                                             "/prompt",
+                                             "status",
+                                             "/status"};
+    size_t rooms = 0;
+    QBENCHMARK {
+        for (int i = 0; i < 1000; ++i) {
+            for (const std::string_view text : move) {
+                const XmlTag tag{text};
+                if (tag.isOpening(XmlTagEnum::ROOM) && tag.hasAttributes()) {
+                    ++rooms;
+                }
+            }
+        }
+    }
+    QVERIFY(rooms > 0);
+}
+
 QTEST_MAIN(TestParser)
@@ -17,4 +17,16 @@ private Q_SLOTS:
     void removeAnsiMarksTest();
     void latinToAsciiTest();
     void createParseEventTest();
+
+    // ActionMatcher
+    void actionMatcherTest();
+    void actionMatcherBenchmark();
+
+    // PatternSet
+    void patternSetTest();
+    void patternSetBenchmark();
+
+    // XmlTag
+    void xmlTagTest();
+    void xmlTagBenchmark();
 };